@@ -0,0 +1,105 @@
+/**
+ * Copyright (C) 2019 Analog Devices, Inc.
+ *
+ * Licensed under the GPL-2.
+ *
+ **/
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef __MINGW32__
+#include <sys/mman.h>
+#endif
+
+#include "arena.h"
+
+/* Slabs at least this big are aligned so they can be backed by huge pages */
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+static void * slab_alloc(size_t size, size_t align)
+{
+	void *ptr;
+
+#ifdef __MINGW32__
+	ptr = __mingw_aligned_malloc(size, align);
+#else
+	if (posix_memalign(&ptr, align, size))
+		return NULL;
+#ifdef MADV_HUGEPAGE
+	if (align == HUGE_PAGE_SIZE)
+		madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+#endif
+	return ptr;
+}
+
+static void slab_free(void *ptr)
+{
+#ifdef __MINGW32__
+	__mingw_aligned_free(ptr);
+#else
+	free(ptr);
+#endif
+}
+
+/* Make room for 'size' bytes. The arena is rewound; if the slab has to grow,
+ * every pointer handed out before is invalidated. */
+int osc_arena_reserve(struct osc_arena *arena, size_t size)
+{
+	size_t align = OSC_ARENA_ALIGN;
+	void *base;
+
+	arena->used = 0;
+	if (size <= arena->size)
+		return 0;
+
+	if (size >= HUGE_PAGE_SIZE) {
+		align = HUGE_PAGE_SIZE;
+		size = (size + HUGE_PAGE_SIZE - 1) & ~((size_t) HUGE_PAGE_SIZE - 1);
+	} else {
+		size = OSC_ARENA_ROUND(size);
+	}
+
+	base = slab_alloc(size, align);
+	if (!base)
+		return -ENOMEM;
+
+	slab_free(arena->base);
+	arena->base = base;
+	arena->size = size;
+	return 0;
+}
+
+void * osc_arena_alloc(struct osc_arena *arena, size_t size)
+{
+	void *ptr;
+
+	size = OSC_ARENA_ROUND(size);
+	if (!arena->base || size > arena->size - arena->used)
+		return NULL;
+
+	ptr = (char *) arena->base + arena->used;
+	arena->used += size;
+	return ptr;
+}
+
+bool osc_arena_owns(const struct osc_arena *arena, const void *ptr)
+{
+	uintptr_t p = (uintptr_t) ptr, base = (uintptr_t) arena->base;
+
+	return arena->base && p >= base && p < base + arena->size;
+}
+
+void osc_arena_reset(struct osc_arena *arena)
+{
+	arena->used = 0;
+}
+
+void osc_arena_release(struct osc_arena *arena)
+{
+	slab_free(arena->base);
+	arena->base = NULL;
+	arena->size = 0;
+	arena->used = 0;
+}
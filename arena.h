@@ -0,0 +1,37 @@
+/**
+ * Copyright (C) 2019 Analog Devices, Inc.
+ *
+ * Licensed under the GPL-2.
+ *
+ **/
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Bump allocator for buffers that share a lifetime (the channel buffers of
+ * a device, the work buffers of a transform). Everything is carved out of a
+ * single slab and released at once; a reset only rewinds the slab, so once
+ * it is big enough reconfiguring does not touch the heap anymore.
+ */
+
+#define OSC_ARENA_ALIGN 64
+#define OSC_ARENA_ROUND(size) \
+	(((size) + OSC_ARENA_ALIGN - 1) & ~((size_t) OSC_ARENA_ALIGN - 1))
+
+struct osc_arena {
+	void *base;
+	size_t size;
+	size_t used;
+};
+
+int osc_arena_reserve(struct osc_arena *arena, size_t size);
+void * osc_arena_alloc(struct osc_arena *arena, size_t size);
+bool osc_arena_owns(const struct osc_arena *arena, const void *ptr);
+void osc_arena_reset(struct osc_arena *arena);
+void osc_arena_release(struct osc_arena *arena);
+
+#endif /* __ARENA_H__ */
@@ -16,6 +16,8 @@
 
 #include <iio.h>
 
+#include "arena.h"
+
 #define FORCE_UPDATE TRUE
 #define NORMAL_UPDATE FALSE
 
@@ -37,12 +39,18 @@ enum {
 	COMPLEX_FFT_TRANSFORM,
 	CROSS_CORRELATION_TRANSFORM,
 	FREQ_SPECTRUM_TRANSFORM,
+	WATERFALL_TRANSFORM,
+	ZOOM_FFT_TRANSFORM,
+	FIR_PREVIEW_TRANSFORM,
+	HISTOGRAM_TRANSFORM,
 	TRANSFORMS_TYPES_COUNT
 };
 
 typedef struct _transform Transform;
 typedef struct _tr_list TrList;
 
+struct code_histogram;
+
 struct extra_info {
 	struct iio_device *dev;
 	gfloat *data_ref;
@@ -50,6 +58,33 @@ struct extra_info {
 	int shadow_of_enabled;
 	bool may_be_enabled;
 	double lo_freq;
+	double gain;				/* dB, NAN when no plugin set it */
+	struct code_histogram *histogram;	/* raw codes, while plotted */
+	unsigned int histogram_users;
+	int32_t *codes;				/* raw codes of the last frame */
+	unsigned int codes_len;
+};
+
+/*
+ * Timing and device state of the last frame captured from a device. Times
+ * are g_get_monotonic_time() values, so frames of different devices can be
+ * put on the same time line. Dropped samples are estimated from the time
+ * between the ends of two refills and the sampling frequency; a frame
+ * that comes out of a new buffer doesn't count any.
+ */
+struct capture_frame {
+	uint64_t sequence;		/* frames since the capture started */
+	int64_t refill_start;		/* us */
+	int64_t refill_end;		/* us */
+	int64_t hw_timestamp;		/* ns, first sample of the "timestamp"
+					   channel, 0 if it isn't enabled */
+	uint64_t first_sample;		/* since the start, drops included */
+	unsigned int nb_samples;
+	uint64_t dropped;		/* since the previous frame */
+	uint64_t total_dropped;
+	double sample_rate;		/* Hz */
+	double lo_freq;			/* Hz, of the first enabled channel */
+	double gain;			/* dB, of the first enabled channel */
 };
 
 struct extra_dev_info {
@@ -66,6 +101,9 @@ struct extra_dev_info {
 	gfloat **channels_data_copy;
 	GSList *plots_sample_counts;
 	gfloat plugin_fft_corr;
+	struct osc_arena arena;		/* backs data_ref of all channels */
+	struct capture_frame frame;
+	bool frame_continuous;		/* next refill follows the last one */
 };
 
 struct buffer {
@@ -91,6 +129,10 @@ struct _fft_alg_data{
 	int cached_fft_size;
 	int cached_num_active_channels;
 	int num_active_channels;
+	bool fixed_point;	/* use the int_fft.c engine instead of FFTW */
+	int fixed_shift;	/* bits to shift ADC codes left to get Q15 */
+	short *fix_re;
+	short *fix_im;
 };
 
 struct _transform {
@@ -139,10 +181,21 @@ struct _fft_settings {
 	enum marker_types *marker_type;
 };
 
+/* Resolution of the constellation density map, in bins per axis */
+#define CONSTELLATION_GRID 256
+
 struct _constellation_settings {
 	gfloat *x_source;
 	gfloat *y_source;
 	unsigned int num_samples;
+	bool density;
+	gfloat *hist;			/* GRID x GRID hit counts, row 0 on top */
+	gfloat persistence;		/* weight kept from previous frames */
+	gfloat range;			/* half width of the binned I/Q square */
+	unsigned int ref_order;		/* QAM order for EVM/MER, 0 disables */
+	gfloat evm;			/* percent RMS */
+	gfloat mer;			/* dB */
+	cairo_surface_t *image;
 };
 
 struct _cross_correlation_settings {
@@ -157,6 +210,16 @@ struct _cross_correlation_settings {
 	fftw_complex *signal_a;
 	fftw_complex *signal_b;
 	fftw_complex *xcorr_data;
+	fftw_complex *signal_a_ext;
+	fftw_complex *signal_b_ext;
+	fftw_complex *fft_a;
+	fftw_complex *fft_b;
+	fftw_complex *product;
+	fftw_complex *cross;
+	fftw_plan plan_a;
+	fftw_plan plan_b;
+	fftw_plan plan_cross;
+	struct osc_arena arena;		/* backs all of the above */
 	struct marker_type *markers;
 	struct marker_type **markers_copy;
 	GMutex *marker_lock;
@@ -189,6 +252,80 @@ struct _freq_spectrum_settings {
 	enum marker_types *marker_type;
 };
 
+/* Bounds of the waterfall history, independent of the FFT size */
+#define WATERFALL_ROWS 256
+#define WATERFALL_MAX_COLUMNS 1024
+/* The history keeps levels quantized in 1/8 dB steps from -256 dB, so a
+ * new color range only has to remap WATERFALL_LEVELS colors */
+#define WATERFALL_LEVEL_FLOOR -256.0f
+#define WATERFALL_LEVEL_STEPS 8
+#define WATERFALL_LEVELS 4096
+
+struct _waterfall_settings {
+	struct _fft_settings fft;	/* must be first, do_fft() works on it */
+	unsigned int rows;
+	unsigned int columns;
+	unsigned int bins_per_column;
+	unsigned int head;		/* ring position of the newest row */
+	unsigned int filled;		/* number of valid rows in the ring */
+	guint16 *history;		/* rows x columns of quantized levels */
+	gfloat *hold;			/* max-hold line, one value per column */
+	gfloat hold_decay;		/* dB per frame, 0 disables max-hold */
+	gfloat level_min;
+	gfloat level_max;
+	guint32 *colors;		/* color of each quantized level */
+	cairo_surface_t *image;		/* colorized copy of the history ring */
+};
+
+struct dsp_ddc;
+
+struct _zoom_fft_settings {
+	struct _fft_settings fft;	/* must be first, do_fft() works on it */
+	gfloat *i_source;
+	gfloat *q_source;
+	unsigned int num_samples;	/* input samples mixed per frame */
+	double center;			/* Hz, relative to the LO */
+	double span;			/* Hz */
+	struct dsp_ddc *ddc;
+	gfloat *dec_i;			/* decimated stream, out_size long */
+	gfloat *dec_q;
+	unsigned int out_size;
+};
+
+struct dsp_fir;
+struct fir_filter_file;
+
+struct _fir_preview_settings {
+	struct _fft_settings fft;	/* must be first, do_fft() works on it */
+	gfloat *i_source;
+	gfloat *q_source;		/* NULL for a single real channel */
+	unsigned int num_samples;	/* input samples filtered per frame */
+	struct fir_filter_file *filter;	/* owned by the plot */
+	struct dsp_fir *fir_i;
+	struct dsp_fir *fir_q;
+	gfloat *dec_i;			/* filtered stream, out_size long */
+	gfloat *dec_q;
+	unsigned int out_size;
+	gfloat *response;		/* filter magnitude on the x axis, dB */
+	GtkDataboxGraph *response_graph;
+};
+
+/* Index of the "Histogram" combo box of the time domain */
+enum histogram_mode {
+	HISTOGRAM_OFF,
+	HISTOGRAM_COUNTS,
+	HISTOGRAM_DNL,
+	HISTOGRAM_INL,
+};
+
+struct _histogram_settings {
+	struct iio_channel *channel;
+	struct code_histogram *hist;	/* shared by the plots of the channel */
+	enum histogram_mode mode;
+	gfloat *dnl;
+	gfloat *inl;
+};
+
 Transform* Transform_new(int tr_type);
 void Transform_destroy(Transform *tr);
 void Transform_resize_x_axis(Transform *tr, int new_size);
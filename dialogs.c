@@ -23,6 +23,7 @@
 #include "osc.h"
 #include "config.h"
 #include "phone_home.h"
+#include "instrument.h"
 
 #if defined(FRU_FILES) && !defined(__linux__)
 #undef FRU_FILES
@@ -47,6 +48,9 @@ struct _Dialogs
 	GtkWidget *latest_version;
 	GtkWidget *ver_progress_window;
 	GtkWidget *ver_progress_bar;
+	GtkWidget *pipeline_stats;
+	GtkWidget *pipeline_stats_label;
+	guint pipeline_stats_timer;
 };
 
 static Dialogs dialogs;
@@ -59,6 +63,34 @@ static Release *release;
 static gchar *usb_pids[128];
 static int active_pid = -1;
 
+/* Background USB scan, cached for USB_SCAN_TTL */
+#define USB_SCAN_TTL (5 * G_USEC_PER_SEC)
+
+struct usb_scan_entry {
+	gchar *label;
+	gchar *pid;
+};
+
+static GMutex usb_scan_lock;
+static GSList *usb_scan_cache;
+static gint64 usb_scan_time;
+static bool usb_scan_running;
+
+/* Context created ahead of time for the selected backend */
+struct warm_context {
+	gchar *uri;
+	struct iio_context *ctx;
+	bool done;
+	bool abandoned;
+};
+
+static GMutex warm_lock;
+static GCond warm_cond;
+static struct warm_context *warm;
+
+/* How long OK waits for it, libiio's own connect timeout */
+#define WARM_CONTEXT_TIMEOUT_MS 5000
+
 #ifdef FRU_FILES
 static time_t mins_since_jan_1_1996(void)
 {
@@ -307,8 +339,174 @@ static bool widget_use_parent_cursor(GtkWidget *widget)
 	return true;
 }
 
+/* Returns the URI of the backend currently selected in the connect dialog,
+ * or NULL when it can not be expressed as one (network autodetection). */
+static gchar * get_selected_uri(void)
+{
+	if (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(dialogs.connect_net))) {
+		const char *hostname = gtk_entry_get_text(GTK_ENTRY(dialogs.net_ip));
+
+		return hostname[0] ? g_strdup_printf("ip:%s", hostname) : NULL;
+	} else if (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(dialogs.connect_usb))) {
+		gchar *uri = gtk_combo_box_get_active_text(
+				GTK_COMBO_BOX(dialogs.connect_usbd));
+		gchar *uri2, *ret;
+
+		if (!uri)
+			return NULL;
+
+		/* take off the [] */
+		uri2 = strrchr(uri, '[');
+		if (!uri2 || uri2[strlen(uri2) - 1] != ']') {
+			g_free(uri);
+			return NULL;
+		}
+		ret = g_strndup(uri2 + 1, strlen(uri2) - 2);
+		g_free(uri);
+		return ret;
+	} else {
+		return g_strdup("local:");
+	}
+}
+
+/* A context is created ahead of time for the entry highlighted in the
+ * connect dialog, so that pressing OK does not have to wait for it. */
+static gpointer warm_context_thread(gpointer data)
+{
+	struct warm_context *warm = data;
+	struct iio_context *ctx = iio_create_context_from_uri(warm->uri);
+
+	g_mutex_lock(&warm_lock);
+	if (warm->abandoned) {
+		if (ctx)
+			iio_context_destroy(ctx);
+		g_free(warm->uri);
+		g_free(warm);
+	} else {
+		warm->ctx = ctx;
+		warm->done = true;
+		g_cond_broadcast(&warm_cond);
+	}
+	g_mutex_unlock(&warm_lock);
+
+	return NULL;
+}
+
+static void warm_context_drop_locked(void)
+{
+	if (!warm)
+		return;
+
+	if (warm->done) {
+		if (warm->ctx && warm->ctx != get_context_from_osc())
+			iio_context_destroy(warm->ctx);
+		g_free(warm->uri);
+		g_free(warm);
+	} else {
+		/* the thread cleans up once the connection attempt ends */
+		warm->abandoned = true;
+	}
+	warm = NULL;
+}
+
+static void warm_context_drop(void)
+{
+	g_mutex_lock(&warm_lock);
+	warm_context_drop_locked();
+	g_mutex_unlock(&warm_lock);
+}
+
+static void warm_context_start(const char *uri)
+{
+	g_mutex_lock(&warm_lock);
+	if (warm && !strcmp(warm->uri, uri)) {
+		g_mutex_unlock(&warm_lock);
+		return;
+	}
+
+	warm_context_drop_locked();
+	warm = g_new0(struct warm_context, 1);
+	warm->uri = g_strdup(uri);
+	g_thread_unref(g_thread_new("warm-context",
+				warm_context_thread, warm));
+	g_mutex_unlock(&warm_lock);
+}
+
+static void warm_context_store(const char *uri, struct iio_context *ctx)
+{
+	g_mutex_lock(&warm_lock);
+	warm_context_drop_locked();
+	warm = g_new0(struct warm_context, 1);
+	warm->uri = g_strdup(uri);
+	warm->ctx = ctx;
+	warm->done = true;
+	g_mutex_unlock(&warm_lock);
+}
+
+static struct iio_context * warm_context_take(const char *uri)
+{
+	gint64 end_time = g_get_monotonic_time() +
+		WARM_CONTEXT_TIMEOUT_MS * G_TIME_SPAN_MILLISECOND;
+	struct iio_context *ctx;
+
+	g_mutex_lock(&warm_lock);
+	if (!warm || !uri || strcmp(warm->uri, uri)) {
+		/* made for another entry, nobody is going to ask for it */
+		warm_context_drop_locked();
+		g_mutex_unlock(&warm_lock);
+		return NULL;
+	}
+
+	while (!warm->done) {
+		if (!g_cond_wait_until(&warm_cond, &warm_lock, end_time)) {
+			/* Stuck: let the thread clean up whenever it returns,
+			 * the caller makes a fresh context */
+			fprintf(stderr, "Connecting to %s timed out, retrying\n",
+					uri);
+			warm_context_drop_locked();
+			g_mutex_unlock(&warm_lock);
+			return NULL;
+		}
+	}
+
+	ctx = warm->ctx;
+	g_free(warm->uri);
+	g_free(warm);
+	warm = NULL;
+	g_mutex_unlock(&warm_lock);
+
+	return ctx;
+}
+
+static void connect_usbd_changed_cb(GtkComboBox *box, gpointer data)
+{
+	gchar *uri;
+
+	gtk_widget_set_sensitive(dialogs.ok_btn, false);
+
+	if (!gtk_widget_get_visible(dialogs.connect) ||
+			!gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(dialogs.connect_usb)))
+		return;
+
+	uri = get_selected_uri();
+	if (uri && strncmp(uri, "usb:", sizeof("usb:") - 1) == 0)
+		warm_context_start(uri);
+	g_free(uri);
+}
+
 static struct iio_context * get_context(Dialogs *data)
 {
+	struct iio_context *ctx;
+	gchar *selected = get_selected_uri();
+
+	if (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(dialogs.connect_usb)))
+		active_pid = gtk_combo_box_get_active(GTK_COMBO_BOX(dialogs.connect_usbd));
+
+	ctx = warm_context_take(selected);
+	g_free(selected);
+	if (ctx)
+		return ctx;
+
 	if (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(dialogs.connect_net))) {
 		const char *hostname = gtk_entry_get_text(GTK_ENTRY(dialogs.net_ip));
 		if (!hostname[0])
@@ -316,7 +514,6 @@ static struct iio_context * get_context(Dialogs *data)
 
 		return iio_create_network_context(hostname);
 	} else if (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(dialogs.connect_usb))) {
-		struct iio_context *ctx;
 		gchar *uri = gtk_combo_box_get_active_text(
 				GTK_COMBO_BOX(dialogs.connect_usbd));
 		gchar *uri2 = uri + strlen(uri);
@@ -333,6 +530,7 @@ static struct iio_context * get_context(Dialogs *data)
 		/* try to open, if fail & busy, it's likely we are the same */
 
 		ctx = iio_create_context_from_uri(uri2);
+		g_free(uri);
 		if (!ctx && errno == EBUSY &&
 				!strcmp("usb", iio_context_get_name(get_context_from_osc()))) {
 			return get_context_from_osc();
@@ -343,44 +541,33 @@ static struct iio_context * get_context(Dialogs *data)
 	}
 }
 
-static void refresh_usb(void)
+static void usb_scan_entry_free(struct usb_scan_entry *entry)
+{
+	g_free(entry->label);
+	g_free(entry->pid);
+	g_free(entry);
+}
+
+/* Scans the USB backend, does not touch any widget */
+static GSList * usb_scan(void)
 {
 	struct iio_scan_context *ctxs;
 	struct iio_context_info **info;
-	GtkListStore *liststore;
+	struct usb_scan_entry *entry;
+	GSList *list = NULL;
 	ssize_t ret;
-	unsigned int i = 0;
-	gint index = 0;
-	gchar *tmp, *tmp1, *pid, *buf;
-	char *current = NULL;
-
-	/* get the active setting (if there is one) */
-	if(active_pid != -1 && usb_pids[active_pid])
-		current = strdup(usb_pids[active_pid]);
-
-	for(i = 0; i < 127 ; i++) {
-		if (usb_pids[i]) {
-			free(usb_pids[i]);
-			usb_pids[i] = NULL;
-		}
-	}
+	unsigned int i;
+	gchar *tmp, *tmp1, *pid;
 
-	/* clear everything, and scan again */
-	liststore = GTK_LIST_STORE(gtk_combo_box_get_model(GTK_COMBO_BOX(dialogs.connect_usbd)));
-	gtk_list_store_clear(liststore);
-
-	i = 0;
 	ctxs = iio_create_scan_context("usb", 0);
 	if (!ctxs)
-		goto nope;
+		return NULL;
 
 	ret = iio_scan_context_get_info_list(ctxs, &info);
 	if (ret < 0)
 		goto err_free_ctxs;
-	if (!ret)
-		goto err_free_info_list;
 
-	for (i = 0; i < (size_t) ret; i++) {
+	for (i = 0; i < (size_t) ret && i < G_N_ELEMENTS(usb_pids) - 1; i++) {
 		tmp = strdup(iio_context_info_get_description(info[i]));
 		pid = strdup(iio_context_info_get_description(info[i]));
 
@@ -398,29 +585,61 @@ static void refresh_usb(void)
 						strlen(")), serial=")));
 			}
 		}
-		if (active_pid != -1 && !strcmp(pid, current)) {
-			index = i;
-		}
-		usb_pids[i]=pid;
 
 		if (!tmp1)
 			tmp1 = tmp;
-		buf = malloc(strlen(iio_context_info_get_uri(info[i])) +
-				strlen(tmp1) + 5);
-		sprintf(buf, "%s [%s]", tmp1,
+
+		entry = g_new(struct usb_scan_entry, 1);
+		entry->label = g_strdup_printf("%s [%s]", tmp1,
 				iio_context_info_get_uri(info[i]));
-		tmp1 = NULL;
+		entry->pid = g_strdup(pid);
+		list = g_slist_append(list, entry);
 
-		gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(dialogs.connect_usbd), buf);
-		free(buf);
+		free(pid);
 		free(tmp);
 	}
 
-err_free_info_list:
 	iio_context_info_list_free(info);
 err_free_ctxs:
 	iio_scan_context_destroy(ctxs);
-nope:
+	return list;
+}
+
+/* Must be called with usb_scan_lock held */
+static void usb_list_fill(GSList *list)
+{
+	GtkListStore *liststore;
+	struct usb_scan_entry *entry;
+	unsigned int i = 0;
+	gint index = 0;
+	char *current = NULL;
+
+	/* get the active setting (if there is one) */
+	if(active_pid != -1 && usb_pids[active_pid])
+		current = strdup(usb_pids[active_pid]);
+
+	for(i = 0; i < 127 ; i++) {
+		if (usb_pids[i]) {
+			free(usb_pids[i]);
+			usb_pids[i] = NULL;
+		}
+	}
+
+	/* clear everything, and fill in again */
+	liststore = GTK_LIST_STORE(gtk_combo_box_get_model(GTK_COMBO_BOX(dialogs.connect_usbd)));
+	gtk_list_store_clear(liststore);
+
+	for (i = 0; list; list = g_slist_next(list), i++) {
+		entry = list->data;
+
+		if (current && !strcmp(entry->pid, current))
+			index = i;
+		usb_pids[i] = strdup(entry->pid);
+
+		gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(dialogs.connect_usbd),
+				entry->label);
+	}
+	free(current);
 
 	if (!i) {
 		gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(dialogs.connect_usbd), "None");
@@ -436,6 +655,58 @@ nope:
 	gtk_combo_box_set_active(GTK_COMBO_BOX(dialogs.connect_usbd), index);
 }
 
+static void usb_scan_cache_update(GSList *list)
+{
+	g_slist_free_full(usb_scan_cache, (GDestroyNotify) usb_scan_entry_free);
+	usb_scan_cache = list;
+	usb_scan_time = g_get_monotonic_time();
+}
+
+/* Synchronous variant, used when the result is needed right away (profile
+ * loading). A scan younger than USB_SCAN_TTL is reused. */
+static void refresh_usb(void)
+{
+	g_mutex_lock(&usb_scan_lock);
+	if (!usb_scan_time ||
+			g_get_monotonic_time() - usb_scan_time > USB_SCAN_TTL)
+		usb_scan_cache_update(usb_scan());
+	usb_list_fill(usb_scan_cache);
+	g_mutex_unlock(&usb_scan_lock);
+}
+
+static gboolean usb_scan_done(gpointer data)
+{
+	g_mutex_lock(&usb_scan_lock);
+	usb_list_fill(usb_scan_cache);
+	usb_scan_running = false;
+	g_mutex_unlock(&usb_scan_lock);
+
+	return FALSE;
+}
+
+static gpointer usb_scan_thread(gpointer data)
+{
+	GSList *list = usb_scan();
+
+	g_mutex_lock(&usb_scan_lock);
+	usb_scan_cache_update(list);
+	g_mutex_unlock(&usb_scan_lock);
+
+	g_idle_add(usb_scan_done, NULL);
+	return NULL;
+}
+
+/* Scan in the background, the device list is refreshed once done */
+static void refresh_usb_async(void)
+{
+	g_mutex_lock(&usb_scan_lock);
+	if (!usb_scan_running) {
+		usb_scan_running = true;
+		g_thread_unref(g_thread_new("usb-scan", usb_scan_thread, NULL));
+	}
+	g_mutex_unlock(&usb_scan_lock);
+}
+
 char * usb_get_serialnumber(struct iio_context *context)
 {
 	const char *name = iio_context_get_name(context);
@@ -609,17 +880,18 @@ static bool connect_fillin(Dialogs *data)
 	gtk_text_view_set_buffer(GTK_TEXT_VIEW(data->connect_iio), buf);
 	g_object_unref(buf);
 
-	if (ctx && ctx != get_context_from_osc())
-		iio_context_destroy(ctx);
-
-	return !!ctx;
-}
+	/* Keep the context around, OK will most likely be pressed next */
+	if (ctx && ctx != get_context_from_osc()) {
+		gchar *uri = get_selected_uri();
 
-static bool hide_ok_btn()
-{
-	gtk_widget_set_sensitive(dialogs.ok_btn, false);
+		if (uri)
+			warm_context_store(uri, ctx);
+		else
+			iio_context_destroy(ctx);
+		g_free(uri);
+	}
 
-	return true;
+	return !!ctx;
 }
 
 static gint fru_connect_dialog(Dialogs *data, bool load_profile)
@@ -664,7 +936,7 @@ static gint fru_connect_dialog(Dialogs *data, bool load_profile)
 			connect_clear(NULL);
 			has_context = connect_fillin(data);
 			widget_use_parent_cursor(data->connect);
-			refresh_usb();
+			refresh_usb_async();
 			continue;
 		case GTK_RESPONSE_OK:
 			ctx = get_context(data);
@@ -684,6 +956,8 @@ static gint fru_connect_dialog(Dialogs *data, bool load_profile)
 			break;
 		}
 
+		/* OK already took it, otherwise it won't be used anymore */
+		warm_context_drop();
 		gtk_widget_hide(data->connect);
 		return ret;
 	}
@@ -711,6 +985,129 @@ G_MODULE_EXPORT void cb_show_about(GtkButton *button, Dialogs *data)
 	gtk_widget_hide(data->about);
 }
 
+/* Response codes of the pipeline statistics dialog */
+enum {
+	PIPELINE_STATS_RESET = 1,
+	PIPELINE_STATS_EXPORT_TRACE,
+	PIPELINE_STATS_EXPORT_CSV,
+};
+
+static gboolean pipeline_stats_refresh(Dialogs *data)
+{
+	struct instr_stats stats[INSTR_STAGES_COUNT];
+	GString *text;
+	gchar *markup;
+	unsigned int i;
+
+	instr_get_stats(stats);
+
+	text = g_string_new(NULL);
+	g_string_append_printf(text, "%-10s %10s %12s %10s %10s\n",
+			"stage", "count", "total (ms)", "avg (us)", "max (us)");
+	for (i = 0; i < INSTR_STAGES_COUNT; i++) {
+		double avg = stats[i].count ?
+			stats[i].total_ns / 1e3 / stats[i].count : 0.0;
+
+		g_string_append_printf(text, "%-10s %10llu %12.1f %10.1f %10.1f\n",
+				instr_stage_name(i),
+				(unsigned long long) stats[i].count,
+				stats[i].total_ns / 1e6, avg,
+				stats[i].max_ns / 1e3);
+	}
+
+	markup = g_markup_printf_escaped("<tt>%s</tt>", text->str);
+	gtk_label_set_markup(GTK_LABEL(data->pipeline_stats_label), markup);
+	g_free(markup);
+	g_string_free(text, TRUE);
+
+	return TRUE;
+}
+
+static void pipeline_stats_export(Dialogs *data, bool trace)
+{
+	GtkWidget *chooser;
+	char *filename;
+	int ret;
+
+	chooser = gtk_file_chooser_dialog_new(trace ? "Export Trace" : "Export CSV",
+			GTK_WINDOW(data->pipeline_stats),
+			GTK_FILE_CHOOSER_ACTION_SAVE,
+			GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+			GTK_STOCK_SAVE, GTK_RESPONSE_ACCEPT, NULL);
+	gtk_file_chooser_set_do_overwrite_confirmation(
+			GTK_FILE_CHOOSER(chooser), TRUE);
+	gtk_file_chooser_set_current_name(GTK_FILE_CHOOSER(chooser),
+			trace ? "osc_trace.json" : "osc_stats.csv");
+
+	if (gtk_dialog_run(GTK_DIALOG(chooser)) == GTK_RESPONSE_ACCEPT) {
+		filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(chooser));
+		if (trace)
+			ret = instr_export_chrome_trace(filename);
+		else
+			ret = instr_export_csv(filename);
+		if (ret < 0)
+			fprintf(stderr, "Failed to export to %s: %s\n",
+					filename, strerror(-ret));
+		g_free(filename);
+	}
+
+	gtk_widget_destroy(chooser);
+}
+
+static void pipeline_stats_response(GtkDialog *dialog, gint response,
+		Dialogs *data)
+{
+	switch (response) {
+	case PIPELINE_STATS_RESET:
+		instr_reset();
+		pipeline_stats_refresh(data);
+		break;
+	case PIPELINE_STATS_EXPORT_TRACE:
+		pipeline_stats_export(data, true);
+		break;
+	case PIPELINE_STATS_EXPORT_CSV:
+		pipeline_stats_export(data, false);
+		break;
+	default:
+		g_source_remove(data->pipeline_stats_timer);
+		gtk_widget_destroy(data->pipeline_stats);
+		data->pipeline_stats = NULL;
+		break;
+	}
+}
+
+G_MODULE_EXPORT void cb_show_pipeline_stats(GtkMenuItem *item, Dialogs *data)
+{
+	GtkWidget *content;
+
+	if (data->pipeline_stats) {
+		gtk_window_present(GTK_WINDOW(data->pipeline_stats));
+		return;
+	}
+
+	data->pipeline_stats = gtk_dialog_new_with_buttons("Pipeline Statistics",
+			NULL, 0,
+			"_Reset", PIPELINE_STATS_RESET,
+			"Export _Trace", PIPELINE_STATS_EXPORT_TRACE,
+			"Export _CSV", PIPELINE_STATS_EXPORT_CSV,
+			GTK_STOCK_CLOSE, GTK_RESPONSE_CLOSE, NULL);
+
+	data->pipeline_stats_label = gtk_label_new(NULL);
+	gtk_misc_set_padding(GTK_MISC(data->pipeline_stats_label), 10, 10);
+	content = gtk_dialog_get_content_area(GTK_DIALOG(data->pipeline_stats));
+	gtk_box_pack_start(GTK_BOX(content), data->pipeline_stats_label,
+			TRUE, TRUE, 0);
+
+	g_signal_connect(data->pipeline_stats, "response",
+			G_CALLBACK(pipeline_stats_response), data);
+
+	pipeline_stats_refresh(data);
+	data->pipeline_stats_timer = g_timeout_add(500,
+			(GSourceFunc) pipeline_stats_refresh, data);
+
+	gtk_widget_show_all(data->pipeline_stats);
+}
+
 G_MODULE_EXPORT void load_save_profile_cb(GtkButton *button, Dialogs *data)
 {
 	/* Save as Dialog */
@@ -1051,7 +1448,7 @@ void dialogs_init(GtkBuilder *builder)
 	g_object_bind_property(dialogs.connect_usb, "active", dialogs.connect_usbd, "sensitive", 0);
 
 	g_signal_connect(G_OBJECT(dialogs.connect_usbd), "changed",
-			(GCallback) hide_ok_btn, NULL);
+			(GCallback) connect_usbd_changed_cb, NULL);
 
 	gtk_widget_set_sensitive(GTK_WIDGET(gtk_builder_get_object(builder, "connect_usb_label")),
 			false);
@@ -1089,7 +1486,7 @@ void dialogs_init(GtkBuilder *builder)
 		}
 	}
 
-	refresh_usb();
+	refresh_usb_async();
 
 	g_signal_connect(dialogs.net_ip, "key-press-event",
 			(GCallback) connect_key_press_cb, dialogs.connect);
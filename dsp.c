@@ -0,0 +1,405 @@
+/**
+ * Copyright (C) 2019 Analog Devices, Inc.
+ *
+ * Licensed under the GPL-2.
+ *
+ **/
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dsp.h"
+
+/* Input samples pushed through the whole DDC chain in one go */
+#define DSP_DDC_BLOCK		4096
+#define DSP_DDC_MAX_STAGES	16
+/* The FIR stage decimates by up to this much, CIC stages do the rest */
+#define DSP_DDC_FIR_DECIM	4
+/* FIR length per unit of decimation, ~75 dB of rejection with Blackman */
+#define DSP_DDC_FIR_TAPS	48
+/* Keep the requested span within 80% of the output band */
+#define DSP_DDC_GUARD		1.25
+
+/*
+ * One CIC stage of order 6 decimating by 2, in its non-recursive form:
+ * (1 + z^-1)^6 / 64. Floats don't wrap like the integer registers of the
+ * recursive form, so this one doesn't drift.
+ */
+static const float cic_taps[] = {
+	1.0f / 64, 6.0f / 64, 15.0f / 64, 20.0f / 64, 15.0f / 64, 6.0f / 64, 1.0f / 64,
+};
+
+#define CIC_NTAPS (sizeof(cic_taps) / sizeof(cic_taps[0]))
+
+struct dsp_ddc_plan {
+	unsigned int decim;
+	unsigned int cic_stages;
+	unsigned int fir_decim;
+	unsigned int fir_ntaps;
+};
+
+struct dsp_ddc {
+	struct dsp_ddc_plan plan;
+	struct dsp_nco nco;
+	struct dsp_fir cic_i[DSP_DDC_MAX_STAGES];
+	struct dsp_fir cic_q[DSP_DDC_MAX_STAGES];
+	struct dsp_fir fir_i;
+	struct dsp_fir fir_q;
+	float work_i[DSP_DDC_BLOCK];
+	float work_q[DSP_DDC_BLOCK];
+};
+
+/* Windowed sinc (Blackman), 'cutoff' in cycles per sample, unity DC gain */
+void dsp_fir_design_lowpass(float *taps, unsigned int ntaps, double cutoff)
+{
+	double c = (ntaps - 1) / 2.0;
+	double x, h, w, sum = 0.0;
+	unsigned int i;
+
+	if (ntaps == 1) {
+		taps[0] = 1.0f;
+		return;
+	}
+
+	for (i = 0; i < ntaps; i++) {
+		x = i - c;
+		if (x == 0.0)
+			h = 2.0 * cutoff;
+		else
+			h = sin(2.0 * M_PI * cutoff * x) / (M_PI * x);
+		w = 0.42 - 0.5 * cos(2.0 * M_PI * i / (ntaps - 1)) +
+			0.08 * cos(4.0 * M_PI * i / (ntaps - 1));
+		taps[i] = h * w;
+		sum += h * w;
+	}
+
+	for (i = 0; i < ntaps; i++)
+		taps[i] /= sum;
+}
+
+static int dsp_fir_alloc(struct dsp_fir *fir, unsigned int ntaps,
+		unsigned int block)
+{
+	fir->taps = malloc(sizeof(*fir->taps) * ntaps);
+	fir->buf = calloc(ntaps - 1 + block, sizeof(*fir->buf));
+	if (!fir->taps || !fir->buf) {
+		dsp_fir_free(fir);
+		return -ENOMEM;
+	}
+
+	fir->ntaps = ntaps;
+	fir->block = block;
+	fir->skip = 0;
+
+	return 0;
+}
+
+int dsp_fir_init(struct dsp_fir *fir, const float *taps,
+		unsigned int ntaps, unsigned int decim, unsigned int block)
+{
+	unsigned int i;
+	int ret;
+
+	if (!ntaps || !decim || !block)
+		return -EINVAL;
+
+	ret = dsp_fir_alloc(fir, ntaps, block);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < ntaps; i++)
+		fir->taps[i] = taps[ntaps - 1 - i];
+	fir->decim = decim;
+
+	return 0;
+}
+
+/* Clears the history, for when the next input isn't contiguous */
+void dsp_fir_reset(struct dsp_fir *fir)
+{
+	memset(fir->buf, 0, sizeof(*fir->buf) * (fir->ntaps - 1));
+	fir->skip = 0;
+}
+
+void dsp_fir_free(struct dsp_fir *fir)
+{
+	free(fir->taps);
+	free(fir->buf);
+	fir->taps = NULL;
+	fir->buf = NULL;
+}
+
+/* Four partial sums, so the loop doesn't serialize on one accumulator */
+static float dsp_dot(const float *a, const float *b, unsigned int n)
+{
+	float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	unsigned int i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		acc[0] += a[i] * b[i];
+		acc[1] += a[i + 1] * b[i + 1];
+		acc[2] += a[i + 2] * b[i + 2];
+		acc[3] += a[i + 3] * b[i + 3];
+	}
+	for (; i < n; i++)
+		acc[0] += a[i] * b[i];
+
+	return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+/*
+ * Filters 'n' samples and returns the number of samples written to 'out',
+ * at most n / decim + 1. The input is copied first, so 'out' may be 'in'.
+ */
+unsigned int dsp_fir_decimate(struct dsp_fir *fir, const float *in,
+		unsigned int n, float *out)
+{
+	unsigned int hist = fir->ntaps - 1;
+	unsigned int len, pos, k = 0;
+
+	while (n) {
+		len = n < fir->block ? n : fir->block;
+		memcpy(fir->buf + hist, in, sizeof(*in) * len);
+
+		/* buf[pos + hist] is the newest sample of the window */
+		for (pos = fir->skip; pos < len; pos += fir->decim)
+			out[k++] = dsp_dot(fir->buf + pos, fir->taps, fir->ntaps);
+
+		fir->skip = pos - len;
+		memmove(fir->buf, fir->buf + len, sizeof(*fir->buf) * hist);
+		in += len;
+		n -= len;
+	}
+
+	return k;
+}
+
+void dsp_nco_init(struct dsp_nco *nco, double freq)
+{
+	nco->freq = freq;
+	nco->count = 0;
+}
+
+/*
+ * The phasor of each lane is seeded from the absolute phase on every call
+ * and only rotated within it, so rounding errors never pile up.
+ */
+void dsp_nco_mix(struct dsp_nco *nco, const float *in_i, const float *in_q,
+		unsigned int n, float *out_i, float *out_q)
+{
+	double pr[DSP_NCO_LANES], pi[DSP_NCO_LANES];
+	double phase, wr, wi, t;
+	float c, s, x, y;
+	unsigned int i, l;
+
+	phase = fmod((double) nco->count * nco->freq, 1.0);
+	for (l = 0; l < DSP_NCO_LANES; l++) {
+		pr[l] = cos(-2.0 * M_PI * (phase + l * nco->freq));
+		pi[l] = sin(-2.0 * M_PI * (phase + l * nco->freq));
+	}
+	wr = cos(-2.0 * M_PI * DSP_NCO_LANES * nco->freq);
+	wi = sin(-2.0 * M_PI * DSP_NCO_LANES * nco->freq);
+
+	for (i = 0; i + DSP_NCO_LANES <= n; i += DSP_NCO_LANES) {
+		for (l = 0; l < DSP_NCO_LANES; l++) {
+			c = pr[l];
+			s = pi[l];
+			x = in_i[i + l];
+			y = in_q[i + l];
+			out_i[i + l] = x * c - y * s;
+			out_q[i + l] = x * s + y * c;
+
+			t = pr[l] * wr - pi[l] * wi;
+			pi[l] = pr[l] * wi + pi[l] * wr;
+			pr[l] = t;
+		}
+	}
+
+	for (l = 0; i < n; i++, l++) {
+		c = pr[l];
+		s = pi[l];
+		x = in_i[i];
+		y = in_q[i];
+		out_i[i] = x * c - y * s;
+		out_q[i] = x * s + y * c;
+	}
+
+	nco->count += n;
+}
+
+static void dsp_ddc_make_plan(double fs, double span,
+		struct dsp_ddc_plan *plan)
+{
+	unsigned int stages = 0, fir_stages;
+
+	plan->decim = 1;
+	while (stages < DSP_DDC_MAX_STAGES + 2 &&
+			fs / (plan->decim * 2) >= span * DSP_DDC_GUARD) {
+		plan->decim *= 2;
+		stages++;
+	}
+
+	plan->fir_decim = 1;
+	for (fir_stages = 0; fir_stages < stages &&
+			plan->fir_decim < DSP_DDC_FIR_DECIM; fir_stages++)
+		plan->fir_decim *= 2;
+
+	plan->cic_stages = stages - fir_stages;
+	plan->fir_ntaps = plan->fir_decim > 1 ?
+		DSP_DDC_FIR_TAPS * plan->fir_decim + 1 : 0;
+}
+
+/* Output samples affected by the start-up of the filters */
+static unsigned int dsp_ddc_plan_settle(const struct dsp_ddc_plan *plan)
+{
+	unsigned int cic = 1 << plan->cic_stages;
+	unsigned int len = CIC_NTAPS * (cic - 1) + plan->fir_ntaps * cic;
+
+	return (len + plan->decim - 1) / plan->decim;
+}
+
+struct dsp_ddc * dsp_ddc_new(double fs, double center, double span)
+{
+	struct dsp_ddc *ddc;
+	float *taps;
+	unsigned int i, block = DSP_DDC_BLOCK;
+	int ret = 0;
+
+	if (fs <= 0.0 || span <= 0.0)
+		return NULL;
+
+	ddc = calloc(1, sizeof(*ddc));
+	if (!ddc)
+		return NULL;
+
+	dsp_ddc_make_plan(fs, span, &ddc->plan);
+	dsp_nco_init(&ddc->nco, center / fs);
+
+	for (i = 0; !ret && i < ddc->plan.cic_stages; i++) {
+		ret = dsp_fir_init(&ddc->cic_i[i], cic_taps, CIC_NTAPS, 2, block);
+		if (!ret)
+			ret = dsp_fir_init(&ddc->cic_q[i], cic_taps, CIC_NTAPS,
+					2, block);
+		if (block > 64)
+			block /= 2;
+	}
+
+	if (!ret && ddc->plan.fir_ntaps) {
+		taps = malloc(sizeof(*taps) * ddc->plan.fir_ntaps);
+		if (!taps) {
+			ret = -ENOMEM;
+		} else {
+			/* Passband up to 90% of the output Nyquist frequency */
+			dsp_fir_design_lowpass(taps, ddc->plan.fir_ntaps,
+					0.45 / ddc->plan.fir_decim);
+			ret = dsp_fir_init(&ddc->fir_i, taps, ddc->plan.fir_ntaps,
+					ddc->plan.fir_decim, block);
+			if (!ret)
+				ret = dsp_fir_init(&ddc->fir_q, taps,
+						ddc->plan.fir_ntaps,
+						ddc->plan.fir_decim, block);
+			free(taps);
+		}
+	}
+
+	if (ret) {
+		dsp_ddc_free(ddc);
+		return NULL;
+	}
+
+	return ddc;
+}
+
+void dsp_ddc_free(struct dsp_ddc *ddc)
+{
+	unsigned int i;
+
+	if (!ddc)
+		return;
+
+	for (i = 0; i < DSP_DDC_MAX_STAGES; i++) {
+		dsp_fir_free(&ddc->cic_i[i]);
+		dsp_fir_free(&ddc->cic_q[i]);
+	}
+	dsp_fir_free(&ddc->fir_i);
+	dsp_fir_free(&ddc->fir_q);
+	free(ddc);
+}
+
+void dsp_ddc_reset(struct dsp_ddc *ddc)
+{
+	unsigned int i;
+
+	ddc->nco.count = 0;
+	for (i = 0; i < ddc->plan.cic_stages; i++) {
+		dsp_fir_reset(&ddc->cic_i[i]);
+		dsp_fir_reset(&ddc->cic_q[i]);
+	}
+	if (ddc->plan.fir_ntaps) {
+		dsp_fir_reset(&ddc->fir_i);
+		dsp_fir_reset(&ddc->fir_q);
+	}
+}
+
+unsigned int dsp_ddc_decimation(const struct dsp_ddc *ddc)
+{
+	return ddc->plan.decim;
+}
+
+/* Number of leading output samples to drop after a reset */
+unsigned int dsp_ddc_settle(const struct dsp_ddc *ddc)
+{
+	return dsp_ddc_plan_settle(&ddc->plan);
+}
+
+/*
+ * Mixes and decimates 'n' input samples. 'out_i' and 'out_q' must have
+ * room for n / decimation + 1 samples; returns how many were written.
+ */
+unsigned int dsp_ddc_process(struct dsp_ddc *ddc, const float *in_i,
+		const float *in_q, unsigned int n, float *out_i, float *out_q)
+{
+	unsigned int i, len, m, k = 0;
+
+	while (n) {
+		len = n < DSP_DDC_BLOCK ? n : DSP_DDC_BLOCK;
+		dsp_nco_mix(&ddc->nco, in_i, in_q, len,
+				ddc->work_i, ddc->work_q);
+
+		m = len;
+		for (i = 0; i < ddc->plan.cic_stages; i++) {
+			dsp_fir_decimate(&ddc->cic_i[i], ddc->work_i, m,
+					ddc->work_i);
+			m = dsp_fir_decimate(&ddc->cic_q[i], ddc->work_q, m,
+					ddc->work_q);
+		}
+		if (ddc->plan.fir_ntaps) {
+			dsp_fir_decimate(&ddc->fir_i, ddc->work_i, m,
+					ddc->work_i);
+			m = dsp_fir_decimate(&ddc->fir_q, ddc->work_q, m,
+					ddc->work_q);
+		}
+
+		memcpy(out_i + k, ddc->work_i, sizeof(*out_i) * m);
+		memcpy(out_q + k, ddc->work_q, sizeof(*out_q) * m);
+		k += m;
+		in_i += len;
+		in_q += len;
+		n -= len;
+	}
+
+	return k;
+}
+
+/* Input samples needed for 'outputs' settled samples out of the DDC */
+unsigned int dsp_ddc_input_length(double fs, double span,
+		unsigned int outputs)
+{
+	struct dsp_ddc_plan plan;
+
+	dsp_ddc_make_plan(fs, span, &plan);
+
+	return (outputs + dsp_ddc_plan_settle(&plan)) * plan.decim;
+}
@@ -0,0 +1,68 @@
+/**
+ * Copyright (C) 2019 Analog Devices, Inc.
+ *
+ * Licensed under the GPL-2.
+ *
+ **/
+
+#ifndef __DSP_H__
+#define __DSP_H__
+
+#include <stdint.h>
+
+/*
+ * Small signal processing blocks for the software transforms.
+ *
+ * Samples are kept as separate float arrays for I and Q, and every inner
+ * loop runs over contiguous memory with no dependency between iterations,
+ * so the compiler is free to vectorize them.
+ */
+
+/* Polyphase FIR decimator, only computes the output samples it keeps */
+struct dsp_fir {
+	float *taps;		/* reversed, so the dot product runs forward */
+	unsigned int ntaps;
+	unsigned int decim;
+	float *buf;		/* ntaps - 1 samples of history, then the block */
+	unsigned int block;	/* input samples handled in one pass */
+	unsigned int skip;	/* input samples before the next output */
+};
+
+void dsp_fir_design_lowpass(float *taps, unsigned int ntaps, double cutoff);
+int dsp_fir_init(struct dsp_fir *fir, const float *taps,
+		unsigned int ntaps, unsigned int decim, unsigned int block);
+void dsp_fir_reset(struct dsp_fir *fir);
+void dsp_fir_free(struct dsp_fir *fir);
+unsigned int dsp_fir_decimate(struct dsp_fir *fir, const float *in,
+		unsigned int n, float *out);
+
+/* Numerically controlled oscillator, mixes I/Q down by 'freq' */
+#define DSP_NCO_LANES 8
+
+struct dsp_nco {
+	double freq;		/* cycles per sample */
+	uint64_t count;		/* samples mixed since the last reset */
+};
+
+void dsp_nco_init(struct dsp_nco *nco, double freq);
+void dsp_nco_mix(struct dsp_nco *nco, const float *in_i, const float *in_q,
+		unsigned int n, float *out_i, float *out_q);
+
+/*
+ * Digital down converter: NCO, then a chain of CIC decimate-by-2 stages,
+ * then a polyphase FIR that shapes the final band. The overall decimation
+ * is a power of two, picked so that the output rate covers 'span'.
+ */
+struct dsp_ddc;
+
+struct dsp_ddc * dsp_ddc_new(double fs, double center, double span);
+void dsp_ddc_free(struct dsp_ddc *ddc);
+void dsp_ddc_reset(struct dsp_ddc *ddc);
+unsigned int dsp_ddc_decimation(const struct dsp_ddc *ddc);
+unsigned int dsp_ddc_settle(const struct dsp_ddc *ddc);
+unsigned int dsp_ddc_process(struct dsp_ddc *ddc, const float *in_i,
+		const float *in_q, unsigned int n, float *out_i, float *out_q);
+unsigned int dsp_ddc_input_length(double fs, double span,
+		unsigned int outputs);
+
+#endif /* __DSP_H__ */
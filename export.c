@@ -0,0 +1,442 @@
+/**
+ * Copyright (C) 2019 Analog Devices, Inc.
+ *
+ * Licensed under the GPL-2.
+ *
+ **/
+#include <glib.h>
+#include <errno.h>
+#include <math.h>
+#include <matio.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "export.h"
+
+/* add backwards compat for <matio-1.5.0 */
+#if MATIO_MAJOR_VERSION == 1 && MATIO_MINOR_VERSION < 5
+typedef int mat_dim;
+#define MAT_COMPRESSION_NONE COMPRESSION_NONE
+#define MAT_COMPRESSION_ZLIB COMPRESSION_ZLIB
+#else
+typedef size_t mat_dim;
+#endif
+
+/* Rows formatted by one thread in one go */
+#define EXPORT_BLOCK_ROWS	16384
+#define EXPORT_MAX_THREADS	8
+/* Longest "%g" output of a float is "-1.17549e-38" */
+#define EXPORT_VALUE_MAX	16
+
+struct export_column {
+	gchar *name;
+	float *data;
+	double scale;
+};
+
+struct export_section {
+	gchar *header;
+	gchar *footer;
+	unsigned int rows;
+	GPtrArray *columns;
+};
+
+struct export_job {
+	enum export_format format;
+	gchar *filename;
+	gchar *separator;
+	gchar *row_end;
+	gchar *trailer;
+	bool compress;
+	GPtrArray *sections;
+
+	GThread *thread;
+	gint total;		/* values to write */
+	volatile gint done;
+	volatile gint cancel;
+	volatile gint finished;
+	int result;
+};
+
+struct export_block {
+	const struct export_job *job;
+	const struct export_section *section;
+	unsigned int first, last;
+	char *buf;
+	size_t len;
+};
+
+static void export_column_free(struct export_column *col)
+{
+	g_free(col->name);
+	g_free(col->data);
+	g_free(col);
+}
+
+static void export_section_free(struct export_section *section)
+{
+	g_free(section->header);
+	g_free(section->footer);
+	g_ptr_array_free(section->columns, TRUE);
+	g_free(section);
+}
+
+struct export_job * export_job_new(enum export_format format,
+		const char *filename)
+{
+	struct export_job *job = g_new0(struct export_job, 1);
+
+	job->format = format;
+	job->filename = g_strdup(filename);
+	job->separator = g_strdup(", ");
+	job->row_end = g_strdup("\n");
+	job->trailer = g_strdup("");
+	job->sections = g_ptr_array_new_with_free_func(
+			(GDestroyNotify) export_section_free);
+
+	return job;
+}
+
+/* 'separator' goes between the values of a row, 'row_end' after the last
+ * one and 'trailer' at the very end of the file */
+void export_job_set_text_format(struct export_job *job,
+		const char *separator, const char *row_end, const char *trailer)
+{
+	g_free(job->separator);
+	g_free(job->row_end);
+	g_free(job->trailer);
+	job->separator = g_strdup(separator);
+	job->row_end = g_strdup(row_end);
+	job->trailer = g_strdup(trailer);
+}
+
+void export_job_set_compression(struct export_job *job, bool compress)
+{
+	job->compress = compress;
+}
+
+void export_job_add_section(struct export_job *job, const char *header,
+		unsigned int rows, const char *footer)
+{
+	struct export_section *section = g_new0(struct export_section, 1);
+
+	section->header = g_strdup(header ?: "");
+	section->footer = g_strdup(footer ?: "");
+	section->rows = rows;
+	section->columns = g_ptr_array_new_with_free_func(
+			(GDestroyNotify) export_column_free);
+	g_ptr_array_add(job->sections, section);
+}
+
+/* The data of the column is copied, 'scale' only applies to MAT files
+ * where anything other than 1.0 stores the column as doubles */
+void export_job_add_column(struct export_job *job, const char *name,
+		const float *data, double scale)
+{
+	struct export_section *section;
+	struct export_column *col;
+
+	g_return_if_fail(job->sections->len);
+
+	section = g_ptr_array_index(job->sections, job->sections->len - 1);
+	col = g_new0(struct export_column, 1);
+	col->name = g_strdup(name);
+	col->data = g_memdup(data, section->rows * sizeof(*data));
+	col->scale = scale;
+	g_ptr_array_add(section->columns, col);
+}
+
+/* Same output as "%g", with a fast path for the integers raw samples are */
+static char * export_format_value(char *p, float v)
+{
+	char digits[8];
+	unsigned int n, i = 0;
+	int iv;
+
+	if (v > -1e6f && v < 1e6f && v == (float) (int) v &&
+			!(v == 0.0f && signbit(v))) {
+		iv = (int) v;
+		if (iv < 0) {
+			*p++ = '-';
+			n = -iv;
+		} else {
+			n = iv;
+		}
+
+		do {
+			digits[i++] = '0' + n % 10;
+			n /= 10;
+		} while (n);
+
+		while (i)
+			*p++ = digits[--i];
+		return p;
+	}
+
+	return p + sprintf(p, "%g", v);
+}
+
+static gpointer export_format_block(struct export_block *b)
+{
+	const GPtrArray *columns = b->section->columns;
+	size_t sep_len = strlen(b->job->separator);
+	size_t end_len = strlen(b->job->row_end);
+	struct export_column *col;
+	unsigned int r, c;
+	char *p = b->buf;
+
+	for (r = b->first; r < b->last; r++) {
+		for (c = 0; c < columns->len; c++) {
+			col = g_ptr_array_index(columns, c);
+			if (c) {
+				memcpy(p, b->job->separator, sep_len);
+				p += sep_len;
+			}
+			p = export_format_value(p, col->data[r]);
+		}
+		memcpy(p, b->job->row_end, end_len);
+		p += end_len;
+	}
+
+	b->len = p - b->buf;
+	return NULL;
+}
+
+static int export_write_section(struct export_job *job, FILE *fp,
+		const struct export_section *section,
+		struct export_block *blocks, unsigned int nb_threads)
+{
+	GThread *threads[EXPORT_MAX_THREADS];
+	size_t row_max = section->columns->len *
+		(EXPORT_VALUE_MAX + strlen(job->separator)) +
+		strlen(job->row_end);
+	unsigned int row = 0, first, i, n;
+
+	for (i = 0; i < nb_threads; i++) {
+		blocks[i].job = job;
+		blocks[i].section = section;
+		blocks[i].buf = g_realloc(blocks[i].buf,
+				EXPORT_BLOCK_ROWS * row_max);
+	}
+
+	while (row < section->rows) {
+		if (g_atomic_int_get(&job->cancel))
+			return -ECANCELED;
+
+		first = row;
+		for (n = 0; n < nb_threads && row < section->rows; n++) {
+			blocks[n].first = row;
+			row = MIN(row + EXPORT_BLOCK_ROWS, section->rows);
+			blocks[n].last = row;
+		}
+
+		for (i = 1; i < n; i++)
+			threads[i] = g_thread_new("export",
+					(GThreadFunc) export_format_block,
+					&blocks[i]);
+		export_format_block(&blocks[0]);
+		for (i = 1; i < n; i++)
+			g_thread_join(threads[i]);
+
+		for (i = 0; i < n; i++)
+			if (fwrite(blocks[i].buf, 1, blocks[i].len, fp) !=
+					blocks[i].len)
+				return errno ? -errno : -EIO;
+
+		g_atomic_int_add(&job->done,
+				(row - first) * section->columns->len);
+	}
+
+	return 0;
+}
+
+static int export_write_text(struct export_job *job)
+{
+	struct export_block blocks[EXPORT_MAX_THREADS];
+	struct export_section *section;
+	unsigned int i, nb_threads;
+	FILE *fp;
+	int ret = 0;
+
+	fp = fopen(job->filename, "w");
+	if (!fp)
+		return -errno;
+
+	nb_threads = CLAMP(g_get_num_processors(), 1, EXPORT_MAX_THREADS);
+	memset(blocks, 0, sizeof(blocks));
+
+	for (i = 0; !ret && i < job->sections->len; i++) {
+		section = g_ptr_array_index(job->sections, i);
+
+		if (fputs(section->header, fp) < 0) {
+			ret = errno ? -errno : -EIO;
+			break;
+		}
+
+		ret = export_write_section(job, fp, section, blocks, nb_threads);
+		if (!ret && fputs(section->footer, fp) < 0)
+			ret = errno ? -errno : -EIO;
+	}
+
+	if (!ret && fputs(job->trailer, fp) < 0)
+		ret = errno ? -errno : -EIO;
+
+	for (i = 0; i < nb_threads; i++)
+		g_free(blocks[i].buf);
+
+	if (fclose(fp) && !ret)
+		ret = -errno;
+
+	return ret;
+}
+
+static int export_write_mat(struct export_job *job)
+{
+	struct export_section *section;
+	struct export_column *col;
+	mat_dim dims[2] = {0, 1};
+	matvar_t *matvar;
+	double *scaled = NULL;
+	unsigned int i, c, r, last;
+	mat_t *mat;
+	int ret = 0;
+
+	mat = Mat_Create(job->filename, NULL);
+	if (!mat)
+		return errno ? -errno : -EIO;
+
+	for (i = 0; !ret && i < job->sections->len; i++) {
+		section = g_ptr_array_index(job->sections, i);
+		dims[0] = section->rows;
+		if (section->rows)
+			scaled = g_renew(double, scaled, section->rows);
+
+		for (c = 0; !ret && c < section->columns->len; c++) {
+			col = g_ptr_array_index(section->columns, c);
+
+			if (g_atomic_int_get(&job->cancel)) {
+				ret = -ECANCELED;
+				break;
+			}
+
+			if (col->scale == 1.0) {
+				matvar = Mat_VarCreate(col->name, MAT_C_SINGLE,
+						MAT_T_SINGLE, 2, dims, col->data,
+						MAT_F_DONT_COPY_DATA);
+			} else {
+				/* Chunks keep the cancel latency low */
+				for (r = 0; r < section->rows; r = last) {
+					if (g_atomic_int_get(&job->cancel)) {
+						ret = -ECANCELED;
+						break;
+					}
+
+					last = MIN(r + EXPORT_BLOCK_ROWS, section->rows);
+					for (; r < last; r++)
+						scaled[r] = col->data[r] * col->scale;
+				}
+				if (ret)
+					break;
+
+				matvar = Mat_VarCreate(col->name, MAT_C_DOUBLE,
+						MAT_T_DOUBLE, 2, dims, scaled,
+						MAT_F_DONT_COPY_DATA);
+			}
+
+			if (!matvar) {
+				fprintf(stderr, "error creating matvar on channel %s\n",
+						col->name);
+				ret = -ENOMEM;
+				break;
+			}
+
+			if (Mat_VarWrite(mat, matvar, job->compress ?
+						MAT_COMPRESSION_ZLIB :
+						MAT_COMPRESSION_NONE))
+				ret = -EIO;
+			Mat_VarFree(matvar);
+
+			g_atomic_int_add(&job->done, section->rows);
+		}
+	}
+
+	g_free(scaled);
+	Mat_Close(mat);
+
+	return ret;
+}
+
+static gpointer export_thread(struct export_job *job)
+{
+	if (job->format == EXPORT_MAT)
+		job->result = export_write_mat(job);
+	else
+		job->result = export_write_text(job);
+
+	/* Don't leave half written files behind */
+	if (job->result)
+		unlink(job->filename);
+
+	g_atomic_int_set(&job->finished, 1);
+	return NULL;
+}
+
+int export_job_start(struct export_job *job)
+{
+	struct export_section *section;
+	unsigned int i;
+
+	job->total = 0;
+	for (i = 0; i < job->sections->len; i++) {
+		section = g_ptr_array_index(job->sections, i);
+		job->total += section->rows * section->columns->len;
+	}
+
+	job->thread = g_thread_new("export", (GThreadFunc) export_thread, job);
+	return job->thread ? 0 : -ENOMEM;
+}
+
+void export_job_cancel(struct export_job *job)
+{
+	g_atomic_int_set(&job->cancel, 1);
+}
+
+bool export_job_done(struct export_job *job)
+{
+	return !!g_atomic_int_get(&job->finished);
+}
+
+double export_job_progress(struct export_job *job)
+{
+	if (!job->total)
+		return export_job_done(job) ? 1.0 : 0.0;
+
+	return (double) g_atomic_int_get(&job->done) / job->total;
+}
+
+const char * export_job_filename(const struct export_job *job)
+{
+	return job->filename;
+}
+
+/* Waits for the job if it is still running, frees it and returns
+ * 0 or a negative error code (-ECANCELED if it was cancelled) */
+int export_job_finish(struct export_job *job)
+{
+	int ret = 0;
+
+	if (job->thread) {
+		g_thread_join(job->thread);
+		ret = job->result;
+	}
+
+	g_ptr_array_free(job->sections, TRUE);
+	g_free(job->filename);
+	g_free(job->separator);
+	g_free(job->row_end);
+	g_free(job->trailer);
+	g_free(job);
+
+	return ret;
+}
@@ -0,0 +1,48 @@
+/**
+ * Copyright (C) 2019 Analog Devices, Inc.
+ *
+ * Licensed under the GPL-2.
+ *
+ **/
+
+#ifndef __EXPORT_H__
+#define __EXPORT_H__
+
+#include <stdbool.h>
+
+/*
+ * Capture export engine.
+ *
+ * A job owns a copy of the data, so the capture can go on while the file
+ * is written from a separate thread. Text output is formatted in blocks of
+ * rows by several threads and written with large fwrite() calls; MAT files
+ * get one variable per column.
+ *
+ * A job is made of sections, each with its own header, columns and footer.
+ */
+
+enum export_format {
+	EXPORT_TEXT,
+	EXPORT_MAT,
+};
+
+struct export_job;
+
+struct export_job * export_job_new(enum export_format format,
+		const char *filename);
+void export_job_set_text_format(struct export_job *job,
+		const char *separator, const char *row_end, const char *trailer);
+void export_job_set_compression(struct export_job *job, bool compress);
+void export_job_add_section(struct export_job *job, const char *header,
+		unsigned int rows, const char *footer);
+void export_job_add_column(struct export_job *job, const char *name,
+		const float *data, double scale);
+
+int export_job_start(struct export_job *job);
+void export_job_cancel(struct export_job *job);
+bool export_job_done(struct export_job *job);
+double export_job_progress(struct export_job *job);
+const char * export_job_filename(const struct export_job *job);
+int export_job_finish(struct export_job *job);
+
+#endif /* __EXPORT_H__ */
@@ -0,0 +1,960 @@
+/**
+ * Copyright (C) 2019 Analog Devices, Inc.
+ *
+ * Licensed under the GPL-2.
+ *
+ * Headless mode: capture, FFT and measurements without any GTK widget,
+ * results are published over a local Unix socket (see headless.h).
+ *
+ **/
+#include <glib.h>
+#include <gtk/gtk.h>
+#include <complex.h>
+#include <fftw3.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <float.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <iio.h>
+
+#include "libini2.h"
+#include "osc.h"
+#include "oscplot.h"
+#include "datatypes.h"
+#include "headless.h"
+
+#define HEADLESS_MAX_CLIENTS	8
+#define HEADLESS_MAX_MARKERS	10
+#define HEADLESS_DEF_FFT_SIZE	8192
+#define HEADLESS_DEF_MARKERS	5
+
+struct headless_config {
+	int plot_id;
+	char *device;
+	char *channels[2];
+	unsigned int nb_channels;
+	unsigned int fft_size;
+	unsigned int fft_avg;
+	double pwr_offset;
+	unsigned int markers;
+};
+
+struct headless_state {
+	struct iio_device *dev;
+	struct iio_channel *chn[2];
+	struct iio_buffer *buf;
+	unsigned int nb_channels;
+	unsigned int fft_size;
+	unsigned int m;
+	double sample_rate;
+	double fft_corr;
+
+	double *win;
+	double *in;
+	fftw_complex *in_c;
+	fftw_complex *out;
+	fftw_plan plan;
+	double *re, *im;
+	float *spectrum;
+	float *sorted;
+	bool first;
+
+	int listen_fd;
+	int clients[HEADLESS_MAX_CLIENTS];
+	unsigned int nb_clients;
+	GByteArray *frame;
+	uint32_t seq;
+};
+
+static struct headless_config cfg;
+static struct iio_context *h_ctx;
+static volatile sig_atomic_t headless_quit;
+
+void headless_stop(void)
+{
+	headless_quit = 1;
+}
+
+static int headless_skip_item(const char *attrib, const char *value)
+{
+	DBG("Skipping plugin specific item %s = %s", attrib, value);
+	return 0;
+}
+
+static int headless_capture_item(const char *name, const char *value)
+{
+	gchar **elems;
+
+	if (!strcmp(name, "fft_size")) {
+		cfg.fft_size = atoi(value);
+	} else if (!strcmp(name, "fft_avg")) {
+		cfg.fft_avg = atoi(value);
+	} else if (!strcmp(name, "fft_pwr_offset")) {
+		cfg.pwr_offset = atof(value);
+	} else if (!strncmp(name, "marker.", sizeof("marker.") - 1)) {
+		if (cfg.markers < HEADLESS_MAX_MARKERS)
+			cfg.markers++;
+	} else {
+		elems = g_strsplit(name, ".", 3);
+		if (elems[0] && elems[1] && elems[2] &&
+				!strcmp(elems[2], "enabled") && atoi(value) &&
+				cfg.nb_channels < 2 && (!cfg.device ||
+				!strcmp(cfg.device, elems[0]))) {
+			if (!cfg.device)
+				cfg.device = g_strdup(elems[0]);
+			cfg.channels[cfg.nb_channels++] = g_strdup(elems[1]);
+		}
+		g_strfreev(elems);
+	}
+
+	return 0;
+}
+
+static int headless_profile_handler(int line, const char *section,
+		const char *name, const char *value)
+{
+	int plot_id;
+
+	if (!strcmp(section, OSC_INI_SECTION))
+		return 0;
+
+	if (!strncmp(section, CAPTURE_INI_SECTION,
+				sizeof(CAPTURE_INI_SECTION) - 1)) {
+		/* Only the first capture window drives the pipeline */
+		plot_id = atoi(section + sizeof(CAPTURE_INI_SECTION) - 1);
+		if (cfg.plot_id < 0)
+			cfg.plot_id = plot_id;
+		if (plot_id == cfg.plot_id)
+			return headless_capture_item(name, value);
+		return 0;
+	}
+
+	/* Plugin sections: apply the plain device/channel attributes, a
+	 * failing write is reported but does not stop the daemon */
+	osc_plugin_default_handle(h_ctx, line, name, value, headless_skip_item);
+	return 0;
+}
+
+static int headless_load_profile(const char *profile)
+{
+	gchar *unrolled;
+	char buf[32];
+	int ret;
+
+	snprintf(buf, sizeof(buf), "osc_headless_%u.ini", getpid());
+	unrolled = g_build_filename(getenv("TEMP") ?: P_tmpdir, buf, NULL);
+	unlink(unrolled);
+
+	ret = ini_unroll(profile, unrolled);
+	if (ret >= 0)
+		ret = foreach_in_ini(unrolled, headless_profile_handler);
+
+	unlink(unrolled);
+	g_free(unrolled);
+	return ret;
+}
+
+static bool headless_pick_default_channels(void)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < iio_context_get_devices_count(h_ctx); i++) {
+		struct iio_device *dev = iio_context_get_device(h_ctx, i);
+
+		if (!is_input_device(dev))
+			continue;
+
+		for (j = 0; j < iio_device_get_channels_count(dev) &&
+				cfg.nb_channels < 2; j++) {
+			struct iio_channel *ch = iio_device_get_channel(dev, j);
+
+			if (iio_channel_is_output(ch) ||
+					!iio_channel_is_scan_element(ch))
+				continue;
+			cfg.channels[cfg.nb_channels++] =
+				g_strdup(iio_channel_get_id(ch));
+		}
+
+		if (cfg.nb_channels) {
+			cfg.device = g_strdup(iio_device_get_id(dev));
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static int headless_setup_device(struct headless_state *h)
+{
+	const struct iio_data_format *fmt;
+	unsigned int i;
+
+	h->dev = iio_context_find_device(h_ctx, cfg.device);
+	if (!h->dev) {
+		fprintf(stderr, "Headless: no device named %s\n", cfg.device);
+		return -ENODEV;
+	}
+
+	for (i = 0; i < iio_device_get_channels_count(h->dev); i++)
+		iio_channel_disable(iio_device_get_channel(h->dev, i));
+
+	h->nb_channels = cfg.nb_channels;
+	for (i = 0; i < h->nb_channels; i++) {
+		h->chn[i] = iio_device_find_channel(h->dev,
+				cfg.channels[i], false);
+		if (!h->chn[i]) {
+			fprintf(stderr, "Headless: no channel %s in %s\n",
+					cfg.channels[i], cfg.device);
+			return -ENOENT;
+		}
+		iio_channel_enable(h->chn[i]);
+	}
+
+	fmt = iio_channel_get_data_format(h->chn[0]);
+	h->fft_corr = 20 * log10(2.0 / (1ULL << (fmt->bits - 1)));
+	h->sample_rate = read_sampling_frequency(h->dev);
+
+	h->buf = iio_device_create_buffer(h->dev, h->fft_size, false);
+	if (!h->buf) {
+		fprintf(stderr, "Headless: unable to create buffer: %s\n",
+				strerror(errno));
+		return -errno;
+	}
+
+	return 0;
+}
+
+static void headless_setup_fft(struct headless_state *h)
+{
+	unsigned int i, n = h->fft_size;
+
+	h->win = fftw_malloc(sizeof(double) * n);
+	for (i = 0; i < n; i++)
+		h->win[i] = 0.5 * (1.0 - cos(2.0 * M_PI * i / (n - 1)));
+
+	if (h->nb_channels == 2) {
+		h->m = n;
+		h->in_c = fftw_malloc(sizeof(fftw_complex) * n);
+		h->out = fftw_malloc(sizeof(fftw_complex) * (h->m + 1));
+		h->plan = fftw_plan_dft_1d(n, h->in_c, h->out,
+				FFTW_FORWARD, FFTW_ESTIMATE);
+	} else {
+		h->m = n / 2;
+		h->in = fftw_malloc(sizeof(double) * n);
+		h->out = fftw_malloc(sizeof(fftw_complex) * (h->m + 1));
+		h->plan = fftw_plan_dft_r2c_1d(n, h->in, h->out, FFTW_ESTIMATE);
+	}
+
+	h->re = g_new0(double, n);
+	h->im = g_new0(double, n);
+	h->spectrum = g_new0(float, h->m);
+	h->sorted = g_new0(float, h->m);
+	h->first = true;
+}
+
+/* Same sign handling as demux_sample() in osc.c, but into doubles */
+static void headless_demux(struct iio_buffer *buf,
+		const struct iio_channel *chn, double *out, unsigned int count)
+{
+	const struct iio_data_format *fmt = iio_channel_get_data_format(chn);
+	ptrdiff_t step = iio_buffer_step(buf);
+	uint8_t *p = iio_buffer_first(buf, chn);
+	uint8_t *end = iio_buffer_end(buf);
+	unsigned int i;
+
+	for (i = 0; i < count && p < end; i++, p += step) {
+		if (fmt->length <= 8) {
+			int8_t val;
+			iio_channel_convert(chn, &val, p);
+			out[i] = fmt->is_signed ? val : (uint8_t) val;
+		} else if (fmt->length <= 16) {
+			int16_t val;
+			iio_channel_convert(chn, &val, p);
+			out[i] = fmt->is_signed ? val : (uint16_t) val;
+		} else {
+			int32_t val;
+			iio_channel_convert(chn, &val, p);
+			out[i] = fmt->is_signed ? val : (uint32_t) val;
+		}
+	}
+}
+
+static void headless_transform(struct headless_state *h)
+{
+	unsigned int i, j, n = h->fft_size;
+	double avg = cfg.fft_avg > 1 ? 1.0 / cfg.fft_avg : 1.0;
+	double mag;
+
+	if (h->nb_channels == 2) {
+		for (i = 0; i < n; i++)
+			h->in_c[i] = h->re[i] * h->win[i] +
+				I * h->im[i] * h->win[i];
+	} else {
+		for (i = 0; i < n; i++)
+			h->in[i] = h->re[i] * h->win[i];
+	}
+
+	fftw_execute(h->plan);
+
+	for (i = 0; i < h->m; i++) {
+		/* complex spectra are shifted so that DC is in the middle */
+		if (h->nb_channels == 2)
+			j = i < h->m / 2 ? i + h->m / 2 : i - h->m / 2;
+		else
+			j = i;
+
+		mag = creal(h->out[j]) * creal(h->out[j]) +
+			cimag(h->out[j]) * cimag(h->out[j]);
+		if (mag == 0)
+			mag = FLT_MIN;
+		mag = 10 * log10(mag / ((unsigned long long) h->m * h->m)) +
+			h->fft_corr + cfg.pwr_offset;
+
+		if (h->first)
+			h->spectrum[i] = mag;
+		else
+			h->spectrum[i] = (1 - avg) * h->spectrum[i] + avg * mag;
+	}
+	h->first = false;
+}
+
+/* Strongest local maxima, sorted by level */
+static unsigned int headless_find_peaks(struct headless_state *h,
+		struct headless_marker *mk, unsigned int max)
+{
+	const float *s = h->spectrum;
+	unsigned int i, k, count = 0;
+
+	for (i = 2; i + 1 < h->m; i++) {
+		if (!(s[i] > s[i - 1] && s[i] >= s[i + 1]))
+			continue;
+		if (count == max && s[i] <= mk[max - 1].level)
+			continue;
+
+		k = count < max ? count++ : max - 1;
+		while (k > 0 && mk[k - 1].level < s[i]) {
+			mk[k] = mk[k - 1];
+			k--;
+		}
+		mk[k].bin = i;
+		mk[k].level = s[i];
+	}
+
+	for (i = 0; i < count; i++) {
+		mk[i].freq = mk[i].bin * h->sample_rate / h->fft_size;
+		if (h->nb_channels == 2)
+			mk[i].freq -= h->sample_rate / 2;
+	}
+
+	return count;
+}
+
+static int float_cmp(const void *a, const void *b)
+{
+	float fa = *(const float *) a, fb = *(const float *) b;
+
+	return (fa > fb) - (fa < fb);
+}
+
+static void headless_frame_add(struct headless_state *h,
+		enum headless_msg_type type, uint64_t timestamp,
+		const void *p1, size_t l1, const void *p2, size_t l2)
+{
+	struct headless_msg_hdr hdr = {
+		.magic = HEADLESS_MAGIC,
+		.version = HEADLESS_VERSION,
+		.type = type,
+		.seq = h->seq,
+		.length = l1 + l2,
+		.timestamp_us = timestamp,
+	};
+
+	g_byte_array_append(h->frame, (const guint8 *) &hdr, sizeof(hdr));
+	g_byte_array_append(h->frame, p1, l1);
+	if (l2)
+		g_byte_array_append(h->frame, p2, l2);
+}
+
+static void headless_drop_client(struct headless_state *h, unsigned int i)
+{
+	close(h->clients[i]);
+	h->clients[i] = h->clients[--h->nb_clients];
+}
+
+static void headless_accept(struct headless_state *h)
+{
+	int fd;
+
+	while ((fd = accept(h->listen_fd, NULL, NULL)) >= 0) {
+		if (h->nb_clients == HEADLESS_MAX_CLIENTS) {
+			close(fd);
+			continue;
+		}
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		h->clients[h->nb_clients++] = fd;
+	}
+}
+
+/* A client with a full socket misses this capture. Once the first byte is
+ * out the rest has to follow, otherwise the stream would be corrupted and
+ * the client gets dropped. */
+static void headless_publish(struct headless_state *h)
+{
+	unsigned int i = 0;
+	struct pollfd pfd;
+	size_t done;
+	ssize_t ret;
+
+	while (i < h->nb_clients) {
+		ret = send(h->clients[i], h->frame->data, h->frame->len,
+				MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			i++;
+			continue;
+		}
+
+		done = ret < 0 ? 0 : ret;
+		while (ret >= 0 && done < h->frame->len) {
+			pfd.fd = h->clients[i];
+			pfd.events = POLLOUT;
+			if (poll(&pfd, 1, 100) <= 0) {
+				ret = -1;
+				break;
+			}
+			ret = send(h->clients[i], h->frame->data + done,
+					h->frame->len - done,
+					MSG_NOSIGNAL | MSG_DONTWAIT);
+			if (ret > 0)
+				done += ret;
+			else if (ret < 0 && errno == EAGAIN)
+				ret = 0;
+		}
+
+		if (ret < 0)
+			headless_drop_client(h, i);
+		else
+			i++;
+	}
+}
+
+static int headless_listen(struct headless_state *h, const char *path)
+{
+	struct sockaddr_un addr;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Headless: socket path too long: %s\n", path);
+		return -ENAMETOOLONG;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	unlink(path);
+
+	h->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (h->listen_fd < 0)
+		return -errno;
+
+	if (bind(h->listen_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+			listen(h->listen_fd, HEADLESS_MAX_CLIENTS) < 0) {
+		int ret = -errno;
+		fprintf(stderr, "Headless: unable to listen on %s: %s\n",
+				path, strerror(errno));
+		close(h->listen_fd);
+		h->listen_fd = -1;
+		return ret;
+	}
+
+	fcntl(h->listen_fd, F_SETFL, fcntl(h->listen_fd, F_GETFL) | O_NONBLOCK);
+	return 0;
+}
+
+static int headless_process(struct headless_state *h)
+{
+	struct headless_marker mk[HEADLESS_MAX_MARKERS];
+	struct headless_spectrum spec;
+	struct headless_metrics met;
+	uint32_t nb_markers;
+	gint64 t0, t1, t2;
+	ssize_t ret;
+
+	t0 = g_get_monotonic_time();
+	ret = iio_buffer_refill(h->buf);
+	if (ret < 0) {
+		fprintf(stderr, "Headless: error while reading data: %s\n",
+				strerror(-ret));
+		return (int) ret;
+	}
+	t1 = g_get_monotonic_time();
+
+	headless_demux(h->buf, h->chn[0], h->re, h->fft_size);
+	if (h->nb_channels == 2)
+		headless_demux(h->buf, h->chn[1], h->im, h->fft_size);
+	headless_transform(h);
+	nb_markers = headless_find_peaks(h, mk, cfg.markers);
+
+	memcpy(h->sorted, h->spectrum, h->m * sizeof(float));
+	qsort(h->sorted, h->m, sizeof(float), float_cmp);
+	t2 = g_get_monotonic_time();
+
+	spec.sample_rate = h->sample_rate;
+	spec.bin_width = h->sample_rate / h->fft_size;
+	spec.start_freq = h->nb_channels == 2 ? -h->sample_rate / 2 : 0;
+	spec.bins = h->m;
+	spec.complex_fft = h->nb_channels == 2;
+
+	met.peak_level = nb_markers ? mk[0].level : h->sorted[h->m - 1];
+	met.noise_floor = h->sorted[h->m / 2];
+	met.sfdr = nb_markers > 1 ? mk[0].level - mk[1].level : 0;
+	met.capture_ms = (t1 - t0) / 1000.0f;
+	met.transform_ms = (t2 - t1) / 1000.0f;
+	met.clients = h->nb_clients;
+
+	g_byte_array_set_size(h->frame, 0);
+	headless_frame_add(h, HEADLESS_MSG_SPECTRUM, t1, &spec, sizeof(spec),
+			h->spectrum, h->m * sizeof(float));
+	headless_frame_add(h, HEADLESS_MSG_MARKERS, t1,
+			&nb_markers, sizeof(nb_markers),
+			mk, nb_markers * sizeof(*mk));
+	headless_frame_add(h, HEADLESS_MSG_METRICS, t1,
+			&met, sizeof(met), NULL, 0);
+
+	headless_accept(h);
+	headless_publish(h);
+	h->seq++;
+
+	return 0;
+}
+
+static void headless_cleanup(struct headless_state *h, const char *path)
+{
+	unsigned int i;
+
+	while (h->nb_clients)
+		headless_drop_client(h, 0);
+	if (h->listen_fd >= 0) {
+		close(h->listen_fd);
+		unlink(path);
+	}
+	if (h->frame)
+		g_byte_array_free(h->frame, TRUE);
+	if (h->buf)
+		iio_buffer_destroy(h->buf);
+	if (h->win) {
+		fftw_destroy_plan(h->plan);
+		fftw_free(h->win);
+		fftw_free(h->out);
+		fftw_free(h->in);
+		fftw_free(h->in_c);
+	}
+	g_free(h->re);
+	g_free(h->im);
+	g_free(h->spectrum);
+	g_free(h->sorted);
+
+	g_free(cfg.device);
+	for (i = 0; i < cfg.nb_channels; i++)
+		g_free(cfg.channels[i]);
+}
+
+int headless_run(struct iio_context *ctx, const char *profile,
+		const char *socket_path)
+{
+	struct headless_state h;
+	unsigned int n;
+	char *value;
+	int ret;
+
+	memset(&h, 0, sizeof(h));
+	h.listen_fd = -1;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.plot_id = -1;
+	cfg.fft_avg = 1;
+
+	if (!ctx && profile) {
+		value = read_token_from_ini(profile, OSC_INI_SECTION,
+				"remote_ip_addr");
+		if (value) {
+			ctx = iio_create_network_context(value);
+			free(value);
+		}
+	}
+	if (!ctx)
+		ctx = iio_create_default_context();
+	if (!ctx) {
+		fprintf(stderr, "Headless: no IIO context available\n");
+		return -ENODEV;
+	}
+	h_ctx = ctx;
+
+	if (profile && headless_load_profile(profile) < 0)
+		fprintf(stderr, "Headless: errors while loading %s\n", profile);
+
+	if (!cfg.nb_channels && !headless_pick_default_channels()) {
+		fprintf(stderr, "Headless: no capture device found\n");
+		ret = -ENODEV;
+		goto out;
+	}
+
+	/* Round down to a power of two, the same sizes the GUI offers */
+	if (!cfg.fft_size)
+		cfg.fft_size = HEADLESS_DEF_FFT_SIZE;
+	if (cfg.fft_size > MAX_SAMPLES)
+		cfg.fft_size = MAX_SAMPLES;
+	for (n = 32; n * 2 <= cfg.fft_size; n *= 2);
+	h.fft_size = n;
+	if (!cfg.markers)
+		cfg.markers = HEADLESS_DEF_MARKERS;
+
+	ret = headless_setup_device(&h);
+	if (ret < 0)
+		goto out;
+	headless_setup_fft(&h);
+
+	ret = headless_listen(&h, socket_path);
+	if (ret < 0)
+		goto out;
+	h.frame = g_byte_array_sized_new(sizeof(struct headless_msg_hdr) * 3 +
+			sizeof(struct headless_spectrum) +
+			h.m * sizeof(float) + sizeof(struct headless_metrics) +
+			sizeof(uint32_t) + sizeof(struct headless_marker) *
+			HEADLESS_MAX_MARKERS);
+
+	printf("Headless: %s (%u channel%s), %u point FFT, publishing on %s\n",
+			cfg.device, h.nb_channels, h.nb_channels > 1 ? "s" : "",
+			h.fft_size, socket_path);
+
+	headless_quit = 0;
+	while (!headless_quit) {
+		ret = headless_process(&h);
+		if (ret < 0)
+			break;
+	}
+	if (headless_quit)
+		ret = 0;
+
+out:
+	headless_cleanup(&h, socket_path);
+	iio_context_destroy(ctx);
+	h_ctx = NULL;
+	return ret;
+}
+
+/*
+ * Benchmark: the capture pipeline fed by a synthetic source instead of an
+ * IIO buffer. The source packs deterministic IQ (two tones, a chirp and
+ * noise) the way the DMA cores do: each code is 'bits' wide, shifted left
+ * by 'shift' into a 8/16/32-bit storage word.
+ */
+#define BENCH_DEVICE "bench-adc"
+
+struct bench_format {
+	unsigned int bits;
+	unsigned int shift;
+	unsigned int length;
+	bool is_signed;
+};
+
+static uint32_t bench_rand_state;
+
+/* Deterministic noise, same sequence on every run */
+static double bench_rand(void)
+{
+	bench_rand_state = bench_rand_state * 1664525 + 1013904223;
+	return (double) (bench_rand_state >> 8) / (1 << 24) - 0.5;
+}
+
+static void bench_generate(uint8_t *raw, unsigned int count,
+		unsigned int nb_channels, const struct bench_format *fmt,
+		unsigned long long *phase)
+{
+	unsigned int i, c, bytes = fmt->length / 8;
+	double full = (1ULL << (fmt->bits - 1)) - 1;
+	double t, arg, v;
+	uint32_t code;
+
+	for (i = 0; i < count; i++, (*phase)++) {
+		t = (double) (*phase % 65536) / 65536;
+		for (c = 0; c < nb_channels; c++) {
+			/* quadrature channel lags by 90 degrees */
+			arg = c ? M_PI / 2 : 0;
+			v = 0.5 * cos(2 * M_PI * 0.0625 * *phase - arg) +
+				0.1 * cos(2 * M_PI * 0.2 * *phase - arg) +
+				0.05 * cos(M_PI * 0.45 * t * *phase - arg) +
+				0.001 * bench_rand();
+			code = (int32_t) (v * full);
+			if (!fmt->is_signed)
+				code += 1U << (fmt->bits - 1);
+			code = (code & ((1ULL << fmt->bits) - 1)) << fmt->shift;
+			memcpy(raw, &code, bytes);
+			raw += bytes;
+		}
+	}
+}
+
+/* A context with one capture device whose scan elements have fmt */
+static struct iio_context * bench_context(unsigned int nb_channels,
+		const struct bench_format *fmt)
+{
+	struct iio_context *bctx;
+	GString *xml;
+	unsigned int i;
+
+	xml = g_string_new("<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+			"<context name=\"xml\"><device id=\"iio:device0\" "
+			"name=\"" BENCH_DEVICE "\">");
+	for (i = 0; i < nb_channels; i++)
+		g_string_append_printf(xml, "<channel id=\"voltage%u\" "
+				"type=\"input\"><scan-element index=\"%u\" "
+				"format=\"le:%c%u/%u&gt;&gt;%u\" /></channel>",
+				i, i, fmt->is_signed ? 'S' : 'U', fmt->bits,
+				fmt->length, fmt->shift);
+	g_string_append(xml, "</device></context>");
+
+	bctx = iio_create_xml_context_mem(xml->str, xml->len);
+	g_string_free(xml, TRUE);
+	return bctx;
+}
+
+struct bench_stage {
+	const char *name;
+	unsigned int iterations;
+	gint64 total;
+	unsigned long long samples;
+};
+
+/* Stages that didn't run are left out */
+static void bench_report(const struct bench_stage *st, unsigned int nb)
+{
+	unsigned int i;
+
+	printf("stage,iterations,total_ms,avg_us,msps\n");
+	for (i = 0; i < nb; i++)
+		if (st[i].iterations)
+			printf("%s,%u,%.3f,%.3f,%.3f\n", st[i].name,
+					st[i].iterations, st[i].total / 1000.0,
+					(double) st[i].total / st[i].iterations,
+					st[i].total ? (double) st[i].samples /
+					st[i].total : 0);
+}
+
+/*
+ * spec is a comma separated list of key=value: fft, channels (1 or 2),
+ * bits, shift, signed, iterations. Missing keys keep their defaults.
+ *
+ * The synthetic frames go through the same code as a capture: the demux of
+ * osc.c, then the FFT and cross correlation transforms of the plots, then
+ * the analysis and framing of the headless stream. The draw of a plot is
+ * timed too when there is a display to draw on.
+ */
+int headless_bench(const char *spec, const char *profile)
+{
+	struct bench_format fmt = { 12, 0, 16, true };
+	struct headless_marker mk[HEADLESS_MAX_MARKERS];
+	struct headless_spectrum spec_hdr;
+	struct headless_metrics met;
+	struct headless_state h;
+	enum { SYNTH, DEMUX, FFT, XCORR, REDRAW, PEAKS, METRICS, FRAME,
+		PROFILE, STAGES };
+	struct bench_stage st[STAGES] = {
+		{ .name = "synth" }, { .name = "demux" }, { .name = "fft" },
+		{ .name = "xcorr" }, { .name = "redraw" },
+		{ .name = "peaks" }, { .name = "metrics" },
+		{ .name = "frame" }, { .name = "profile_load" },
+	};
+	unsigned int i, n, iterations = 100, fft = 8192, channels = 2;
+	unsigned long long phase = 0;
+	struct iio_context *bctx;
+	struct iio_device *dev;
+	Transform *tr_fft, *tr_xcorr = NULL;
+	OscPlot *plot = NULL;
+	uint32_t nb_markers;
+	gchar **keys, **kv;
+	uint8_t *raw;
+	gint64 t;
+	int ret = 0;
+
+	keys = g_strsplit(spec ? spec : "", ",", 0);
+	for (i = 0; keys[i]; i++) {
+		kv = g_strsplit(keys[i], "=", 2);
+		if (kv[0] && kv[1]) {
+			if (!strcmp(kv[0], "fft"))
+				fft = atoi(kv[1]);
+			else if (!strcmp(kv[0], "channels"))
+				channels = atoi(kv[1]);
+			else if (!strcmp(kv[0], "bits"))
+				fmt.bits = atoi(kv[1]);
+			else if (!strcmp(kv[0], "shift"))
+				fmt.shift = atoi(kv[1]);
+			else if (!strcmp(kv[0], "signed"))
+				fmt.is_signed = !!atoi(kv[1]);
+			else if (!strcmp(kv[0], "iterations"))
+				iterations = atoi(kv[1]);
+			else
+				fprintf(stderr, "Bench: unknown key %s\n", kv[0]);
+		}
+		g_strfreev(kv);
+	}
+	g_strfreev(keys);
+
+	if (fmt.bits < 2 || fmt.bits > 32 || fmt.bits + fmt.shift > 32 ||
+			channels < 1 || channels > 2 || !iterations) {
+		fprintf(stderr, "Bench: invalid parameters\n");
+		return -EINVAL;
+	}
+	fmt.length = fmt.bits + fmt.shift <= 8 ? 8 :
+		fmt.bits + fmt.shift <= 16 ? 16 : 32;
+
+	for (n = 32; n * 2 <= fft && n * 2 <= MAX_SAMPLES; n *= 2);
+
+	bctx = bench_context(channels, &fmt);
+	if (!bctx) {
+		fprintf(stderr, "Bench: unable to create the context\n");
+		return -ENOMEM;
+	}
+	dev = iio_context_find_device(bctx, BENCH_DEVICE);
+	ret = osc_bench_setup(bctx, n);
+	if (ret < 0) {
+		iio_context_destroy(bctx);
+		return ret;
+	}
+	rx_update_device_sampling_freq(BENCH_DEVICE, 1000000);
+
+	tr_fft = osc_plot_bench_transform_new(dev, channels == 2 ?
+			COMPLEX_FFT_TRANSFORM : FFT_TRANSFORM, n);
+	if (channels == 2)
+		tr_xcorr = osc_plot_bench_transform_new(dev,
+				CROSS_CORRELATION_TRANSFORM, n);
+	if (!tr_fft || (channels == 2 && !tr_xcorr)) {
+		fprintf(stderr, "Bench: unable to set up the transforms\n");
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	if (gtk_init_check(NULL, NULL)) {
+		plot = OSC_PLOT(osc_plot_new(bctx));
+		osc_plot_bench_show(plot, tr_fft);
+	} else {
+		fprintf(stderr, "Bench: no display, skipping redraw\n");
+	}
+
+	memset(&h, 0, sizeof(h));
+	memset(&cfg, 0, sizeof(cfg));
+	h.listen_fd = -1;
+	h.fft_size = n;
+	h.nb_channels = channels;
+	h.sample_rate = 1000000;
+	cfg.fft_avg = 1;
+	cfg.markers = HEADLESS_DEF_MARKERS;
+	headless_setup_fft(&h);
+	h.frame = g_byte_array_new();
+	raw = g_malloc((size_t) n * iio_device_get_sample_size(dev));
+	bench_rand_state = 1;
+
+	printf("# bench: fft=%u channels=%u bits=%u shift=%u storage=%u "
+			"signed=%d iterations=%u\n", n, channels, fmt.bits,
+			fmt.shift, fmt.length, fmt.is_signed, iterations);
+
+	for (i = 0; i < iterations; i++) {
+		t = g_get_monotonic_time();
+		bench_generate(raw, n, channels, &fmt, &phase);
+		st[SYNTH].total += g_get_monotonic_time() - t;
+
+		t = g_get_monotonic_time();
+		osc_bench_demux(dev, raw, n);
+		st[DEMUX].total += g_get_monotonic_time() - t;
+
+		t = g_get_monotonic_time();
+		Transform_update_output(tr_fft);
+		st[FFT].total += g_get_monotonic_time() - t;
+
+		if (tr_xcorr) {
+			t = g_get_monotonic_time();
+			Transform_update_output(tr_xcorr);
+			st[XCORR].total += g_get_monotonic_time() - t;
+		}
+
+		if (plot) {
+			t = g_get_monotonic_time();
+			osc_plot_bench_redraw(plot);
+			st[REDRAW].total += g_get_monotonic_time() - t;
+		}
+
+		/* The stream analyses the spectrum of the plot FFT */
+		memcpy(h.spectrum, tr_fft->y_axis, h.m * sizeof(float));
+
+		t = g_get_monotonic_time();
+		nb_markers = headless_find_peaks(&h, mk, cfg.markers);
+		st[PEAKS].total += g_get_monotonic_time() - t;
+
+		t = g_get_monotonic_time();
+		memcpy(h.sorted, h.spectrum, h.m * sizeof(float));
+		qsort(h.sorted, h.m, sizeof(float), float_cmp);
+		met.peak_level = nb_markers ? mk[0].level : h.sorted[h.m - 1];
+		met.noise_floor = h.sorted[h.m / 2];
+		met.sfdr = nb_markers > 1 ? mk[0].level - mk[1].level : 0;
+		st[METRICS].total += g_get_monotonic_time() - t;
+
+		t = g_get_monotonic_time();
+		g_byte_array_set_size(h.frame, 0);
+		spec_hdr.sample_rate = h.sample_rate;
+		spec_hdr.bin_width = h.sample_rate / h.fft_size;
+		spec_hdr.start_freq = channels == 2 ? -h.sample_rate / 2 : 0;
+		spec_hdr.bins = h.m;
+		spec_hdr.complex_fft = channels == 2;
+		headless_frame_add(&h, HEADLESS_MSG_SPECTRUM, t, &spec_hdr,
+				sizeof(spec_hdr), h.spectrum,
+				h.m * sizeof(float));
+		headless_frame_add(&h, HEADLESS_MSG_MARKERS, t, &nb_markers,
+				sizeof(nb_markers), mk, nb_markers * sizeof(*mk));
+		headless_frame_add(&h, HEADLESS_MSG_METRICS, t, &met,
+				sizeof(met), NULL, 0);
+		st[FRAME].total += g_get_monotonic_time() - t;
+	}
+
+	for (i = 0; i < PROFILE; i++) {
+		if ((i == XCORR && !tr_xcorr) || (i == REDRAW && !plot))
+			continue;
+		st[i].iterations = iterations;
+		st[i].samples = (unsigned long long) n * iterations;
+	}
+
+	if (profile) {
+		h_ctx = iio_create_default_context();
+		if (h_ctx) {
+			t = g_get_monotonic_time();
+			headless_load_profile(profile);
+			st[PROFILE].total = g_get_monotonic_time() - t;
+			st[PROFILE].iterations = 1;
+			iio_context_destroy(h_ctx);
+			h_ctx = NULL;
+		} else {
+			fprintf(stderr, "Bench: no IIO context, skipping "
+					"profile load\n");
+		}
+	}
+
+	bench_report(st, STAGES);
+
+	g_free(raw);
+	headless_cleanup(&h, NULL);
+out:
+	if (plot)
+		gtk_widget_destroy(GTK_WIDGET(plot));
+	osc_plot_bench_transform_destroy(tr_fft);
+	osc_plot_bench_transform_destroy(tr_xcorr);
+	osc_bench_teardown();
+	iio_context_destroy(bctx);
+	return ret;
+}
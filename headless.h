@@ -0,0 +1,77 @@
+/**
+ * Copyright (C) 2019 Analog Devices, Inc.
+ *
+ * Licensed under the GPL-2.
+ *
+ **/
+
+#ifndef __HEADLESS_H__
+#define __HEADLESS_H__
+
+#include <stdint.h>
+#include <iio.h>
+
+/*
+ * Wire protocol of the headless mode.
+ *
+ * Clients connect to a SOCK_STREAM Unix socket and receive a continuous
+ * stream of messages; nothing is ever read back from them. Every message
+ * starts with a struct headless_msg_hdr followed by 'length' bytes of
+ * payload. All fields are in host byte order (the socket is local).
+ *
+ * One capture produces, in this order and with the same 'seq':
+ *  - HEADLESS_MSG_SPECTRUM: struct headless_spectrum + 'bins' floats (dBFS)
+ *  - HEADLESS_MSG_MARKERS:  'count' (uint32_t) + 'count' struct headless_marker
+ *  - HEADLESS_MSG_METRICS:  struct headless_metrics
+ *
+ * A client that can not keep up simply misses whole captures, the stream
+ * itself never gets truncated in the middle of a message.
+ */
+
+#define HEADLESS_MAGIC		0x4843534f /* "OSCH" */
+#define HEADLESS_VERSION	1
+
+enum headless_msg_type {
+	HEADLESS_MSG_SPECTRUM = 1,
+	HEADLESS_MSG_MARKERS,
+	HEADLESS_MSG_METRICS,
+};
+
+struct headless_msg_hdr {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t type;
+	uint32_t seq;
+	uint32_t length;
+	uint64_t timestamp_us;	/* monotonic, taken right after the refill */
+} __attribute__((packed));
+
+struct headless_spectrum {
+	double sample_rate;
+	double start_freq;	/* frequency of the first bin, in Hz */
+	double bin_width;	/* in Hz */
+	uint32_t bins;
+	uint32_t complex_fft;
+} __attribute__((packed));
+
+struct headless_marker {
+	uint32_t bin;
+	float level;		/* dBFS */
+	double freq;		/* Hz */
+} __attribute__((packed));
+
+struct headless_metrics {
+	float peak_level;	/* dBFS */
+	float noise_floor;	/* median bin, dBFS */
+	float sfdr;		/* dBc, strongest vs second strongest tone */
+	float capture_ms;
+	float transform_ms;
+	uint32_t clients;
+} __attribute__((packed));
+
+int headless_run(struct iio_context *ctx, const char *profile,
+		const char *socket_path);
+void headless_stop(void);
+int headless_bench(const char *spec, const char *profile);
+
+#endif /* __HEADLESS_H__ */
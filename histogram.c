@@ -0,0 +1,226 @@
+/**
+ * Copyright (C) 2019 Analog Devices, Inc.
+ *
+ * Licensed under the GPL-2.
+ *
+ **/
+#include <glib.h>
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+
+#include "histogram.h"
+
+/* Sub-tables per counting thread */
+#define HIST_LANES		4
+#define HIST_MAX_THREADS	4
+/* Smaller frames are counted by the calling thread alone */
+#define HIST_THREAD_MIN		(1 << 18)
+
+struct hist_worker {
+	const struct code_histogram *hist;
+	const int32_t *codes;
+	unsigned int n;
+	uint32_t *lanes;	/* HIST_LANES tables of 'size' counters */
+};
+
+struct code_histogram {
+	unsigned int size;
+	int32_t first;		/* code counted in bin 0 */
+	uint64_t *totals;
+	uint64_t total;
+	uint64_t pending;	/* samples in the sub-tables, not in totals */
+	struct hist_worker workers[HIST_MAX_THREADS];
+};
+
+struct code_histogram * code_histogram_new(unsigned int bits, bool is_signed)
+{
+	struct code_histogram *hist;
+
+	if (!bits || bits > CODE_HISTOGRAM_MAX_BITS)
+		return NULL;
+
+	hist = g_new0(struct code_histogram, 1);
+	hist->size = 1U << bits;
+	hist->first = is_signed ? -(int32_t)(hist->size / 2) : 0;
+	hist->totals = g_new0(uint64_t, hist->size);
+
+	return hist;
+}
+
+void code_histogram_free(struct code_histogram *hist)
+{
+	unsigned int i;
+
+	if (!hist)
+		return;
+
+	for (i = 0; i < HIST_MAX_THREADS; i++)
+		g_free(hist->workers[i].lanes);
+	g_free(hist->totals);
+	g_free(hist);
+}
+
+static void code_histogram_fold(struct code_histogram *hist)
+{
+	unsigned int i, l, b, size = hist->size;
+	uint32_t *lanes;
+	uint64_t sum;
+
+	if (!hist->pending)
+		return;
+
+	for (i = 0; i < HIST_MAX_THREADS; i++) {
+		lanes = hist->workers[i].lanes;
+		if (!lanes)
+			continue;
+
+		for (b = 0; b < size; b++) {
+			sum = 0;
+			for (l = 0; l < HIST_LANES; l++)
+				sum += lanes[l * size + b];
+			hist->totals[b] += sum;
+		}
+		memset(lanes, 0, sizeof(*lanes) * HIST_LANES * size);
+	}
+
+	hist->pending = 0;
+}
+
+void code_histogram_reset(struct code_histogram *hist)
+{
+	unsigned int i;
+
+	for (i = 0; i < HIST_MAX_THREADS; i++)
+		if (hist->workers[i].lanes)
+			memset(hist->workers[i].lanes, 0, sizeof(uint32_t) *
+					HIST_LANES * hist->size);
+	memset(hist->totals, 0, sizeof(*hist->totals) * hist->size);
+	hist->total = 0;
+	hist->pending = 0;
+}
+
+/* Consecutive samples go to different tables, so a run of equal codes
+ * doesn't wait on the previous increment of the same counter */
+static gpointer hist_count(struct hist_worker *w)
+{
+	const int32_t *codes = w->codes;
+	unsigned int size = w->hist->size, i, n = w->n & ~(HIST_LANES - 1);
+	uint32_t mask = size - 1, first = w->hist->first;
+	uint32_t *l0 = w->lanes, *l1 = l0 + size, *l2 = l1 + size, *l3 = l2 + size;
+
+	for (i = 0; i < n; i += HIST_LANES) {
+		l0[((uint32_t) codes[i] - first) & mask]++;
+		l1[((uint32_t) codes[i + 1] - first) & mask]++;
+		l2[((uint32_t) codes[i + 2] - first) & mask]++;
+		l3[((uint32_t) codes[i + 3] - first) & mask]++;
+	}
+	for (; i < w->n; i++)
+		l0[((uint32_t) codes[i] - first) & mask]++;
+
+	return NULL;
+}
+
+void code_histogram_add(struct code_histogram *hist,
+		const int32_t *codes, unsigned int n)
+{
+	GThread *threads[HIST_MAX_THREADS];
+	unsigned int i, nb_threads = 1, chunk;
+	struct hist_worker *w;
+
+	if (!n)
+		return;
+
+	/* A sub-table counter could get every sample, fold before it wraps */
+	if (hist->pending + n > UINT32_MAX)
+		code_histogram_fold(hist);
+
+	if (n >= HIST_THREAD_MIN)
+		nb_threads = CLAMP(g_get_num_processors(), 1, HIST_MAX_THREADS);
+	chunk = (n + nb_threads - 1) / nb_threads;
+
+	for (i = 0; i < nb_threads; i++) {
+		w = &hist->workers[i];
+		if (!w->lanes)
+			w->lanes = g_new0(uint32_t, HIST_LANES * hist->size);
+		w->hist = hist;
+		w->codes = codes + i * chunk;
+		w->n = MIN(chunk, n - i * chunk);
+	}
+
+	for (i = 1; i < nb_threads; i++)
+		threads[i] = g_thread_new("histogram",
+				(GThreadFunc) hist_count, &hist->workers[i]);
+	hist_count(&hist->workers[0]);
+	for (i = 1; i < nb_threads; i++)
+		g_thread_join(threads[i]);
+
+	hist->pending += n;
+	hist->total += n;
+}
+
+unsigned int code_histogram_size(const struct code_histogram *hist)
+{
+	return hist->size;
+}
+
+int32_t code_histogram_first_code(const struct code_histogram *hist)
+{
+	return hist->first;
+}
+
+uint64_t code_histogram_total(struct code_histogram *hist)
+{
+	return hist->total;
+}
+
+/* Counts of the 'size' codes, from the first one up */
+const uint64_t * code_histogram_counts(struct code_histogram *hist)
+{
+	code_histogram_fold(hist);
+	return hist->totals;
+}
+
+/*
+ * Sine wave histogram test (IEEE 1241): with a sine that slightly
+ * overdrives the ADC, the code transition levels follow from the
+ * cumulative histogram as T[k] = -cos(pi * C[k - 1] / N). DNL and INL
+ * are in LSB, INL against the line through the first and last
+ * transitions. The two end codes hold the clipped samples, their DNL
+ * and INL are left at 0.
+ */
+int code_histogram_linearity(struct code_histogram *hist,
+		float *dnl, float *inl)
+{
+	const uint64_t *counts = code_histogram_counts(hist);
+	unsigned int k, size = hist->size;
+	double *t, lsb;
+	uint64_t cum = 0;
+
+	if (size < 4)
+		return -EINVAL;
+	if (!hist->total)
+		return -ENODATA;
+
+	t = g_new(double, size);
+	for (k = 1; k < size; k++) {
+		cum += counts[k - 1];
+		t[k] = -cos(M_PI * (double) cum / hist->total);
+	}
+
+	lsb = (t[size - 1] - t[1]) / (size - 2);
+	if (lsb <= 0) {
+		g_free(t);
+		return -ENODATA;
+	}
+
+	dnl[0] = inl[0] = 0;
+	dnl[size - 1] = inl[size - 1] = 0;
+	for (k = 1; k < size - 1; k++) {
+		dnl[k] = (t[k + 1] - t[k]) / lsb - 1.0;
+		inl[k] = (t[k] - t[1]) / lsb - (k - 1);
+	}
+
+	g_free(t);
+	return 0;
+}
@@ -0,0 +1,41 @@
+/**
+ * Copyright (C) 2019 Analog Devices, Inc.
+ *
+ * Licensed under the GPL-2.
+ *
+ **/
+
+#ifndef __HISTOGRAM_H__
+#define __HISTOGRAM_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * ADC code histogram for linearity testing.
+ *
+ * Raw codes are counted as they are captured and only the counts are kept,
+ * so a histogram can run over any number of samples. Each counting thread
+ * spreads consecutive samples over several sub-tables, which keeps runs of
+ * the same code from serializing on one counter; the sub-tables are folded
+ * into the 64-bit totals when the counts are read.
+ */
+
+#define CODE_HISTOGRAM_MAX_BITS	16
+
+struct code_histogram;
+
+struct code_histogram * code_histogram_new(unsigned int bits, bool is_signed);
+void code_histogram_free(struct code_histogram *hist);
+void code_histogram_reset(struct code_histogram *hist);
+void code_histogram_add(struct code_histogram *hist,
+		const int32_t *codes, unsigned int n);
+
+unsigned int code_histogram_size(const struct code_histogram *hist);
+int32_t code_histogram_first_code(const struct code_histogram *hist);
+uint64_t code_histogram_total(struct code_histogram *hist);
+const uint64_t * code_histogram_counts(struct code_histogram *hist);
+int code_histogram_linearity(struct code_histogram *hist,
+		float *dnl, float *inl);
+
+#endif /* __HISTOGRAM_H__ */
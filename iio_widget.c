@@ -7,18 +7,88 @@
 
 #include <gtk/gtk.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <errno.h>
 #include <string.h>
 #include <math.h>
 
 #include "iio_widget.h"
+#include "osc.h"
+#include "instrument.h"
 
 struct update_widgets_params {
-	struct iio_widget *widgets;
-	unsigned int nb;
+	struct iio_attr_map *map;
 };
 
+struct iio_attr_map {
+	GHashTable *table;	/* attribute name -> GArray of entries */
+};
+
+struct iio_attr_map * iio_attr_map_new(void)
+{
+	struct iio_attr_map *map = g_new(struct iio_attr_map, 1);
+
+	map->table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify) g_array_unref);
+	return map;
+}
+
+/* The "#bit" suffix is split off here, so lookups never parse names */
+void iio_attr_map_add(struct iio_attr_map *map, const char *key, void *data)
+{
+	struct iio_attr_map_entry entry = {
+		.data = data,
+		.bit = -1,
+	};
+	const char *sep = strchr(key, '#');
+	GArray *entries;
+	gchar *name;
+
+	if (sep) {
+		name = g_strndup(key, sep - key);
+		entry.bit = atoi(sep + 1);
+	} else {
+		name = g_strdup(key);
+	}
+
+	entries = g_hash_table_lookup(map->table, name);
+	if (entries) {
+		g_free(name);
+	} else {
+		entries = g_array_new(FALSE, FALSE,
+				sizeof(struct iio_attr_map_entry));
+		g_hash_table_insert(map->table, name, entries);
+	}
+
+	g_array_append_val(entries, entry);
+}
+
+/* Entries keep the order they were added in */
+const struct iio_attr_map_entry * iio_attr_map_lookup(
+		const struct iio_attr_map *map, const char *attr,
+		unsigned int *count)
+{
+	GArray *entries = map ? g_hash_table_lookup(map->table, attr) : NULL;
+
+	if (!entries) {
+		*count = 0;
+		return NULL;
+	}
+
+	*count = entries->len;
+	return (const struct iio_attr_map_entry *) entries->data;
+}
+
+void iio_attr_map_free(struct iio_attr_map *map)
+{
+	if (!map)
+		return;
+
+	g_hash_table_destroy(map->table);
+	g_free(map);
+}
+
 void g_builder_connect_signal(GtkBuilder *builder, const gchar *name,
 	const gchar *signal, GCallback callback, gpointer data)
 {
@@ -379,13 +449,19 @@ void iio_combo_box_init(struct iio_widget *widget, struct iio_device *dev,
 
 void iio_widget_update(struct iio_widget *widget)
 {
+	uint64_t t = instr_now();
+
 	widget->update(widget);
+	instr_record(INSTR_ATTR_IO, t, "widget_update");
 }
 
 void iio_widget_save(struct iio_widget *widget)
 {
+	uint64_t t = instr_now();
+
 	widget->save(widget);
 	widget->update(widget);
+	instr_record(INSTR_ATTR_IO, t, "widget_save");
 }
 
 void iio_update_widgets(struct iio_widget *widgets, unsigned int num_widgets)
@@ -399,14 +475,14 @@ void iio_update_widgets(struct iio_widget *widgets, unsigned int num_widgets)
 static int __cb_dev_update(struct iio_device *dev, const char *attr,
 		const char *value, size_t len, void *d)
 {
-	unsigned int i;
 	struct update_widgets_params *params = d;
+	const struct iio_attr_map_entry *entries;
+	unsigned int i, count;
 
-	for (i = 0; i < params->nb; i++) {
-		struct iio_widget *widget = &params->widgets[i];
-		if (widget->update_value && !widget->chn &&
-				widget->dev == dev &&
-				!strcmp(widget->attr_name, attr)) {
+	entries = iio_attr_map_lookup(params->map, attr, &count);
+	for (i = 0; i < count; i++) {
+		struct iio_widget *widget = entries[i].data;
+		if (!widget->chn && widget->dev == dev) {
 			widget->update_value(widget, value, len);
 			return 0;
 		}
@@ -418,13 +494,14 @@ static int __cb_dev_update(struct iio_device *dev, const char *attr,
 static int __cb_chn_update(struct iio_channel *chn, const char *attr,
 		const char *value, size_t len, void *d)
 {
-	unsigned int i;
 	struct update_widgets_params *params = d;
+	const struct iio_attr_map_entry *entries;
+	unsigned int i, count;
 
-	for (i = 0; i < params->nb; i++) {
-		struct iio_widget *widget = &params->widgets[i];
-		if (widget->update_value && widget->chn == chn &&
-				!strcmp(widget->attr_name, attr)) {
+	entries = iio_attr_map_lookup(params->map, attr, &count);
+	for (i = 0; i < count; i++) {
+		struct iio_widget *widget = entries[i].data;
+		if (widget->chn == chn) {
 			widget->update_value(widget, value, len);
 			return 0;
 		}
@@ -433,20 +510,30 @@ static int __cb_chn_update(struct iio_channel *chn, const char *attr,
 	return 0;
 }
 
+/* Indexing the widgets first makes the refresh a single pass over the
+ * attributes instead of a scan of all widgets for each of them. */
 void iio_update_widgets_of_device(struct iio_widget *widgets,
 		unsigned int num_widgets, struct iio_device *dev)
 {
 	unsigned int i;
 	struct update_widgets_params params = {
-		.widgets = widgets,
-		.nb = num_widgets,
+		.map = iio_attr_map_new(),
 	};
+	uint64_t t = instr_now();
+
+	for (i = 0; i < num_widgets; i++)
+		if (widgets[i].update_value && widgets[i].attr_name)
+			iio_attr_map_add(params.map, widgets[i].attr_name,
+					&widgets[i]);
 
 	iio_device_attr_read_all(dev, __cb_dev_update, &params);
 
 	for (i = 0; i < iio_device_get_channels_count(dev); i++)
 		iio_channel_attr_read_all(iio_device_get_channel(dev, i),
 				__cb_chn_update, &params);
+	instr_record(INSTR_ATTR_IO, t, "read_all");
+
+	iio_attr_map_free(params.map);
 }
 
 void iio_save_widgets(struct iio_widget *widgets, unsigned int num_widgets)
@@ -457,6 +544,19 @@ void iio_save_widgets(struct iio_widget *widgets, unsigned int num_widgets)
 		iio_widget_save(&widgets[i]);
 }
 
+/* Points the widgets at the handles of 'ctx', a new context of the same
+ * hardware, after the link to it was reopened */
+void iio_rebind_widgets(struct iio_widget *widgets, unsigned int num_widgets,
+		struct iio_context *ctx)
+{
+	unsigned int i;
+
+	for (i = 0; i < num_widgets; i++) {
+		widgets[i].dev = osc_device_rebind(ctx, widgets[i].dev);
+		widgets[i].chn = osc_channel_rebind(ctx, widgets[i].chn);
+	}
+}
+
 void iio_spin_button_init_from_builder(struct iio_widget *widget,
 	struct iio_device *dev, struct iio_channel *chn, const char *attr_name,
 	GtkBuilder *builder, const char *widget_name, const gdouble *scale)
@@ -33,12 +33,29 @@ void g_builder_bind_property(GtkBuilder *builder,
 	const gchar *target_name, const gchar *target_property,
 	GBindingFlags flags);
 
+/* Attribute name to item index, keys may be "attr" or "attr#bit" */
+struct iio_attr_map_entry {
+	void *data;
+	int bit;	/* -1 when the key has no "#bit" suffix */
+};
+
+struct iio_attr_map;
+
+struct iio_attr_map * iio_attr_map_new(void);
+void iio_attr_map_add(struct iio_attr_map *map, const char *key, void *data);
+const struct iio_attr_map_entry * iio_attr_map_lookup(
+		const struct iio_attr_map *map, const char *attr,
+		unsigned int *count);
+void iio_attr_map_free(struct iio_attr_map *map);
+
 void iio_update_widgets(struct iio_widget *widgets, unsigned int num_widgets);
 void iio_widget_update(struct iio_widget *widget);
 void iio_update_widgets_of_device(struct iio_widget *widgets,
 		unsigned int num_widgets, struct iio_device *dev);
 void iio_widget_save(struct iio_widget *widget);
 void iio_save_widgets(struct iio_widget *widgets, unsigned int num_widgets);
+void iio_rebind_widgets(struct iio_widget *widgets, unsigned int num_widgets,
+		struct iio_context *ctx);
 
 void iio_spin_button_init(struct iio_widget *widget, struct iio_device *dev,
 	struct iio_channel *chn, const char *attr_name,
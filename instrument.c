@@ -0,0 +1,315 @@
+/**
+ * Copyright (C) 2019 Analog Devices, Inc.
+ *
+ * Licensed under the GPL-2.
+ *
+ **/
+#include <glib.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "instrument.h"
+
+/* Last events kept per thread for the trace export */
+#define INSTR_RING_SIZE 8192
+
+struct instr_event {
+	uint64_t start;
+	uint64_t dur;
+	const char *label;
+	enum instr_stage stage;
+};
+
+/* Only the owner writes, nothing it does ever waits for a reader.
+ * 'seq' is odd while the counters are being updated, readers copy them
+ * again until it stayed the same even value. The ring is never copied
+ * under 'seq': 'head' only grows, and a reader keeps the events that
+ * were not overwritten while it was copying. */
+struct instr_thread {
+	unsigned int tid;
+	gint seq;
+	unsigned int generation;
+	struct instr_stats stats[INSTR_STAGES_COUNT];
+	unsigned int ring_base;
+	struct instr_event ring[INSTR_RING_SIZE];
+	unsigned int head;
+	struct instr_thread *next;
+};
+
+static const char * const stage_names[INSTR_STAGES_COUNT] = {
+	[INSTR_REFILL] = "refill",
+	[INSTR_DEMUX] = "demux",
+	[INSTR_TRIGGER] = "trigger",
+	[INSTR_TRANSFORM] = "transform",
+	[INSTR_MATH] = "math",
+	[INSTR_REDRAW] = "redraw",
+	[INSTR_ATTR_IO] = "attr_io",
+};
+
+static void instr_thread_unregister(gpointer data);
+
+static GPrivate instr_self = G_PRIVATE_INIT(instr_thread_unregister);
+static struct instr_thread *instr_threads;
+static volatile unsigned int instr_generation;
+static unsigned int instr_thread_count;
+static uint64_t instr_epoch;
+/* Counters of the threads that exited since the last reset */
+static struct instr_stats instr_retired[INSTR_STAGES_COUNT];
+static unsigned int instr_retired_generation;
+G_LOCK_DEFINE_STATIC(instr_register);
+
+uint64_t instr_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+const char * instr_stage_name(enum instr_stage stage)
+{
+	return stage < INSTR_STAGES_COUNT ? stage_names[stage] : "unknown";
+}
+
+static void instr_stats_add(struct instr_stats *dst,
+		const struct instr_stats *src)
+{
+	unsigned int i;
+
+	for (i = 0; i < INSTR_STAGES_COUNT; i++) {
+		dst[i].count += src[i].count;
+		dst[i].total_ns += src[i].total_ns;
+		if (src[i].max_ns > dst[i].max_ns)
+			dst[i].max_ns = src[i].max_ns;
+	}
+}
+
+/* The register lock is only taken the first time a thread records
+ * something, and when it exits */
+static struct instr_thread * instr_thread_register(uint64_t start)
+{
+	struct instr_thread *t = g_new0(struct instr_thread, 1);
+
+	G_LOCK(instr_register);
+	if (!instr_epoch || start < instr_epoch)
+		instr_epoch = start;
+	t->tid = ++instr_thread_count;
+	t->generation = instr_generation;
+	t->next = instr_threads;
+	instr_threads = t;
+	G_UNLOCK(instr_register);
+
+	g_private_set(&instr_self, t);
+	return t;
+}
+
+/* Called by GLib when a recording thread exits. Its counters are kept in
+ * the totals, its events go with it. */
+static void instr_thread_unregister(gpointer data)
+{
+	struct instr_thread *t = data, **p;
+
+	G_LOCK(instr_register);
+	for (p = &instr_threads; *p; p = &(*p)->next) {
+		if (*p == t) {
+			*p = t->next;
+			break;
+		}
+	}
+
+	if (instr_retired_generation != instr_generation) {
+		memset(instr_retired, 0, sizeof(instr_retired));
+		instr_retired_generation = instr_generation;
+	}
+	if (t->generation == instr_generation)
+		instr_stats_add(instr_retired, t->stats);
+	G_UNLOCK(instr_register);
+
+	g_free(t);
+}
+
+/* Copies the counters of a thread, FALSE if they are from before the last
+ * reset. Called with the register lock held. */
+static gboolean instr_thread_read(struct instr_thread *t,
+		struct instr_stats *stats, unsigned int *ring_base,
+		unsigned int *head)
+{
+	gint seq;
+	gboolean current;
+
+	do {
+		while ((seq = g_atomic_int_get(&t->seq)) & 1)
+			g_thread_yield();
+
+		current = t->generation == instr_generation;
+		if (stats)
+			memcpy(stats, t->stats, sizeof(t->stats));
+		if (ring_base)
+			*ring_base = t->ring_base;
+		if (head)
+			*head = t->head;
+
+		/* The copies above must be done before 'seq' is read again */
+		__sync_synchronize();
+	} while (g_atomic_int_get(&t->seq) != seq);
+
+	return current;
+}
+
+void instr_record(enum instr_stage stage, uint64_t start, const char *label)
+{
+	struct instr_thread *t = g_private_get(&instr_self);
+	struct instr_stats *st;
+	struct instr_event *ev;
+	uint64_t dur = instr_now() - start;
+
+	if (!t)
+		t = instr_thread_register(start);
+
+	/* Both increments are full barriers */
+	g_atomic_int_inc(&t->seq);
+
+	/* A reset is applied by the owner, readers never write */
+	if (t->generation != instr_generation) {
+		memset(t->stats, 0, sizeof(t->stats));
+		t->ring_base = t->head;
+		t->generation = instr_generation;
+	}
+
+	st = &t->stats[stage];
+	st->count++;
+	st->total_ns += dur;
+	if (dur > st->max_ns)
+		st->max_ns = dur;
+
+	ev = &t->ring[t->head % INSTR_RING_SIZE];
+	ev->start = start;
+	ev->dur = dur;
+	ev->label = label;
+	ev->stage = stage;
+	t->head++;
+
+	g_atomic_int_inc(&t->seq);
+}
+
+void instr_reset(void)
+{
+	G_LOCK(instr_register);
+	instr_epoch = instr_now();
+	instr_generation++;
+	G_UNLOCK(instr_register);
+}
+
+/* Sums all threads, including the ones that already exited */
+void instr_get_stats(struct instr_stats *stats)
+{
+	struct instr_stats thread_stats[INSTR_STAGES_COUNT];
+	struct instr_thread *t;
+
+	memset(stats, 0, sizeof(*stats) * INSTR_STAGES_COUNT);
+
+	G_LOCK(instr_register);
+	if (instr_retired_generation == instr_generation)
+		instr_stats_add(stats, instr_retired);
+
+	for (t = instr_threads; t; t = t->next)
+		if (instr_thread_read(t, thread_stats, NULL, NULL))
+			instr_stats_add(stats, thread_stats);
+	G_UNLOCK(instr_register);
+}
+
+/* Chrome trace event format, loads in chrome://tracing and Perfetto. The
+ * rings are copied while their threads keep recording. */
+int instr_export_chrome_trace(const char *filename)
+{
+	struct instr_thread *t;
+	struct instr_event *ring, *ev;
+	unsigned int i, base, head, used, count;
+	bool sep = false;
+	FILE *fp;
+
+	fp = fopen(filename, "w");
+	if (!fp)
+		return -errno;
+
+	ring = g_new(struct instr_event, INSTR_RING_SIZE);
+
+	fprintf(fp, "{\"traceEvents\":[\n");
+	G_LOCK(instr_register);
+	for (t = instr_threads; t; t = t->next) {
+		if (!instr_thread_read(t, NULL, &base, &head))
+			continue;
+
+		memcpy(ring, t->ring, sizeof(t->ring));
+		__sync_synchronize();
+
+		/* The slots the owner wrote during the copy, the one it may be
+		 * writing included, held the oldest events */
+		used = (unsigned int) g_atomic_int_get(&t->head) - head + 1;
+		count = MIN(head - base, INSTR_RING_SIZE - MIN(used,
+					INSTR_RING_SIZE));
+
+		fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+				"\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+				sep ? ",\n" : "", t->tid, t->tid);
+		sep = true;
+
+		for (i = head - count; i != head; i++) {
+			ev = &ring[i % INSTR_RING_SIZE];
+			fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"osc\",\"ph\":\"X\","
+					"\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u",
+					ev->label ?: instr_stage_name(ev->stage),
+					ev->start > instr_epoch ?
+					(ev->start - instr_epoch) / 1000.0 : 0.0,
+					ev->dur / 1000.0, t->tid);
+			if (ev->label)
+				fprintf(fp, ",\"args\":{\"stage\":\"%s\"}",
+						instr_stage_name(ev->stage));
+			fprintf(fp, "}");
+		}
+	}
+	G_UNLOCK(instr_register);
+	fprintf(fp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+	g_free(ring);
+	fclose(fp);
+	return 0;
+}
+
+int instr_export_csv(const char *filename)
+{
+	struct instr_stats stats[INSTR_STAGES_COUNT], *st;
+	struct instr_thread *t;
+	unsigned int i;
+	FILE *fp;
+
+	fp = fopen(filename, "w");
+	if (!fp)
+		return -errno;
+
+	fprintf(fp, "thread,stage,count,total_ms,avg_us,max_us\n");
+	G_LOCK(instr_register);
+	for (t = instr_threads; t; t = t->next) {
+		if (!instr_thread_read(t, stats, NULL, NULL))
+			continue;
+
+		for (i = 0; i < INSTR_STAGES_COUNT; i++) {
+			st = &stats[i];
+			if (!st->count)
+				continue;
+			fprintf(fp, "%u,%s,%llu,%.3f,%.3f,%.3f\n", t->tid,
+					instr_stage_name(i),
+					(unsigned long long) st->count,
+					st->total_ns / 1e6,
+					st->total_ns / 1e3 / st->count,
+					st->max_ns / 1e3);
+		}
+	}
+	G_UNLOCK(instr_register);
+
+	fclose(fp);
+	return 0;
+}
@@ -0,0 +1,50 @@
+/**
+ * Copyright (C) 2019 Analog Devices, Inc.
+ *
+ * Licensed under the GPL-2.
+ *
+ **/
+
+#ifndef __INSTRUMENT_H__
+#define __INSTRUMENT_H__
+
+#include <stdint.h>
+
+/*
+ * Always-on timing of the capture pipeline stages. Every thread records
+ * into its own counters and event ring without locking, readers retry
+ * until they got a consistent copy.
+ *
+ *	uint64_t t = instr_now();
+ *	...
+ *	instr_record(INSTR_DEMUX, t, NULL);
+ */
+
+enum instr_stage {
+	INSTR_REFILL,
+	INSTR_DEMUX,
+	INSTR_TRIGGER,
+	INSTR_TRANSFORM,
+	INSTR_MATH,
+	INSTR_REDRAW,
+	INSTR_ATTR_IO,
+	INSTR_STAGES_COUNT
+};
+
+struct instr_stats {
+	uint64_t count;
+	uint64_t total_ns;
+	uint64_t max_ns;
+};
+
+uint64_t instr_now(void);
+void instr_record(enum instr_stage stage, uint64_t start, const char *label);
+
+const char * instr_stage_name(enum instr_stage stage);
+void instr_get_stats(struct instr_stats *stats);
+void instr_reset(void);
+
+int instr_export_chrome_trace(const char *filename);
+int instr_export_csv(const char *filename);
+
+#endif /* __INSTRUMENT_H__ */
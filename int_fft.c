@@ -245,7 +245,7 @@ db_from_ampl (fixed re, fixed im)
 {
   static long loud2[N_LOUD] = { 0 };
   long v;
-  int i;
+  int i, lo, hi;
 
   if (loud2[0] == 0)
     {
@@ -260,11 +260,19 @@ db_from_ampl (fixed re, fixed im)
 
   v = (long) re *(long) re + (long) im *(long) im;
 
-  for (i = 0; i < N_LOUD; ++i)
-    if (loud2[i] <= v)
-      break;
+  /* loud2[] is decreasing: binary search for the first entry <= v */
+  lo = 0;
+  hi = N_LOUD;
+  while (lo < hi)
+    {
+      i = (lo + hi) >> 1;
+      if (loud2[i] <= v)
+	hi = i;
+      else
+	lo = i + 1;
+    }
 
-  return (-i);
+  return (-lo);
 }
 
 /*
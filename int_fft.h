@@ -3,8 +3,12 @@
 #define fixed short
 #endif
 
+/* Largest transform supported by the Sinewave[] table */
+#define FIX_FFT_MAX_POINTS 1024
+
 extern int fix_fft (fixed *, fixed *, int, int);
 extern int iscale (int, int, int);
 extern void window (fixed *, int);
 extern void fix_loud (fixed loud[], fixed fr[], fixed fi[], int n, int scale_shift);
+extern int db_from_ampl (fixed re, fixed im);
 
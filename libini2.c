@@ -20,23 +20,8 @@ struct load_store_params {
 	size_t list_len;
 	bool is_debug;
 	FILE *f;
-	struct INI *ini;
-	const void *section_top;
 };
 
-static bool attr_matches(const char *dev_name, size_t dev_len,
-		const char *attr, size_t attr_len,
-		const char *key, size_t len, bool debug)
-{
-	return (!debug && (len == dev_len + 1 + attr_len) &&
-			!strncmp(key, dev_name, dev_len) &&
-			!strncmp(key + dev_len + 1, attr, attr_len)) ||
-		(debug && (len == dev_len + sizeof("debug.") + attr_len) &&
-			!strncmp(key, "debug.", sizeof("debug.") - 1) &&
-			!strncmp(key + sizeof("debug.") - 1, dev_name, dev_len) &&
-			!strncmp(key + sizeof("debug.") + dev_len, attr, attr_len));
-}
-
 static bool attr_in_whitelist(const char *attr,
 		const char *dev_name, size_t dev_len, bool is_debug,
 		const char * const *whitelist, size_t list_len)
@@ -52,88 +37,274 @@ static bool attr_in_whitelist(const char *attr,
 	return false;
 }
 
-static ssize_t read_from_ini(struct load_store_params *params,
-		const char *dev_name, size_t name_len,
-		const char *attr, void *buf, size_t len)
+/*
+ * Profile loads only write the attributes whose value differs from what
+ * the hardware holds. The writes go in passes, the attributes others
+ * depend on first and the state machine last. The current values are read
+ * with one bulk read per channel and per device, again after each pass
+ * that wrote something, as the writes can change the attributes of the
+ * passes that follow.
+ */
+static const struct {
+	const char *suffix;
+	unsigned int rank;
+} attr_write_order[] = {
+	{ "rate_governor", 0 },
+	{ "sampling_frequency", 1 },
+	{ "rf_bandwidth", 2 },
+	{ "gain_control_mode", 2 },
+	{ "ensm_mode", 4 },
+};
+
+#define ATTR_RANK_DEFAULT 3
+#define ATTR_RANK_LAST 4
+
+struct ini_write {
+	struct iio_channel *chn;	/* NULL for device attributes */
+	const char *attr;
+	bool is_debug;
+	char *value;
+};
+
+struct ini_snapshot {
+	struct iio_device *dev;
+	const char *dev_name;
+	size_t name_len;
+	const char * const *whitelist;
+	size_t list_len;
+	bool is_debug;
+	bool has_debug;			/* the whitelist has debug attributes */
+	GHashTable *values;		/* key as in the INI file -> value */
+};
+
+static unsigned int attr_rank(const char *attr)
 {
-	bool found = false;
-	const char *key, *value;
-	size_t klen, vlen;
+	size_t len = strlen(attr), slen;
+	unsigned int i;
 
-	if (!len)
-		return 0;
+	for (i = 0; i < G_N_ELEMENTS(attr_write_order); i++) {
+		slen = strlen(attr_write_order[i].suffix);
+		if (len >= slen && !strcmp(attr + len - slen,
+					attr_write_order[i].suffix))
+			return attr_write_order[i].rank;
+	}
 
-	/* Rewind to the beginning of the section */
-	ini_set_read_pointer(params->ini, params->section_top);
+	return ATTR_RANK_DEFAULT;
+}
 
-	while (!found && ini_read_pair(params->ini,
-				&key, &klen, &value, &vlen) > 0)
-		found = attr_matches(dev_name, name_len, attr, strlen(attr),
-				key, klen, params->is_debug);
-	if (!found)
-		return 0;
+static gchar * ini_key(const char *dev_name, const char *attr, bool is_debug)
+{
+	return g_strdup_printf("%s%s.%s", is_debug ? "debug." : "",
+			dev_name ?: "", attr);
+}
+
+/* Values are compared as numbers when both sides are, so "1.0" and
+ * "1.000000" don't cause a write */
+static bool attr_value_equal(const char *a, const char *b)
+{
+	char *end_a, *end_b;
+	double da, db;
+
+	if (!strcmp(a, b))
+		return true;
+
+	da = g_ascii_strtod(a, &end_a);
+	db = g_ascii_strtod(b, &end_b);
+	if (end_a == a || end_b == b)
+		return false;
 
-	if (len > vlen)
-		len = vlen;
-	memcpy(buf, value, len);
-	return (ssize_t) len;
+	while (g_ascii_isspace(*end_a))
+		end_a++;
+	while (g_ascii_isspace(*end_b))
+		end_b++;
+
+	/* Allows for a common unit suffix, like the " dB" of hardwaregain */
+	return !strcmp(end_a, end_b) && da == db;
 }
 
-static ssize_t update_from_ini_dev_cb(struct iio_device *dev,
-		const char *attr, void *buf, size_t len, void *d)
+static void snapshot_add(struct ini_snapshot *snap,
+		const char *attr, const char *val, size_t len)
 {
-	struct load_store_params *params = (struct load_store_params *) d;
-	const char *dev_name = iio_device_get_name(dev);
-	size_t name_len = dev_name ? strlen(dev_name) : 0;
+	if (!attr_in_whitelist(attr, snap->dev_name, snap->name_len,
+				snap->is_debug, snap->whitelist, snap->list_len))
+		return;
 
-	if (attr_in_whitelist(attr, dev_name, name_len, params->is_debug,
-				params->whitelist, params->list_len))
-		return read_from_ini(params,
-				dev_name, name_len, attr, buf, len);
+	g_hash_table_insert(snap->values,
+			ini_key(snap->dev_name, attr, snap->is_debug),
+			g_strstrip(g_strndup(val, len)));
+}
+
+static int snapshot_dev_cb(struct iio_device *dev,
+		const char *attr, const char *val, size_t len, void *d)
+{
+	snapshot_add((struct ini_snapshot *) d, attr, val, len);
 	return 0;
 }
 
-static ssize_t update_from_ini_chn_cb(struct iio_channel *chn,
-		const char *attr, void *buf, size_t len, void *d)
+static int snapshot_chn_cb(struct iio_channel *chn,
+		const char *attr, const char *val, size_t len, void *d)
 {
-	struct load_store_params *params = (struct load_store_params *) d;
-	const char *dev_name = iio_device_get_name(params->dev);
-	size_t name_len = dev_name ? strlen(dev_name) : 0;
-	bool is_hardwaregain = !strncmp(attr, "hardwaregain", len);
+	snapshot_add((struct ini_snapshot *) d,
+			iio_channel_attr_get_filename(chn, attr), val, len);
+	return 0;
+}
 
-	attr = iio_channel_attr_get_filename(chn, attr);
-	if (attr_in_whitelist(attr, dev_name, name_len, false,
-				params->whitelist, params->list_len)) {
-		ssize_t ret = read_from_ini(params,
-				dev_name, name_len, attr, buf, len);
-
-		/* Dirty workaround that strips the "dB" suffix of
-		 * hardwaregain value. Fix me when possible. */
-		if (is_hardwaregain) {
-			char *tmp = strstr((char *) buf, " dB");
-			if (tmp)
-				*tmp = '\0';
+static bool whitelist_has_debug(const char *dev_name, size_t dev_len,
+		const char * const *whitelist, size_t list_len)
+{
+	unsigned int i;
+
+	for (i = 0; i < list_len && whitelist[i]; i++)
+		if (!strncmp(whitelist[i], "debug.", sizeof("debug.") - 1) &&
+				!strncmp(whitelist[i] + sizeof("debug.") - 1,
+					dev_name, dev_len))
+			return true;
+	return false;
+}
+
+/* What the hardware holds now. Attributes that can't be read aren't in
+ * there, and neither is anything if the bulk reads aren't supported:
+ * those are always written. */
+static void snapshot_read(struct ini_snapshot *snap)
+{
+	struct iio_device *dev = snap->dev;
+	unsigned int i;
+
+	g_hash_table_remove_all(snap->values);
+
+	for (i = 0; i < iio_device_get_channels_count(dev); i++)
+		iio_channel_attr_read_all(iio_device_get_channel(dev, i),
+				snapshot_chn_cb, snap);
+	if (iio_device_get_attrs_count(dev))
+		iio_device_attr_read_all(dev, snapshot_dev_cb, snap);
+	if (snap->has_debug) {
+		snap->is_debug = true;
+		iio_device_debug_attr_read_all(dev, snapshot_dev_cb, snap);
+		snap->is_debug = false;
+	}
+}
+
+/* Queues a write of 'attr' if it belongs to the pass 'rank' and the
+ * profile has a different value for it. Attributes shared by several
+ * channels have one file, they are only queued once. */
+static void diff_attr(GArray *writes, GHashTable *queued, GHashTable *profile,
+		struct ini_snapshot *snap, unsigned int rank,
+		struct iio_channel *chn, const char *attr, const char *filename)
+{
+	struct ini_write w;
+	const char *value, *cur;
+	gchar *key;
+	char *tmp;
+
+	if (attr_rank(filename) != rank ||
+			!attr_in_whitelist(filename, snap->dev_name,
+				snap->name_len, snap->is_debug,
+				snap->whitelist, snap->list_len))
+		return;
+
+	key = ini_key(snap->dev_name, filename, snap->is_debug);
+	value = g_hash_table_lookup(profile, key);
+	cur = g_hash_table_lookup(snap->values, key);
+
+	if (!value || (cur && attr_value_equal(value, cur)) ||
+			g_hash_table_lookup(queued, key)) {
+		g_free(key);
+		return;
+	}
+	g_hash_table_insert(queued, key, GINT_TO_POINTER(1));
+
+	w.chn = chn;
+	w.attr = attr;
+	w.is_debug = snap->is_debug;
+	w.value = g_strdup(value);
+
+	/* Dirty workaround that strips the "dB" suffix of
+	 * hardwaregain value. Fix me when possible. */
+	if (chn && !strcmp(attr, "hardwaregain")) {
+		tmp = strstr(w.value, " dB");
+		if (tmp)
+			*tmp = '\0';
+	}
+
+	g_array_append_val(writes, w);
+}
+
+static void diff_rank(GArray *writes, GHashTable *queued, GHashTable *profile,
+		struct ini_snapshot *snap, unsigned int rank)
+{
+	struct iio_device *dev = snap->dev;
+	unsigned int i, j;
+
+	for (i = 0; i < iio_device_get_channels_count(dev); i++) {
+		struct iio_channel *chn = iio_device_get_channel(dev, i);
+
+		for (j = 0; j < iio_channel_get_attrs_count(chn); j++) {
+			const char *attr = iio_channel_get_attr(chn, j);
+
+			diff_attr(writes, queued, profile, snap, rank, chn, attr,
+					iio_channel_attr_get_filename(chn, attr));
 		}
-		return ret;
 	}
-	return 0;
+
+	for (j = 0; j < iio_device_get_attrs_count(dev); j++) {
+		const char *attr = iio_device_get_attr(dev, j);
+
+		diff_attr(writes, queued, profile, snap, rank, NULL, attr, attr);
+	}
+
+	if (!snap->has_debug)
+		return;
+
+	snap->is_debug = true;
+	for (j = 0; j < iio_device_get_debug_attrs_count(dev); j++) {
+		const char *attr = iio_device_get_debug_attr(dev, j);
+
+		diff_attr(writes, queued, profile, snap, rank, NULL, attr, attr);
+	}
+	snap->is_debug = false;
+}
+
+static void apply_writes(struct iio_device *dev, GArray *writes)
+{
+	unsigned int i;
+
+	for (i = 0; i < writes->len; i++) {
+		struct ini_write *w = &g_array_index(writes, struct ini_write, i);
+		ssize_t ret;
+
+		if (w->chn)
+			ret = iio_channel_attr_write(w->chn, w->attr, w->value);
+		else if (w->is_debug)
+			ret = iio_device_debug_attr_write(dev, w->attr, w->value);
+		else
+			ret = iio_device_attr_write(dev, w->attr, w->value);
+
+		if (ret < 0)
+			fprintf(stderr, "Unable to write %s: %s\n",
+					w->attr, strerror((int) -ret));
+		g_free(w->value);
+	}
+
+	g_array_set_size(writes, 0);
 }
 
 void update_from_ini(const char *ini_file,
 		const char *driver_name, struct iio_device *dev,
 		const char * const *whitelist, size_t list_len)
 {
-	bool found = false;
-	const char *name;
-	size_t nlen, dlen;
-	unsigned int i;
+	bool found = false, stale = true;
+	const char *name, *key, *value;
+	size_t nlen, dlen, klen, vlen;
+	unsigned int rank;
 	struct INI *ini = ini_open(ini_file);
-	struct load_store_params params = {
+	GHashTable *profile, *queued;
+	GArray *writes;
+	struct ini_snapshot snap = {
 		.dev = dev,
+		.dev_name = iio_device_get_name(dev),
 		.whitelist = whitelist,
 		.list_len = list_len,
 		.is_debug = false,
-		.ini = ini,
 	};
 
 	if (!ini) {
@@ -155,19 +326,44 @@ void update_from_ini(const char *ini_file,
 		return;
 	}
 
-	params.section_top = name + nlen + 1;
+	/* The first occurrence of a key is the one that counts */
+	profile = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	while (ini_read_pair(ini, &key, &klen, &value, &vlen) > 0) {
+		gchar *k = g_strndup(key, klen);
 
-	for (i = 0; i < iio_device_get_channels_count(dev); i++)
-		iio_channel_attr_write_all(iio_device_get_channel(dev, i),
-				update_from_ini_chn_cb, &params);
+		if (g_hash_table_lookup(profile, k))
+			g_free(k);
+		else
+			g_hash_table_insert(profile, k,
+					g_strstrip(g_strndup(value, vlen)));
+	}
+	ini_close(ini);
 
-	if (iio_device_get_attrs_count(dev))
-		iio_device_attr_write_all(dev, update_from_ini_dev_cb, &params);
+	snap.name_len = snap.dev_name ? strlen(snap.dev_name) : 0;
+	snap.has_debug = whitelist_has_debug(snap.dev_name, snap.name_len,
+			whitelist, list_len);
+	snap.values = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, g_free);
+	queued = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	writes = g_array_new(FALSE, FALSE, sizeof(struct ini_write));
+
+	for (rank = 0; rank <= ATTR_RANK_LAST; rank++) {
+		if (stale) {
+			snapshot_read(&snap);
+			stale = false;
+		}
 
-	params.is_debug = true;
-	iio_device_debug_attr_write_all(dev, update_from_ini_dev_cb, &params);
+		diff_rank(writes, queued, profile, &snap, rank);
+		if (writes->len) {
+			apply_writes(dev, writes);
+			stale = true;
+		}
+	}
 
-	ini_close(ini);
+	g_array_free(writes, TRUE);
+	g_hash_table_destroy(queued);
+	g_hash_table_destroy(snap.values);
+	g_hash_table_destroy(profile);
 }
 
 char * read_token_from_ini(const char *ini_file,
@@ -32,6 +32,8 @@
 #include "int_fft.h"
 #include "config.h"
 #include "osc_plugin.h"
+#include "instrument.h"
+#include "histogram.h"
 
 GSList *plugin_list = NULL;
 
@@ -54,12 +56,21 @@ struct iio_context *ctx = NULL;
 static unsigned int num_devices = 0;
 bool ctx_destroyed_by_do_quit;
 
+/* Automatic reconnect delays (ms), doubled after every failed attempt */
+#define RECONNECT_MIN_DELAY 250
+#define RECONNECT_MAX_DELAY 8000
+static guint reconnect_delay;
+static bool reconnect_busy;
+/* Still owned by application_reconnect() while the plugins move off it */
+static struct iio_context *ctx_being_replaced;
+
 static void gfunc_save_plot_data_to_ini(gpointer data, gpointer user_data);
 static void plugin_restore_ini_state(const char *plugin_name,
 		const char *attribute, int value);
 static void plot_init(GtkWidget *plot);
 static void plot_destroyed_cb(OscPlot *plot);
-static void capture_profile_save(const char *filename);
+static void capture_profile_save(const char *filename,
+		struct iio_context *_ctx);
 static int load_profile(const char *filename, bool load_plugins);
 static int capture_setup(void);
 static void capture_start(void);
@@ -255,6 +266,24 @@ static void close_active_buffers(void)
 	}
 }
 
+static void free_capture_buffers(void)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < num_devices; i++) {
+		struct iio_device *dev = iio_context_get_device(ctx, i);
+		struct extra_dev_info *dev_info = iio_device_get_data(dev);
+
+		for (j = 0; j < iio_device_get_channels_count(dev); j++) {
+			struct iio_channel *ch = iio_device_get_channel(dev, j);
+			struct extra_info *info = iio_channel_get_data(ch);
+
+			info->data_ref = NULL;
+		}
+		osc_arena_release(&dev_info->arena);
+	}
+}
+
 static void stop_sampling(void)
 {
 	stop_capture = TRUE;
@@ -352,21 +381,14 @@ static GtkWidget * extract_label_from_box(GtkWidget *box)
 	return label;
 }
 
-static void detach_plugin(GtkToolButton *btn, gpointer data)
+/* Find the page that belongs to a plugin, using the plugin name */
+static gint plugin_page_find(const char *plugin_name)
 {
-	struct detachable_plugin *d_plugin = (struct detachable_plugin *)data;
-	const struct osc_plugin *plugin = d_plugin->plugin;
-	const char *plugin_name = plugin->name;
-	const char *page_name = NULL;
-	GtkWidget *page = NULL;
-	GtkWidget *box;
-	GtkWidget *label;
-	GtkWidget *window;
-	GtkWidget *hbox;
+	const char *page_name;
+	GtkWidget *page, *box, *label;
 	int num_pages;
 	int i;
 
-	/* Find the page that belongs to a plugin, using the plugin name */
 	num_pages = gtk_notebook_get_n_pages(GTK_NOTEBOOK(notebook));
 	for (i = 0; i < num_pages; i++) {
 		page = gtk_notebook_get_nth_page(GTK_NOTEBOOK(notebook), i);
@@ -377,13 +399,28 @@ static void detach_plugin(GtkToolButton *btn, gpointer data)
 			label = box;
 		page_name = gtk_label_get_text(GTK_LABEL(label));
 		if (!strcmp(page_name, plugin_name))
-			break;
+			return i;
 	}
-	if (i == num_pages) {
-		fprintf(stderr, "Could not find %s plugin in the notebook\n",
-				plugin_name);
+
+	fprintf(stderr, "Could not find %s plugin in the notebook\n",
+			plugin_name);
+	return -1;
+}
+
+static void detach_plugin(GtkToolButton *btn, gpointer data)
+{
+	struct detachable_plugin *d_plugin = (struct detachable_plugin *)data;
+	const struct osc_plugin *plugin = d_plugin->plugin;
+	const char *page_name = plugin->name;
+	GtkWidget *page;
+	GtkWidget *window;
+	GtkWidget *hbox;
+	gint index;
+
+	index = plugin_page_find(page_name);
+	if (index < 0)
 		return;
-	}
+	page = gtk_notebook_get_nth_page(GTK_NOTEBOOK(notebook), index);
 
 	window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
 	if (plugin->get_preferred_size) {
@@ -778,6 +815,50 @@ static void close_plugins(const char *ini_fn)
 	plugin_list = NULL;
 }
 
+/* Gives a plugin that can't move to a new context by itself a fresh start
+ * on the current one, in the same tab or window */
+static void plugin_reload(struct detachable_plugin *d_plugin)
+{
+	const struct osc_plugin *plugin = d_plugin->plugin;
+	gboolean detached = d_plugin->detached_state;
+	GtkWidget *widget;
+	gint index;
+
+	if (detached)
+		attach_plugin(d_plugin->window, d_plugin);
+
+	index = plugin_page_find(plugin->name);
+	if (index < 0)
+		return;
+
+	printf("Reloading plugin: %s\n", plugin->name);
+	gtk_notebook_remove_page(GTK_NOTEBOOK(notebook), index);
+	if (plugin->destroy)
+		plugin->destroy(NULL);
+
+	widget = plugin->init(notebook, NULL);
+	if (!widget) {
+		fprintf(stderr, "Failed to reload plugin %s\n", plugin->name);
+		dplugin_list = g_slist_remove(dplugin_list, d_plugin);
+		plugin_list = g_slist_remove(plugin_list, plugin);
+		if (plugin == spect_analyzer_plugin)
+			spect_analyzer_plugin = NULL;
+		dlclose(plugin->handle);
+		g_free(d_plugin);
+		return;
+	}
+
+	index = gtk_notebook_insert_page(GTK_NOTEBOOK(notebook), widget,
+			NULL, index);
+	d_plugin->detach_attach_button =
+		plugin_tab_add_detach_btn(widget, d_plugin);
+	if (plugin->update_active_page)
+		plugin->update_active_page(index, FALSE);
+
+	if (detached)
+		detach_plugin(NULL, d_plugin);
+}
+
 static struct osc_plugin * get_plugin_from_name(const char *name)
 {
 	GSList *node;
@@ -998,6 +1079,7 @@ static ssize_t demux_sample(const struct iio_channel *chn,
 	struct extra_info *info = iio_channel_get_data(chn);
 	struct extra_dev_info *dev_info = iio_device_get_data(info->dev);
 	const struct iio_data_format *format = iio_channel_get_data_format(chn);
+	int32_t code;
 
 	/* Prevent buffer overflow */
 	if ((unsigned long) info->offset == (unsigned long) dev_info->sample_count)
@@ -1006,29 +1088,67 @@ static ssize_t demux_sample(const struct iio_channel *chn,
 	if (size == 1) {
 		int8_t val;
 		iio_channel_convert(chn, &val, sample);
-		if (format->is_signed)
-			*(info->data_ref + info->offset++) = (gfloat) val;
-		else
-			*(info->data_ref + info->offset++) = (gfloat) (uint8_t)val;
+		code = format->is_signed ? val : (uint8_t)val;
 	} else if (size == 2) {
 		int16_t val;
 		iio_channel_convert(chn, &val, sample);
-		if (format->is_signed)
-			*(info->data_ref + info->offset++) = (gfloat) val;
-		else
-			*(info->data_ref + info->offset++) = (gfloat) (uint16_t)val;
+		code = format->is_signed ? val : (uint16_t)val;
 	} else {
 		int32_t val;
 		iio_channel_convert(chn, &val, sample);
-		if (format->is_signed)
-			*(info->data_ref + info->offset++) = (gfloat) val;
-		else
+		if (!format->is_signed) {
 			*(info->data_ref + info->offset++) = (gfloat) (uint32_t)val;
+			return size;
+		}
+		code = val;
 	}
 
+	/* Histograms count the codes themselves, before any float rounding */
+	if (info->codes)
+		info->codes[info->offset] = code;
+	*(info->data_ref + info->offset++) = (gfloat) code;
+
 	return size;
 }
 
+/* Starts counting the raw codes of a channel, the histogram is shared by
+ * all the plots that show it and lives until the last one lets it go */
+struct code_histogram * osc_channel_histogram_get(struct iio_channel *chn)
+{
+	struct extra_info *info = iio_channel_get_data(chn);
+	const struct iio_data_format *format = iio_channel_get_data_format(chn);
+
+	if (!info)
+		return NULL;
+
+	if (!info->histogram) {
+		info->histogram = code_histogram_new(format->bits,
+				format->is_signed);
+		if (!info->histogram) {
+			fprintf(stderr, "No code histogram for %u-bit channel %s\n",
+					format->bits, iio_channel_get_id(chn));
+			return NULL;
+		}
+	}
+
+	info->histogram_users++;
+	return info->histogram;
+}
+
+void osc_channel_histogram_put(struct iio_channel *chn)
+{
+	struct extra_info *info = iio_channel_get_data(chn);
+
+	if (!info || !info->histogram_users || --info->histogram_users)
+		return;
+
+	code_histogram_free(info->histogram);
+	info->histogram = NULL;
+	g_free(info->codes);
+	info->codes = NULL;
+	info->codes_len = 0;
+}
+
 static off_t get_trigger_offset(const struct iio_channel *chn,
 		bool falling_edge, float trigger_value)
 {
@@ -1068,6 +1188,62 @@ static bool device_is_oneshot(struct iio_device *dev)
 	return false;
 }
 
+/* Fills in the timing and device state of the frame that was just read */
+static void capture_frame_update(struct iio_device *dev,
+		int64_t refill_start, int64_t refill_end, unsigned int nb_samples)
+{
+	struct extra_dev_info *dev_info = iio_device_get_data(dev);
+	struct capture_frame *frame = &dev_info->frame;
+	unsigned int i, nb_channels = iio_device_get_channels_count(dev);
+	struct iio_channel *chn;
+	uint64_t expected = 0;
+	double rate;
+
+	rate = dev_info->adc_freq;
+	if (dev_info->adc_scale == 'M')
+		rate *= 1000000.0;
+	else if (dev_info->adc_scale == 'k')
+		rate *= 1000.0;
+
+	if (dev_info->frame_continuous && rate > 0)
+		expected = (uint64_t) ((refill_end - frame->refill_end) *
+				rate / G_USEC_PER_SEC);
+
+	frame->sequence++;
+	frame->first_sample += frame->nb_samples;
+	frame->dropped = expected > nb_samples ? expected - nb_samples : 0;
+	frame->first_sample += frame->dropped;
+	frame->total_dropped += frame->dropped;
+	frame->refill_start = refill_start;
+	frame->refill_end = refill_end;
+	frame->nb_samples = nb_samples;
+	frame->sample_rate = rate;
+
+	frame->hw_timestamp = 0;
+	chn = iio_device_find_channel(dev, "timestamp", false);
+	if (chn && iio_channel_is_enabled(chn))
+		iio_channel_convert(chn, &frame->hw_timestamp,
+				iio_buffer_first(dev_info->buffer, chn));
+
+	frame->lo_freq = 0.0;
+	frame->gain = NAN;
+	for (i = 0; i < nb_channels; i++) {
+		struct extra_info *info;
+
+		chn = iio_device_get_channel(dev, i);
+		if (!iio_channel_is_enabled(chn) ||
+				!iio_channel_is_scan_element(chn))
+			continue;
+
+		info = iio_channel_get_data(chn);
+		frame->lo_freq = info->lo_freq;
+		frame->gain = info->gain;
+		break;
+	}
+
+	dev_info->frame_continuous = !device_is_oneshot(dev);
+}
+
 static gboolean capture_process(void)
 {
 	unsigned int i;
@@ -1082,7 +1258,9 @@ static gboolean capture_process(void)
 		unsigned int nb_channels = iio_device_get_channels_count(dev);
 		ssize_t sample_count = dev_info->sample_count;
 		struct iio_channel *chn;
+		int64_t refill_start;
 		off_t offset = 0;
+		uint64_t t;
 
 		if (dev_info->input_device == false)
 			continue;
@@ -1094,6 +1272,7 @@ static gboolean capture_process(void)
 			dev_info->buffer_size = sample_count;
 			dev_info->buffer = iio_device_create_buffer(dev,
 				sample_count, false);
+			dev_info->frame_continuous = false;
 			if (!dev_info->buffer) {
 				fprintf(stderr, "Error: Unable to create buffer: %s\n", strerror(errno));
 				goto capture_stop_check;
@@ -1105,10 +1284,20 @@ static gboolean capture_process(void)
 			struct iio_channel *ch = iio_device_get_channel(dev, i);
 			struct extra_info *info = iio_channel_get_data(ch);
 			info->offset = 0;
+
+			if (info->histogram && (ssize_t) info->codes_len < sample_count) {
+				info->codes = g_renew(int32_t, info->codes, sample_count);
+				info->codes_len = sample_count;
+			}
 		}
 
 		while (true) {
-			ssize_t ret = iio_buffer_refill(dev_info->buffer);
+			ssize_t ret;
+
+			t = instr_now();
+			refill_start = g_get_monotonic_time();
+			ret = iio_buffer_refill(dev_info->buffer);
+			instr_record(INSTR_REFILL, t, NULL);
 			if (ret < 0) {
 				fprintf(stderr, "Error while reading data: %s\n", strerror(-ret));
 				stop_sampling();
@@ -1117,8 +1306,22 @@ static gboolean capture_process(void)
 
 			ret /= iio_buffer_step(dev_info->buffer);
 			if (ret >= sample_count) {
+				t = instr_now();
 				iio_buffer_foreach_sample(
 						dev_info->buffer, demux_sample, NULL);
+				instr_record(INSTR_DEMUX, t, NULL);
+
+				capture_frame_update(dev, refill_start,
+						g_get_monotonic_time(), ret);
+
+				for (i = 0; i < nb_channels; i++) {
+					struct iio_channel *ch = iio_device_get_channel(dev, i);
+					struct extra_info *info = iio_channel_get_data(ch);
+
+					if (info->histogram && info->codes)
+						code_histogram_add(info->histogram,
+								info->codes, info->offset);
+				}
 
 				if (ret >= sample_count * 2) {
 					printf("Decreasing buffer size\n");
@@ -1126,6 +1329,7 @@ static gboolean capture_process(void)
 					dev_info->buffer_size /= 2;
 					dev_info->buffer = iio_device_create_buffer(dev,
 							dev_info->buffer_size, false);
+					dev_info->frame_continuous = false;
 				}
 				break;
 			}
@@ -1135,6 +1339,7 @@ static gboolean capture_process(void)
 			dev_info->buffer_size *= 2;
 			dev_info->buffer = iio_device_create_buffer(dev,
 					dev_info->buffer_size, false);
+			dev_info->frame_continuous = false;
 		}
 
 		if (dev_info->channel_trigger_enabled) {
@@ -1145,8 +1350,11 @@ static gboolean capture_process(void)
 
 		if (dev_info->channel_trigger_enabled) {
 			struct extra_info *info = iio_channel_get_data(chn);
+
+			t = instr_now();
 			offset = get_trigger_offset(chn, dev_info->trigger_falling_edge,
 					dev_info->trigger_value);
+			instr_record(INSTR_TRIGGER, t, NULL);
 			if (offset / (off_t)sizeof(gfloat) < info->offset / 4) {
 				offset = 0;
 			} else if (offset) {
@@ -1204,7 +1412,7 @@ static unsigned int max_sample_count_from_plots(struct extra_dev_info *info)
 	return max_count;
 }
 
-static double read_sampling_frequency(const struct iio_device *dev)
+double read_sampling_frequency(const struct iio_device *dev)
 {
 	double freq = 400.0;
 	int ret = -1;
@@ -1252,6 +1460,41 @@ static double read_sampling_frequency(const struct iio_device *dev)
 	return freq;
 }
 
+/* Gives each channel of the device room for sample_count samples */
+static int capture_setup_device(struct iio_device *dev,
+		unsigned int sample_count)
+{
+	struct extra_dev_info *dev_info = iio_device_get_data(dev);
+	unsigned int j, nb_channels = iio_device_get_channels_count(dev);
+
+	/* Only grows, restarting with the same sizes allocates nothing */
+	if (osc_arena_reserve(&dev_info->arena, nb_channels *
+			OSC_ARENA_ROUND(sample_count * sizeof(gfloat)))) {
+		fprintf(stderr, "Unable to allocate capture buffers for %s\n",
+				iio_device_get_name(dev) ?: iio_device_get_id(dev));
+		disable_all_channels(dev);
+		return -ENOMEM;
+	}
+
+	for (j = 0; j < nb_channels; j++) {
+		struct iio_channel *ch = iio_device_get_channel(dev, j);
+		struct extra_info *info = iio_channel_get_data(ch);
+
+		info->data_ref = osc_arena_alloc(&dev_info->arena,
+				sample_count * sizeof(gfloat));
+		memset(info->data_ref, 0, sample_count * sizeof(gfloat));
+	}
+
+	if (dev_info->buffer)
+		iio_buffer_destroy(dev_info->buffer);
+	dev_info->buffer = NULL;
+	dev_info->sample_count = sample_count;
+	memset(&dev_info->frame, 0, sizeof(dev_info->frame));
+	dev_info->frame_continuous = false;
+
+	return 0;
+}
+
 static int capture_setup(void)
 {
 	unsigned int i, j;
@@ -1281,21 +1524,8 @@ static int capture_setup(void)
 		if (sample_size == 0 || sample_count == 0)
 			continue;
 
-		for (j = 0; j < nb_channels; j++) {
-			struct iio_channel *ch = iio_device_get_channel(dev, j);
-			struct extra_info *info = iio_channel_get_data(ch);
-
-			if (info->data_ref)
-				g_free(info->data_ref);
-			info->data_ref = (gfloat *) g_new0(gfloat, sample_count);
-		}
-
-		if (dev_info->buffer)
-			iio_buffer_destroy(dev_info->buffer);
-		dev_info->buffer = NULL;
-		dev_info->sample_count = sample_count;
-
-		iio_device_set_data(dev, dev_info);
+		if (capture_setup_device(dev, sample_count))
+			continue;
 
 		freq = read_sampling_frequency(dev);
 		if (freq > 0) {
@@ -1315,8 +1545,29 @@ static int capture_setup(void)
 	return 0;
 }
 
+/* Every capture run counts its own codes, a plot started later doesn't
+ * pick up what the earlier ones had seen */
+static void reset_code_histograms(void)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < num_devices; i++) {
+		struct iio_device *dev = iio_context_get_device(ctx, i);
+
+		for (j = 0; j < iio_device_get_channels_count(dev); j++) {
+			struct iio_channel *ch = iio_device_get_channel(dev, j);
+			struct extra_info *info = iio_channel_get_data(ch);
+
+			if (info && info->histogram)
+				code_histogram_reset(info->histogram);
+		}
+	}
+}
+
 static void capture_start(void)
 {
+	reset_code_histograms();
+
 	if (capture_function) {
 		stop_capture = FALSE;
 	}
@@ -1433,6 +1684,89 @@ static void free_setup_check_fct_list(void)
 	setup_check_functions = NULL;
 }
 
+struct reconnect_job {
+	struct iio_context *old_ctx;	/* only compared, never used */
+	struct iio_context *new_ctx;
+	gchar *uri;
+};
+
+static gboolean reconnect_attempt(gpointer ptr);
+
+static gchar * context_uri(struct iio_context *_ctx)
+{
+	const char *uri = iio_context_get_attr_value(_ctx, "uri");
+	gchar **host;
+	gchar *ret;
+
+	if (uri)
+		return g_strdup(uri);
+
+	/* Older servers: the description starts with the address */
+	host = g_strsplit(iio_context_get_description(_ctx), " ", 2);
+	ret = g_strdup_printf("ip:%s", host[0] ?: "");
+	g_strfreev(host);
+	return ret;
+}
+
+/* Back on the GTK thread with the outcome of reconnect_thread() */
+static gboolean reconnect_done(gpointer data)
+{
+	struct reconnect_job *job = data;
+
+	reconnect_busy = false;
+
+	/* Reconnected by hand, or quit, in the meantime */
+	if (job->old_ctx != ctx) {
+		if (job->new_ctx)
+			iio_context_destroy(job->new_ctx);
+	} else if (!job->new_ctx) {
+		reconnect_delay = MIN(reconnect_delay * 2, RECONNECT_MAX_DELAY);
+		fprintf(stderr, "Reconnect failed, retrying in %u ms\n",
+				reconnect_delay);
+		g_timeout_add(reconnect_delay, reconnect_attempt, ctx);
+	} else {
+		application_reconnect(job->new_ctx);
+	}
+
+	g_free(job->uri);
+	g_free(job);
+	return FALSE;
+}
+
+/* Connecting can take the whole network timeout, keep it off the GTK
+ * thread. The old context may be gone by the time it returns, so the
+ * thread only gets its URI. */
+static gpointer reconnect_thread(gpointer data)
+{
+	struct reconnect_job *job = data;
+
+	job->new_ctx = iio_create_context_from_uri(job->uri);
+	g_idle_add(reconnect_done, job);
+	return NULL;
+}
+
+static gboolean reconnect_attempt(gpointer ptr)
+{
+	struct reconnect_job *job;
+
+	/* Reconnected by hand in the meantime */
+	if (ptr != ctx || reconnect_busy)
+		return FALSE;
+
+	job = g_new0(struct reconnect_job, 1);
+	job->old_ctx = ctx;
+	job->uri = context_uri(ctx);
+	reconnect_busy = true;
+	g_thread_unref(g_thread_new("reconnect", reconnect_thread, job));
+	return FALSE;
+}
+
+void application_reconnect_start(void)
+{
+	reconnect_delay = RECONNECT_MIN_DELAY;
+	reconnect_attempt(ctx);
+}
+
 static gboolean idle_timeout_check(gpointer ptr)
 {
 	int ret;
@@ -1446,6 +1780,8 @@ static gboolean idle_timeout_check(gpointer ptr)
 	ret = iio_context_get_version(ctx, NULL, NULL, NULL);
 	if (ret == -EPIPE) {
 		gtk_widget_set_visible(infobar, true);
+		reconnect_delay = RECONNECT_MIN_DELAY;
+		g_timeout_add(reconnect_delay, reconnect_attempt, ctx);
 		return FALSE;
 	} else {
 		return TRUE;
@@ -1467,7 +1803,7 @@ static void do_quit(bool reload)
 	/* Before we shut down, let's save the profile */
 	if (!reload) {
 		path = get_default_profile_name();
-		capture_profile_save(path);
+		capture_profile_save(path, ctx);
 	}
 
 	stop_capture = TRUE;
@@ -1477,6 +1813,7 @@ static void do_quit(bool reload)
 
 	close_all_plots();
 	destroy_all_plots();
+	free_capture_buffers();
 
 	g_list_free(plot_list);
 	free_setup_check_fct_list();
@@ -1527,6 +1864,163 @@ void application_reload(struct iio_context *new_ctx, bool load_profile)
 		load_default_profile(NULL, true);
 }
 
+/* The handle of 'ctx' that stands for 'dev' of another context of the same
+ * hardware, NULL if there is none */
+struct iio_device * osc_device_rebind(struct iio_context *_ctx,
+		const struct iio_device *dev)
+{
+	if (!dev)
+		return NULL;
+
+	return iio_context_find_device(_ctx, iio_device_get_id(dev));
+}
+
+struct iio_channel * osc_channel_rebind(struct iio_context *_ctx,
+		const struct iio_channel *chn)
+{
+	struct iio_device *dev;
+
+	if (!chn)
+		return NULL;
+
+	dev = osc_device_rebind(_ctx, iio_channel_get_device(chn));
+	if (!dev)
+		return NULL;
+
+	return iio_device_find_channel(dev, iio_channel_get_id(chn),
+			iio_channel_is_output(chn));
+}
+
+/* Same devices and channels on both sides of the link drop */
+static bool context_same_hardware(struct iio_context *old_ctx,
+		struct iio_context *new_ctx)
+{
+	unsigned int i, j;
+
+	if (iio_context_get_devices_count(old_ctx) !=
+			iio_context_get_devices_count(new_ctx))
+		return false;
+
+	for (i = 0; i < iio_context_get_devices_count(old_ctx); i++) {
+		struct iio_device *dev = iio_context_get_device(old_ctx, i);
+		struct iio_device *new_dev = osc_device_rebind(new_ctx, dev);
+
+		if (!new_dev || iio_device_get_channels_count(dev) !=
+				iio_device_get_channels_count(new_dev))
+			return false;
+
+		for (j = 0; j < iio_device_get_channels_count(dev); j++)
+			if (!osc_channel_rebind(new_ctx,
+					iio_device_get_channel(dev, j)))
+				return false;
+	}
+
+	return true;
+}
+
+/* Hands the capture state of every device and channel to its new handle */
+static void context_move_data(struct iio_context *old_ctx,
+		struct iio_context *new_ctx)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < iio_context_get_devices_count(old_ctx); i++) {
+		struct iio_device *dev = iio_context_get_device(old_ctx, i);
+		struct iio_device *new_dev = osc_device_rebind(new_ctx, dev);
+
+		iio_device_set_data(new_dev, iio_device_get_data(dev));
+		iio_device_set_data(dev, NULL);
+
+		for (j = 0; j < iio_device_get_channels_count(dev); j++) {
+			struct iio_channel *ch = iio_device_get_channel(dev, j);
+			struct iio_channel *new_ch = osc_channel_rebind(new_ctx, ch);
+			struct extra_info *info = iio_channel_get_data(ch);
+
+			info->dev = new_dev;
+			iio_channel_set_data(new_ch, info);
+			iio_channel_set_data(ch, NULL);
+		}
+	}
+}
+
+static void plugins_reconnect(void)
+{
+	GSList *node, *next;
+
+	/* A plugin that fails to reload leaves the list */
+	for (node = dplugin_list; node; node = next) {
+		struct detachable_plugin *d_plugin = node->data;
+
+		next = g_slist_next(node);
+		if (d_plugin->plugin->reconnect)
+			d_plugin->plugin->reconnect();
+		else
+			plugin_reload(d_plugin);
+	}
+}
+
+/*
+ * Reconnect without losing the session. When the same hardware is found
+ * behind the new link, the capture state, the plots and the plugins move
+ * over to the new handles in place; plugins that can't do that are
+ * reloaded and read the device state back. Otherwise only the capture
+ * windows are carried over, through a temporary profile.
+ */
+void application_reconnect(struct iio_context *new_ctx)
+{
+	gint64 start = g_get_monotonic_time();
+	struct iio_context *old_ctx = ctx;
+	GList *node;
+	gchar *path;
+	char buf[32];
+
+	if (!new_ctx) {
+		fprintf(stderr, "Invalid new context!\n");
+		return;
+	}
+
+	if (!old_ctx || !context_same_hardware(old_ctx, new_ctx)) {
+		fprintf(stderr, "Different hardware after the reconnect, "
+				"reloading\n");
+		snprintf(buf, sizeof(buf), "osc_reconnect_%u.ini", getpid());
+		path = g_build_filename(getenv("TEMP") ?: P_tmpdir, buf, NULL);
+		/* The old link is dead, record the new one */
+		capture_profile_save(path, new_ctx);
+
+		application_reload(new_ctx, false);
+		load_profile(path, false);
+
+		unlink(path);
+		g_free(path);
+		return;
+	}
+
+	stop_sampling();
+	context_move_data(old_ctx, new_ctx);
+	ctx = new_ctx;
+
+	for (node = plot_list; node; node = g_list_next(node))
+		osc_plot_rebind_context(OSC_PLOT(node->data), new_ctx);
+	ctx_being_replaced = old_ctx;
+	plugins_reconnect();
+	ctx_being_replaced = NULL;
+
+	iio_context_destroy(old_ctx);
+
+	gtk_widget_set_visible(infobar, false);
+	g_timeout_add_full(G_PRIORITY_DEFAULT_IDLE, 1000,
+			idle_timeout_check, new_ctx, NULL);
+
+	if (num_capturing_plots) {
+		capture_setup();
+		capture_start();
+		restart_all_running_plots();
+	}
+
+	printf("Reconnected in %.1f ms\n",
+			(g_get_monotonic_time() - start) / 1000.0);
+}
+
 void application_quit (void)
 {
 	do_quit(false);
@@ -1582,6 +2076,7 @@ static void init_device_list(struct iio_context *_ctx)
 			struct iio_channel *ch = iio_device_get_channel(dev, j);
 			struct extra_info *info = calloc(1, sizeof(*info));
 			info->dev = dev;
+			info->gain = NAN;
 			iio_channel_set_data(ch, info);
 		}
 
@@ -1590,6 +2085,117 @@ static void init_device_list(struct iio_context *_ctx)
 	}
 }
 
+/*
+ * Benchmark hooks: "osc -b" runs the capture path of a context whose
+ * samples come from a synthetic source instead of iio_buffer_refill(), so
+ * it times the same demux and transforms as the plots. All the scan
+ * elements are enabled and sample_count samples are kept per channel.
+ */
+static struct iio_context *bench_saved_ctx;
+static unsigned int bench_saved_num_devices;
+
+int osc_bench_setup(struct iio_context *bench_ctx, unsigned int sample_count)
+{
+	unsigned int i, j;
+	int ret;
+
+	bench_saved_ctx = ctx;
+	bench_saved_num_devices = num_devices;
+	ctx = bench_ctx;
+	init_device_list(ctx);
+
+	for (i = 0; i < num_devices; i++) {
+		struct iio_device *dev = iio_context_get_device(ctx, i);
+
+		for (j = 0; j < iio_device_get_channels_count(dev); j++) {
+			struct iio_channel *ch = iio_device_get_channel(dev, j);
+
+			if (iio_channel_is_scan_element(ch))
+				iio_channel_enable(ch);
+		}
+
+		if (!iio_device_get_sample_size(dev))
+			continue;
+
+		ret = capture_setup_device(dev, sample_count);
+		if (ret) {
+			osc_bench_teardown();
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+/* Same walk as iio_buffer_foreach_sample() over an interleaved block */
+void osc_bench_demux(struct iio_device *dev, const void *raw,
+		unsigned int nb_samples)
+{
+	unsigned int i, j, nb_channels = iio_device_get_channels_count(dev);
+	ssize_t sample_size = iio_device_get_sample_size(dev);
+	const uint8_t *sample;
+	size_t pos, len;
+
+	for (j = 0; j < nb_channels; j++) {
+		struct iio_channel *ch = iio_device_get_channel(dev, j);
+		struct extra_info *info = iio_channel_get_data(ch);
+
+		info->offset = 0;
+	}
+
+	for (i = 0; i < nb_samples; i++) {
+		sample = (const uint8_t *) raw + i * sample_size;
+		for (pos = 0, j = 0; j < nb_channels; j++) {
+			struct iio_channel *ch = iio_device_get_channel(dev, j);
+			const struct iio_data_format *fmt =
+				iio_channel_get_data_format(ch);
+
+			if (!iio_channel_is_enabled(ch))
+				continue;
+
+			len = fmt->length / 8;
+			if (pos % len)
+				pos += len - pos % len;
+			demux_sample(ch, (void *) (sample + pos), len, NULL);
+			pos += len;
+		}
+	}
+}
+
+/* Gives the bench context back, undoing osc_bench_setup() and the
+ * init_device_list() it did */
+void osc_bench_teardown(void)
+{
+	unsigned int i, j;
+
+	free_capture_buffers();
+
+	for (i = 0; i < num_devices; i++) {
+		struct iio_device *dev = iio_context_get_device(ctx, i);
+		struct extra_dev_info *dev_info = iio_device_get_data(dev);
+
+		for (j = 0; j < iio_device_get_channels_count(dev); j++) {
+			struct iio_channel *ch = iio_device_get_channel(dev, j);
+			struct extra_info *info = iio_channel_get_data(ch);
+
+			code_histogram_free(info->histogram);
+			g_free(info->codes);
+			free(info);
+			iio_channel_set_data(ch, NULL);
+		}
+
+		if (dev_info->buffer)
+			iio_buffer_destroy(dev_info->buffer);
+		g_slist_free(dev_info->plots_sample_counts);
+		free(dev_info);
+		iio_device_set_data(dev, NULL);
+	}
+
+	ctx = bench_saved_ctx;
+	num_devices = bench_saved_num_devices;
+	bench_saved_ctx = NULL;
+}
+
 #define ENTER_KEY_CODE 0xFF0D
 
 gboolean save_sample_count_cb(GtkWidget *widget, GdkEventKey *event, gpointer data)
@@ -1655,16 +2261,20 @@ bool rx_update_device_sampling_freq(const char *device, double freq)
 	return true;
 }
 
-/*
- * Allows plugins to set the "lo_freq" field of the "struct extra_info"
- * for the given iio channel. Only input channels are affected.
- * @device  - name of the device
- * @channel - name of the channel
- *          - use "all" value to target all iio scan_element channels
- * @lo_freq - value of the Local Oscillcator frequency (Hz)
- */
-bool rx_update_channel_lo_freq(const char *device, const char *channel,
-	double lo_freq)
+static double * extra_info_lo_freq(struct extra_info *info)
+{
+	return &info->lo_freq;
+}
+
+static double * extra_info_gain(struct extra_info *info)
+{
+	return &info->gain;
+}
+
+/* Sets a double field of the "struct extra_info" of one or all ("all")
+ * input scan_element channels of a device */
+static bool rx_update_channel_info(const char *device, const char *channel,
+	double * (*field)(struct extra_info *), double value)
 {
 	struct iio_device *dev;
 	struct iio_channel *chn;
@@ -1690,7 +2300,7 @@ bool rx_update_channel_lo_freq(const char *device, const char *channel,
 			}
 			chn_info = iio_channel_get_data(chn);
 			if (chn_info) {
-				chn_info->lo_freq = lo_freq;
+				*field(chn_info) = value;
 			} else {
 				fprintf(stderr, "Channel: %s extra info "
 					"not found!\n", channel);
@@ -1712,8 +2322,67 @@ bool rx_update_channel_lo_freq(const char *device, const char *channel,
 		return false;
 	}
 
-	chn_info->lo_freq = lo_freq;
+	*field(chn_info) = value;
+
+	return true;
+}
+
+/*
+ * Allows plugins to set the "lo_freq" field of the "struct extra_info"
+ * for the given iio channel. Only input channels are affected.
+ * @device  - name of the device
+ * @channel - name of the channel
+ *          - use "all" value to target all iio scan_element channels
+ * @lo_freq - value of the Local Oscillcator frequency (Hz)
+ */
+bool rx_update_channel_lo_freq(const char *device, const char *channel,
+	double lo_freq)
+{
+	return rx_update_channel_info(device, channel,
+			extra_info_lo_freq, lo_freq);
+}
+
+/*
+ * Allows plugins to set the "gain" field of the "struct extra_info" for
+ * the given iio channel, so captured frames carry the gain they were
+ * taken with. Only input channels are affected.
+ * @device  - name of the device
+ * @channel - name of the channel
+ *          - use "all" value to target all iio scan_element channels
+ * @gain    - value of the RX gain (dB)
+ */
+bool rx_update_channel_gain(const char *device, const char *channel,
+	double gain)
+{
+	return rx_update_channel_info(device, channel,
+			extra_info_gain, gain);
+}
+
+/*
+ * Gives plugins the timing and device state of the last frame captured
+ * from the given iio device (see "struct capture_frame").
+ * @device - name of the device
+ * @frame  - where to copy the frame information
+ */
+bool rx_get_device_frame(const char *device, struct capture_frame *frame)
+{
+	struct iio_device *dev;
+	struct extra_dev_info *info;
+
+	g_return_val_if_fail(device, false);
+	g_return_val_if_fail(frame, false);
+
+	dev = iio_context_find_device(ctx, device);
+	if (!dev) {
+		fprintf(stderr, "Device: %s not found!\n", device);
+		return false;
+	}
+
+	info = iio_device_get_data(dev);
+	if (!info || !info->frame.sequence)
+		return false;
 
+	*frame = info->frame;
 	return true;
 }
 
@@ -1877,7 +2546,9 @@ static void gfunc_save_plot_data_to_ini(gpointer data, gpointer user_data)
 	osc_plot_save_to_ini(plot, filename);
 }
 
-static void capture_profile_save(const char *filename)
+/* '_ctx' is the link recorded in the profile */
+static void capture_profile_save(const char *filename,
+		struct iio_context *_ctx)
 {
 	FILE *fp;
 
@@ -1903,17 +2574,17 @@ static void capture_profile_save(const char *filename)
 		gtk_check_menu_item_get_active(GTK_CHECK_MENU_ITEM(tooltips_en)));
 	fprintf(fp, "startup_version_check=%d\n",
 		gtk_check_menu_item_get_active(GTK_CHECK_MENU_ITEM(versioncheck_en)));
-	if (ctx) {
-		if (!strcmp(iio_context_get_name(ctx), "network")) {
-			char *ip_addr = (char *) iio_context_get_description(ctx);
+	if (_ctx) {
+		if (!strcmp(iio_context_get_name(_ctx), "network")) {
+			char *ip_addr = (char *) iio_context_get_description(_ctx);
 			ip_addr = strtok(ip_addr, " ");
 			fprintf(fp, "remote_ip_addr=%s\n", ip_addr);
-		} else if (!strcmp(iio_context_get_name(ctx), "usb")) {
-			if (usb_get_serialnumber(ctx))
-				fprintf(fp, "uri=%s\n", usb_get_serialnumber(ctx));
+		} else if (!strcmp(iio_context_get_name(_ctx), "usb")) {
+			if (usb_get_serialnumber(_ctx))
+				fprintf(fp, "uri=%s\n", usb_get_serialnumber(_ctx));
 		} else {
 			fprintf(stderr, "%s: unknown context %s\n",
-				__func__, iio_context_get_name(ctx));
+				__func__, iio_context_get_name(_ctx));
 		}
 	}
 
@@ -1969,7 +2640,7 @@ void save_complete_profile(const char *filename)
 {
 	GSList *node;
 
-	capture_profile_save(filename);
+	capture_profile_save(filename, ctx);
 
 	for (node = plugin_list; node; node = g_slist_next(node)) {
 		struct osc_plugin *plugin = node->data;
@@ -2234,7 +2905,7 @@ struct iio_context * osc_create_context(void)
 
 void osc_destroy_context(struct iio_context *_ctx)
 {
-	if (_ctx != ctx)
+	if (_ctx != ctx && _ctx != ctx_being_replaced)
 		iio_context_destroy(_ctx);
 }
 
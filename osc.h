@@ -90,6 +90,14 @@ enum marker_types {
 bool rx_update_device_sampling_freq(const char *device, double freq);
 bool rx_update_channel_lo_freq(const char *device, const char *channel,
 	double lo_freq);
+bool rx_update_channel_gain(const char *device, const char *channel,
+	double gain);
+struct capture_frame;
+bool rx_get_device_frame(const char *device, struct capture_frame *frame);
+int osc_bench_setup(struct iio_context *bench_ctx, unsigned int sample_count);
+void osc_bench_demux(struct iio_device *dev, const void *raw,
+	unsigned int nb_samples);
+void osc_bench_teardown(void);
 void dialogs_init(GtkBuilder *builder);
 char * usb_get_serialnumber(struct iio_context *context);
 void usb_set_serialnumber(char *);
@@ -103,6 +111,9 @@ void add_ch_setup_check_fct(char *device_name, void *fp);
 void *find_setup_check_fct_by_devname(const char *dev_name);
 bool is_input_device(const struct iio_device *dev);
 bool is_output_device(const struct iio_device *dev);
+double read_sampling_frequency(const struct iio_device *dev);
+struct code_histogram * osc_channel_histogram_get(struct iio_channel *chn);
+void osc_channel_histogram_put(struct iio_channel *chn);
 
 struct iio_context * get_context_from_osc(void);
 const void * plugin_get_device_by_reference(const char *device_name);
@@ -132,6 +143,12 @@ gint fru_connect(void);
 gint connect_dialog(bool load_profile);
 
 void application_reload(struct iio_context *ctx, bool load_profile);
+void application_reconnect(struct iio_context *ctx);
+void application_reconnect_start(void);
+struct iio_device * osc_device_rebind(struct iio_context *ctx,
+		const struct iio_device *dev);
+struct iio_channel * osc_channel_rebind(struct iio_context *ctx,
+		const struct iio_channel *chn);
 
 struct iio_context * osc_create_context(void);
 void osc_destroy_context(struct iio_context *ctx);
@@ -25,6 +25,10 @@ struct osc_plugin {
 
 	void (*save_profile)(const char *ini_fn);
 	void (*load_profile)(const char *ini_fn);
+
+	/* The link to the device came back: move over to the handles of a
+	 * new osc_create_context(). Plugins without it get reloaded. */
+	void (*reconnect)(void);
 };
 
 void osc_plugin_register(const struct osc_plugin *plugin);
@@ -7,6 +7,9 @@
 
 #include "config.h"
 #include "osc.h"
+#ifndef __MINGW32__
+#include "headless.h"
+#endif
 #include "backtrace.h"
 
 extern GtkWidget *notebook;
@@ -26,11 +29,7 @@ static void infobar_hide_cb(GtkButton *btn, gpointer user_data)
 
 static void infobar_reconnect_cb(GtkMenuItem *btn, gpointer user_data)
 {
-	struct iio_context *new_ctx = iio_context_clone(ctx);
-	if (new_ctx) {
-		application_reload(new_ctx, true);
-		gtk_widget_set_visible(infobar, false);
-	}
+	application_reconnect_start();
 }
 
 static void tooltips_enable_cb (GtkCheckMenuItem *item, gpointer data)
@@ -178,7 +177,10 @@ static void usage(char *program)
 	/* please keep this list sorted in alphabetical order */
 	printf( "Command line options:\n"
 		"\t-p\tload specific profile (to skip profile loading use \"-\")\n"
+		"\t-b\tbenchmark the capture pipeline on synthetic data\n"
+		"\t\t(\"fft=8192,channels=2,bits=12,shift=0,signed=1,iterations=100\")\n"
 		"\t-c\tIP address of device to connect to (192.168.2.1)\n"
+		"\t-d\trun without GUI, publish results on this Unix socket\n"
 		"\t-u\tUniform Resource Identifer (URI) of device to connect to ('usb:3.2.5')\n");
 
 	printf("\nEnvironmental variables:\n"
@@ -192,17 +194,53 @@ static void sigterm (int signum)
 	application_quit();
 }
 
+#ifndef __MINGW32__
+static void headless_sigterm (int signum)
+{
+	headless_stop();
+}
+
+static int run_headless(const char *socket_path, const char *profile)
+{
+	signal(SIGTERM, headless_sigterm);
+	signal(SIGINT, headless_sigterm);
+	signal(SIGHUP, headless_sigterm);
+
+	if (profile && !strcmp(profile, "-"))
+		profile = NULL;
+
+	return headless_run(ctx, profile, socket_path);
+}
+#else
+static int run_headless(const char *socket_path, const char *profile)
+{
+	printf("Headless mode is not supported on this platform\n");
+	return -1;
+}
+
+static int headless_bench(const char *spec, const char *profile)
+{
+	printf("Headless mode is not supported on this platform\n");
+	return -1;
+}
+#endif
+
 gint main (int argc, char **argv)
 {
 	int c;
 
 	char *profile = NULL;
+	char *headless_socket = NULL;
+	char *bench = NULL;
 
 	init_signal_handlers(argv[0]);
 
 	opterr = 0;
-	while ((c = getopt (argc, argv, "c:p:u:")) != -1)
+	while ((c = getopt (argc, argv, "b:c:d:p:u:")) != -1)
 		switch (c) {
+			case 'b':
+				bench = strdup(optarg);
+				break;
 			case 'c':
 				ctx = iio_create_network_context(optarg);
 				if (!ctx) {
@@ -210,6 +248,9 @@ gint main (int argc, char **argv)
 					exit(-1);
 				}
 				break;
+			case 'd':
+				headless_socket = strdup(optarg);
+				break;
 			case 'u':
 				ctx = iio_create_context_from_uri(optarg);
 				if (!ctx) {
@@ -229,6 +270,26 @@ gint main (int argc, char **argv)
 				break;
 		}
 
+	if (bench) {
+		if (profile && !strcmp(profile, "-")) {
+			free(profile);
+			profile = NULL;
+		}
+		c = headless_bench(bench, profile);
+		free(bench);
+		if (profile)
+			free(profile);
+		return c < 0 ? -1 : 0;
+	}
+
+	if (headless_socket) {
+		c = run_headless(headless_socket, profile);
+		free(headless_socket);
+		if (profile)
+			free(profile);
+		return c < 0 ? -1 : 0;
+	}
+
 #ifndef __MINGW32__
 	/* XXX: Enabling threading when compiling for Windows will lock the UI
 	 * as soon as the main window is moved. */
@@ -15,7 +15,6 @@
 #include <stdbool.h>
 #include <malloc.h>
 #include <math.h>
-#include <matio.h>
 #include <string.h>
 #include <sys/types.h>
 #include <dirent.h>
@@ -29,15 +28,15 @@
 #include "config.h"
 #include "iio_widget.h"
 #include "datatypes.h"
+#include "int_fft.h"
 #include "osc_plugin.h"
 #include "math_expression_generator.h"
-
-/* add backwards compat for <matio-1.5.0 */
-#if MATIO_MAJOR_VERSION == 1 && MATIO_MINOR_VERSION < 5
-typedef int mat_dim;
-#else
-typedef size_t mat_dim;
-#endif
+#include "instrument.h"
+#include "export.h"
+#include "dsp.h"
+#include "plugins/fir_filter.h"
+#include "histogram.h"
+#include "readout.h"
 
 extern void *find_setup_check_fct_by_devname(const char *dev_name);
 
@@ -53,11 +52,13 @@ static void add_grid(OscPlot *plot);
 static void rescale_databox(OscPlotPrivate *priv, GtkDatabox *box, gfloat border);
 static bool call_all_transform_functions(OscPlotPrivate *priv);
 static void capture_start(OscPlotPrivate *priv);
+static void plot_schedule_redraw(OscPlotPrivate *priv);
 static void plot_profile_save(OscPlot *plot, char *filename);
 static void transform_add_plot_markers(OscPlot *plot, Transform *transform);
 static void osc_plot_finalize(GObject *object);
 static void osc_plot_dispose(GObject *object);
-static void save_as(OscPlot *plot, const char *filename, int type);
+static void save_as(OscPlot *plot, const char *filename, int type, bool wait);
+static int export_finish(OscPlotPrivate *priv);
 static void treeview_expand_update(OscPlot *plot);
 static void treeview_icon_color_update(OscPlot *plot);
 static int enabled_channels_of_device(GtkTreeView *treeview, const char *name, unsigned *enabled_mask);
@@ -79,6 +80,7 @@ static void set_channel_shadow_of_enabled(gpointer data, gpointer user_data);
 static gfloat * plot_channels_get_nth_data_ref(GSList *list, guint n);
 static void transform_add_own_markers(OscPlot *plot, Transform *transform);
 static void transform_remove_own_markers(Transform *transform);
+static bool fir_preview_load(OscPlot *plot, const char *filename);
 
 /* IDs of signals */
 enum {
@@ -125,6 +127,9 @@ enum {
 
 #define MATH_CHANNELS_DEVICE "Math"
 
+/* Windows without the focus are drawn this many times less often */
+#define BACKGROUND_REDRAW_DIVIDER 2
+
 #define OSC_COLOR(r, g, b) { \
 	.red = (r) << 8, \
 	.green = (g) << 8, \
@@ -171,6 +176,12 @@ static GdkColor color_marker = {
 	.blue = 0xFFFF,
 };
 
+static GdkColor color_fir_response = {
+	.red = 0xFFFF,
+	.green = 0xFFFF,
+	.blue = 0xFFFF,
+};
+
 typedef struct channel_settings PlotChn;
 typedef struct iio_channel_settings PlotIioChn;
 typedef struct math_channel_settings PlotMathChn;
@@ -216,6 +227,10 @@ struct math_channel_settings {
 #define CONSTELLATION_SETTINGS(obj) ((struct _constellation_settings *)obj->settings)
 #define XCORR_SETTINGS(obj) ((struct _cross_correlation_settings *)obj->settings)
 #define FREQ_SPECTRUM_SETTINGS(obj) ((struct _freq_spectrum_settings *)obj->settings)
+#define WATERFALL_SETTINGS(obj) ((struct _waterfall_settings *)obj->settings)
+#define ZOOM_FFT_SETTINGS(obj) ((struct _zoom_fft_settings *)obj->settings)
+#define FIR_PREVIEW_SETTINGS(obj) ((struct _fir_preview_settings *)obj->settings)
+#define HISTOGRAM_SETTINGS(obj) ((struct _histogram_settings *)obj->settings)
 #define MATH_SETTINGS(obj) ((struct _math_settings *)obj->settings)
 
 #define PLOT_CHN(obj) ((PlotChn *)obj)
@@ -277,6 +292,20 @@ struct _OscPlotPrivate
 	GtkWidget *fft_size_widget;
 	GtkWidget *fft_avg_widget;
 	GtkWidget *fft_pwr_offset_widget;
+	GtkWidget *waterfall_widget;
+	GtkWidget *waterfall_decay_widget;
+	GtkWidget *waterfall_area;
+	GtkWidget *density_persistence_widget;
+	GtkWidget *fixed_point_fft_widget;
+	GtkWidget *evm_reference_widget;
+	GtkWidget *zoom_fft_widget;
+	GtkWidget *zoom_center_widget;
+	GtkWidget *zoom_span_widget;
+	GtkWidget *fir_preview_widget;
+	GtkWidget *fir_preview_file_widget;
+	struct fir_filter_file *fir_preview;
+	GtkWidget *histogram_widget;
+	GtkWidget *max_fps_widget;
 	GtkWidget *device_settings_menu;
 	GtkWidget *math_settings_menu;
 	GtkWidget *device_trigger_menuitem;
@@ -293,6 +322,11 @@ struct _OscPlotPrivate
 	GtkWidget *capture_options_box;
 	GtkWidget *saveas_settings_box;
 	GtkWidget *save_mat_scale;
+	GtkWidget *save_mat_compress;
+	GtkWidget *export_window;
+	GtkWidget *export_progress;
+	guint export_timer;
+	struct export_job *export_job;
 	GtkWidget *new_plot_button;
 	GtkWidget *cmb_saveas_type;
 	GtkWidget *math_expression_dialog;
@@ -301,9 +335,9 @@ struct _OscPlotPrivate
 	GtkWidget *math_channel_name_entry;
 	GtkWidget *math_expr_error;
 
-	GtkTextBuffer* tbuf;
+	struct text_readout *marker_readout;
 	GtkTextBuffer* devices_buf;
-	GtkTextBuffer* phase_buf;
+	struct text_readout *phase_readout;
 	GtkTextBuffer* math_expression;
 
 	struct iio_context *ctx;
@@ -359,9 +393,14 @@ struct _OscPlotPrivate
 
 	gint line_thickness;
 
-	gint redraw_function;
+	gboolean redraw_active;		/* capture running, frames get drawn */
 	gboolean stop_redraw;
-	gboolean redraw;
+	gboolean redraw;		/* new data since the last draw */
+	guint redraw_source;		/* pending draw, 0 if none */
+	gint64 last_redraw;		/* ms, monotonic */
+	gint max_fps;
+	bool iconified;
+	bool obscured;
 
 	bool spectrum_data_ready;
 
@@ -481,8 +520,10 @@ struct iio_buffer * osc_plot_get_buffer(OscPlot *plot)
 
 void osc_plot_data_update (OscPlot *plot)
 {
-	if (call_all_transform_functions(plot->priv))
+	if (call_all_transform_functions(plot->priv)) {
 		plot->priv->redraw = TRUE;
+		plot_schedule_redraw(plot->priv);
+	}
 
 	if (plot->priv->single_shot_mode) {
 		plot->priv->single_shot_mode = false;
@@ -494,7 +535,38 @@ static bool is_frequency_transform(OscPlotPrivate *priv)
 {
 	return priv->active_transform_type == FFT_TRANSFORM ||
 	       priv->active_transform_type == COMPLEX_FFT_TRANSFORM ||
-	       priv->active_transform_type == FREQ_SPECTRUM_TRANSFORM;
+	       priv->active_transform_type == FREQ_SPECTRUM_TRANSFORM ||
+	       priv->active_transform_type == WATERFALL_TRANSFORM ||
+	       priv->active_transform_type == ZOOM_FFT_TRANSFORM ||
+	       priv->active_transform_type == FIR_PREVIEW_TRANSFORM;
+}
+
+static unsigned int evm_reference_order(OscPlotPrivate *priv)
+{
+	static const unsigned int orders[] = { 0, 4, 16, 64 };
+	int active = gtk_combo_box_get_active(GTK_COMBO_BOX(priv->evm_reference_widget));
+
+	if (active < 0 || active >= (int)G_N_ELEMENTS(orders))
+		return 0;
+
+	return orders[active];
+}
+
+/* A waterfall or a FIR preview runs on one (real) or two (I/Q) channels,
+ * like the FFTs do */
+static bool is_complex_frequency_transform(OscPlotPrivate *priv)
+{
+	if (priv->active_transform_type == COMPLEX_FFT_TRANSFORM ||
+			priv->active_transform_type == ZOOM_FFT_TRANSFORM)
+		return true;
+
+	if ((priv->active_transform_type != WATERFALL_TRANSFORM &&
+			priv->active_transform_type != FIR_PREVIEW_TRANSFORM) ||
+			!priv->transform_list->size)
+		return false;
+
+	return FFT_SETTINGS(priv->transform_list->transforms[0])->
+		fft_alg_data.num_active_channels == 2;
 }
 
 void osc_plot_update_rx_lbl(OscPlot *plot, bool force_update)
@@ -509,12 +581,12 @@ void osc_plot_update_rx_lbl(OscPlot *plot, bool force_update)
 	device_rx_info_update(plot);
 
 	/* Skip rescaling graphs, updating labels and others if the redrawing is currently halted. */
-	if (priv->redraw_function <= 0 && !force_update)
+	if (!priv->redraw_active && !force_update)
 		return;
 
 	if (is_frequency_transform(priv)) {
 		gfloat top, bottom, left, right;
-		gfloat padding;
+		gfloat padding, low, high;
 
 		/* In FFT mode we need to scale the x-axis according to the selected sampling frequency */
 		for (i = 0; i < tr_list->size; i++) {
@@ -526,22 +598,41 @@ void osc_plot_update_rx_lbl(OscPlot *plot, bool force_update)
 		sprintf(buf, "%cHz", dev_info->adc_scale);
 		gtk_label_set_text(GTK_LABEL(priv->hor_scale), buf);
 
-		if (priv->active_transform_type == COMPLEX_FFT_TRANSFORM)
-			corr = dev_info->adc_freq / 2.0;
-		else
-			corr = 0;
 		if (!gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(priv->enable_auto_scale)) && !force_update)
 			return;
 		if (priv->profile_loaded_scale)
 			return;
 
-		update_grid(plot, -corr, dev_info->adc_freq / 2.0);
-		padding = (dev_info->adc_freq / 2.0 + corr) * 0.05;
+		if (priv->active_transform_type == ZOOM_FFT_TRANSFORM) {
+			/* Only the requested span, the rest is the filter skirt */
+			struct _zoom_fft_settings *zoom = ZOOM_FFT_SETTINGS(
+					tr_list->transforms[0]);
+
+			corr = prefix2scale(dev_info->adc_scale);
+			low = (zoom->center - zoom->span / 2.0) / corr;
+			high = (zoom->center + zoom->span / 2.0) / corr;
+		} else {
+			high = dev_info->adc_freq / 2.0;
+			/* The preview shows the band left after decimation */
+			if (priv->active_transform_type == FIR_PREVIEW_TRANSFORM &&
+					priv->fir_preview)
+				high /= priv->fir_preview->rx_dec;
+			if (is_complex_frequency_transform(priv))
+				corr = high;
+			else
+				corr = 0;
+			low = -corr;
+		}
+
+		update_grid(plot, low, high);
+		padding = (high - low) * 0.05;
 		gtk_databox_get_total_limits(GTK_DATABOX(priv->databox), &left, &right,
 				&top, &bottom);
 		gtk_databox_set_total_limits(GTK_DATABOX(priv->databox),
-				-corr - padding, dev_info->adc_freq / 2.0 + padding,
+				low - padding, high + padding,
 				top, bottom);
+	} else if (priv->active_transform_type == HISTOGRAM_TRANSFORM) {
+		gtk_label_set_text(GTK_LABEL(priv->hor_scale), "Code");
 	} else {
 		switch (gtk_combo_box_get_active(GTK_COMBO_BOX(priv->hor_units))) {
 		case 0:
@@ -558,7 +649,7 @@ void osc_plot_restart (OscPlot *plot)
 {
 	OscPlotPrivate *priv = plot->priv;
 
-	if (priv->redraw_function > 0)
+	if (priv->redraw_active)
 	{
 		priv->stop_redraw = TRUE;
 		plot_setup(plot);
@@ -571,7 +662,7 @@ void osc_plot_restart (OscPlot *plot)
 
 bool osc_plot_running_state (OscPlot *plot)
 {
-	return !!plot->priv->redraw_function;
+	return !!plot->priv->redraw_active;
 }
 
 void osc_plot_draw_start (OscPlot *plot)
@@ -595,7 +686,7 @@ void osc_plot_save_to_ini (OscPlot *plot, char *filename)
 
 void osc_plot_save_as (OscPlot *plot, char *filename, int type)
 {
-	save_as(plot, filename, type);
+	save_as(plot, filename, type, true);
 }
 
 const char * osc_plot_get_active_device (OscPlot *plot)
@@ -827,6 +918,70 @@ void osc_plot_spect_set_filter_bw(OscPlot *plot, double bw)
 	plot->priv->filter_bw = bw;
 }
 
+static void plot_channel_rebind(PlotChn *pchn, struct iio_context *ctx)
+{
+	GSList *node;
+
+	pchn->ctx = ctx;
+	if (pchn->type == PLOT_IIO_CHANNEL) {
+		PLOT_IIO_CHN(pchn)->iio_chn = osc_channel_rebind(ctx,
+				PLOT_IIO_CHN(pchn)->iio_chn);
+	} else if (pchn->type == PLOT_MATH_CHANNEL) {
+		for (node = PLOT_MATH_CHN(pchn)->iio_channels; node;
+				node = g_slist_next(node))
+			node->data = osc_channel_rebind(ctx, node->data);
+	}
+}
+
+/* The link to the hardware was reopened: swap every device and channel
+ * handle for its counterpart in 'ctx', keeping the plot as it is */
+void osc_plot_rebind_context(OscPlot *plot, struct iio_context *ctx)
+{
+	OscPlotPrivate *priv = plot->priv;
+	GtkTreeModel *model;
+	GtkTreeIter dev_iter, ch_iter;
+	gboolean next_dev, next_ch, is_device;
+	PlotChn *pchn;
+	gpointer ref;
+	Transform *tr;
+	int i;
+
+	priv->ctx = ctx;
+	priv->current_device = osc_device_rebind(ctx, priv->current_device);
+
+	model = gtk_tree_view_get_model(GTK_TREE_VIEW(priv->channel_list_view));
+	next_dev = gtk_tree_model_get_iter_first(model, &dev_iter);
+	while (next_dev) {
+		gtk_tree_model_get(model, &dev_iter, ELEMENT_REFERENCE, &ref,
+				IS_DEVICE, &is_device, -1);
+		if (is_device && ref)
+			gtk_tree_store_set(GTK_TREE_STORE(model), &dev_iter,
+					ELEMENT_REFERENCE,
+					osc_device_rebind(ctx, ref), -1);
+
+		next_ch = gtk_tree_model_iter_children(model, &ch_iter, &dev_iter);
+		while (next_ch) {
+			gtk_tree_model_get(model, &ch_iter, ELEMENT_REFERENCE, &ref,
+					CHANNEL_SETTINGS, &pchn, -1);
+			if (ref)
+				gtk_tree_store_set(GTK_TREE_STORE(model), &ch_iter,
+						ELEMENT_REFERENCE,
+						osc_channel_rebind(ctx, ref), -1);
+			if (pchn)
+				plot_channel_rebind(pchn, ctx);
+			next_ch = gtk_tree_model_iter_next(model, &ch_iter);
+		}
+		next_dev = gtk_tree_model_iter_next(model, &dev_iter);
+	}
+
+	for (i = 0; i < priv->transform_list->size; i++) {
+		tr = priv->transform_list->transforms[i];
+		if (tr->type_id == HISTOGRAM_TRANSFORM)
+			HISTOGRAM_SETTINGS(tr)->channel = osc_channel_rebind(ctx,
+					HISTOGRAM_SETTINGS(tr)->channel);
+	}
+}
+
 static void osc_plot_dispose(GObject *object)
 {
 	G_OBJECT_CLASS(osc_plot_parent_class)->dispose(object);
@@ -846,6 +1001,45 @@ static double win_hanning(int j, int n)
 	return (w);
 }
 
+/* Runs the fixed-point FFT of int_fft.c into fft->fix_re/fix_im */
+static void do_fixed_fft(struct _fft_settings *settings)
+{
+	struct _fft_alg_data *fft = &settings->fft_alg_data;
+	gfloat *in_re = settings->real_source;
+	gfloat *in_im = settings->imag_source;
+	int fft_size = settings->fft_size;
+	int shift = fft->fixed_shift;
+	int i, log2n, v;
+
+	if (fft->cached_fft_size != fft_size) {
+		fft->fix_re = realloc(fft->fix_re, sizeof(short) * fft_size);
+		fft->fix_im = realloc(fft->fix_im, sizeof(short) * fft_size);
+		fft->m = fft->num_active_channels == 2 ? fft_size : fft_size / 2;
+		fft->cached_fft_size = fft_size;
+		fft->cached_num_active_channels = fft->num_active_channels;
+	}
+
+	for (i = 0; i < fft_size; i++) {
+		v = (int)in_re[i];
+		v = shift >= 0 ? v << shift : v >> -shift;
+		fft->fix_re[i] = CLAMP(v, -32768, 32767);
+		if (fft->num_active_channels == 2) {
+			v = (int)in_im[i];
+			v = shift >= 0 ? v << shift : v >> -shift;
+			fft->fix_im[i] = CLAMP(v, -32768, 32767);
+		} else {
+			fft->fix_im[i] = 0;
+		}
+	}
+
+	window(fft->fix_re, fft_size);
+	if (fft->num_active_channels == 2)
+		window(fft->fix_im, fft_size);
+
+	for (log2n = 0; (1 << log2n) < fft_size; log2n++);
+	fix_fft(fft->fix_re, fft->fix_im, log2n, 0);
+}
+
 static void do_fft(Transform *tr)
 {
 	struct _fft_settings *settings = tr->settings;
@@ -864,11 +1058,19 @@ static void do_fft(Transform *tr)
 	int maxX[MAX_MARKERS + 1];
 	gfloat maxY[MAX_MARKERS + 1];
 	gfloat plugin_fft_corr;
+	gfloat fixed_corr = 0;
+	bool use_fixed;
 
 	if (settings->marker_type)
 		marker_type = *((enum marker_types *)settings->marker_type);
 
-	if ((fft->cached_fft_size == -1) || (fft->cached_fft_size != fft_size) ||
+	/* The Sinewave[] table of int_fft.c limits the fixed-point size */
+	use_fixed = fft->fixed_point && fft_size <= FIX_FFT_MAX_POINTS;
+	if (use_fixed) {
+		do_fixed_fft(settings);
+		/* fix_fft() scales by 1/n, db_from_ampl() is relative to Q15 */
+		fixed_corr = 20 * log10(2.0 * fft_size / fft->m);
+	} else if ((fft->cached_fft_size == -1) || (fft->cached_fft_size != fft_size) ||
 		(fft->cached_num_active_channels != fft->num_active_channels)) {
 
 		if (fft->cached_fft_size != -1) {
@@ -905,7 +1107,9 @@ static void do_fft(Transform *tr)
 		fft->cached_num_active_channels = fft->num_active_channels;
 	}
 
-	if (fft->num_active_channels == 2) {
+	if (use_fixed) {
+		/* already transformed */
+	} else if (fft->num_active_channels == 2) {
 		in_data_c = settings->imag_source;
 		for (cnt = 0, i = 0; cnt < fft_size; cnt++) {
 			/* normalization and scaling see fft_corr */
@@ -924,7 +1128,8 @@ static void do_fft(Transform *tr)
 	struct extra_dev_info *dev_info = iio_device_get_data(iio_dev);
 	plugin_fft_corr = dev_info->plugin_fft_corr;
 
-	fftw_execute(fft->plan_forward);
+	if (!use_fixed)
+		fftw_execute(fft->plan_forward);
 	avg = (double)settings->fft_avg;
 	if (avg && avg != 128 )
 		avg = 1.0f / avg;
@@ -946,12 +1151,17 @@ static void do_fft(Transform *tr)
 				j = i;
 		}
 
-		if (creal(fft->out[j]) == 0 && cimag(fft->out[j]) == 0)
-			fft->out[j] = FLT_MIN + I * FLT_MIN;
+		if (use_fixed) {
+			mag = db_from_ampl(fft->fix_re[j], fft->fix_im[j]) +
+				fixed_corr + pwr_offset + plugin_fft_corr;
+		} else {
+			if (creal(fft->out[j]) == 0 && cimag(fft->out[j]) == 0)
+				fft->out[j] = FLT_MIN + I * FLT_MIN;
 
-		mag = 10 * log10((creal(fft->out[j]) * creal(fft->out[j]) +
-				cimag(fft->out[j]) * cimag(fft->out[j])) / ((unsigned long long)fft->m * fft->m)) +
-			fft->fft_corr + pwr_offset + plugin_fft_corr;
+			mag = 10 * log10((creal(fft->out[j]) * creal(fft->out[j]) +
+					cimag(fft->out[j]) * cimag(fft->out[j])) / ((unsigned long long)fft->m * fft->m)) +
+				fft->fft_corr + pwr_offset + plugin_fft_corr;
+		}
 		/* it's better for performance to have separate loops,
 		 * rather than do these tests inside the loop, but it makes
 		 * the code harder to understand... Oh well...
@@ -1032,14 +1242,14 @@ static void do_fft(Transform *tr)
 					i = 1;
 				} else if (j == 1) {
 					/* keep DC */
-					if (tr->type_id == COMPLEX_FFT_TRANSFORM)
+					if (fft->num_active_channels == 2)
 						markers[j].bin = m / 2;
 					else
 						markers[j].bin = 0;
 				} else {
 					/* where should the spurs be? */
 					i++;
-					if (tr->type_id == COMPLEX_FFT_TRANSFORM) {
+					if (fft->num_active_channels == 2) {
 						markers[j].bin = (markers[0].bin - (m / 2)) * i + (m / 2);
 						if (markers[j].bin > m)
 							markers[j].bin -= 2 * (markers[j].bin - m);
@@ -1240,36 +1450,20 @@ static void do_fft_for_spectrum(Transform *tr)
  * http://blog.dmaggot.org/2010/06/cross-correlation-using-fftw3/
  * which is copyright 2010 David E. Narváez
  */
-static void xcorr(fftw_complex *signala, fftw_complex *signalb, fftw_complex *result, int N, double avg)
+static void xcorr(struct _cross_correlation_settings *settings,
+		fftw_complex *signala, fftw_complex *signalb, int N, double avg)
 {
-	fftw_complex * signala_ext = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) * (2 * N - 1));
-	fftw_complex * signalb_ext = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) * (2 * N - 1));
-	fftw_complex * outa = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) * (2 * N - 1));
-	fftw_complex * outb = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) * (2 * N - 1));
-	fftw_complex * out = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) * (2 * N - 1));
+	fftw_complex *result = settings->xcorr_data;
+	fftw_complex *cross = avg > 1 ? settings->cross : result;
 	fftw_complex scale;
-	fftw_complex *cross;
-
 	int i;
 	double peak_a = 0.0, peak_b = 0.0;
 
-	if (!signala_ext || !signalb_ext || !outa || !outb || !out)
-		return;
-
-	if (avg > 1)
-		cross = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * (2 * N));
-	else
-		cross = result;
-
-	fftw_plan pa = fftw_plan_dft_1d(2 * N - 1, signala_ext, outa, FFTW_FORWARD, FFTW_ESTIMATE);
-	fftw_plan pb = fftw_plan_dft_1d(2 * N - 1, signalb_ext, outb, FFTW_FORWARD, FFTW_ESTIMATE);
-	fftw_plan px = fftw_plan_dft_1d(2 * N - 1, out, cross, FFTW_BACKWARD, FFTW_ESTIMATE);
-
 	//zeropadding
-	memset(signala_ext, 0, sizeof(fftw_complex) * (N - 1));
-	memcpy(signala_ext + (N - 1), signala, sizeof(fftw_complex) * N);
-	memcpy(signalb_ext, signalb, sizeof(fftw_complex) * N);
-	memset(signalb_ext + N, 0, sizeof(fftw_complex) * (N - 1));
+	memset(settings->signal_a_ext, 0, sizeof(fftw_complex) * (N - 1));
+	memcpy(settings->signal_a_ext + (N - 1), signala, sizeof(fftw_complex) * N);
+	memcpy(settings->signal_b_ext, signalb, sizeof(fftw_complex) * N);
+	memset(settings->signal_b_ext + N, 0, sizeof(fftw_complex) * (N - 1));
 
 	/* find the peaks of the time domain, for normalization */
 	for (i = 0; i < N; i++) {
@@ -1281,26 +1475,18 @@ static void xcorr(fftw_complex *signala, fftw_complex *signalb, fftw_complex *re
 	}
 
 	/* Move the two signals into the fourier domain */
-	fftw_execute(pa);
-	fftw_execute(pb);
+	fftw_execute(settings->plan_a);
+	fftw_execute(settings->plan_b);
 
 	/* Compute the dot product, and scale them */
 	scale = (2 * N -1) * peak_a * peak_b * 2;
 	for (i = 0; i < 2 * N - 1; i++)
-		out[i] = outa[i] * conj(outb[i]) / scale;
+		settings->product[i] = settings->fft_a[i] *
+			conj(settings->fft_b[i]) / scale;
 
-	/* Inverse FFT on the dot product */
-	fftw_execute(px);
-
-	fftw_destroy_plan(pa);
-	fftw_destroy_plan(pb);
-	fftw_destroy_plan(px);
-
-	fftw_free(signala_ext);
-	fftw_free(signalb_ext);
-	fftw_free(out);
-	fftw_free(outa);
-	fftw_free(outb);
+	/* Inverse FFT on the dot product, both outputs live in the same arena
+	 * so they have the alignment the plan was made for */
+	fftw_execute_dft(settings->plan_cross, settings->product, cross);
 
 	if(avg > 1) {
 		if (result[0] == FLT_MAX) {
@@ -1310,14 +1496,77 @@ static void xcorr(fftw_complex *signala, fftw_complex *signalb, fftw_complex *re
 			for (i = 0; i < 2 * N -1; i++)
 				result[i] = (result[i] * (avg - 1) + cross[i]) / avg;
 		}
-		fftw_free(cross);
 	}
 
-	fftw_cleanup();
-
 	return;
 }
 
+static void xcorr_destroy_plans(struct _cross_correlation_settings *settings)
+{
+	if (!settings->plan_a)
+		return;
+
+	fftw_destroy_plan(settings->plan_a);
+	fftw_destroy_plan(settings->plan_b);
+	fftw_destroy_plan(settings->plan_cross);
+	settings->plan_a = NULL;
+	settings->plan_b = NULL;
+	settings->plan_cross = NULL;
+}
+
+static void xcorr_destroy(struct _cross_correlation_settings *settings)
+{
+	xcorr_destroy_plans(settings);
+	osc_arena_release(&settings->arena);
+	settings->signal_a = NULL;
+	settings->signal_b = NULL;
+	settings->xcorr_data = NULL;
+}
+
+/* All work buffers of one correlation come from a single slab, and the
+ * plans are made once here instead of on every frame */
+static int xcorr_setup(struct _cross_correlation_settings *settings,
+		unsigned int N)
+{
+	size_t sz = sizeof(fftw_complex);
+	unsigned int L = 2 * N - 1;
+
+	xcorr_destroy_plans(settings);
+
+	if (osc_arena_reserve(&settings->arena,
+				2 * OSC_ARENA_ROUND(sz * N) +
+				2 * OSC_ARENA_ROUND(sz * 2 * N) +
+				5 * OSC_ARENA_ROUND(sz * L)))
+		return -ENOMEM;
+
+	settings->signal_a = osc_arena_alloc(&settings->arena, sz * N);
+	settings->signal_b = osc_arena_alloc(&settings->arena, sz * N);
+	settings->xcorr_data = osc_arena_alloc(&settings->arena, sz * 2 * N);
+	settings->cross = osc_arena_alloc(&settings->arena, sz * 2 * N);
+	settings->signal_a_ext = osc_arena_alloc(&settings->arena, sz * L);
+	settings->signal_b_ext = osc_arena_alloc(&settings->arena, sz * L);
+	settings->fft_a = osc_arena_alloc(&settings->arena, sz * L);
+	settings->fft_b = osc_arena_alloc(&settings->arena, sz * L);
+	settings->product = osc_arena_alloc(&settings->arena, sz * L);
+
+	settings->plan_a = fftw_plan_dft_1d(L, settings->signal_a_ext,
+			settings->fft_a, FFTW_FORWARD, FFTW_ESTIMATE);
+	settings->plan_b = fftw_plan_dft_1d(L, settings->signal_b_ext,
+			settings->fft_b, FFTW_FORWARD, FFTW_ESTIMATE);
+	settings->plan_cross = fftw_plan_dft_1d(L, settings->product,
+			settings->cross, FFTW_BACKWARD, FFTW_ESTIMATE);
+
+	return 0;
+}
+
+static void math_channel_evaluate(PlotMathChn *m, unsigned long long count)
+{
+	uint64_t t = instr_now();
+
+	m->math_expression(m->iio_channels_data, m->data_ref, count);
+	instr_record(INSTR_MATH, t, NULL);
+}
+
 bool time_transform_function(Transform *tr, gboolean init_transform)
 {
 	struct _time_settings *settings = tr->settings;
@@ -1353,8 +1602,7 @@ bool time_transform_function(Transform *tr, gboolean init_transform)
 
 	if (tr->plot_channels_type == PLOT_MATH_CHANNEL) {
 		PlotMathChn *m = tr->plot_channels->data;
-		m->math_expression(m->iio_channels_data,
-			m->data_ref, settings->num_samples);
+		math_channel_evaluate(m, settings->num_samples);
 	} else if (tr->plot_channels_type == PLOT_IIO_CHANNEL) {
 		if (!settings->apply_inverse_funct &&
 				!settings->apply_multiply_funct &&
@@ -1400,21 +1648,10 @@ bool cross_correlation_transform_function(Transform *tr, gboolean init_transform
 		settings->q1_source = plot_channels_get_nth_data_ref(tr->plot_channels, 3);
 
 		/* Initialize axis */
-		if (settings->signal_a) {
-			fftw_free(settings->signal_a);
-			settings->signal_a = NULL;
-		}
-		if (settings->signal_b) {
-			fftw_free(settings->signal_b);
-			settings->signal_b = NULL;
-		}
-		if (settings->xcorr_data) {
-			fftw_free(settings->xcorr_data);
-			settings->xcorr_data = NULL;
+		if (xcorr_setup(settings, axis_length)) {
+			fprintf(stderr, "Unable to allocate cross correlation buffers\n");
+			return false;
 		}
-		settings->signal_a = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) * axis_length);
-		settings->signal_b = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) * axis_length);
-		settings->xcorr_data = (fftw_complex *) fftw_malloc(sizeof(fftw_complex) * axis_length * 2);
 		settings->xcorr_data[0] = FLT_MAX;
 
 		Transform_resize_x_axis(tr, 2 * axis_length);
@@ -1428,13 +1665,15 @@ bool cross_correlation_transform_function(Transform *tr, gboolean init_transform
 		return true;
 	}
 
+	if (!settings->plan_a)
+		return false;
+
 	GSList *node;
 
 	if (tr->plot_channels_type == PLOT_MATH_CHANNEL)
 		for (node = tr->plot_channels; node; node = g_slist_next(node)) {
 			PlotMathChn *m = node->data;
-			m->math_expression(m->iio_channels_data,
-				m->data_ref, settings->num_samples);
+			math_channel_evaluate(m, settings->num_samples);
 		}
 
 	i_0 = settings->i0_source;
@@ -1448,9 +1687,9 @@ bool cross_correlation_transform_function(Transform *tr, gboolean init_transform
 	}
 
 	if (settings->revert_xcorr)
-		xcorr(settings->signal_b, settings->signal_a, settings->xcorr_data, axis_length, (double)settings->avg);
+		xcorr(settings, settings->signal_b, settings->signal_a, axis_length, (double)settings->avg);
 	else
-		xcorr(settings->signal_a, settings->signal_b, settings->xcorr_data, axis_length, (double)settings->avg);
+		xcorr(settings, settings->signal_a, settings->signal_b, axis_length, (double)settings->avg);
 
 	gfloat *out_data = tr->y_axis;
 	gfloat *X = tr->x_axis;
@@ -1678,6 +1917,7 @@ bool fft_transform_function(Transform *tr, gboolean init_transform)
 
 		/* Compute FFT normalization and scaling offset */
 		settings->fft_alg_data.fft_corr = 20 * log10(2.0 / (1ULL << (bits_used - 1)));
+		settings->fft_alg_data.fixed_shift = 16 - bits_used;
 
 		/* Make sure that previous positions of markers are not out of bonds */
 		if (settings->markers)
@@ -1693,14 +1933,710 @@ bool fft_transform_function(Transform *tr, gboolean init_transform)
 	if (tr->plot_channels_type == PLOT_MATH_CHANNEL)
 		for (node = tr->plot_channels; node; node = g_slist_next(node)) {
 			PlotMathChn *m = node->data;
-			m->math_expression(m->iio_channels_data,
-				m->data_ref, settings->fft_size);
+			math_channel_evaluate(m, settings->fft_size);
 		}
 	do_fft(tr);
 
 	return true;
 }
 
+static guint32 waterfall_lut[256];
+
+static void waterfall_lut_init(void)
+{
+	/* black -> blue -> cyan -> yellow -> red -> white */
+	static const guint8 stops[][3] = {
+		{ 0, 0, 0 },
+		{ 0, 0, 160 },
+		{ 0, 200, 255 },
+		{ 255, 255, 0 },
+		{ 255, 0, 0 },
+		{ 255, 255, 255 },
+	};
+	static bool initialized = false;
+	unsigned int i, seg, c;
+	guint8 rgb[3];
+	double pos, f;
+
+	if (initialized)
+		return;
+
+	for (i = 0; i < 256; i++) {
+		pos = i * 5.0 / 255.0;
+		seg = (unsigned int)pos;
+		if (seg > 4)
+			seg = 4;
+		f = pos - seg;
+		for (c = 0; c < 3; c++)
+			rgb[c] = stops[seg][c] + f * (stops[seg + 1][c] - stops[seg][c]);
+		waterfall_lut[i] = (rgb[0] << 16) | (rgb[1] << 8) | rgb[2];
+	}
+	initialized = true;
+}
+
+static guint16 waterfall_quantize(gfloat level)
+{
+	gfloat q = (level - WATERFALL_LEVEL_FLOOR) * WATERFALL_LEVEL_STEPS;
+
+	/* written so that NaN and -inf end up at the floor */
+	if (!(q > 0.0f))
+		return 0;
+	if (q >= WATERFALL_LEVELS - 1)
+		return WATERFALL_LEVELS - 1;
+	return (guint16)q;
+}
+
+/* Maps every quantized level to its color in the current range */
+static void waterfall_colors_update(struct _waterfall_settings *wf)
+{
+	gfloat scale = 255.0f / (wf->level_max - wf->level_min);
+	gfloat level;
+	unsigned int i;
+	int idx;
+
+	for (i = 0; i < WATERFALL_LEVELS; i++) {
+		level = WATERFALL_LEVEL_FLOOR + (gfloat)i / WATERFALL_LEVEL_STEPS;
+		idx = (int)((level - wf->level_min) * scale);
+		if (idx < 0)
+			idx = 0;
+		else if (idx > 255)
+			idx = 255;
+		wf->colors[i] = waterfall_lut[idx];
+	}
+}
+
+static void waterfall_paint_row(struct _waterfall_settings *wf, unsigned int row)
+{
+	unsigned char *data;
+	guint32 *pixel;
+	guint16 *values = wf->history + row * wf->columns;
+	unsigned int i;
+
+	if (wf->level_max <= wf->level_min)
+		return;
+
+	cairo_surface_flush(wf->image);
+	data = cairo_image_surface_get_data(wf->image);
+	pixel = (guint32 *)(data + row * cairo_image_surface_get_stride(wf->image));
+
+	for (i = 0; i < wf->columns; i++)
+		pixel[i] = wf->colors[values[i]];
+	cairo_surface_mark_dirty_rectangle(wf->image, 0, row, wf->columns, 1);
+}
+
+static void waterfall_push_row(Transform *tr)
+{
+	struct _waterfall_settings *wf = tr->settings;
+	gfloat *in_data = tr->y_axis;
+	guint16 *row;
+	gfloat peak;
+	unsigned int i, j, bin;
+
+	/* Rows are written backwards, so the newest one always sits at head */
+	wf->head = (wf->head + wf->rows - 1) % wf->rows;
+	row = wf->history + wf->head * wf->columns;
+
+	for (i = 0, bin = 0; i < wf->columns; i++) {
+		/* keep the strongest bin of each column, so narrow spurs survive */
+		peak = in_data[bin++];
+		for (j = 1; j < wf->bins_per_column && bin < tr->y_axis_size; j++, bin++)
+			if (in_data[bin] > peak)
+				peak = in_data[bin];
+
+		if (wf->hold_decay > 0) {
+			wf->hold[i] -= wf->hold_decay;
+			if (wf->hold[i] < peak)
+				wf->hold[i] = peak;
+			peak = wf->hold[i];
+		}
+		row[i] = waterfall_quantize(peak);
+	}
+
+	if (wf->filled < wf->rows)
+		wf->filled++;
+
+	waterfall_paint_row(wf, wf->head);
+}
+
+static void waterfall_update_levels(OscPlotPrivate *priv, Transform *tr)
+{
+	struct _waterfall_settings *wf = tr->settings;
+	gfloat left, right, top, bottom, low, high, step;
+	unsigned int i, row;
+
+	if (!wf->image)
+		return;
+
+	/* The color scale follows the vertical range of the spectrum plot */
+	gtk_databox_get_visible_limits(GTK_DATABOX(priv->databox),
+			&left, &right, &top, &bottom);
+	low = MIN(top, bottom);
+	high = MAX(top, bottom);
+	if (high <= low)
+		return;
+
+	/* Autoscale nudges the range on every frame; as long as no level
+	 * moves by a whole color, the image stays as it is */
+	step = (high - low) / 256;
+	if (wf->level_max > wf->level_min &&
+			fabsf(low - wf->level_min) < step &&
+			fabsf(high - wf->level_max) < step)
+		return;
+
+	wf->level_min = low;
+	wf->level_max = high;
+	waterfall_colors_update(wf);
+	for (i = 0, row = wf->head; i < wf->filled; i++, row = (row + 1) % wf->rows)
+		waterfall_paint_row(wf, row);
+}
+
+bool waterfall_transform_function(Transform *tr, gboolean init_transform)
+{
+	struct _waterfall_settings *wf = tr->settings;
+	unsigned int i;
+
+	if (init_transform) {
+		if (!fft_transform_function(tr, TRUE))
+			return false;
+
+		waterfall_lut_init();
+
+		wf->bins_per_column = (tr->y_axis_size + WATERFALL_MAX_COLUMNS - 1) /
+			WATERFALL_MAX_COLUMNS;
+		wf->columns = (tr->y_axis_size + wf->bins_per_column - 1) /
+			wf->bins_per_column;
+		wf->rows = WATERFALL_ROWS;
+		wf->head = 0;
+		wf->filled = 0;
+
+		wf->history = realloc(wf->history,
+				sizeof(guint16) * wf->rows * wf->columns);
+		wf->colors = realloc(wf->colors,
+				sizeof(guint32) * WATERFALL_LEVELS);
+		/* no colors until the first waterfall_update_levels() */
+		wf->level_min = wf->level_max = 0;
+		wf->hold = realloc(wf->hold, sizeof(gfloat) * wf->columns);
+		for (i = 0; i < wf->columns; i++)
+			wf->hold[i] = -200.0f;
+
+		if (wf->image)
+			cairo_surface_destroy(wf->image);
+		wf->image = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+				wf->columns, wf->rows);
+
+		return true;
+	}
+
+	if (!fft_transform_function(tr, FALSE))
+		return false;
+
+	waterfall_push_row(tr);
+
+	return true;
+}
+
+static void waterfall_destroy(Transform *tr)
+{
+	struct _waterfall_settings *wf = tr->settings;
+
+	free(wf->history);
+	free(wf->colors);
+	free(wf->hold);
+	if (wf->image)
+		cairo_surface_destroy(wf->image);
+}
+
+/*
+ * Zoom FFT: the I/Q pair is mixed down by the zoom center, decimated to
+ * just cover the span and only then transformed, so a narrow band gets a
+ * fine resolution out of a small FFT.
+ */
+bool zoom_fft_transform_function(Transform *tr, gboolean init_transform)
+{
+	struct _zoom_fft_settings *zoom = tr->settings;
+	struct _fft_settings *fft = &zoom->fft;
+	struct extra_dev_info *dev_info;
+	struct iio_device *dev;
+	unsigned int i, produced, fft_size;
+	double fs, fs_out, scale;
+	GSList *node;
+
+	if (init_transform) {
+		dev = transform_get_device_parent(tr);
+		if (!dev)
+			return false;
+		dev_info = iio_device_get_data(dev);
+		scale = prefix2scale(dev_info->adc_scale);
+		fs = dev_info->adc_freq * scale;
+		zoom->num_samples = dev_info->sample_count;
+		if (dev_info->channel_trigger_enabled)
+			zoom->num_samples /= 2;
+
+		/* Use a smaller FFT if the capture is too short to feed it */
+		while (fft->fft_size > 32 && dsp_ddc_input_length(fs,
+				zoom->span, fft->fft_size) > zoom->num_samples)
+			fft->fft_size /= 2;
+
+		if (!fft_transform_function(tr, TRUE))
+			return false;
+
+		zoom->i_source = fft->real_source;
+		zoom->q_source = fft->imag_source;
+		if (!zoom->q_source)
+			return false;
+
+		dsp_ddc_free(zoom->ddc);
+		zoom->ddc = dsp_ddc_new(fs, zoom->center, zoom->span);
+		if (!zoom->ddc)
+			return false;
+
+		zoom->out_size = zoom->num_samples /
+			dsp_ddc_decimation(zoom->ddc) + 1;
+		if (zoom->out_size < fft->fft_size)
+			zoom->out_size = fft->fft_size;
+		zoom->dec_i = realloc(zoom->dec_i, sizeof(gfloat) * zoom->out_size);
+		zoom->dec_q = realloc(zoom->dec_q, sizeof(gfloat) * zoom->out_size);
+
+		/* The axis is centered on the NCO frequency */
+		fs_out = fs / dsp_ddc_decimation(zoom->ddc);
+		for (i = 0; i < fft->fft_size; i++)
+			tr->x_axis[i] = (zoom->center + ((double)i -
+				fft->fft_size / 2.0) * fs_out / fft->fft_size) / scale;
+
+		return true;
+	}
+
+	if (tr->plot_channels_type == PLOT_MATH_CHANNEL)
+		for (node = tr->plot_channels; node; node = g_slist_next(node))
+			math_channel_evaluate(node->data, zoom->num_samples);
+
+	/* Captures are not contiguous, each one is filtered on its own */
+	dsp_ddc_reset(zoom->ddc);
+	produced = dsp_ddc_process(zoom->ddc, zoom->i_source, zoom->q_source,
+			zoom->num_samples, zoom->dec_i, zoom->dec_q);
+
+	/* The last samples are the ones the filters have settled on */
+	fft_size = fft->fft_size;
+	if (produced < fft_size) {
+		memset(zoom->dec_i + produced, 0, sizeof(gfloat) * (fft_size - produced));
+		memset(zoom->dec_q + produced, 0, sizeof(gfloat) * (fft_size - produced));
+		produced = fft_size;
+	}
+	fft->real_source = zoom->dec_i + produced - fft_size;
+	fft->imag_source = zoom->dec_q + produced - fft_size;
+
+	do_fft(tr);
+
+	return true;
+}
+
+static void zoom_fft_destroy(Transform *tr)
+{
+	struct _zoom_fft_settings *zoom = tr->settings;
+
+	dsp_ddc_free(zoom->ddc);
+	free(zoom->dec_i);
+	free(zoom->dec_q);
+}
+
+static bool zoom_fft_enabled(OscPlot *plot)
+{
+	OscPlotPrivate *priv = plot->priv;
+	int channels;
+
+	if (gtk_combo_box_get_active(GTK_COMBO_BOX(priv->plot_domain)) != FFT_PLOT ||
+			!gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(priv->zoom_fft_widget)))
+		return false;
+
+	/* Only I/Q pairs are zoomed, a single channel keeps the plain FFT */
+	channels = enabled_channels_count(plot);
+	return channels == 2 || channels == 4;
+}
+
+/* Input samples a zoom FFT needs from the device, within MAX_SAMPLES */
+static int zoom_fft_sample_count(OscPlotPrivate *priv,
+		struct extra_dev_info *dev_info)
+{
+	double fs = dev_info->adc_freq * prefix2scale(dev_info->adc_scale);
+	double span = gtk_spin_button_get_value(GTK_SPIN_BUTTON(priv->zoom_span_widget));
+	unsigned int count;
+
+	count = dsp_ddc_input_length(fs, span, comboboxtext_get_active_text_as_int(
+				GTK_COMBO_BOX_TEXT(priv->fft_size_widget)));
+
+	return count > MAX_SAMPLES ? MAX_SAMPLES : count;
+}
+
+/*
+ * FIR preview: runs the RX filter of a .ftr file over the capture, as the
+ * hardware would with its own FIR bypassed, and shows the spectrum of the
+ * decimated stream together with the response of the filter.
+ */
+bool fir_preview_transform_function(Transform *tr, gboolean init_transform)
+{
+	struct _fir_preview_settings *fir = tr->settings;
+	struct _fft_settings *fft = &fir->fft;
+	struct extra_dev_info *dev_info;
+	struct iio_device *dev;
+	float taps[FIR_FILTER_MAX_TAPS];
+	unsigned int i, ntaps, dec, idx, produced, fft_size;
+	const float *resp;
+	double fs_out, corr;
+	GSList *node;
+
+	if (init_transform) {
+		if (!fir->filter)
+			return false;
+
+		dev = transform_get_device_parent(tr);
+		if (!dev)
+			return false;
+		dev_info = iio_device_get_data(dev);
+		fir->num_samples = dev_info->sample_count;
+		if (dev_info->channel_trigger_enabled)
+			fir->num_samples /= 2;
+
+		/* Use a smaller FFT if the capture is too short to feed it */
+		dec = fir->filter->rx_dec;
+		while (fft->fft_size > 32 && dec * fft->fft_size +
+				fir->filter->ntaps > fir->num_samples)
+			fft->fft_size /= 2;
+
+		if (!fft_transform_function(tr, TRUE))
+			return false;
+
+		fir->i_source = fft->real_source;
+		fir->q_source = fft->imag_source;
+
+		if (!fir->fir_i)
+			fir->fir_i = calloc(1, sizeof(*fir->fir_i));
+		if (!fir->fir_q)
+			fir->fir_q = calloc(1, sizeof(*fir->fir_q));
+		if (!fir->fir_i || !fir->fir_q)
+			return false;
+
+		ntaps = fir_filter_file_rx_taps(fir->filter, taps);
+		dsp_fir_free(fir->fir_i);
+		dsp_fir_free(fir->fir_q);
+		if (dsp_fir_init(fir->fir_i, taps, ntaps, dec, 4096) ||
+				dsp_fir_init(fir->fir_q, taps, ntaps, dec, 4096))
+			return false;
+
+		fir->out_size = fir->num_samples / dec + 1;
+		if (fir->out_size < fft->fft_size)
+			fir->out_size = fft->fft_size;
+		fir->dec_i = realloc(fir->dec_i, sizeof(gfloat) * fir->out_size);
+		fir->dec_q = realloc(fir->dec_q, sizeof(gfloat) * fir->out_size);
+
+		/* The spectrum is that of the decimated stream */
+		fs_out = dev_info->adc_freq / dec;
+		corr = fir->q_source ? fs_out / 2.0 : 0;
+		for (i = 0; i < tr->x_axis_size; i++)
+			tr->x_axis[i] = i * fs_out / fft->fft_size - corr;
+
+		/* The response is sampled at the input rate, from DC up */
+		resp = fir_filter_file_rx_response(fir->filter);
+		fir->response = realloc(fir->response,
+				sizeof(gfloat) * tr->x_axis_size);
+		for (i = 0; i < tr->x_axis_size; i++) {
+			idx = fabs(tr->x_axis[i]) * 2 * (FIR_FILTER_RESPONSE_LEN - 1) /
+				dev_info->adc_freq + 0.5;
+			fir->response[i] = resp[MIN(idx, FIR_FILTER_RESPONSE_LEN - 1)];
+		}
+
+		return true;
+	}
+
+	if (tr->plot_channels_type == PLOT_MATH_CHANNEL)
+		for (node = tr->plot_channels; node; node = g_slist_next(node))
+			math_channel_evaluate(node->data, fir->num_samples);
+
+	/* Captures are not contiguous, each one is filtered on its own */
+	dsp_fir_reset(fir->fir_i);
+	produced = dsp_fir_decimate(fir->fir_i, fir->i_source,
+			fir->num_samples, fir->dec_i);
+	if (fir->q_source) {
+		dsp_fir_reset(fir->fir_q);
+		dsp_fir_decimate(fir->fir_q, fir->q_source,
+				fir->num_samples, fir->dec_q);
+	}
+
+	/* The last samples are the ones the filter has settled on */
+	fft_size = fft->fft_size;
+	if (produced < fft_size) {
+		memset(fir->dec_i + produced, 0, sizeof(gfloat) * (fft_size - produced));
+		memset(fir->dec_q + produced, 0, sizeof(gfloat) * (fft_size - produced));
+		produced = fft_size;
+	}
+	fft->real_source = fir->dec_i + produced - fft_size;
+	if (fir->q_source)
+		fft->imag_source = fir->dec_q + produced - fft_size;
+
+	do_fft(tr);
+
+	return true;
+}
+
+static void fir_preview_destroy(Transform *tr)
+{
+	struct _fir_preview_settings *fir = tr->settings;
+
+	if (fir->fir_i)
+		dsp_fir_free(fir->fir_i);
+	if (fir->fir_q)
+		dsp_fir_free(fir->fir_q);
+	free(fir->fir_i);
+	free(fir->fir_q);
+	free(fir->dec_i);
+	free(fir->dec_q);
+	free(fir->response);
+	if (fir->response_graph)
+		g_object_unref(fir->response_graph);
+}
+
+static bool fir_preview_enabled(OscPlot *plot)
+{
+	OscPlotPrivate *priv = plot->priv;
+
+	return gtk_combo_box_get_active(GTK_COMBO_BOX(priv->plot_domain)) == FFT_PLOT &&
+		gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(priv->fir_preview_widget)) &&
+		priv->fir_preview;
+}
+
+/* Overlays the filter response, 0 dB at the full scale of the FFT */
+static void fir_preview_add_response(OscPlotPrivate *priv, Transform *tr)
+{
+	struct _fir_preview_settings *fir = tr->settings;
+
+	if (fir->response_graph)
+		g_object_unref(fir->response_graph);
+	fir->response_graph = NULL;
+	if (!fir->response)
+		return;
+
+	fir->response_graph = gtk_databox_lines_new(tr->x_axis_size,
+			tr->x_axis, fir->response, &color_fir_response, 1);
+	gtk_databox_graph_add(GTK_DATABOX(priv->databox), fir->response_graph);
+}
+
+/* Input samples the FIR preview needs from the device, within MAX_SAMPLES */
+static int fir_preview_sample_count(OscPlotPrivate *priv)
+{
+	unsigned int count;
+
+	count = priv->fir_preview->rx_dec * comboboxtext_get_active_text_as_int(
+			GTK_COMBO_BOX_TEXT(priv->fft_size_widget)) +
+		priv->fir_preview->ntaps;
+
+	return count > MAX_SAMPLES ? MAX_SAMPLES : count;
+}
+
+/*
+ * Code histogram of one channel, or the DNL/INL derived from it. The
+ * counts are taken from the raw codes by the capture and keep growing
+ * for as long as the plot runs.
+ */
+bool histogram_transform_function(Transform *tr, gboolean init_transform)
+{
+	struct _histogram_settings *settings = tr->settings;
+	PlotChn *chn = tr->plot_channels->data;
+	const uint64_t *counts;
+	unsigned int i, size;
+	int32_t first;
+
+	if (init_transform) {
+		if (!settings->hist) {
+			if (chn->type != PLOT_IIO_CHANNEL || !PLOT_IIO_CHN(chn)->iio_chn)
+				return false;
+
+			settings->channel = PLOT_IIO_CHN(chn)->iio_chn;
+			settings->hist = osc_channel_histogram_get(settings->channel);
+			if (!settings->hist)
+				return false;
+		}
+
+		size = code_histogram_size(settings->hist);
+		first = code_histogram_first_code(settings->hist);
+		Transform_resize_x_axis(tr, size);
+		Transform_resize_y_axis(tr, size);
+		tr->y_axis_size = size;
+		for (i = 0; i < size; i++) {
+			tr->x_axis[i] = first + (int32_t)i;
+			tr->y_axis[i] = 0;
+		}
+
+		settings->dnl = realloc(settings->dnl, sizeof(gfloat) * size);
+		settings->inl = realloc(settings->inl, sizeof(gfloat) * size);
+
+		return true;
+	}
+
+	if (!settings->hist)
+		return false;
+
+	size = tr->y_axis_size;
+	switch (settings->mode) {
+	case HISTOGRAM_DNL:
+	case HISTOGRAM_INL:
+		/* Keep the last curve until there is something to work on */
+		if (code_histogram_linearity(settings->hist,
+					settings->dnl, settings->inl))
+			break;
+		memcpy(tr->y_axis, settings->mode == HISTOGRAM_DNL ?
+				settings->dnl : settings->inl, sizeof(gfloat) * size);
+		break;
+	default:
+		counts = code_histogram_counts(settings->hist);
+		for (i = 0; i < size; i++)
+			tr->y_axis[i] = counts[i];
+		break;
+	}
+
+	return true;
+}
+
+static void histogram_destroy(Transform *tr)
+{
+	struct _histogram_settings *settings = tr->settings;
+
+	if (settings->hist)
+		osc_channel_histogram_put(settings->channel);
+	free(settings->dnl);
+	free(settings->inl);
+}
+
+static enum histogram_mode histogram_mode(OscPlotPrivate *priv)
+{
+	int active = gtk_combo_box_get_active(GTK_COMBO_BOX(priv->histogram_widget));
+
+	return active < 0 ? HISTOGRAM_OFF : (enum histogram_mode)active;
+}
+
+static void constellation_bin_samples(struct _constellation_settings *settings)
+{
+	const gfloat *x = settings->x_source;
+	const gfloat *y = settings->y_source;
+	gfloat *hist = settings->hist;
+	gfloat scale, range = settings->range;
+	unsigned int i, n = CONSTELLATION_GRID * CONSTELLATION_GRID;
+	int ix, iy;
+
+	if (settings->persistence < 1.0f)
+		for (i = 0; i < n; i++)
+			hist[i] *= settings->persistence;
+
+	if (range <= 0)
+		return;
+
+	/* Branch-light loop, left for the compiler to vectorize */
+	scale = CONSTELLATION_GRID / (2.0f * range);
+	for (i = 0; i < settings->num_samples; i++) {
+		ix = (int)((x[i] + range) * scale);
+		iy = (int)((range - y[i]) * scale);
+		if ((unsigned int)ix < CONSTELLATION_GRID &&
+				(unsigned int)iy < CONSTELLATION_GRID)
+			hist[iy * CONSTELLATION_GRID + ix] += 1.0f;
+	}
+}
+
+static void constellation_measure_evm(struct _constellation_settings *settings)
+{
+	const gfloat *x = settings->x_source;
+	const gfloat *y = settings->y_source;
+	unsigned int i, n = settings->num_samples;
+	int k = (int)sqrt(settings->ref_order);
+	double power = 0, ideal_power, gain, err = 0, ref = 0;
+	double sx, sy, lx, ly;
+
+	if (k < 2 || !n)
+		return;
+
+	for (i = 0; i < n; i++)
+		power += x[i] * x[i] + y[i] * y[i];
+	power /= n;
+	if (power <= 0)
+		return;
+
+	/* Normalize to the mean power of a square QAM with odd integer levels */
+	ideal_power = 2.0 * (settings->ref_order - 1) / 3.0;
+	gain = sqrt(ideal_power / power);
+
+	for (i = 0; i < n; i++) {
+		sx = x[i] * gain;
+		sy = y[i] * gain;
+		lx = 2 * floor((sx + k) / 2) - k + 1;
+		ly = 2 * floor((sy + k) / 2) - k + 1;
+		lx = MAX(MIN(lx, k - 1), 1 - k);
+		ly = MAX(MIN(ly, k - 1), 1 - k);
+		err += (sx - lx) * (sx - lx) + (sy - ly) * (sy - ly);
+		ref += lx * lx + ly * ly;
+	}
+	if (err <= 0 || ref <= 0)
+		return;
+
+	settings->evm = 100.0 * sqrt(err / ref);
+	settings->mer = 10.0 * log10(ref / err);
+}
+
+static void constellation_paint_density(struct _constellation_settings *settings)
+{
+	unsigned char *data;
+	guint32 *pixel, rgb;
+	gfloat peak = 0, scale;
+	unsigned int i, j, stride;
+	gfloat h;
+
+	for (i = 0; i < CONSTELLATION_GRID * CONSTELLATION_GRID; i++)
+		if (settings->hist[i] > peak)
+			peak = settings->hist[i];
+
+	cairo_surface_flush(settings->image);
+	data = cairo_image_surface_get_data(settings->image);
+	stride = cairo_image_surface_get_stride(settings->image);
+	scale = peak > 0 ? 255.0f / logf(1.0f + peak) : 0;
+
+	/* Log intensity, empty bins are transparent so the grid shows through */
+	for (j = 0; j < CONSTELLATION_GRID; j++) {
+		pixel = (guint32 *)(data + j * stride);
+		for (i = 0; i < CONSTELLATION_GRID; i++) {
+			h = settings->hist[j * CONSTELLATION_GRID + i];
+			if (h < 0.5f) {
+				pixel[i] = 0;
+				continue;
+			}
+			rgb = waterfall_lut[MIN((int)(logf(1.0f + h) * scale), 255)];
+			pixel[i] = 0xff000000 | rgb;
+		}
+	}
+	cairo_surface_mark_dirty(settings->image);
+}
+
+static void constellation_update_range(OscPlotPrivate *priv, Transform *tr)
+{
+	struct _constellation_settings *settings = tr->settings;
+	gfloat left, right, top, bottom, range;
+
+	gtk_databox_get_visible_limits(GTK_DATABOX(priv->databox),
+			&left, &right, &top, &bottom);
+	range = MAX(MAX(fabs(left), fabs(right)), MAX(fabs(top), fabs(bottom)));
+
+	/* Bins are only meaningful for one range, restart when it moves */
+	if (range != settings->range) {
+		settings->range = range;
+		memset(settings->hist, 0, sizeof(gfloat) *
+				CONSTELLATION_GRID * CONSTELLATION_GRID);
+	}
+}
+
+static void constellation_destroy(Transform *tr)
+{
+	struct _constellation_settings *settings = tr->settings;
+
+	free(settings->hist);
+	if (settings->image)
+		cairo_surface_destroy(settings->image);
+}
+
 bool constellation_transform_function(Transform *tr, gboolean init_transform)
 {
 	struct _constellation_settings *settings = tr->settings;
@@ -1717,6 +2653,18 @@ bool constellation_transform_function(Transform *tr, gboolean init_transform)
 		tr->x_axis = settings->x_source;
 		tr->y_axis = settings->y_source;
 
+		settings->evm = 0;
+		settings->mer = 0;
+		if (settings->density) {
+			waterfall_lut_init();
+			if (!settings->hist)
+				settings->hist = calloc(CONSTELLATION_GRID * CONSTELLATION_GRID,
+						sizeof(gfloat));
+			if (!settings->image)
+				settings->image = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+						CONSTELLATION_GRID, CONSTELLATION_GRID);
+		}
+
 		return true;
 	}
 
@@ -1725,10 +2673,14 @@ bool constellation_transform_function(Transform *tr, gboolean init_transform)
 	if (tr->plot_channels_type == PLOT_MATH_CHANNEL)
 		for (node = tr->plot_channels; node; node = g_slist_next(node)) {
 			PlotMathChn *m = node->data;
-			m->math_expression(m->iio_channels_data,
-				m->data_ref, settings->num_samples);
+			math_channel_evaluate(m, settings->num_samples);
 		}
 
+	if (settings->density && settings->hist)
+		constellation_bin_samples(settings);
+	if (settings->ref_order)
+		constellation_measure_evm(settings);
+
 	return true;
 }
 
@@ -2185,6 +3137,19 @@ static int plot_get_sample_count_of_device(OscPlot *plot, const char *device)
 	switch (gtk_combo_box_get_active(GTK_COMBO_BOX(priv->hor_units))) {
 	case 0:
 		count = (int)osc_plot_get_sample_count(plot);
+		/* The FIR preview decimates too and takes over the zoom FFT */
+		if (fir_preview_enabled(plot)) {
+			count = fir_preview_sample_count(priv);
+			break;
+		}
+		if (!zoom_fft_enabled(plot))
+			break;
+
+		/* The zoom FFT decimates, it needs more than fft_size samples */
+		iio_dev = iio_context_find_device(ctx, device);
+		dev_info = iio_dev ? iio_device_get_data(iio_dev) : NULL;
+		if (dev_info)
+			count = zoom_fft_sample_count(priv, dev_info);
 		break;
 	case 1:
 		iio_dev = iio_context_find_device(ctx, device);
@@ -2252,10 +3217,25 @@ static void update_transform_settings(OscPlot *plot, Transform *transform)
 		FFT_SETTINGS(transform)->fft_alg_data.cached_fft_size = -1;
 		FFT_SETTINGS(transform)->fft_alg_data.cached_num_active_channels = -1;
 		FFT_SETTINGS(transform)->fft_alg_data.num_active_channels = g_slist_length(transform->plot_channels);
+		FFT_SETTINGS(transform)->fft_alg_data.fixed_point = gtk_toggle_button_get_active(
+				GTK_TOGGLE_BUTTON(priv->fixed_point_fft_widget));
 		FFT_SETTINGS(transform)->markers = NULL;
 		FFT_SETTINGS(transform)->markers_copy = NULL;
 		FFT_SETTINGS(transform)->marker_lock = NULL;
 		FFT_SETTINGS(transform)->marker_type = NULL;
+		if (transform->type_id == WATERFALL_TRANSFORM)
+			WATERFALL_SETTINGS(transform)->hold_decay = gtk_spin_button_get_value(
+					GTK_SPIN_BUTTON(priv->waterfall_decay_widget));
+		if (transform->type_id == ZOOM_FFT_TRANSFORM) {
+			ZOOM_FFT_SETTINGS(transform)->center = gtk_spin_button_get_value(
+					GTK_SPIN_BUTTON(priv->zoom_center_widget));
+			ZOOM_FFT_SETTINGS(transform)->span = gtk_spin_button_get_value(
+					GTK_SPIN_BUTTON(priv->zoom_span_widget));
+		}
+		if (transform->type_id == FIR_PREVIEW_TRANSFORM)
+			FIR_PREVIEW_SETTINGS(transform)->filter = priv->fir_preview;
+	} else if (plot_type == TIME_PLOT && transform->type_id == HISTOGRAM_TRANSFORM) {
+		HISTOGRAM_SETTINGS(transform)->mode = histogram_mode(priv);
 	} else if (plot_type == TIME_PLOT) {
 		int dev_samples = plot_get_sample_count_for_transform(plot, transform);
 		if (dev_samples < 0)
@@ -2274,7 +3254,13 @@ static void update_transform_settings(OscPlot *plot, Transform *transform)
 			TIME_SETTINGS(transform)->max_x_axis = gtk_spin_button_get_value(GTK_SPIN_BUTTON(priv->sample_count_widget));
 		}
 	} else if (plot_type == XY_PLOT){
+		gchar *plot_type_str = gtk_combo_box_text_get_active_text(GTK_COMBO_BOX_TEXT(priv->plot_type));
+
 		CONSTELLATION_SETTINGS(transform)->num_samples = gtk_spin_button_get_value(GTK_SPIN_BUTTON(priv->sample_count_widget));
+		CONSTELLATION_SETTINGS(transform)->density = plot_type_str && !strcmp(plot_type_str, "Density");
+		CONSTELLATION_SETTINGS(transform)->persistence = gtk_spin_button_get_value(GTK_SPIN_BUTTON(priv->density_persistence_widget));
+		CONSTELLATION_SETTINGS(transform)->ref_order = evm_reference_order(priv);
+		g_free(plot_type_str);
 	} else if (plot_type == XCORR_PLOT){
 		int dev_samples = plot_get_sample_count_for_transform(plot, transform);
 		if (dev_samples < 0)
@@ -2318,6 +3304,10 @@ static Transform* add_transform_to_list(OscPlot *plot, int tr_type, GSList *chan
 	struct _constellation_settings *constellation_settings;
 	struct _cross_correlation_settings *xcross_settings;
 	struct _freq_spectrum_settings *freq_spectrum_settings;
+	struct _waterfall_settings *waterfall_settings;
+	struct _zoom_fft_settings *zoom_fft_settings;
+	struct _fir_preview_settings *fir_preview_settings;
+	struct _histogram_settings *histogram_settings;
 	GSList *node;
 
 	transform = Transform_new(tr_type);
@@ -2366,6 +3356,27 @@ static Transform* add_transform_to_list(OscPlot *plot, int tr_type, GSList *chan
 		freq_spectrum_settings = (struct _freq_spectrum_settings *)calloc(sizeof(struct _freq_spectrum_settings), 1);
 		Transform_attach_settings(transform, freq_spectrum_settings);
 		break;
+	case WATERFALL_TRANSFORM:
+		Transform_attach_function(transform, waterfall_transform_function);
+		waterfall_settings = (struct _waterfall_settings *)calloc(sizeof(struct _waterfall_settings), 1);
+		Transform_attach_settings(transform, waterfall_settings);
+		break;
+	case ZOOM_FFT_TRANSFORM:
+		Transform_attach_function(transform, zoom_fft_transform_function);
+		zoom_fft_settings = (struct _zoom_fft_settings *)calloc(sizeof(struct _zoom_fft_settings), 1);
+		Transform_attach_settings(transform, zoom_fft_settings);
+		break;
+	case FIR_PREVIEW_TRANSFORM:
+		Transform_attach_function(transform, fir_preview_transform_function);
+		fir_preview_settings = (struct _fir_preview_settings *)calloc(sizeof(struct _fir_preview_settings), 1);
+		Transform_attach_settings(transform, fir_preview_settings);
+		break;
+	case HISTOGRAM_TRANSFORM:
+		Transform_attach_function(transform, histogram_transform_function);
+		histogram_settings = (struct _histogram_settings *)calloc(sizeof(struct _histogram_settings), 1);
+		Transform_attach_settings(transform, histogram_settings);
+		transform->graph_color = &PLOT_CHN(channels->data)->graph_color;
+		break;
 	default:
 		fprintf(stderr, "Invalid transform\n");
 		return NULL;
@@ -2434,6 +3445,28 @@ static void remove_transform_from_list(OscPlot *plot, Transform *tr)
 		free(FREQ_SPECTRUM_SETTINGS(tr)->ffts_alg_data);
 		free(FREQ_SPECTRUM_SETTINGS(tr)->maxXaxis);
 		free(FREQ_SPECTRUM_SETTINGS(tr)->maxYaxis);
+	} else if (tr->type_id == WATERFALL_TRANSFORM) {
+		free(FFT_SETTINGS(tr)->fft_alg_data.fix_re);
+		free(FFT_SETTINGS(tr)->fft_alg_data.fix_im);
+		waterfall_destroy(tr);
+	} else if (tr->type_id == ZOOM_FFT_TRANSFORM) {
+		free(FFT_SETTINGS(tr)->fft_alg_data.fix_re);
+		free(FFT_SETTINGS(tr)->fft_alg_data.fix_im);
+		zoom_fft_destroy(tr);
+	} else if (tr->type_id == FIR_PREVIEW_TRANSFORM) {
+		free(FFT_SETTINGS(tr)->fft_alg_data.fix_re);
+		free(FFT_SETTINGS(tr)->fft_alg_data.fix_im);
+		fir_preview_destroy(tr);
+	} else if (tr->type_id == FFT_TRANSFORM ||
+			tr->type_id == COMPLEX_FFT_TRANSFORM) {
+		free(FFT_SETTINGS(tr)->fft_alg_data.fix_re);
+		free(FFT_SETTINGS(tr)->fft_alg_data.fix_im);
+	} else if (tr->type_id == CONSTELLATION_TRANSFORM) {
+		constellation_destroy(tr);
+	} else if (tr->type_id == CROSS_CORRELATION_TRANSFORM) {
+		xcorr_destroy(XCORR_SETTINGS(tr));
+	} else if (tr->type_id == HISTOGRAM_TRANSFORM) {
+		histogram_destroy(tr);
 	}
 	TrList_remove_transform(list, tr);
 	Transform_destroy(tr);
@@ -2447,19 +3480,18 @@ static void markers_init(OscPlot *plot)
 	OscPlotPrivate *priv = plot->priv;
 	GtkDatabox *databox = GTK_DATABOX(plot->priv->databox);
 	struct marker_type *markers = priv->markers;
-	const char *empty_text = " ";
 	char buf[10];
 	int i;
 
 	/* Clear marker information text box */
-	if (priv->tbuf)
-		gtk_text_buffer_set_text(priv->tbuf, empty_text, -1);
+	text_readout_set_text(priv->marker_readout, " ");
 
 	priv->markers_copy = NULL;
 
 	/* Don't go any further with the init when in TIME or XY domains*/
 	if (priv->active_transform_type == TIME_TRANSFORM ||
-			priv->active_transform_type == CONSTELLATION_TRANSFORM)
+			priv->active_transform_type == CONSTELLATION_TRANSFORM ||
+			priv->active_transform_type == HISTOGRAM_TRANSFORM)
 		return;
 
 	/* Ensure that Marker Image is applied only to Complex FFT Transforms */
@@ -2494,7 +3526,10 @@ static void transform_add_plot_markers(OscPlot *plot, Transform *transform)
 	transform->has_the_marker = true;
 	priv->tr_with_marker = transform;
 	if (priv->active_transform_type == FFT_TRANSFORM ||
-		priv->active_transform_type == COMPLEX_FFT_TRANSFORM) {
+		priv->active_transform_type == COMPLEX_FFT_TRANSFORM ||
+		priv->active_transform_type == WATERFALL_TRANSFORM ||
+		priv->active_transform_type == ZOOM_FFT_TRANSFORM ||
+		priv->active_transform_type == FIR_PREVIEW_TRANSFORM) {
 		FFT_SETTINGS(transform)->markers = priv->markers;
 		FFT_SETTINGS(transform)->markers_copy = &priv->markers_copy;
 		FFT_SETTINGS(transform)->marker_type = &priv->marker_type;
@@ -2530,7 +3565,10 @@ static void transform_add_own_markers(OscPlot *plot, Transform *transform)
 		markers[i].active = (i <= 4);
 
 	if (transform->type_id == FFT_TRANSFORM ||
-		transform->type_id == COMPLEX_FFT_TRANSFORM) {
+		transform->type_id == COMPLEX_FFT_TRANSFORM ||
+		transform->type_id == WATERFALL_TRANSFORM ||
+		transform->type_id == ZOOM_FFT_TRANSFORM ||
+		transform->type_id == FIR_PREVIEW_TRANSFORM) {
 		FFT_SETTINGS(transform)->markers = markers;
 		FFT_SETTINGS(transform)->marker_type = FFT_SETTINGS(
 					priv->tr_with_marker)->marker_type;
@@ -2549,7 +3587,10 @@ static void transform_remove_own_markers(Transform *transform)
 		return;
 
 	if (transform->type_id == FFT_TRANSFORM ||
-		transform->type_id == COMPLEX_FFT_TRANSFORM) {
+		transform->type_id == COMPLEX_FFT_TRANSFORM ||
+		transform->type_id == WATERFALL_TRANSFORM ||
+		transform->type_id == ZOOM_FFT_TRANSFORM ||
+		transform->type_id == FIR_PREVIEW_TRANSFORM) {
 		markers = FFT_SETTINGS(transform)->markers;
 	} else if (transform->type_id == CROSS_CORRELATION_TRANSFORM) {
 		markers = XCORR_SETTINGS(transform)->markers;
@@ -2661,18 +3702,16 @@ static void markers_phase_diff_show(OscPlotPrivate *priv)
 {
 	static float avg[MAX_MARKERS] = {NAN};
 
-	GtkTextIter iter;
-	char text[256];
 	int m;
 	struct marker_type *trA_markers;
 	struct marker_type *trB_markers;
 	float angle_diff, lead_lag;
 	float filter, angle;
 
-	gtk_text_buffer_set_text(priv->phase_buf, "", -1);
-	gtk_text_buffer_get_iter_at_line(priv->phase_buf, &iter, 1);
+	text_readout_begin(priv->phase_readout);
 
-	if (priv->active_transform_type == COMPLEX_FFT_TRANSFORM &&
+	if ((priv->active_transform_type == COMPLEX_FFT_TRANSFORM ||
+			priv->active_transform_type == ZOOM_FFT_TRANSFORM) &&
 					priv->transform_list->size == 2) {
 		trA_markers = FFT_SETTINGS(
 				priv->transform_list->transforms[0])->markers;
@@ -2733,22 +3772,19 @@ static void markers_phase_diff_show(OscPlotPrivate *priv)
 				trA_markers[m].angle = angle;
 				trB_markers[m].angle = angle;
 
-				snprintf(text, sizeof(text),
-					"%s: %02.3f° @ %2.3f %cHz %c",
+				text_readout_add(priv->phase_readout,
+					"%s: %02.3f° @ %2.3f %cHz",
 					trA_markers[m].label,
 					angle,
 					/* lo_freq / markers_scale */ trA_markers[m].x,
-					/*dev_info->adc_scale */ 'M',
-					m != MAX_MARKERS ? '\n' : '\0');
-
-				gtk_text_buffer_insert(priv->phase_buf,
-						&iter, text, -1);
+					/*dev_info->adc_scale */ 'M');
 			}
 		} else {
-			gtk_text_buffer_set_text(priv->phase_buf,
-				"No markers active", 17);
+			text_readout_add(priv->phase_readout, "No markers active");
 		}
 	}
+
+	text_readout_end(priv->phase_readout);
 }
 
 static void draw_marker_values(OscPlotPrivate *priv, Transform *tr)
@@ -2756,8 +3792,6 @@ static void draw_marker_values(OscPlotPrivate *priv, Transform *tr)
 	struct iio_device *iio_dev;
 	struct extra_dev_info *dev_info;
 	struct marker_type *markers;
-	GtkTextIter iter;
-	char text[256];
 	int markers_scale;
 	double lo_freq;
 	int m;
@@ -2770,13 +3804,15 @@ static void draw_marker_values(OscPlotPrivate *priv, Transform *tr)
 		markers = FFT_SETTINGS(tr)->markers;
 	else if(tr->type_id == COMPLEX_FFT_TRANSFORM)
 		markers = FFT_SETTINGS(tr)->markers;
+	else if(tr->type_id == WATERFALL_TRANSFORM)
+		markers = FFT_SETTINGS(tr)->markers;
+	else if(tr->type_id == ZOOM_FFT_TRANSFORM)
+		markers = FFT_SETTINGS(tr)->markers;
+	else if(tr->type_id == FIR_PREVIEW_TRANSFORM)
+		markers = FFT_SETTINGS(tr)->markers;
 	else
 		return;
 
-	if (priv->tbuf == NULL) {
-			priv->tbuf = gtk_text_buffer_new(NULL);
-			gtk_text_view_set_buffer(GTK_TEXT_VIEW(priv->marker_label), priv->tbuf);
-	}
 	iio_dev = transform_get_device_parent(tr);
 	if (!iio_dev) {
 		fprintf(stderr,
@@ -2805,32 +3841,31 @@ static void draw_marker_values(OscPlotPrivate *priv, Transform *tr)
 
 	markers_scale = prefix2scale(dev_info->adc_scale);
 
+	/* Only the lines whose formatted value changed reach the text view */
+	text_readout_begin(priv->marker_readout);
 	if (MAX_MARKERS && priv->marker_type != MARKER_OFF) {
 		for (m = 0; m <= MAX_MARKERS && markers[m].active; m++) {
-			if (tr->type_id == FFT_TRANSFORM || tr->type_id == COMPLEX_FFT_TRANSFORM) {
-				sprintf(text, "%s: %2.2f dBFS @ %2.3f %cHz%c",
+			if (tr->type_id == FFT_TRANSFORM || tr->type_id == COMPLEX_FFT_TRANSFORM ||
+					tr->type_id == WATERFALL_TRANSFORM ||
+					tr->type_id == ZOOM_FFT_TRANSFORM ||
+					tr->type_id == FIR_PREVIEW_TRANSFORM) {
+				text_readout_add(priv->marker_readout,
+					"%s: %2.2f dBFS @ %2.3f %cHz",
 					markers[m].label, markers[m].y,
 					lo_freq / markers_scale + markers[m].x,
-					dev_info->adc_scale,
-					m != MAX_MARKERS ? '\n' : '\0');
+					dev_info->adc_scale);
 			} else if (tr->type_id == CROSS_CORRELATION_TRANSFORM) {
-				sprintf(text, "M%i: %1.6f @ %2.3f%c", m, markers[m].y, markers[m].x,
-					m != MAX_MARKERS ? '\n' : '\0');
+				text_readout_add(priv->marker_readout, "M%i: %1.6f @ %2.3f",
+					m, markers[m].y, markers[m].x);
 			} else if (tr->type_id == FREQ_SPECTRUM_TRANSFORM) {
-				sprintf(text, "M%i: %1.6f @ %2.3f%c", m, markers[m].y, markers[m].x,
-					m != MAX_MARKERS ? '\n' : '\0');
-			}
-
-			if (m == 0) {
-				gtk_text_buffer_set_text(priv->tbuf, text, -1);
-				gtk_text_buffer_get_iter_at_line(priv->tbuf, &iter, 1);
-			} else {
-				gtk_text_buffer_insert(priv->tbuf, &iter, text, -1);
+				text_readout_add(priv->marker_readout, "M%i: %1.6f @ %2.3f",
+					m, markers[m].y, markers[m].x);
 			}
 		}
 	} else {
-		gtk_text_buffer_set_text(priv->tbuf, "No markers active", 17);
+		text_readout_add(priv->marker_readout, "No markers active");
 	}
+	text_readout_end(priv->marker_readout);
 }
 
 static void device_rx_info_update(OscPlot *plot)
@@ -2860,21 +3895,41 @@ static void device_rx_info_update(OscPlot *plot)
 	}
 }
 
+/* Trace labels, indexed by transform type */
+static const char * const transform_names[TRANSFORMS_TYPES_COUNT] = {
+	[NO_TRANSFORM_TYPE] = "none",
+	[TIME_TRANSFORM] = "time",
+	[FFT_TRANSFORM] = "fft",
+	[CONSTELLATION_TRANSFORM] = "constellation",
+	[COMPLEX_FFT_TRANSFORM] = "complex_fft",
+	[CROSS_CORRELATION_TRANSFORM] = "cross_correlation",
+	[FREQ_SPECTRUM_TRANSFORM] = "freq_spectrum",
+	[WATERFALL_TRANSFORM] = "waterfall",
+	[ZOOM_FFT_TRANSFORM] = "zoom_fft",
+	[FIR_PREVIEW_TRANSFORM] = "fir_preview",
+	[HISTOGRAM_TRANSFORM] = "histogram",
+};
+
 static bool call_all_transform_functions(OscPlotPrivate *priv)
 {
 	TrList *tr_list = priv->transform_list;
 	Transform *tr;
 	bool valid = true;
 	bool tr_valid;
+	uint64_t t;
 	int i = 0;
 
-	if (priv->redraw_function <= 0)
+	if (!priv->redraw_active)
 		return false;
 
 	for (; i < tr_list->size; i++) {
 		tr = tr_list->transforms[i];
+		t = instr_now();
 		tr_valid = Transform_update_output(tr);
-		if (tr_valid)
+		instr_record(INSTR_TRANSFORM, t, transform_names[tr->type_id]);
+		/* Density maps are drawn over the databox, not as a graph */
+		if (tr_valid && !(tr->type_id == CONSTELLATION_TRANSFORM &&
+				CONSTELLATION_SETTINGS(tr)->density))
 			gtk_databox_graph_set_hide(tr->graph, FALSE);
 		valid &= tr_valid;
 	}
@@ -3000,6 +4055,7 @@ static void channels_transform_assignment(GtkTreeModel *model,
 	PlotChn *settings;
 	Transform *transform = NULL;
 	gboolean enabled;
+	gboolean waterfall, zoom, fir;
 	int num_added_chs;
 
 	gtk_tree_model_get(model, iter,
@@ -3009,23 +4065,40 @@ static void channels_transform_assignment(GtkTreeModel *model,
 	if (!enabled)
 		return;
 
+	waterfall = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(priv->waterfall_widget));
+	zoom = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(priv->zoom_fft_widget));
+	fir = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(priv->fir_preview_widget)) &&
+		priv->fir_preview;
+
 	prm->ch_settings = g_slist_prepend(prm->ch_settings, settings);
 	num_added_chs = g_slist_length(prm->ch_settings);
 
 	switch (gtk_combo_box_get_active(GTK_COMBO_BOX(priv->plot_domain))) {
 	case TIME_PLOT:
-		transform = add_transform_to_list(plot, TIME_TRANSFORM, prm->ch_settings);
+		if (histogram_mode(priv) == HISTOGRAM_OFF) {
+			transform = add_transform_to_list(plot, TIME_TRANSFORM, prm->ch_settings);
+		} else if (settings->type == PLOT_IIO_CHANNEL) {
+			transform = add_transform_to_list(plot, HISTOGRAM_TRANSFORM, prm->ch_settings);
+		} else {
+			/* Math channels have no raw codes to count */
+			g_slist_free(prm->ch_settings);
+			prm->ch_settings = NULL;
+		}
 		break;
 	case FFT_PLOT:
 		if (prm->enabled_channels == 1) {
-			transform = add_transform_to_list(plot, FFT_TRANSFORM, prm->ch_settings);
+			transform = add_transform_to_list(plot,
+				fir ? FIR_PREVIEW_TRANSFORM :
+				waterfall ? WATERFALL_TRANSFORM : FFT_TRANSFORM,
+				prm->ch_settings);
 		} else if ((prm->enabled_channels == 2 || prm->enabled_channels == 4) && num_added_chs == 2) {
-			if (plugin_installed("FMComms6")) {
-				transform = add_transform_to_list(plot, COMPLEX_FFT_TRANSFORM, prm->ch_settings);
-			} else {
+			if (!plugin_installed("FMComms6"))
 				prm->ch_settings = g_slist_reverse(prm->ch_settings);
-				transform = add_transform_to_list(plot, COMPLEX_FFT_TRANSFORM, prm->ch_settings);
-			}
+			transform = add_transform_to_list(plot,
+				fir ? FIR_PREVIEW_TRANSFORM :
+				zoom ? ZOOM_FFT_TRANSFORM :
+				waterfall ? WATERFALL_TRANSFORM : COMPLEX_FFT_TRANSFORM,
+				prm->ch_settings);
 		}
 		break;
 	case XY_PLOT:
@@ -3139,12 +4212,15 @@ static gboolean plot_redraw(OscPlotPrivate *priv)
 	TrList *tr_list = priv->transform_list;
 	Transform *tr;
 	bool show_diff_phase = false;
+	uint64_t t = instr_now();
 	int i;
 
+	priv->redraw_source = 0;
 	if (!GTK_IS_DATABOX(priv->databox))
 		return FALSE;
 
 	if (priv->redraw) {
+			priv->last_redraw = g_get_monotonic_time() / 1000;
 			auto_scale_databox(priv, GTK_DATABOX(priv->databox));
 			gtk_widget_queue_draw(priv->databox);
 			fps_counter(priv);
@@ -3158,22 +4234,72 @@ static gboolean plot_redraw(OscPlotPrivate *priv)
 			}
 			if (show_diff_phase)
 				markers_phase_diff_show(priv);
+			if (priv->active_transform_type == WATERFALL_TRANSFORM &&
+					tr_list->size) {
+				waterfall_update_levels(priv, tr_list->transforms[0]);
+				gtk_widget_queue_draw(priv->waterfall_area);
+			}
+			if (priv->active_transform_type == CONSTELLATION_TRANSFORM)
+				for (i = 0; i < tr_list->size; i++) {
+					tr = tr_list->transforms[i];
+					if (!CONSTELLATION_SETTINGS(tr)->density)
+						continue;
+					constellation_update_range(priv, tr);
+					constellation_paint_density(tr->settings);
+				}
+			instr_record(INSTR_REDRAW, t, NULL);
 	}
 	if (priv->stop_redraw == TRUE)
-		priv->redraw_function = 0;
+		priv->redraw_active = FALSE;
 
 	priv->redraw = FALSE;
-	return !priv->stop_redraw;
+	return FALSE;
+}
+
+static bool plot_is_visible(OscPlotPrivate *priv)
+{
+	return gtk_widget_get_mapped(priv->databox) &&
+		!priv->iconified && !priv->obscured;
+}
+
+/*
+ * Draws happen on demand: new data asks for one, and all the requests
+ * made until it runs are served by that single draw. Draws are spaced by
+ * the frame interval, which is longer for windows without the focus, and
+ * are held back while the plot can't be seen.
+ */
+static void plot_schedule_redraw(OscPlotPrivate *priv)
+{
+	gint64 now, due;
+	guint interval;
+
+	if (priv->redraw_source || !priv->redraw || !plot_is_visible(priv))
+		return;
+
+	interval = 1000 / CLAMP(priv->max_fps, 1, 1000);
+	if (!gtk_window_is_active(GTK_WINDOW(priv->window)))
+		interval *= BACKGROUND_REDRAW_DIVIDER;
+
+	now = g_get_monotonic_time() / 1000;
+	due = priv->last_redraw + interval;
+	priv->redraw_source = g_timeout_add_full(G_PRIORITY_DEFAULT_IDLE,
+			due > now ? due - now : 0,
+			(GSourceFunc) plot_redraw, priv, NULL);
 }
 
 static void capture_start(OscPlotPrivate *priv)
 {
-	if (priv->redraw_function) {
-		priv->stop_redraw = FALSE;
-	} else {
-		priv->stop_redraw = FALSE;
-		priv->redraw_function = g_timeout_add_full(G_PRIORITY_DEFAULT_IDLE, 50, (GSourceFunc) plot_redraw, priv, NULL);
-	}
+	priv->stop_redraw = FALSE;
+	priv->redraw_active = TRUE;
+	plot_schedule_redraw(priv);
+}
+
+/* A pending draw still runs, it shows the last frame of a single shot */
+static void capture_stop(OscPlotPrivate *priv)
+{
+	priv->stop_redraw = TRUE;
+	if (!priv->redraw_source)
+		priv->redraw_active = FALSE;
 }
 
 static void plot_setup(OscPlot *plot)
@@ -3223,6 +4349,9 @@ static void plot_setup(OscPlot *plot)
 
 		gtk_databox_graph_set_hide(graph, TRUE);
 		gtk_databox_graph_add(GTK_DATABOX(priv->databox), graph);
+
+		if (transform->type_id == FIR_PREVIEW_TRANSFORM)
+			fir_preview_add_response(priv, transform);
 	}
 	if (!priv->profile_loaded_scale) {
 		if (priv->active_transform_type == TIME_TRANSFORM &&
@@ -3244,8 +4373,12 @@ static void plot_setup(OscPlot *plot)
 
 	osc_plot_update_rx_lbl(plot, FORCE_UPDATE);
 
+	gtk_widget_set_visible(priv->waterfall_area,
+		priv->active_transform_type == WATERFALL_TRANSFORM);
+
 	bool show_phase_info = false;
-	if (priv->active_transform_type == COMPLEX_FFT_TRANSFORM &&
+	if ((priv->active_transform_type == COMPLEX_FFT_TRANSFORM ||
+			priv->active_transform_type == ZOOM_FFT_TRANSFORM) &&
 			priv->transform_list->size == 2) {
 		show_phase_info = true;
 	}
@@ -3254,6 +4387,142 @@ static void plot_setup(OscPlot *plot)
 		2, show_phase_info);
 }
 
+/*
+ * Benchmark hooks: "osc -b" feeds the channels of a device from a synthetic
+ * source and runs the same transforms and draws as a plot on them. The
+ * transform gets the settings a new plot starts with: one graph without
+ * markers, averaging off and floating point FFTs.
+ */
+Transform * osc_plot_bench_transform_new(struct iio_device *dev,
+		int tr_type, unsigned int size)
+{
+	struct extra_dev_info *dev_info = iio_device_get_data(dev);
+	Transform *transform;
+	GSList *channels = NULL;
+	unsigned int i, nb = 0, needed;
+
+	/* A real FFT reads one channel, the others an I/Q pair */
+	needed = tr_type == FFT_TRANSFORM ? 1 : 2;
+	for (i = 0; i < iio_device_get_channels_count(dev) && nb < needed; i++) {
+		struct iio_channel *chn = iio_device_get_channel(dev, i);
+		PlotIioChn *pic;
+
+		if (!iio_channel_is_enabled(chn))
+			continue;
+		pic = plot_iio_channel_new(iio_device_get_context(dev));
+		if (!pic)
+			break;
+		pic->base.name = g_strdup(iio_channel_get_id(chn));
+		pic->base.parent_name = g_strdup(iio_device_get_name(dev) ?:
+				iio_device_get_id(dev));
+		pic->iio_chn = chn;
+		channels = g_slist_append(channels, pic);
+		nb++;
+	}
+	if (nb < needed) {
+		g_slist_free_full(channels, (GDestroyNotify) plot_iio_channel_destroy);
+		return NULL;
+	}
+
+	/* The correlation runs between two I/Q pairs: the pair and itself */
+	if (tr_type == CROSS_CORRELATION_TRANSFORM)
+		channels = g_slist_concat(channels, g_slist_copy(channels));
+
+	transform = Transform_new(tr_type);
+	transform->graph_color = &color_graph[0];
+	transform->plot_channels = channels;
+	transform->plot_channels_type = PLOT_IIO_CHANNEL;
+
+	switch (tr_type) {
+	case FFT_TRANSFORM:
+	case COMPLEX_FFT_TRANSFORM:
+		Transform_attach_function(transform, fft_transform_function);
+		Transform_attach_settings(transform,
+				calloc(sizeof(struct _fft_settings), 1));
+		FFT_SETTINGS(transform)->fft_size = size;
+		FFT_SETTINGS(transform)->fft_avg = 1;
+		FFT_SETTINGS(transform)->fft_alg_data.cached_fft_size = -1;
+		FFT_SETTINGS(transform)->fft_alg_data.cached_num_active_channels = -1;
+		FFT_SETTINGS(transform)->fft_alg_data.num_active_channels = nb;
+		break;
+	case CROSS_CORRELATION_TRANSFORM:
+		Transform_attach_function(transform,
+				cross_correlation_transform_function);
+		Transform_attach_settings(transform,
+				calloc(sizeof(struct _cross_correlation_settings), 1));
+		XCORR_SETTINGS(transform)->num_samples = MIN(size,
+				dev_info->sample_count);
+		XCORR_SETTINGS(transform)->avg = 1;
+		XCORR_SETTINGS(transform)->max_x_axis = size;
+		break;
+	default:
+		fprintf(stderr, "Invalid transform\n");
+		osc_plot_bench_transform_destroy(transform);
+		return NULL;
+	}
+
+	if (!transform->settings ||
+			!transform->transform_function(transform, TRUE)) {
+		osc_plot_bench_transform_destroy(transform);
+		return NULL;
+	}
+
+	return transform;
+}
+
+void osc_plot_bench_transform_destroy(Transform *tr)
+{
+	GSList *node;
+	unsigned int i, nb;
+
+	if (!tr)
+		return;
+
+	if (tr->settings && tr->type_id == CROSS_CORRELATION_TRANSFORM)
+		xcorr_destroy(XCORR_SETTINGS(tr));
+	else if (tr->settings) {
+		free(FFT_SETTINGS(tr)->fft_alg_data.fix_re);
+		free(FFT_SETTINGS(tr)->fft_alg_data.fix_im);
+	}
+
+	/* A correlation lists its channels twice */
+	nb = g_slist_length(tr->plot_channels);
+	if (tr->type_id == CROSS_CORRELATION_TRANSFORM)
+		nb /= 2;
+	for (i = 0, node = tr->plot_channels; i < nb; i++,
+			node = g_slist_next(node))
+		plot_iio_channel_destroy(node->data);
+
+	Transform_destroy(tr);
+}
+
+/* Shows the output of a bench transform, the plot doesn't own it */
+void osc_plot_bench_show(OscPlot *plot, Transform *tr)
+{
+	OscPlotPrivate *priv = plot->priv;
+
+	gtk_databox_graph_remove_all(GTK_DATABOX(priv->databox));
+	tr->graph = gtk_databox_lines_new(tr->y_axis_size,
+			Transform_get_x_axis_ref(tr),
+			Transform_get_y_axis_ref(tr),
+			tr->graph_color, priv->line_thickness);
+	gtk_databox_graph_add(GTK_DATABOX(priv->databox), tr->graph);
+	priv->active_transform_type = tr->type_id;
+	osc_plot_set_visible(plot, true);
+	while (!plot_is_visible(priv) && gtk_events_pending())
+		gtk_main_iteration();
+}
+
+/* One frame drawn to the screen, instead of waiting for the redraw timer */
+void osc_plot_bench_redraw(OscPlot *plot)
+{
+	OscPlotPrivate *priv = plot->priv;
+
+	priv->redraw = TRUE;
+	plot_redraw(priv);
+	gdk_window_process_updates(gtk_widget_get_window(priv->databox), TRUE);
+}
+
 static void single_shot_clicked_cb(GtkToggleToolButton *btn, gpointer data)
 {
 	OscPlot *plot = data;
@@ -3318,7 +4587,7 @@ static void capture_button_clicked_cb(GtkToggleToolButton *btn, gpointer data)
 		priv->frame_counter = 0;
 		capture_start(priv);
 	} else {
-		priv->stop_redraw = TRUE;
+		capture_stop(priv);
 		dispose_parameters_from_plot(plot);
 		deassert_used_channels(plot);
 
@@ -3893,8 +5162,23 @@ static void update_grid(OscPlot *plot, gfloat left, gfloat right)
 {
 	OscPlotPrivate *priv = plot->priv;
 
-	if (priv->active_transform_type == FFT_TRANSFORM ||
-	    priv->active_transform_type == COMPLEX_FFT_TRANSFORM) {
+	if (priv->active_transform_type == ZOOM_FFT_TRANSFORM ||
+			priv->active_transform_type == FIR_PREVIEW_TRANSFORM) {
+		gfloat spacing, mag;
+
+		/* Narrow spans need a 1-2-5 step, not a multiple of 10 */
+		spacing = (right - left) / 10;
+		if (spacing <= 0)
+			return;
+		mag = pow(10, floor(log10(spacing)));
+		spacing /= mag;
+		spacing = (spacing <= 1 ? 1 : spacing <= 2 ? 2 :
+				spacing <= 5 ? 5 : 10) * mag;
+		fill_axis(priv->gridx, floor(left / spacing) * spacing, spacing, 14);
+		fill_axis(priv->gridy, 10, -10, 25);
+	} else if (priv->active_transform_type == FFT_TRANSFORM ||
+	    priv->active_transform_type == COMPLEX_FFT_TRANSFORM ||
+	    priv->active_transform_type == WATERFALL_TRANSFORM) {
 		gfloat spacing;
 
 		spacing = ceil((right - left) / 130) * 10;
@@ -3921,7 +5205,10 @@ static void add_grid(OscPlot *plot)
 	*/
 
 	if (priv->active_transform_type == FFT_TRANSFORM ||
-	    priv->active_transform_type == COMPLEX_FFT_TRANSFORM) {
+	    priv->active_transform_type == COMPLEX_FFT_TRANSFORM ||
+	    priv->active_transform_type == WATERFALL_TRANSFORM ||
+	    priv->active_transform_type == ZOOM_FFT_TRANSFORM ||
+	    priv->active_transform_type == FIR_PREVIEW_TRANSFORM) {
 		priv->grid = gtk_databox_grid_array_new (25, 14, priv->gridy, priv->gridx, &color_grid, 1);
 	} else if (priv->active_transform_type == CONSTELLATION_TRANSFORM) {
 		fill_axis(priv->gridx, -80000, 10000, 18);
@@ -3931,7 +5218,8 @@ static void add_grid(OscPlot *plot)
 		fill_axis(priv->gridx, 0, 100, 5);
 		fill_axis(priv->gridy, -80000, 10000, 18);
 		priv->grid = gtk_databox_grid_array_new (18, 5, priv->gridy, priv->gridx, &color_grid, 1);
-	} else if (priv->active_transform_type == NO_TRANSFORM_TYPE) {
+	} else if (priv->active_transform_type == NO_TRANSFORM_TYPE ||
+			priv->active_transform_type == HISTOGRAM_TRANSFORM) {
 		gfloat left, right, top, bottom;
 
 		gtk_databox_get_total_limits(GTK_DATABOX(priv->databox), &left, &right, &top, &bottom);
@@ -4125,13 +5413,13 @@ static void zoom_out(GtkButton *btn, gpointer data)
 	gtk_databox_set_visible_limits(GTK_DATABOX(priv->databox), left, right, top, bottom);
 }
 
-static void transform_csv_print(OscPlotPrivate *priv, FILE *fp, Transform *tr)
+static void transform_export_section(struct export_job *job, Transform *tr)
 {
 	gfloat *tr_data;
 	gfloat *tr_x_axis;
-	unsigned int i;
 	GSList *node;
 	const char *id1 = NULL, *id2 = NULL;
+	gchar *header = NULL;
 
 	switch (g_slist_length(tr->plot_channels)) {
 	case 2:
@@ -4147,32 +5435,57 @@ static void transform_csv_print(OscPlotPrivate *priv, FILE *fp, Transform *tr)
 	}
 
 	if (tr->type_id == TIME_TRANSFORM)
-		fprintf(fp, "X Axis(Sample Index)    Y Axis(%s)\n", id1);
+		header = g_strdup_printf("X Axis(Sample Index)    Y Axis(%s)\n", id1);
 	else if (tr->type_id == FFT_TRANSFORM)
-		fprintf(fp, "X Axis(Frequency)    Y Axis(FFT - %s)\n", id1);
+		header = g_strdup_printf("X Axis(Frequency)    Y Axis(FFT - %s)\n", id1);
 	else if (tr->type_id == COMPLEX_FFT_TRANSFORM)
-		fprintf(fp, "X Axis(Frequency)    Y Axis(Complex FFT - %s, %s)\n", id1, id2);
+		header = g_strdup_printf("X Axis(Frequency)    Y Axis(Complex FFT - %s, %s)\n", id1, id2);
+	else if (tr->type_id == WATERFALL_TRANSFORM)
+		header = g_strdup_printf("X Axis(Frequency)    Y Axis(Waterfall - %s)\n", id1);
+	else if (tr->type_id == ZOOM_FFT_TRANSFORM)
+		header = g_strdup_printf("X Axis(Frequency)    Y Axis(Zoom FFT - %s, %s)\n", id1, id2);
+	else if (tr->type_id == FIR_PREVIEW_TRANSFORM && id2)
+		header = g_strdup_printf("X Axis(Frequency)    Y Axis(FIR Preview - %s, %s)\n", id1, id2);
+	else if (tr->type_id == FIR_PREVIEW_TRANSFORM)
+		header = g_strdup_printf("X Axis(Frequency)    Y Axis(FIR Preview - %s)\n", id1);
 	else if (tr->type_id == CONSTELLATION_TRANSFORM)
-		fprintf(fp, "X Axis(%s)    Y Axis(%s)\n", id2, id1);
+		header = g_strdup_printf("X Axis(%s)    Y Axis(%s)\n", id2, id1);
+	else if (tr->type_id == HISTOGRAM_TRANSFORM)
+		header = g_strdup_printf("X Axis(Code)    Y Axis(%s - %s)\n",
+			HISTOGRAM_SETTINGS(tr)->mode == HISTOGRAM_DNL ? "DNL" :
+			HISTOGRAM_SETTINGS(tr)->mode == HISTOGRAM_INL ? "INL" :
+			"Histogram", id1);
 
 	tr_x_axis = Transform_get_x_axis_ref(tr);
 	tr_data = Transform_get_y_axis_ref(tr);
 
 	if (tr_x_axis == NULL || tr_data == NULL) {
-		fprintf(fp, "No data\n");
-		return;
+		export_job_add_section(job, header, 0, "No data\n");
+	} else {
+		export_job_add_section(job, header, tr->x_axis_size, "\n");
+		export_job_add_column(job, "x", tr_x_axis, 1.0);
+		export_job_add_column(job, "y", tr_data, 1.0);
 	}
 
-	for (i = 0; i < tr->x_axis_size; i++) {
-		fprintf(fp, "%g, %g,\n", tr_x_axis[i], tr_data[i]);
-	}
-	fprintf(fp, "\n");
+	g_free(header);
 }
 
 static void plot_destroyed (GtkWidget *object, OscPlot *plot)
 {
 	osc_plot_draw_stop(plot);
+	if (plot->priv->redraw_source) {
+		g_source_remove(plot->priv->redraw_source);
+		plot->priv->redraw_source = 0;
+	}
+	if (plot->priv->export_job) {
+		export_job_cancel(plot->priv->export_job);
+		export_finish(plot->priv);
+	}
 	g_slist_free_full(plot->priv->ch_settings_list, (GDestroyNotify)g_free);
+	fir_filter_file_free(plot->priv->fir_preview);
+	text_readout_free(plot->priv->marker_readout);
+	text_readout_free(plot->priv->phase_readout);
+	plot->priv->fir_preview = NULL;
 	g_mutex_trylock(&plot->priv->g_marker_copy_lock);
 	g_mutex_unlock(&plot->priv->g_marker_copy_lock);
 
@@ -4262,93 +5575,329 @@ static void channel_selection_set_default(OscPlot *plot)
 	gchar *device_name;
 	int d;
 
-	device_name = gtk_combo_box_text_get_active_text(GTK_COMBO_BOX_TEXT(priv->device_combobox));
-	d = device_find_by_name(priv->ctx, device_name);
-	if (d >= 0)
-		foreach_channel_iter_of_device(GTK_TREE_VIEW(priv->channel_list_view),
-				device_name, *copy_channel_state_to_selection_channel, plot);
-	g_free(device_name);
-}
+	device_name = gtk_combo_box_text_get_active_text(GTK_COMBO_BOX_TEXT(priv->device_combobox));
+	d = device_find_by_name(priv->ctx, device_name);
+	if (d >= 0)
+		foreach_channel_iter_of_device(GTK_TREE_VIEW(priv->channel_list_view),
+				device_name, *copy_channel_state_to_selection_channel, plot);
+	g_free(device_name);
+}
+
+static int * get_user_saveas_channel_selection(OscPlot *plot, unsigned int nb_channels)
+{
+	OscPlotPrivate *priv = plot->priv;
+	GList *ch_checkbtns = NULL;
+	GList *node;
+	GtkToggleButton *btn;
+	int *mask;
+
+	/* Create masks for all channels */
+	mask = malloc(sizeof(int) * nb_channels);
+
+	/* Get user channel selection from GUI widgets */
+	ch_checkbtns = gtk_container_get_children(GTK_CONTAINER(priv->saveas_channels_list));
+	for (node = ch_checkbtns; node; node = g_list_next(node)) {
+		btn = (GtkToggleButton *)node->data;
+
+		int dev_index, ch_index;
+		gchar *dev_name, *ch_name;
+
+		dev_name = gtk_combo_box_text_get_active_text(GTK_COMBO_BOX_TEXT(priv->device_combobox));
+		dev_index = device_find_by_name(priv->ctx, dev_name);
+		g_free(dev_name);
+		g_object_get(btn, "label", &ch_name, NULL);
+		ch_index = channel_find_by_name(priv->ctx, dev_index, ch_name);
+		if (ch_index < 0) {
+			fprintf(stderr, "Cannot find channel %s\n", ch_name);
+			g_free(ch_name);
+			break;
+		}
+		g_free(ch_name);
+		mask[ch_index] = !gtk_toggle_button_get_active(btn);
+	}
+	g_list_free(ch_checkbtns);
+
+	return mask;
+}
+
+#define SAVE_AS_RAW_DATA 1
+
+static void saveas_dialog_show(GtkWidget *w, OscPlot *plot)
+{
+	OscPlotPrivate *priv = plot->priv;
+
+	gtk_file_chooser_set_action(GTK_FILE_CHOOSER (priv->saveas_dialog), GTK_FILE_CHOOSER_ACTION_SAVE);
+	gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER(priv->saveas_dialog), TRUE);
+
+	if (!priv->saveas_filename) {
+		gtk_file_chooser_set_current_folder(GTK_FILE_CHOOSER (priv->saveas_dialog), getenv("HOME"));
+	} else {
+		if (!gtk_file_chooser_set_filename(GTK_FILE_CHOOSER (priv->saveas_dialog), priv->saveas_filename))
+			gtk_file_chooser_set_current_folder(GTK_FILE_CHOOSER (priv->saveas_dialog), getenv("HOME"));
+		g_free(priv->saveas_filename);
+		priv->saveas_filename = NULL;
+	}
+
+	priv->active_saveas_type = SAVE_AS_RAW_DATA;
+	channel_selection_set_default(plot);
+	gtk_widget_show(priv->saveas_dialog);
+}
+
+static void export_progress_destroy(OscPlotPrivate *priv)
+{
+	if (priv->export_timer) {
+		g_source_remove(priv->export_timer);
+		priv->export_timer = 0;
+	}
+	if (priv->export_window) {
+		gtk_widget_destroy(priv->export_window);
+		priv->export_window = NULL;
+	}
+}
+
+static int export_finish(OscPlotPrivate *priv)
+{
+	gchar *filename = g_strdup(export_job_filename(priv->export_job));
+	int ret;
+
+	ret = export_job_finish(priv->export_job);
+	priv->export_job = NULL;
+	export_progress_destroy(priv);
+
+	if (ret < 0 && ret != -ECANCELED)
+		fprintf(stderr, "Error exporting %s: %s\n",
+				filename, strerror(-ret));
+	g_free(filename);
+
+	return ret;
+}
+
+static gboolean export_progress_update(OscPlot *plot)
+{
+	OscPlotPrivate *priv = plot->priv;
+	int ret;
+
+	if (!export_job_done(priv->export_job)) {
+		gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(priv->export_progress),
+				export_job_progress(priv->export_job));
+		return TRUE;
+	}
+
+	priv->export_timer = 0;
+	ret = export_finish(priv);
+	if (ret < 0 && ret != -ECANCELED)
+		create_blocking_popup(GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE,
+				"Save As", "Could not save the data: %s",
+				strerror(-ret));
+
+	return FALSE;
+}
+
+static void export_cancel_cb(GtkButton *btn, OscPlot *plot)
+{
+	if (plot->priv->export_job)
+		export_job_cancel(plot->priv->export_job);
+}
+
+static void export_progress_show(OscPlot *plot)
+{
+	OscPlotPrivate *priv = plot->priv;
+	GtkWidget *vbox, *label, *cancel;
+	gchar *text;
+
+	priv->export_window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+	gtk_window_set_title(GTK_WINDOW(priv->export_window), "Saving");
+	gtk_window_set_transient_for(GTK_WINDOW(priv->export_window),
+			GTK_WINDOW(priv->window));
+	gtk_window_set_deletable(GTK_WINDOW(priv->export_window), FALSE);
+	gtk_container_set_border_width(GTK_CONTAINER(priv->export_window), 10);
+
+	vbox = gtk_vbox_new(FALSE, 6);
+	text = g_path_get_basename(export_job_filename(priv->export_job));
+	label = gtk_label_new(text);
+	g_free(text);
+	priv->export_progress = gtk_progress_bar_new();
+	cancel = gtk_button_new_from_stock(GTK_STOCK_CANCEL);
+	g_signal_connect(cancel, "clicked", G_CALLBACK(export_cancel_cb), plot);
+
+	gtk_box_pack_start(GTK_BOX(vbox), label, FALSE, FALSE, 0);
+	gtk_box_pack_start(GTK_BOX(vbox), priv->export_progress, FALSE, FALSE, 0);
+	gtk_box_pack_start(GTK_BOX(vbox), cancel, FALSE, FALSE, 0);
+	gtk_container_add(GTK_CONTAINER(priv->export_window), vbox);
+	gtk_widget_show_all(priv->export_window);
+
+	priv->export_timer = g_timeout_add(100,
+			(GSourceFunc) export_progress_update, plot);
+}
+
+static struct iio_device * saveas_active_device(OscPlotPrivate *priv)
+{
+	gchar *active_device;
+	int d;
+
+	active_device = gtk_combo_box_text_get_active_text(GTK_COMBO_BOX_TEXT(priv->device_combobox));
+	d = device_find_by_name(priv->ctx, active_device);
+	g_free(active_device);
+
+	return d < 0 ? NULL : iio_context_get_device(priv->ctx, d);
+}
+
+/* Snapshots the selected channels of the active device into a new section */
+static bool saveas_add_device_section(OscPlot *plot, struct export_job *job,
+		const char *header, const char *footer, bool scaled)
+{
+	OscPlotPrivate *priv = plot->priv;
+	struct iio_device *dev = saveas_active_device(priv);
+	struct extra_dev_info *dev_info;
+	unsigned int nb_channels, i;
+	unsigned int dev_sample_count;
+	int *save_channels_mask;
+	const char *dev_name;
+	char tmp[100];
+
+	if (!dev)
+		return false;
+
+	dev_info = iio_device_get_data(dev);
+	nb_channels = iio_device_get_channels_count(dev);
+	dev_name = iio_device_get_name(dev) ?: iio_device_get_id(dev);
+
+	/* Find which channel need to be saved */
+	save_channels_mask = get_user_saveas_channel_selection(plot, nb_channels);
 
-static int * get_user_saveas_channel_selection(OscPlot *plot, unsigned int nb_channels)
-{
-	OscPlotPrivate *priv = plot->priv;
-	GList *ch_checkbtns = NULL;
-	GList *node;
-	GtkToggleButton *btn;
-	int *mask;
+	dev_sample_count = dev_info->sample_count;
+	if (dev_info->channel_trigger_enabled)
+		dev_sample_count /= 2;
 
-	/* Create masks for all channels */
-	mask = malloc(sizeof(int) * nb_channels);
+	export_job_add_section(job, header, dev_sample_count, footer);
 
-	/* Get user channel selection from GUI widgets */
-	ch_checkbtns = gtk_container_get_children(GTK_CONTAINER(priv->saveas_channels_list));
-	for (node = ch_checkbtns; node; node = g_list_next(node)) {
-		btn = (GtkToggleButton *)node->data;
+	for (i = 0; i < nb_channels; i++) {
+		struct iio_channel *chn = iio_device_get_channel(dev, i);
+		const char *ch_name = iio_channel_get_name(chn) ?:
+			iio_channel_get_id(chn);
+		struct extra_info *info = iio_channel_get_data(chn);
+		double scale = 1.0;
 
-		int dev_index, ch_index;
-		gchar *dev_name, *ch_name;
+		if (save_channels_mask[i] == 1)
+			continue;
 
-		dev_name = gtk_combo_box_text_get_active_text(GTK_COMBO_BOX_TEXT(priv->device_combobox));
-		dev_index = device_find_by_name(priv->ctx, dev_name);
-		g_free(dev_name);
-		g_object_get(btn, "label", &ch_name, NULL);
-		ch_index = channel_find_by_name(priv->ctx, dev_index, ch_name);
-		if (ch_index < 0) {
-			fprintf(stderr, "Cannot find channel %s\n", ch_name);
-			g_free(ch_name);
-			break;
+		/* Full scale to ±1, computed once instead of per sample */
+		if (scaled) {
+			const struct iio_data_format *format =
+				iio_channel_get_data_format(chn);
+
+			scale = ldexp(1.0, -(int) (format->is_signed ?
+						format->bits - 1 : format->bits));
 		}
-		g_free(ch_name);
-		mask[ch_index] = !gtk_toggle_button_get_active(btn);
+
+		snprintf(tmp, sizeof(tmp), "%s_%s", dev_name, ch_name);
+		g_strdelimit(tmp, "-", '_');
+		export_job_add_column(job, tmp, info->data_ref, scale);
 	}
-	g_list_free(ch_checkbtns);
+	free(save_channels_mask);
 
-	return mask;
+	return true;
 }
 
-#define SAVE_AS_RAW_DATA 1
-
-static void saveas_dialog_show(GtkWidget *w, OscPlot *plot)
+static gchar * saveas_vsa_header(OscPlotPrivate *priv)
 {
-	OscPlotPrivate *priv = plot->priv;
+	struct iio_device *dev = saveas_active_device(priv);
+	struct extra_dev_info *dev_info;
+	double freq;
 
-	gtk_file_chooser_set_action(GTK_FILE_CHOOSER (priv->saveas_dialog), GTK_FILE_CHOOSER_ACTION_SAVE);
-	gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER(priv->saveas_dialog), TRUE);
+	if (!dev)
+		return NULL;
 
-	if (!priv->saveas_filename) {
-		gtk_file_chooser_set_current_folder(GTK_FILE_CHOOSER (priv->saveas_dialog), getenv("HOME"));
-	} else {
-		if (!gtk_file_chooser_set_filename(GTK_FILE_CHOOSER (priv->saveas_dialog), priv->saveas_filename))
-			gtk_file_chooser_set_current_folder(GTK_FILE_CHOOSER (priv->saveas_dialog), getenv("HOME"));
-		g_free(priv->saveas_filename);
-		priv->saveas_filename = NULL;
+	dev_info = iio_device_get_data(dev);
+	freq = dev_info->adc_freq * prefix2scale(dev_info->adc_scale);
+
+	return g_strdup_printf(
+			"InputZoom\tTRUE\n"
+			"InputCenter\t0\n"
+			"InputRange\t1\n"
+			"InputRefImped\t50\n"
+			"XStart\t0\n"
+			"XDelta\t%-.17f\n"
+			"XDomain\t2\n"
+			"XUnit\tSec\n"
+			"YUnit\tV\n"
+			"FreqValidMax\t%e\n"
+			"FreqValidMin\t-%e\n"
+			"Y\n", 1.0 / freq, freq / 2, freq / 2);
+}
+
+/* Timing and device state of the captured frame, one "key: value" per line */
+static gchar * saveas_frame_header(OscPlotPrivate *priv)
+{
+	struct iio_device *dev = saveas_active_device(priv);
+	struct capture_frame frame;
+	GString *header;
+
+	if (!dev || !rx_get_device_frame(iio_device_get_name(dev) ?:
+				iio_device_get_id(dev), &frame))
+		return NULL;
+
+	header = g_string_new(NULL);
+	g_string_append_printf(header,
+			"frame: %" G_GUINT64_FORMAT "\n"
+			"refill_start_us: %" G_GINT64_FORMAT "\n"
+			"refill_end_us: %" G_GINT64_FORMAT "\n"
+			"first_sample: %" G_GUINT64_FORMAT "\n"
+			"samples: %u\n"
+			"dropped: %" G_GUINT64_FORMAT "\n"
+			"total_dropped: %" G_GUINT64_FORMAT "\n"
+			"sample_rate_hz: %f\n",
+			frame.sequence, frame.refill_start, frame.refill_end,
+			frame.first_sample, frame.nb_samples, frame.dropped,
+			frame.total_dropped, frame.sample_rate);
+	if (frame.hw_timestamp)
+		g_string_append_printf(header, "hw_timestamp_ns: %"
+				G_GINT64_FORMAT "\n", frame.hw_timestamp);
+	if (frame.lo_freq)
+		g_string_append_printf(header, "lo_freq_hz: %f\n",
+				frame.lo_freq);
+	if (!isnan(frame.gain))
+		g_string_append_printf(header, "gain_db: %f\n", frame.gain);
+
+	return g_string_free(header, FALSE);
+}
+
+/* The frame header goes to '<csv>.meta' rather than into the CSV, which
+ * keeps its plain format */
+static void saveas_frame_meta(OscPlotPrivate *priv, const char *csv_name)
+{
+	gchar *header = saveas_frame_header(priv);
+	GError *err = NULL;
+	gchar *path;
+
+	if (!header)
+		return;
+
+	path = g_strdup_printf("%s.meta", csv_name);
+	if (!g_file_set_contents(path, header, -1, &err)) {
+		fprintf(stderr, "Error writing %s: %s\n", path, err->message);
+		g_error_free(err);
 	}
 
-	priv->active_saveas_type = SAVE_AS_RAW_DATA;
-	channel_selection_set_default(plot);
-	gtk_widget_show(priv->saveas_dialog);
+	g_free(path);
+	g_free(header);
 }
 
-static void save_as(OscPlot *plot, const char *filename, int type)
+/* The data is copied right away, the file itself is written by a separate
+ * thread. Unless 'wait' is set, this returns before it is done. */
+static void save_as(OscPlot *plot, const char *filename, int type, bool wait)
 {
 	OscPlotPrivate *priv = plot->priv;
-	struct iio_context *ctx = priv->ctx;
-	FILE *fp;
-	mat_t *mat;
-	matvar_t *matvar;
-	struct iio_device *dev;
-	struct extra_dev_info *dev_info;
-	char tmp[100];
-	mat_dim dims[2] = {-1, 1};
-	double freq;
+	struct export_job *job = NULL;
+	gchar *header;
 	char *name;
-	gchar *active_device;
-	int *save_channels_mask;
-	int d;
-	unsigned int nb_channels, i, j;
-	const char *dev_name;
-	unsigned int dev_sample_count;
+	int d, ret;
+
+	/* One export at a time, the new one replaces it */
+	if (priv->export_job) {
+		export_job_cancel(priv->export_job);
+		export_finish(priv);
+	}
 
 	name = malloc(strlen(filename) + 5);
 	switch(type) {
@@ -4358,54 +5907,15 @@ static void save_as(OscPlot *plot, const char *filename, int type)
 					strcpy(name, filename);
 				else
 					sprintf(name, "%s.txt", filename);
-			fp = fopen(name, "w");
-			if (!fp)
-				break;
 
-			active_device = gtk_combo_box_text_get_active_text(GTK_COMBO_BOX_TEXT(priv->device_combobox));
-			d = device_find_by_name(ctx, active_device);
-			g_free(active_device);
-			if (d < 0)
+			header = saveas_vsa_header(priv);
+			if (!header)
 				break;
-			dev = iio_context_get_device(ctx, d);
-			dev_info = iio_device_get_data(dev);
-			nb_channels = iio_device_get_channels_count(dev);
-
-			/* Find which channel need to be saved */
-			save_channels_mask = get_user_saveas_channel_selection(plot, nb_channels);
-
-			/* Make a VSA file header */
-			fprintf(fp, "InputZoom\tTRUE\n");
-			fprintf(fp, "InputCenter\t0\n");
-			fprintf(fp, "InputRange\t1\n");
-			fprintf(fp, "InputRefImped\t50\n");
-			fprintf(fp, "XStart\t0\n");
-			freq = dev_info->adc_freq * prefix2scale(dev_info->adc_scale);
-			fprintf(fp, "XDelta\t%-.17f\n", 1.0/freq);
-			fprintf(fp, "XDomain\t2\n");
-			fprintf(fp, "XUnit\tSec\n");
-			fprintf(fp, "YUnit\tV\n");
-			fprintf(fp, "FreqValidMax\t%e\n", freq / 2);
-			fprintf(fp, "FreqValidMin\t-%e\n", freq / 2);
-			fprintf(fp, "Y\n");
-
-			dev_sample_count = dev_info->sample_count;
-			if (dev_info->channel_trigger_enabled)
-				dev_sample_count /= 2;
-
-			/* Start writing the samples */
-			for (i = 0; i < dev_sample_count; i++) {
-				for (j = 0; j < nb_channels; j++) {
-					struct extra_info *info = iio_channel_get_data(iio_device_get_channel(dev, j));
-					if (save_channels_mask[j] == 1)
-						continue;
-					fprintf(fp, "%g\t", info->data_ref[i]);
-				}
-				fprintf(fp, "\n");
-			}
-			fprintf(fp, "\n");
-			fclose(fp);
-			free(save_channels_mask);
+
+			job = export_job_new(EXPORT_TEXT, name);
+			export_job_set_text_format(job, "\t", "\t\n", "");
+			saveas_add_device_section(plot, job, header, "\n", false);
+			g_free(header);
 
 			break;
 		case SAVE_CSV:
@@ -4414,45 +5924,23 @@ static void save_as(OscPlot *plot, const char *filename, int type)
 					strcpy(name, filename);
 				else
 					sprintf(name, "%s.csv", filename);
-			fp = fopen(name, "w");
-			if (!fp)
-				break;
-			if (priv->active_saveas_type == SAVE_AS_RAW_DATA) {
-				active_device = gtk_combo_box_text_get_active_text(GTK_COMBO_BOX_TEXT(priv->device_combobox));
-				d = device_find_by_name(ctx, active_device);
-				g_free(active_device);
-				if (d < 0)
-					break;
-
-				dev = iio_context_get_device(ctx, d);
-				dev_info = iio_device_get_data(dev);
-				nb_channels = iio_device_get_channels_count(dev);
-
-				/* Find which channel need to be saved */
-				save_channels_mask = get_user_saveas_channel_selection(plot, nb_channels);
 
-				dev_sample_count = dev_info->sample_count;
-				if (dev_info->channel_trigger_enabled)
-					dev_sample_count /= 2;
-
-				for (i = 0; i < dev_sample_count; i++) {
-					for (j = 0; j < nb_channels; j++) {
-						struct extra_info *info = iio_channel_get_data(iio_device_get_channel(dev, j));
-						if (save_channels_mask[j] == 1)
-							continue;
-						fprintf(fp, "%g, ", info->data_ref[i]);
-					}
-					fprintf(fp, "\n");
+			job = export_job_new(EXPORT_TEXT, name);
+			if (priv->active_saveas_type == SAVE_AS_RAW_DATA) {
+				export_job_set_text_format(job, ", ", ", \n", "\n");
+				if (!saveas_add_device_section(plot, job,
+							NULL, "\n", false)) {
+					export_job_finish(job);
+					job = NULL;
+				} else {
+					saveas_frame_meta(priv, name);
 				}
-				fprintf(fp, "\n");
-				free(save_channels_mask);
 			} else {
-				for (d = 0; d < priv->transform_list->size; d++) {
-						transform_csv_print(priv, fp, priv->transform_list->transforms[d]);
-				}
+				export_job_set_text_format(job, ", ", ",\n", "\n");
+				for (d = 0; d < priv->transform_list->size; d++)
+					transform_export_section(job,
+						priv->transform_list->transforms[d]);
 			}
-			fprintf(fp, "\n");
-			fclose(fp);
 			break;
 
 		case SAVE_PNG:
@@ -4474,81 +5962,36 @@ static void save_as(OscPlot *plot, const char *filename, int type)
 				else
 					sprintf(name, "%s.mat", filename);
 
-			mat = Mat_Create(name, NULL);
-			if (!mat) {
-				fprintf(stderr, "Error creating MAT file %s: %s\n", name, strerror(errno));
-				break;
-			}
-
-			active_device = gtk_combo_box_text_get_active_text(GTK_COMBO_BOX_TEXT(priv->device_combobox));
-			d = device_find_by_name(ctx, active_device);
-			g_free(active_device);
-			if (d < 0)
-				break;
-
-			dev = iio_context_get_device(ctx, d);
-			dev_info = iio_device_get_data(dev);
-			nb_channels = iio_device_get_channels_count(dev);
-			dev_name = iio_device_get_name(dev) ?:
-				iio_device_get_id(dev);
-
-			/* Find which channel need to be saved */
-			save_channels_mask = get_user_saveas_channel_selection(plot, nb_channels);
-
-			dev_sample_count = dev_info->sample_count;
-			if (dev_info->channel_trigger_enabled)
-				dev_sample_count /= 2;
-
-			dims[0] = dev_sample_count;
-			for (i = 0; i < nb_channels; i++) {
-				struct iio_channel *chn = iio_device_get_channel(dev, i);
-				const char *ch_name = iio_channel_get_name(chn) ?:
-					iio_channel_get_id(chn);
-				struct extra_info *info = iio_channel_get_data(chn);
-				if (save_channels_mask[i] == 1)
-					continue;
-				sprintf(tmp, "%s_%s", dev_name, ch_name);
-				g_strdelimit(tmp, "-", '_');
-				if (!gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(priv->save_mat_scale))) {
-						matvar = Mat_VarCreate(tmp, MAT_C_SINGLE, MAT_T_SINGLE, 2, dims,
-					info->data_ref, 0);
-				} else {
-					const struct iio_data_format* format = iio_channel_get_data_format(chn);
-					gdouble *tmp_data;
-					double k;
-
-					tmp_data = g_new(gdouble, dev_sample_count);
-					if (format->is_signed)
-						k = format->bits - 1;
-					else
-						k = format->bits;
-					for (j = 0; j < dev_sample_count; j++) {
-						tmp_data[j] = (gdouble)info->data_ref[j] /
-									(pow(2.0, k));
-					}
-					matvar = Mat_VarCreate(tmp, MAT_C_DOUBLE, MAT_T_DOUBLE,
-							2, dims, tmp_data, 0);
-					g_free(tmp_data);
-				}
-
-				if (!matvar)
-					fprintf(stderr,
-						"error creating matvar on channel %s\n",
-						tmp);
-				else {
-					Mat_VarWrite(mat, matvar, 0);
-					Mat_VarFree(matvar);
-				}
+			job = export_job_new(EXPORT_MAT, name);
+			export_job_set_compression(job, gtk_toggle_button_get_active(
+					GTK_TOGGLE_BUTTON(priv->save_mat_compress)));
+			if (!saveas_add_device_section(plot, job, NULL, NULL,
+					gtk_toggle_button_get_active(
+					GTK_TOGGLE_BUTTON(priv->save_mat_scale)))) {
+				export_job_finish(job);
+				job = NULL;
 			}
-			free(save_channels_mask);
-
-			Mat_Close(mat);
 			break;
 
 		default:
 			fprintf(stderr, "SaveAs response: %i\n", type);
 	}
 
+	if (job) {
+		ret = export_job_start(job);
+		if (ret < 0) {
+			fprintf(stderr, "Error exporting %s: %s\n",
+					name, strerror(-ret));
+			export_job_finish(job);
+		} else {
+			priv->export_job = job;
+			if (wait)
+				export_finish(priv);
+			else
+				export_progress_show(plot);
+		}
+	}
+
 	if (priv->saveas_filename)
 		g_free(priv->saveas_filename);
 
@@ -4565,7 +6008,7 @@ void cb_saveas_response(GtkDialog *dialog, gint response_id, OscPlot *plot)
 
 	if (response_id == GTK_RESPONSE_ACCEPT) {
 		gint type = gtk_combo_box_get_active(GTK_COMBO_BOX(priv->cmb_saveas_type));
-		save_as(plot, priv->saveas_filename, type);
+		save_as(plot, priv->saveas_filename, type, false);
 	}
 
 	gtk_widget_hide(priv->saveas_dialog);
@@ -4806,6 +6249,43 @@ static void plot_profile_save(OscPlot *plot, char *filename)
 	tmp_float = gtk_spin_button_get_value(GTK_SPIN_BUTTON(priv->fft_pwr_offset_widget));
 	fprintf(fp, "fft_pwr_offset=%f\n", tmp_float);
 
+	tmp_int = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(priv->waterfall_widget));
+	fprintf(fp, "waterfall=%d\n", tmp_int);
+
+	tmp_float = gtk_spin_button_get_value(GTK_SPIN_BUTTON(priv->waterfall_decay_widget));
+	fprintf(fp, "waterfall_decay=%f\n", tmp_float);
+
+	tmp_int = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(priv->fixed_point_fft_widget));
+	fprintf(fp, "fft_fixed_point=%d\n", tmp_int);
+
+	tmp_float = gtk_spin_button_get_value(GTK_SPIN_BUTTON(priv->density_persistence_widget));
+	fprintf(fp, "density_persistence=%f\n", tmp_float);
+
+	tmp_int = gtk_combo_box_get_active(GTK_COMBO_BOX(priv->evm_reference_widget));
+	fprintf(fp, "evm_reference=%d\n", tmp_int);
+
+	tmp_int = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(priv->zoom_fft_widget));
+	fprintf(fp, "zoom_fft=%d\n", tmp_int);
+
+	/* Doubles, a float can't hold a center frequency to the Hz */
+	fprintf(fp, "zoom_fft_center=%f\n",
+		gtk_spin_button_get_value(GTK_SPIN_BUTTON(priv->zoom_center_widget)));
+	fprintf(fp, "zoom_fft_span=%f\n",
+		gtk_spin_button_get_value(GTK_SPIN_BUTTON(priv->zoom_span_widget)));
+
+	tmp_string = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(priv->fir_preview_file_widget));
+	if (tmp_string && priv->fir_preview)
+		fprintf(fp, "fir_preview_file=%s\n", tmp_string);
+	g_free(tmp_string);
+
+	tmp_int = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(priv->fir_preview_widget));
+	fprintf(fp, "fir_preview=%d\n", tmp_int);
+
+	tmp_int = gtk_combo_box_get_active(GTK_COMBO_BOX(priv->histogram_widget));
+	fprintf(fp, "histogram=%d\n", tmp_int);
+
+	fprintf(fp, "max_fps=%d\n", priv->max_fps);
+
 	tmp_string = gtk_combo_box_text_get_active_text(GTK_COMBO_BOX_TEXT(priv->plot_type));
 	fprintf(fp, "graph_type=%s\n", tmp_string);
 	g_free(tmp_string);
@@ -4933,7 +6413,7 @@ static void plot_profile_save(OscPlot *plot, char *filename)
 			fprintf(fp, "marker.%i = %i\n", tmp_int, priv->markers[tmp_int].bin);
 	}
 
-	fprintf(fp, "capture_started=%d\n", (priv->redraw_function) ? 1 : 0);
+	fprintf(fp, "capture_started=%d\n", (priv->redraw_active) ? 1 : 0);
 	fclose(fp);
 }
 
@@ -5064,7 +6544,7 @@ int osc_plot_ini_read_handler (OscPlot *plot, int line, const char *section,
 	switch(elem_type) {
 		case PLOT_ATTRIBUTE:
 			if (MATCH_NAME("capture_started")) {
-				if (priv->redraw_function && atoi(value))
+				if (priv->redraw_active && atoi(value))
 					goto handled;
 				treeview_expand_update(plot);
 				treeview_icon_color_update(plot);
@@ -5108,6 +6588,32 @@ int osc_plot_ini_read_handler (OscPlot *plot, int line, const char *section,
 				gtk_spin_button_set_value(GTK_SPIN_BUTTON(priv->fft_avg_widget), atoi(value));
 			} else if (MATCH_NAME("fft_pwr_offset")) {
 				gtk_spin_button_set_value(GTK_SPIN_BUTTON(priv->fft_pwr_offset_widget), atof(value));
+			} else if (MATCH_NAME("waterfall")) {
+				gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(priv->waterfall_widget), atoi(value));
+			} else if (MATCH_NAME("waterfall_decay")) {
+				gtk_spin_button_set_value(GTK_SPIN_BUTTON(priv->waterfall_decay_widget), atof(value));
+			} else if (MATCH_NAME("fft_fixed_point")) {
+				gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(priv->fixed_point_fft_widget), atoi(value));
+			} else if (MATCH_NAME("density_persistence")) {
+				gtk_spin_button_set_value(GTK_SPIN_BUTTON(priv->density_persistence_widget), atof(value));
+			} else if (MATCH_NAME("evm_reference")) {
+				gtk_combo_box_set_active(GTK_COMBO_BOX(priv->evm_reference_widget), atoi(value));
+			} else if (MATCH_NAME("zoom_fft")) {
+				gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(priv->zoom_fft_widget), atoi(value));
+			} else if (MATCH_NAME("zoom_fft_center")) {
+				gtk_spin_button_set_value(GTK_SPIN_BUTTON(priv->zoom_center_widget), atof(value));
+			} else if (MATCH_NAME("zoom_fft_span")) {
+				gtk_spin_button_set_value(GTK_SPIN_BUTTON(priv->zoom_span_widget), atof(value));
+			} else if (MATCH_NAME("fir_preview_file")) {
+				if (!fir_preview_load(plot, value))
+					goto unhandled;
+				gtk_file_chooser_set_filename(GTK_FILE_CHOOSER(priv->fir_preview_file_widget), value);
+			} else if (MATCH_NAME("fir_preview")) {
+				gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(priv->fir_preview_widget), atoi(value));
+			} else if (MATCH_NAME("histogram")) {
+				gtk_combo_box_set_active(GTK_COMBO_BOX(priv->histogram_widget), atoi(value));
+			} else if (MATCH_NAME("max_fps")) {
+				gtk_spin_button_set_value(GTK_SPIN_BUTTON(priv->max_fps_widget), atoi(value));
 			} else if (MATCH_NAME("graph_type")) {
 				if (!comboboxtext_set_active_by_string(GTK_COMBO_BOX(priv->plot_type), value))
 					goto unhandled;
@@ -5180,7 +6686,7 @@ int osc_plot_ini_read_handler (OscPlot *plot, int line, const char *section,
 						priv->markers[i].active = FALSE;
 				}
 			} else if (MATCH_NAME("save_png")) {
-				save_as(plot, value, SAVE_PNG);
+				save_as(plot, value, SAVE_PNG, true);
 				i = 0;
 				while (gtk_events_pending() && i < 1000) {
 					gtk_main_iteration();
@@ -5529,7 +7035,7 @@ static gint moved_fixed(GtkDatabox *box, GdkEventMotion *event, gpointer user_da
 	int max_size;
 	gfloat *X = Transform_get_x_axis_ref(priv->tr_with_marker);
 
-	if (priv->active_transform_type == COMPLEX_FFT_TRANSFORM)
+	if (is_complex_frequency_transform(priv))
 		max_size = priv->tr_with_marker->x_axis_size;
 	else
 		max_size = priv->tr_with_marker->x_axis_size / 2;
@@ -5673,7 +7179,7 @@ static gint marker_button(GtkDatabox *box, GdkEventButton *event, gpointer data)
 	i++;
 	*/
 
-	if (priv->active_transform_type == COMPLEX_FFT_TRANSFORM) {
+	if (is_complex_frequency_transform(priv)) {
 		menuitem = gtk_check_menu_item_new_with_label(IMAGE_MRK);
 		gtk_menu_attach(GTK_MENU(popupmenu), menuitem, 0, 1, i, i + 1);
 		gtk_check_menu_item_set_active(GTK_CHECK_MENU_ITEM(menuitem),
@@ -5773,6 +7279,20 @@ static gboolean domain_is_fft(GBinding *binding,
 	return TRUE;
 }
 
+static gboolean domain_is_fft_only(GBinding *binding,
+	const GValue *source_value, GValue *target_value, gpointer user_data)
+{
+	g_value_set_boolean(target_value, g_value_get_int(source_value) == FFT_PLOT);
+	return TRUE;
+}
+
+static gboolean domain_is_xy(GBinding *binding,
+	const GValue *source_value, GValue *target_value, gpointer user_data)
+{
+	g_value_set_boolean(target_value, g_value_get_int(source_value) == XY_PLOT);
+	return TRUE;
+}
+
 static gboolean domain_is_time(GBinding *binding,
 	const GValue *source_value, GValue *target_value, gpointer user_data)
 {
@@ -5780,6 +7300,13 @@ static gboolean domain_is_time(GBinding *binding,
 	return TRUE;
 }
 
+static gboolean domain_is_time_only(GBinding *binding,
+	const GValue *source_value, GValue *target_value, gpointer user_data)
+{
+	g_value_set_boolean(target_value, g_value_get_int(source_value) == TIME_PLOT);
+	return TRUE;
+}
+
 static gboolean domain_is_xcorr_fft(GBinding *binding,
 	const GValue *source_value, GValue *target_value, gpointer user_data)
 {
@@ -5820,6 +7347,197 @@ static void fft_pwr_offset_value_changed_cb(GtkSpinButton *button, OscPlot *plot
 	}
 }
 
+static void waterfall_decay_value_changed_cb(GtkSpinButton *button, OscPlot *plot)
+{
+	OscPlotPrivate *priv = plot->priv;
+	int i;
+
+	for (i = 0; i < priv->transform_list->size; i++) {
+		Transform *tr = priv->transform_list->transforms[i];
+
+		if (tr->type_id == WATERFALL_TRANSFORM)
+			WATERFALL_SETTINGS(tr)->hold_decay = gtk_spin_button_get_value(button);
+	}
+}
+
+static gboolean waterfall_expose_cb(GtkWidget *widget, GdkEventExpose *event, OscPlot *plot)
+{
+	OscPlotPrivate *priv = plot->priv;
+	struct _waterfall_settings *wf;
+	GtkAllocation alloc;
+	cairo_t *cr;
+	unsigned int older;
+
+	if (priv->active_transform_type != WATERFALL_TRANSFORM ||
+			!priv->transform_list->size)
+		return FALSE;
+
+	wf = WATERFALL_SETTINGS(priv->transform_list->transforms[0]);
+	if (!wf->image)
+		return FALSE;
+
+	gtk_widget_get_allocation(widget, &alloc);
+	cr = gdk_cairo_create(gtk_widget_get_window(widget));
+	gdk_cairo_region(cr, event->region);
+	cairo_clip(cr);
+	cairo_scale(cr, (double)alloc.width / wf->columns,
+			(double)alloc.height / wf->rows);
+
+	/* The newest row is at head, the ring wraps around to the oldest */
+	older = wf->rows - wf->head;
+	cairo_set_source_surface(cr, wf->image, 0, -(double)wf->head);
+	cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_NEAREST);
+	cairo_rectangle(cr, 0, 0, wf->columns, older);
+	cairo_fill(cr);
+	if (wf->head) {
+		cairo_set_source_surface(cr, wf->image, 0, older);
+		cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_NEAREST);
+		cairo_rectangle(cr, 0, older, wf->columns, wf->head);
+		cairo_fill(cr);
+	}
+	cairo_destroy(cr);
+
+	return TRUE;
+}
+
+static void density_persistence_value_changed_cb(GtkSpinButton *button, OscPlot *plot)
+{
+	OscPlotPrivate *priv = plot->priv;
+	int i;
+
+	for (i = 0; i < priv->transform_list->size; i++) {
+		Transform *tr = priv->transform_list->transforms[i];
+
+		if (tr->type_id == CONSTELLATION_TRANSFORM)
+			CONSTELLATION_SETTINGS(tr)->persistence = gtk_spin_button_get_value(button);
+	}
+}
+
+static void evm_reference_changed_cb(GtkComboBox *box, OscPlot *plot)
+{
+	OscPlotPrivate *priv = plot->priv;
+	int i;
+
+	for (i = 0; i < priv->transform_list->size; i++) {
+		Transform *tr = priv->transform_list->transforms[i];
+
+		if (tr->type_id == CONSTELLATION_TRANSFORM) {
+			CONSTELLATION_SETTINGS(tr)->ref_order = evm_reference_order(priv);
+			CONSTELLATION_SETTINGS(tr)->evm = 0;
+			CONSTELLATION_SETTINGS(tr)->mer = 0;
+		}
+	}
+}
+
+/* Switching to the zoom FFT starts from the part of the spectrum on screen */
+static void zoom_fft_toggled_cb(GtkToggleButton *btn, OscPlot *plot)
+{
+	OscPlotPrivate *priv = plot->priv;
+	struct extra_dev_info *dev_info;
+	gfloat left, right, top, bottom;
+	double scale;
+
+	if (!gtk_toggle_button_get_active(btn) ||
+			priv->active_transform_type != COMPLEX_FFT_TRANSFORM ||
+			!priv->current_device)
+		return;
+
+	dev_info = iio_device_get_data(priv->current_device);
+	if (!dev_info)
+		return;
+
+	scale = prefix2scale(dev_info->adc_scale);
+	gtk_databox_get_visible_limits(GTK_DATABOX(priv->databox),
+			&left, &right, &top, &bottom);
+	gtk_spin_button_set_value(GTK_SPIN_BUTTON(priv->zoom_center_widget),
+			(left + right) / 2.0 * scale);
+	gtk_spin_button_set_value(GTK_SPIN_BUTTON(priv->zoom_span_widget),
+			fabs(right - left) * scale);
+}
+
+static bool fir_preview_load(OscPlot *plot, const char *filename)
+{
+	OscPlotPrivate *priv = plot->priv;
+	struct fir_filter_file *ftr;
+
+	ftr = fir_filter_file_load(filename);
+	if (!ftr)
+		return false;
+
+	fir_filter_file_free(priv->fir_preview);
+	priv->fir_preview = ftr;
+	return true;
+}
+
+static void fir_preview_file_set_cb(GtkFileChooser *chooser, OscPlot *plot)
+{
+	gchar *filename = gtk_file_chooser_get_filename(chooser);
+
+	if (filename && !fir_preview_load(plot, filename))
+		gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(
+				plot->priv->fir_preview_widget), FALSE);
+	g_free(filename);
+}
+
+static gboolean constellation_expose_cb(GtkWidget *widget, GdkEventExpose *event, OscPlot *plot)
+{
+	OscPlotPrivate *priv = plot->priv;
+	GtkDatabox *box = GTK_DATABOX(widget);
+	struct _constellation_settings *settings;
+	Transform *tr;
+	gint16 x0, y0, x1, y1;
+	char text[64];
+	cairo_t *cr;
+	int i, line = 0;
+
+	if (priv->active_transform_type != CONSTELLATION_TRANSFORM ||
+			!priv->transform_list->size)
+		return FALSE;
+
+	cr = gdk_cairo_create(gtk_widget_get_window(widget));
+	gdk_cairo_region(cr, event->region);
+	cairo_clip(cr);
+
+	/* Empty bins are transparent, so every map shows through the others */
+	for (i = 0; i < priv->transform_list->size; i++) {
+		tr = priv->transform_list->transforms[i];
+		settings = CONSTELLATION_SETTINGS(tr);
+		if (!(settings->density && settings->image && settings->range > 0))
+			continue;
+
+		x0 = gtk_databox_value_to_pixel_x(box, -settings->range);
+		x1 = gtk_databox_value_to_pixel_x(box, settings->range);
+		y0 = gtk_databox_value_to_pixel_y(box, settings->range);
+		y1 = gtk_databox_value_to_pixel_y(box, -settings->range);
+
+		cairo_save(cr);
+		cairo_translate(cr, x0, y0);
+		cairo_scale(cr, (double)(x1 - x0) / CONSTELLATION_GRID,
+				(double)(y1 - y0) / CONSTELLATION_GRID);
+		cairo_set_source_surface(cr, settings->image, 0, 0);
+		cairo_rectangle(cr, 0, 0, CONSTELLATION_GRID, CONSTELLATION_GRID);
+		cairo_fill(cr);
+		cairo_restore(cr);
+	}
+
+	/* One line per constellation, in the color of its graph */
+	for (i = 0; i < priv->transform_list->size; i++) {
+		tr = priv->transform_list->transforms[i];
+		settings = CONSTELLATION_SETTINGS(tr);
+		if (!settings->ref_order || settings->mer <= 0)
+			continue;
+
+		snprintf(text, sizeof(text), "EVM: %.2f %%  MER: %.2f dB",
+				settings->evm, settings->mer);
+		gdk_cairo_set_source_color(cr, tr->graph_color);
+		cairo_move_to(cr, 10, 20 + 15 * line++);
+		cairo_show_text(cr, text);
+	}
+	cairo_destroy(cr);
+
+	return FALSE;
+}
+
 static gboolean tree_get_selected_row_iter(GtkTreeView *treeview, GtkTreeIter *iter)
 {
 	GtkTreeSelection *selection;
@@ -6613,9 +8331,31 @@ static gboolean window_state_event_cb(GtkWidget *widget, GdkEventWindowState *ev
 	else
 		plot->priv->fullscreen_state = false;
 
+	plot->priv->iconified = !!(event->new_window_state & GDK_WINDOW_STATE_ICONIFIED);
+	plot_schedule_redraw(plot->priv);
+
+	return FALSE;
+}
+
+/* Frames that came in while the plot was hidden get drawn once it shows */
+static gboolean databox_visibility_cb(GtkWidget *widget, GdkEventVisibility *event, OscPlot *plot)
+{
+	plot->priv->obscured = event->state == GDK_VISIBILITY_FULLY_OBSCURED;
+	plot_schedule_redraw(plot->priv);
+
 	return FALSE;
 }
 
+static void databox_map_cb(GtkWidget *widget, OscPlot *plot)
+{
+	plot_schedule_redraw(plot->priv);
+}
+
+static void max_fps_value_changed_cb(GtkSpinButton *button, OscPlot *plot)
+{
+	plot->priv->max_fps = gtk_spin_button_get_value_as_int(button);
+}
+
 static void capture_window_realize_cb(GtkWidget *widget, OscPlot *plot)
 {
 	gtk_window_get_size(GTK_WINDOW(plot->priv->window),
@@ -6659,6 +8399,7 @@ static void create_plot(OscPlot *plot)
 	priv->hor_scale = GTK_WIDGET(gtk_builder_get_object(builder, "hor_scale"));
 	priv->hor_units =  GTK_WIDGET(gtk_builder_get_object(builder, "sample_count_units"));
 	priv->marker_label = GTK_WIDGET(gtk_builder_get_object(builder, "marker_info"));
+	priv->marker_readout = text_readout_new(GTK_TEXT_VIEW(priv->marker_label));
 	priv->devices_label = GTK_WIDGET(gtk_builder_get_object(builder, "device_info"));
 	priv->phase_label = GTK_WIDGET(gtk_builder_get_object(builder, "phase_info"));
 	priv->saveas_button = GTK_WIDGET(gtk_builder_get_object(builder, "save_as"));
@@ -6675,10 +8416,24 @@ static void create_plot(OscPlot *plot)
 	priv->fft_size_widget = GTK_WIDGET(gtk_builder_get_object(builder, "fft_size"));
 	priv->fft_avg_widget = GTK_WIDGET(gtk_builder_get_object(builder, "fft_avg"));
 	priv->fft_pwr_offset_widget = GTK_WIDGET(gtk_builder_get_object(builder, "pwr_offset"));
+	priv->waterfall_widget = GTK_WIDGET(gtk_builder_get_object(builder, "waterfall_enable"));
+	priv->waterfall_decay_widget = GTK_WIDGET(gtk_builder_get_object(builder, "waterfall_decay"));
+	priv->density_persistence_widget = GTK_WIDGET(gtk_builder_get_object(builder, "density_persistence"));
+	priv->fixed_point_fft_widget = GTK_WIDGET(gtk_builder_get_object(builder, "fixed_point_fft"));
+	priv->evm_reference_widget = GTK_WIDGET(gtk_builder_get_object(builder, "evm_reference"));
+	priv->zoom_fft_widget = GTK_WIDGET(gtk_builder_get_object(builder, "zoom_fft_enable"));
+	priv->zoom_center_widget = GTK_WIDGET(gtk_builder_get_object(builder, "zoom_fft_center"));
+	priv->zoom_span_widget = GTK_WIDGET(gtk_builder_get_object(builder, "zoom_fft_span"));
+	priv->fir_preview_widget = GTK_WIDGET(gtk_builder_get_object(builder, "fir_preview_enable"));
+	priv->fir_preview_file_widget = GTK_WIDGET(gtk_builder_get_object(builder, "fir_preview_file"));
+	priv->histogram_widget = GTK_WIDGET(gtk_builder_get_object(builder, "histogram_mode"));
+	priv->max_fps_widget = GTK_WIDGET(gtk_builder_get_object(builder, "max_fps"));
+	priv->max_fps = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(priv->max_fps_widget));
 	priv->math_dialog = GTK_WIDGET(gtk_builder_get_object(builder, "dialog_math_settings"));
 	priv->capture_options_box = GTK_WIDGET(gtk_builder_get_object(builder, "box_capture_options"));
 	priv->saveas_settings_box = GTK_WIDGET(gtk_builder_get_object(builder, "vbox_saveas_settings"));
 	priv->save_mat_scale = GTK_WIDGET(gtk_builder_get_object(builder, "save_mat_scale"));
+	priv->save_mat_compress = GTK_WIDGET(gtk_builder_get_object(builder, "save_mat_compress"));
 	priv->new_plot_button = GTK_WIDGET(gtk_builder_get_object(builder, "toolbutton_new_plot"));
 	priv->cmb_saveas_type = GTK_WIDGET(gtk_builder_get_object(priv->builder, "save_formats"));
 	priv->math_expression_dialog = GTK_WIDGET(gtk_builder_get_object(priv->builder, "math_expression_chooser"));
@@ -6687,7 +8442,6 @@ static void create_plot(OscPlot *plot)
 	priv->math_channel_name_entry = GTK_WIDGET(gtk_builder_get_object(priv->builder, "entry_math_ch_name"));
 	priv->math_expr_error = GTK_WIDGET(gtk_builder_get_object(priv->builder, "label_math_expr_invalid_msg"));
 
-	priv->tbuf = NULL;
 	priv->ch_settings_list = NULL;
 
 	/* Count every object that is being created */
@@ -6716,6 +8470,13 @@ static void create_plot(OscPlot *plot)
 	gtk_widget_set_size_request(table, 320, 240);
 	ruler_y = gtk_databox_get_ruler_y(GTK_DATABOX(priv->databox));
 
+	/* Waterfall history, shown under the spectrum only when in use */
+	priv->waterfall_area = gtk_drawing_area_new();
+	gtk_widget_set_size_request(priv->waterfall_area, -1, 160);
+	gtk_widget_modify_bg(priv->waterfall_area, GTK_STATE_NORMAL, &color_background);
+	gtk_widget_set_no_show_all(priv->waterfall_area, TRUE);
+	gtk_box_pack_start(GTK_BOX(priv->capture_graph), priv->waterfall_area, FALSE, TRUE, 0);
+
 	/* Create a Tree Store that holds information about devices */
 	tree_store = gtk_tree_store_new(NUM_COL,
 					G_TYPE_STRING,    /* ELEMENT_NAME */
@@ -6813,8 +8574,7 @@ static void create_plot(OscPlot *plot)
 	gtk_text_view_set_buffer(GTK_TEXT_VIEW(priv->devices_label), priv->devices_buf);
 
 	/* Initialize text view for Phase Info */
-	priv->phase_buf = gtk_text_buffer_new(NULL);
-	gtk_text_view_set_buffer(GTK_TEXT_VIEW(priv->phase_label), priv->phase_buf);
+	priv->phase_readout = text_readout_new(GTK_TEXT_VIEW(priv->phase_label));
 
 	/* Initialize Impulse Generators (triggers) dialog */
 	trigger_dialog_init(builder);
@@ -6833,6 +8593,11 @@ static void create_plot(OscPlot *plot)
 
 	g_signal_connect(G_OBJECT(priv->window), "window-state-event",
 		G_CALLBACK(window_state_event_cb), plot);
+	gtk_widget_add_events(priv->databox, GDK_VISIBILITY_NOTIFY_MASK);
+	g_signal_connect(priv->databox, "visibility-notify-event",
+		G_CALLBACK(databox_visibility_cb), plot);
+	g_signal_connect(priv->databox, "map",
+		G_CALLBACK(databox_map_cb), plot);
 	g_signal_connect(G_OBJECT(priv->window), "realize",
 		G_CALLBACK(capture_window_realize_cb), plot);
 
@@ -6861,6 +8626,22 @@ static void create_plot(OscPlot *plot)
 		G_CALLBACK(fft_avg_value_changed_cb), plot);
 	g_signal_connect(priv->fft_pwr_offset_widget, "value-changed",
 		G_CALLBACK(fft_pwr_offset_value_changed_cb), plot);
+	g_signal_connect(priv->waterfall_decay_widget, "value-changed",
+		G_CALLBACK(waterfall_decay_value_changed_cb), plot);
+	g_signal_connect(priv->waterfall_area, "expose-event",
+		G_CALLBACK(waterfall_expose_cb), plot);
+	g_signal_connect(priv->density_persistence_widget, "value-changed",
+		G_CALLBACK(density_persistence_value_changed_cb), plot);
+	g_signal_connect(priv->evm_reference_widget, "changed",
+		G_CALLBACK(evm_reference_changed_cb), plot);
+	g_signal_connect(priv->zoom_fft_widget, "toggled",
+		G_CALLBACK(zoom_fft_toggled_cb), plot);
+	g_signal_connect(priv->fir_preview_file_widget, "file-set",
+		G_CALLBACK(fir_preview_file_set_cb), plot);
+	g_signal_connect(priv->max_fps_widget, "value-changed",
+		G_CALLBACK(max_fps_value_changed_cb), plot);
+	g_signal_connect_after(priv->databox, "expose-event",
+		G_CALLBACK(constellation_expose_cb), plot);
 	g_signal_connect(priv->new_plot_button, "clicked",
 		G_CALLBACK(new_plot_button_clicked_cb), plot);
 
@@ -6950,6 +8731,22 @@ static void create_plot(OscPlot *plot)
 		"capture_domain", "sensitive", G_BINDING_INVERT_BOOLEAN);
 	g_builder_bind_property(builder, "capture_button", "active",
 		"fft_size", "sensitive", G_BINDING_INVERT_BOOLEAN);
+	g_builder_bind_property(builder, "capture_button", "active",
+		"waterfall_enable", "sensitive", G_BINDING_INVERT_BOOLEAN);
+	g_builder_bind_property(builder, "capture_button", "active",
+		"fixed_point_fft", "sensitive", G_BINDING_INVERT_BOOLEAN);
+	g_builder_bind_property(builder, "capture_button", "active",
+		"zoom_fft_enable", "sensitive", G_BINDING_INVERT_BOOLEAN);
+	g_builder_bind_property(builder, "capture_button", "active",
+		"zoom_fft_center", "sensitive", G_BINDING_INVERT_BOOLEAN);
+	g_builder_bind_property(builder, "capture_button", "active",
+		"zoom_fft_span", "sensitive", G_BINDING_INVERT_BOOLEAN);
+	g_builder_bind_property(builder, "capture_button", "active",
+		"fir_preview_enable", "sensitive", G_BINDING_INVERT_BOOLEAN);
+	g_builder_bind_property(builder, "capture_button", "active",
+		"fir_preview_file", "sensitive", G_BINDING_INVERT_BOOLEAN);
+	g_builder_bind_property(builder, "capture_button", "active",
+		"histogram_mode", "sensitive", G_BINDING_INVERT_BOOLEAN);
 	g_builder_bind_property(builder, "capture_button", "active",
 		"plot_type", "sensitive", G_BINDING_INVERT_BOOLEAN);
 	g_builder_bind_property(builder, "capture_button", "active",
@@ -6987,6 +8784,66 @@ static void create_plot(OscPlot *plot)
 	 g_object_bind_property_full(priv->plot_domain, "active", priv->fft_pwr_offset_widget, "visible",
 		0, domain_is_fft, NULL, NULL, NULL);
 
+	tmp = GTK_WIDGET(gtk_builder_get_object(builder, "density_persistence_label"));
+	g_object_bind_property_full(priv->plot_domain, "active", tmp, "visible",
+		0, domain_is_xy, NULL, NULL, NULL);
+	g_object_bind_property_full(priv->plot_domain, "active", priv->density_persistence_widget, "visible",
+		0, domain_is_xy, NULL, NULL, NULL);
+	tmp = GTK_WIDGET(gtk_builder_get_object(builder, "evm_reference_label"));
+	g_object_bind_property_full(priv->plot_domain, "active", tmp, "visible",
+		0, domain_is_xy, NULL, NULL, NULL);
+	g_object_bind_property_full(priv->plot_domain, "active", priv->evm_reference_widget, "visible",
+		0, domain_is_xy, NULL, NULL, NULL);
+
+	tmp = GTK_WIDGET(gtk_builder_get_object(builder, "fixed_point_fft_label"));
+	g_object_bind_property_full(priv->plot_domain, "active", tmp, "visible",
+		0, domain_is_fft_only, NULL, NULL, NULL);
+	g_object_bind_property_full(priv->plot_domain, "active", priv->fixed_point_fft_widget, "visible",
+		0, domain_is_fft_only, NULL, NULL, NULL);
+
+	tmp = GTK_WIDGET(gtk_builder_get_object(builder, "waterfall_label"));
+	g_object_bind_property_full(priv->plot_domain, "active", tmp, "visible",
+		0, domain_is_fft_only, NULL, NULL, NULL);
+	g_object_bind_property_full(priv->plot_domain, "active", priv->waterfall_widget, "visible",
+		0, domain_is_fft_only, NULL, NULL, NULL);
+	tmp = GTK_WIDGET(gtk_builder_get_object(builder, "waterfall_decay_label"));
+	g_object_bind_property_full(priv->plot_domain, "active", tmp, "visible",
+		0, domain_is_fft_only, NULL, NULL, NULL);
+	g_object_bind_property_full(priv->plot_domain, "active", priv->waterfall_decay_widget, "visible",
+		0, domain_is_fft_only, NULL, NULL, NULL);
+
+	tmp = GTK_WIDGET(gtk_builder_get_object(builder, "zoom_fft_label"));
+	g_object_bind_property_full(priv->plot_domain, "active", tmp, "visible",
+		0, domain_is_fft_only, NULL, NULL, NULL);
+	g_object_bind_property_full(priv->plot_domain, "active", priv->zoom_fft_widget, "visible",
+		0, domain_is_fft_only, NULL, NULL, NULL);
+	tmp = GTK_WIDGET(gtk_builder_get_object(builder, "zoom_fft_center_label"));
+	g_object_bind_property_full(priv->plot_domain, "active", tmp, "visible",
+		0, domain_is_fft_only, NULL, NULL, NULL);
+	g_object_bind_property_full(priv->plot_domain, "active", priv->zoom_center_widget, "visible",
+		0, domain_is_fft_only, NULL, NULL, NULL);
+	tmp = GTK_WIDGET(gtk_builder_get_object(builder, "zoom_fft_span_label"));
+	g_object_bind_property_full(priv->plot_domain, "active", tmp, "visible",
+		0, domain_is_fft_only, NULL, NULL, NULL);
+	g_object_bind_property_full(priv->plot_domain, "active", priv->zoom_span_widget, "visible",
+		0, domain_is_fft_only, NULL, NULL, NULL);
+	tmp = GTK_WIDGET(gtk_builder_get_object(builder, "fir_preview_label"));
+	g_object_bind_property_full(priv->plot_domain, "active", tmp, "visible",
+		0, domain_is_fft_only, NULL, NULL, NULL);
+	g_object_bind_property_full(priv->plot_domain, "active", priv->fir_preview_widget, "visible",
+		0, domain_is_fft_only, NULL, NULL, NULL);
+	tmp = GTK_WIDGET(gtk_builder_get_object(builder, "fir_preview_file_label"));
+	g_object_bind_property_full(priv->plot_domain, "active", tmp, "visible",
+		0, domain_is_fft_only, NULL, NULL, NULL);
+	g_object_bind_property_full(priv->plot_domain, "active", priv->fir_preview_file_widget, "visible",
+		0, domain_is_fft_only, NULL, NULL, NULL);
+
+	tmp = GTK_WIDGET(gtk_builder_get_object(builder, "histogram_mode_label"));
+	g_object_bind_property_full(priv->plot_domain, "active", tmp, "visible",
+		0, domain_is_time_only, NULL, NULL, NULL);
+	g_object_bind_property_full(priv->plot_domain, "active", priv->histogram_widget, "visible",
+		0, domain_is_time_only, NULL, NULL, NULL);
+
 	g_object_bind_property_full(priv->plot_domain, "active", priv->hor_units, "visible",
 		0, domain_is_time, NULL, NULL, NULL);
 	g_signal_connect(priv->hor_units, "changed", G_CALLBACK(units_changed_cb), plot);
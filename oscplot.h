@@ -73,6 +73,14 @@ void          osc_plot_spect_mode       (OscPlot *plot, bool enable);
 void          osc_plot_spect_set_start_f(OscPlot *plot, double freq_mhz);
 void          osc_plot_spect_set_len    (OscPlot *plot, unsigned fft_count);
 void          osc_plot_spect_set_filter_bw(OscPlot *plot, double bw);
+void          osc_plot_rebind_context(OscPlot *plot, struct iio_context *ctx);
+
+struct _transform;
+struct iio_device;
+struct _transform * osc_plot_bench_transform_new(struct iio_device *dev, int tr_type, unsigned int size);
+void          osc_plot_bench_transform_destroy(struct _transform *tr);
+void          osc_plot_bench_show       (OscPlot *plot, struct _transform *tr);
+void          osc_plot_bench_redraw     (OscPlot *plot);
 
 G_END_DECLS
 
@@ -23,6 +23,7 @@
 #include "../iio_widget.h"
 #include "../osc_plugin.h"
 #include "../config.h"
+#include "lowrate_dac.h"
 
 #define SINEWAVE        0
 #define SQUAREWAVE      1
@@ -31,12 +32,12 @@
 
 static unsigned int buffer_size;
 static uint8_t *soft_buffer_ch0;
-static unsigned int current_sample = 0;
-static gint fill_buffer_function = 0;
 static struct iio_device *dev;
 static bool dev_opened;
 static struct iio_context *ctx, *thread_ctx;
-static struct iio_buffer *dac_buff;
+static struct lowrate_dac *dac_out;
+static guint dac_status_timer;
+static GtkWidget *dac_status;
 
 static struct iio_widget tx_widgets[100];
 static struct iio_widget rx_widgets[100];
@@ -81,25 +82,53 @@ static gdouble wave_offset;
 
 #define IIO_BUFFER_SIZE 400
 
-static int buffer_open(unsigned int length)
+static int buffer_open(void)
 {
-	struct iio_device *trigger = iio_context_find_device(ctx, "hrtimer-1");
+	struct iio_device *trigger = iio_context_find_device(thread_ctx, "hrtimer-1");
 	struct iio_channel *ch0 = iio_device_find_channel(dev, "voltage0", true);
+	int ret;
 
 	iio_device_set_trigger(dev, trigger);
 	iio_channel_enable(ch0);
 
-	dac_buff = iio_device_create_buffer(dev, IIO_BUFFER_SIZE, false);
+	/* One period is enough, the helper repeats it */
+	ret = lowrate_dac_play_periodic(dac_out, soft_buffer_ch0, buffer_size);
+	if (ret < 0)
+		fprintf(stderr, "Unable to start the AD7303 output: %s\n",
+				strerror(-ret));
 
-	return (dac_buff) ? 0 : 1;
+	return ret;
 }
 
-static int buffer_close()
+static void buffer_close(void)
 {
-	iio_buffer_destroy(dac_buff);
-	dac_buff = NULL;
+	lowrate_dac_stop(dac_out);
+}
 
-	return 0;
+static gboolean dac_status_update(gpointer data)
+{
+	struct lowrate_dac_stats stats;
+	gchar *text;
+
+	lowrate_dac_get_stats(dac_out, &stats);
+
+	switch (stats.mode) {
+	case LOWRATE_DAC_CYCLIC:
+		text = g_strdup("Output: cyclic buffer");
+		break;
+	case LOWRATE_DAC_STREAMING:
+		text = g_strdup_printf("Output: streaming, %llu blocks, CPU %.1f %%",
+				stats.blocks, stats.cpu_load);
+		break;
+	default:
+		text = g_strdup("Output: stopped");
+		break;
+	}
+
+	gtk_label_set_text(GTK_LABEL(dac_status), text);
+	g_free(text);
+
+	return TRUE;
 }
 
 static int FillSoftBuffer(int waveType, uint8_t *softBuffer)
@@ -201,7 +230,6 @@ static void generateWavePeriod(void)
 		buffer_size = 2;
 	else if (buffer_size > 10000)
 		buffer_size = 10000;
-	current_sample = 0;
 
 	soft_buffer_ch0 = g_renew(uint8_t, soft_buffer_ch0, buffer_size);
 
@@ -235,34 +263,6 @@ static void generateWavePeriod(void)
 	gtk_databox_set_total_limits(GTK_DATABOX(databox), -0.2, (i - 1), 3.5, -0.2);
 }
 
-static gboolean fillBuffer(void)
-{
-	unsigned int i;
-	uint8_t *buf;
-	int ret;
-
-	while (true) {
-		buf = iio_buffer_start(dac_buff);
-		for (i = 0; i < IIO_BUFFER_SIZE; i++) {
-			buf[i] = soft_buffer_ch0[current_sample];
-			current_sample++;
-			if (current_sample >= buffer_size)
-				current_sample = 0;
-		}
-
-		ret = iio_buffer_push(dac_buff);
-		if (ret < 0)
-			printf("Error occured while writing to buffer: %d\n", ret);
-	}
-
-	return TRUE;
-}
-
-static void startWaveGeneration(void)
-{
-	g_thread_new("fill_buffer_thread", (void *) &fillBuffer, NULL);
-}
-
 static void tx_update_values(void)
 {
 	iio_update_widgets(tx_widgets, num_tx);
@@ -278,12 +278,15 @@ static void rx_update_values(void)
 static void wave_param_changed(GtkRange *range, gpointer user_data)
 {
 	generateWavePeriod();
+
+	/* Keep a running waveform in sync with the controls */
+	if (dev_opened)
+		dev_opened = !buffer_open();
 }
 
 static void save_button_clicked(GtkButton *btn, gpointer data)
 {
 	if (dev_opened) {
-		g_source_remove(fill_buffer_function);
 		buffer_close();
 		dev_opened = false;
 	}
@@ -295,9 +298,9 @@ static void save_button_clicked(GtkButton *btn, gpointer data)
 			USE_INTERN_SAMPLING_FREQ);
 	} else if (gtk_toggle_button_get_active((GtkToggleButton *)radio_waveform)){
 		generateWavePeriod();
-		dev_opened = !buffer_open(buffer_size);
-		startWaveGeneration();
+		dev_opened = !buffer_open();
 	}
+	dac_status_update(NULL);
 }
 
 static GtkWidget * AD7303_init(GtkWidget *notebook, const char *ini_fn)
@@ -305,7 +308,7 @@ static GtkWidget * AD7303_init(GtkWidget *notebook, const char *ini_fn)
 	struct iio_channel *ch0, *ch1;
 	GtkBuilder *builder;
 	GtkWidget *AD7303_panel;
-	GtkWidget *table;
+	GtkWidget *table, *vbox;
 
 	ctx = osc_create_context();
 	if (!ctx)
@@ -368,10 +371,20 @@ static GtkWidget * AD7303_init(GtkWidget *notebook, const char *ini_fn)
 	/* Create a GtkDatabox widget */
 	gtk_databox_create_box_with_scrollbars_and_rulers(&databox, &table,
 						TRUE, TRUE, TRUE, TRUE);
-	gtk_container_add(GTK_CONTAINER(preview_graph), table);
+	vbox = gtk_vbox_new(FALSE, 4);
+	gtk_box_pack_start(GTK_BOX(vbox), table, TRUE, TRUE, 0);
+	gtk_container_add(GTK_CONTAINER(preview_graph), vbox);
 	gtk_widget_modify_bg(databox, GTK_STATE_NORMAL, &color_background);
 	gtk_widget_set_size_request(table, 450, 300);
 
+	dac_status = gtk_label_new(NULL);
+	gtk_misc_set_alignment(GTK_MISC(dac_status), 0.0, 0.5);
+	gtk_box_pack_start(GTK_BOX(vbox), dac_status, FALSE, FALSE, 0);
+
+	dac_out = lowrate_dac_new(dev, IIO_BUFFER_SIZE);
+	dac_status_update(NULL);
+	dac_status_timer = g_timeout_add_seconds(1, dac_status_update, NULL);
+
 	gtk_widget_show_all(AD7303_panel);
 
 	tx_update_values();
@@ -382,10 +395,10 @@ static GtkWidget * AD7303_init(GtkWidget *notebook, const char *ini_fn)
 
 static void context_destroy(const char *ini_fn)
 {
-	if (dac_buff) {
-		iio_buffer_destroy(dac_buff);
-		dac_buff = NULL;
-	}
+	if (dac_status_timer)
+		g_source_remove(dac_status_timer);
+	lowrate_dac_free(dac_out);
+	dac_out = NULL;
 
 	osc_destroy_context(ctx);
 	osc_destroy_context(thread_ctx);
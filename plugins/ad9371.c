@@ -1845,6 +1845,30 @@ static void context_destroy(const char *ini_fn)
 	osc_destroy_context(ctx);
 }
 
+/* Same hardware behind a new link: swap the handles, keep the panel */
+static void ad9371_reconnect(void)
+{
+	struct iio_context *new_ctx = osc_create_context();
+
+	g_source_remove_by_user_data(ctx);
+
+	dev = osc_device_rebind(new_ctx, dev);
+	dds = osc_device_rebind(new_ctx, dds);
+	cap = osc_device_rebind(new_ctx, cap);
+	udc_rx = osc_device_rebind(new_ctx, udc_rx);
+	udc_tx = osc_device_rebind(new_ctx, udc_tx);
+	cap_obs = osc_device_rebind(new_ctx, cap_obs);
+
+	iio_rebind_widgets(widgets, num_glb + num_tx + num_rx + num_obsrx, new_ctx);
+	if (dac_tx_manager)
+		dac_data_manager_reconnect(dac_tx_manager, new_ctx);
+
+	osc_destroy_context(ctx);
+	ctx = new_ctx;
+
+	g_timeout_add(1000, (GSourceFunc) update_display, ctx);
+}
+
 struct osc_plugin plugin;
 
 static bool ad9371_identify(void)
@@ -1869,5 +1893,6 @@ struct osc_plugin plugin = {
 	.get_preferred_size = ad9371_get_preferred_size,
 	.save_profile = save_profile,
 	.load_profile = load_profile,
+	.reconnect = ad9371_reconnect,
 	.destroy = context_destroy,
 };
@@ -30,6 +30,7 @@
 #include "../osc_plugin.h"
 #include "../config.h"
 #include "../iio_widget.h"
+#include "debug_attr_txn.h"
 #include "../datatypes.h"
 
 
@@ -38,6 +39,9 @@
 #define CAP_DEVICE "axi-ad9371-rx-hpc"
 #define THIS_DRIVER "AD9371 Advanced"
 
+/* Longest a reinitialization is expected to take */
+#define INIT_TIMEOUT_MS 2000
+
 #define ARRAY_SIZE(x) (sizeof(x)/sizeof(x[0]))
 
 static struct iio_context *ctx;
@@ -70,6 +74,9 @@ struct w_info {
 	const unsigned char lut_len;
 };
 
+static struct iio_attr_map *attr_map;
+static struct debug_txn *txn;
+
 static struct w_info attrs[] = {
 	{SPINBUTTON, "adi,jesd204-rx-framer-bank-id", NULL, 0},
 	{SPINBUTTON, "adi,jesd204-rx-framer-device-id", NULL, 0},
@@ -818,20 +825,42 @@ static void reload_settings(void)
 		plugin = node->data;
 		if (plugin && !strncmp(plugin->name, "ad9371", 12)) {
 			if (plugin->handle_external_request) {
-				g_usleep(1 * G_USEC_PER_SEC);
 				plugin->handle_external_request("Reload Settings");
 			}
 		}
 	}
 }
 
+static guint init_source;
+
+static void initialize_done(int ret, void *data)
+{
+	init_source = 0;
+
+	if (ret < 0)
+		fprintf(stderr, "Failed to initialize " PHY_DEVICE ": %s\n",
+				strerror(-ret));
+
+	reload_settings();
+}
+
+/* The device is back up in the background, the settings reload then */
+static void initialize_device(void)
+{
+	if (init_source)
+		return;
+
+	init_source = debug_txn_reinitialize(txn, "initialize", "ensm_mode",
+			INIT_TIMEOUT_MS, initialize_done, NULL);
+}
+
 static void signal_handler_cb (GtkWidget *widget, gpointer data)
 {
 	struct w_info *item = data;
 	long long val;
 	char str[80];
 	int bit, ret;
-	long long mask;
+	long long mask = DEBUG_TXN_ALL_BITS;
 
 	switch (item->type) {
 		case CHECKBOX:
@@ -843,12 +872,8 @@ static void signal_handler_cb (GtkWidget *widget, gpointer data)
 		case SPINBUTTON:
 			val = (long long) gtk_spin_button_get_value(GTK_SPIN_BUTTON (widget));
 
-			if (item->lut_len) {
-				iio_device_debug_attr_read_longlong(dev, item->name, &mask);
-				mask &= ~((1 << item->lut_len) - 1);
-				mask |= val & ((1 << item->lut_len) - 1);
-				val = mask;
-			}
+			if (item->lut_len)
+				mask = (1 << item->lut_len) - 1;
 			break;
 		case COMBOBOX:
 			val = gtk_combo_box_get_active(GTK_COMBO_BOX(widget));
@@ -864,25 +889,16 @@ static void signal_handler_cb (GtkWidget *widget, gpointer data)
 			if (ret != 2)
 				return;
 
-			iio_device_debug_attr_read_longlong(dev, str, &mask);
-
-			if (val) {
-				mask |= (1 << bit);
-			} else {
-				mask &= ~(1 << bit);
-			}
-			iio_device_debug_attr_write_longlong(dev, str, mask);
-
+			debug_txn_update(txn, str, 1LL << bit, val ? 1LL << bit : 0);
 			return;
 		default:
 			return;
 	}
 
-	iio_device_debug_attr_write_longlong(dev, item->name, val);
-
-	if (!strcmp(item->name, "initialize")) {
-		reload_settings();
-	}
+	if (!strcmp(item->name, "initialize"))
+		initialize_device();
+	else
+		debug_txn_update(txn, item->name, mask, val);
 }
 
 static void bist_tone_cb (GtkWidget *widget, gpointer data)
@@ -905,10 +921,10 @@ static void bist_tone_cb (GtkWidget *widget, gpointer data)
 	iio_device_debug_attr_write(dev, "bist_tone", temp);
 }
 
-static char * set_widget_value(GtkWidget *widget, struct w_info *item, long long val)
+static char * set_widget_value(GtkWidget *widget, struct w_info *item, int bit,
+		long long val)
 {
-	char str[80];
-	int bit, ret, i;
+	int i;
 	short val_s16;
 	char val_s8;
 
@@ -939,8 +955,7 @@ static char * set_widget_value(GtkWidget *widget, struct w_info *item, long long
 					gtk_combo_box_set_active(GTK_COMBO_BOX(widget), i);
 			return "changed";
 		case CHECKBOX_MASK:
-			ret = sscanf(item->name, "%[^'#']#%d", str, &bit);
-			if (ret != 2)
+			if (bit < 0)
 				break;
 			gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(widget), !!(val & (1 << bit)));
 			return "toggled";
@@ -949,42 +964,42 @@ static char * set_widget_value(GtkWidget *widget, struct w_info *item, long long
 
 	return NULL;
 }
-static void connect_widget(GtkBuilder *builder, struct w_info *item, long long val)
+static void connect_widget(GtkBuilder *builder, struct w_info *item, int bit,
+		long long val)
 {
 	char *signal = NULL;
 	GtkWidget *widget;
 	widget = GTK_WIDGET(gtk_builder_get_object(builder, item->name));
-	signal = set_widget_value(widget, item, val);
+	signal = set_widget_value(widget, item, bit, val);
 	g_builder_connect_signal(builder, item->name, signal,
 		G_CALLBACK(signal_handler_cb), item);
 }
 
-static void update_widget(GtkBuilder *builder, struct w_info *item, long long val)
+static void update_widget(GtkBuilder *builder, struct w_info *item, int bit,
+		long long val)
 {
 	GtkWidget *widget;
 
 	widget = GTK_WIDGET(gtk_builder_get_object(builder, item->name));
-	set_widget_value(widget, item, val);
+	set_widget_value(widget, item, bit, val);
 }
 
 static int __connect_widget(struct iio_device *dev, const char *attr,
 		const char *value, size_t len, void *d)
 {
-	unsigned int i, nb_items = ARRAY_SIZE(attrs);
+	const struct iio_attr_map_entry *entries;
 	GtkBuilder *builder = (GtkBuilder *) d;
-	char str[80];
-	int bit, ret;
+	unsigned int i, count;
+	long long val;
 
-	for (i = 0; i < nb_items; i++) {
-		ret = sscanf(attrs[i].name, "%[^'#']#%d", str, &bit);
-		if (!strcmp(str, attr)) {
-			connect_widget(builder, &attrs[i], atoll(value));
-			if (ret == 1 && attrs[i].lut_len == 0) {
-				return 0;
+	entries = iio_attr_map_lookup(attr_map, attr, &count);
+	if (!count)
+		return 0;
 
-			}
-		}
-	}
+	/* Pending changes win over what the device still holds */
+	val = debug_txn_seed(txn, attr, atoll(value));
+	for (i = 0; i < count; i++)
+		connect_widget(builder, entries[i].data, entries[i].bit, val);
 
 	return 0;
 }
@@ -992,28 +1007,34 @@ static int __connect_widget(struct iio_device *dev, const char *attr,
 static int __update_widget(struct iio_device *dev, const char *attr,
 		const char *value, size_t len, void *d)
 {
-	unsigned int i, nb_items = ARRAY_SIZE(attrs);
+	const struct iio_attr_map_entry *entries;
 	GtkBuilder *builder = (GtkBuilder *) d;
-	char str[80];
-	int bit, ret;
-
-	for (i = 0; i < nb_items; i++) {
+	unsigned int i, count;
+	long long val;
 
-		ret = sscanf(attrs[i].name, "%[^'#']#%d", str, &bit);
-		if (!strcmp(str, attr)) {
-			update_widget(builder, &attrs[i], atoll(value));
-			if (ret == 1 && attrs[i].lut_len == 0) {
-				return 0;
+	entries = iio_attr_map_lookup(attr_map, attr, &count);
+	if (!count)
+		return 0;
 
-			}
-		}
-	}
+	/* Pending changes win over what the device still holds */
+	val = debug_txn_seed(txn, attr, atoll(value));
+	for (i = 0; i < count; i++)
+		update_widget(builder, entries[i].data, entries[i].bit, val);
 
 	return 0;
 }
 
 static int connect_widgets(GtkBuilder *builder)
 {
+	unsigned int i;
+
+	/* Built once, refreshes then cost one lookup per attribute */
+	if (!attr_map) {
+		attr_map = iio_attr_map_new();
+		for (i = 0; i < ARRAY_SIZE(attrs); i++)
+			iio_attr_map_add(attr_map, attrs[i].name, &attrs[i]);
+	}
+
 	return iio_device_debug_attr_read_all(dev, __connect_widget, builder);
 }
 
@@ -1077,6 +1098,8 @@ static void load_profile(const char *ini_fn)
 	update_from_ini(ini_fn, THIS_DRIVER, dev,
 			ad9371_adv_sr_attribs,
 			ARRAY_SIZE(ad9371_adv_sr_attribs));
+	if (txn)
+		debug_txn_invalidate(txn);
 	if (can_update_widgets)
 		update_widgets(builder);
 
@@ -1091,6 +1114,7 @@ static GtkWidget * ad9371adv_init(GtkWidget *notebook, const char *ini_fn)
 		return NULL;
 
 	dev = iio_context_find_device(ctx, PHY_DEVICE);
+	txn = debug_txn_new(dev);
 
 	if (ini_fn)
 		load_profile(ini_fn);
@@ -1141,7 +1165,13 @@ static void update_active_page(gint active_page, gboolean is_detached)
 
 static void save_profile(const char *ini_fn)
 {
-	FILE *f = fopen(ini_fn, "a");
+	FILE *f;
+
+	/* save_to_ini() reads the device, staged changes must be in there */
+	if (txn)
+		debug_txn_commit(txn);
+
+	f = fopen(ini_fn, "a");
 	if (f) {
 		save_to_ini(f, THIS_DRIVER, dev, ad9371_adv_sr_attribs,
 				ARRAY_SIZE(ad9371_adv_sr_attribs));
@@ -1151,8 +1181,17 @@ static void save_profile(const char *ini_fn)
 
 static void context_destroy(const char *ini_fn)
 {
+	if (init_source) {
+		g_source_remove(init_source);
+		init_source = 0;
+	}
+
 	save_profile(ini_fn);
 	osc_destroy_context(ctx);
+	iio_attr_map_free(attr_map);
+	attr_map = NULL;
+	debug_txn_free(txn);
+	txn = NULL;
 }
 
 static bool ad9371adv_identify(void)
@@ -268,6 +268,21 @@ static void context_destroy(const char *ini_fn)
 	osc_destroy_context(ctx);
 }
 
+/* Same hardware behind a new link: swap the handles, keep the panel */
+static void ad9739a_reconnect(void)
+{
+	struct iio_context *new_ctx = osc_create_context();
+
+	dac = osc_device_rebind(new_ctx, dac);
+
+	iio_rebind_widgets(tx_widgets, num_tx, new_ctx);
+	if (dac_tx_manager)
+		dac_data_manager_reconnect(dac_tx_manager, new_ctx);
+
+	osc_destroy_context(ctx);
+	ctx = new_ctx;
+}
+
 static bool ad9739a_identify(void)
 {
 	/* Use the OSC's IIO context just to detect the devices */
@@ -282,5 +297,6 @@ struct osc_plugin plugin = {
 	.handle_item = ad9739a_handle,
 	.save_profile = save_profile,
 	.load_profile = load_profile,
+	.reconnect = ad9739a_reconnect,
 	.destroy = context_destroy,
 };
@@ -30,6 +30,7 @@
 #include "../osc_plugin.h"
 #include "../config.h"
 #include "../iio_widget.h"
+#include "debug_attr_txn.h"
 #include "../datatypes.h"
 
 #define PHY_DEVICE "adrv9009-phy"
@@ -37,6 +38,9 @@
 #define CAP_DEVICE "axi-adrv9009-rx-hpc"
 #define THIS_DRIVER "ADRV9009 Advanced"
 
+/* Longest a reinitialization is expected to take */
+#define INIT_TIMEOUT_MS 2000
+
 #define ARRAY_SIZE(x) (sizeof(x)/sizeof(x[0]))
 
 static struct iio_context *ctx;
@@ -64,6 +68,9 @@ struct w_info {
 	const unsigned char lut_len;
 };
 
+static struct iio_attr_map *attr_map;
+static struct debug_txn *txn;
+
 static struct w_info attrs[] = {
 	{SPINBUTTON, "adi,rxagc-peak-agc-under-range-low-interval_ns", NULL, 0},
 	{SPINBUTTON, "adi,rxagc-peak-agc-under-range-mid-interval", NULL, 0},
@@ -741,20 +748,42 @@ static void reload_settings(void)
 
 		if (plugin && !strncmp(plugin->name, "adrv9009", 12)) {
 			if (plugin->handle_external_request) {
-				g_usleep(1 * G_USEC_PER_SEC);
 				plugin->handle_external_request("Reload Settings");
 			}
 		}
 	}
 }
 
+static guint init_source;
+
+static void initialize_done(int ret, void *data)
+{
+	init_source = 0;
+
+	if (ret < 0)
+		fprintf(stderr, "Failed to initialize " PHY_DEVICE ": %s\n",
+				strerror(-ret));
+
+	reload_settings();
+}
+
+/* The device is back up in the background, the settings reload then */
+static void initialize_device(void)
+{
+	if (init_source)
+		return;
+
+	init_source = debug_txn_reinitialize(txn, "initialize", "ensm_mode",
+			INIT_TIMEOUT_MS, initialize_done, NULL);
+}
+
 static void signal_handler_cb(GtkWidget *widget, gpointer data)
 {
 	struct w_info *item = data;
 	long long val;
 	char str[80];
 	int bit, ret;
-	long long mask;
+	long long mask = DEBUG_TXN_ALL_BITS;
 
 	switch (item->type) {
 	case CHECKBOX:
@@ -768,12 +797,8 @@ static void signal_handler_cb(GtkWidget *widget, gpointer data)
 	case SPINBUTTON:
 		val = (long long) gtk_spin_button_get_value(GTK_SPIN_BUTTON(widget));
 
-		if (item->lut_len) {
-			iio_device_debug_attr_read_longlong(dev, item->name, &mask);
-			mask &= ~((1 << item->lut_len) - 1);
-			mask |= val & ((1 << item->lut_len) - 1);
-			val = mask;
-		}
+		if (item->lut_len)
+			mask = (1 << item->lut_len) - 1;
 
 		break;
 
@@ -793,27 +818,17 @@ static void signal_handler_cb(GtkWidget *widget, gpointer data)
 		if (ret != 2)
 			return;
 
-		iio_device_debug_attr_read_longlong(dev, str, &mask);
-
-		if (val) {
-			mask |= (1 << bit);
-		} else {
-			mask &= ~(1 << bit);
-		}
-
-		iio_device_debug_attr_write_longlong(dev, str, mask);
-
+		debug_txn_update(txn, str, 1LL << bit, val ? 1LL << bit : 0);
 		return;
 
 	default:
 		return;
 	}
 
-	iio_device_debug_attr_write_longlong(dev, item->name, val);
-
-	if (!strcmp(item->name, "initialize")) {
-		reload_settings();
-	}
+	if (!strcmp(item->name, "initialize"))
+		initialize_device();
+	else
+		debug_txn_update(txn, item->name, mask, val);
 }
 
 static void bist_tone_cb(GtkWidget *widget, gpointer data)
@@ -836,10 +851,10 @@ static void bist_tone_cb(GtkWidget *widget, gpointer data)
 	iio_device_debug_attr_write(dev, "bist_tone", temp);
 }
 
-static char *set_widget_value(GtkWidget *widget, struct w_info *item, long long val)
+static char *set_widget_value(GtkWidget *widget, struct w_info *item, int bit,
+                              long long val)
 {
-	char str[80];
-	int bit, ret, i;
+	int i;
 	short val_s16;
 	char val_s8;
 
@@ -877,9 +892,7 @@ static char *set_widget_value(GtkWidget *widget, struct w_info *item, long long
 		return "changed";
 
 	case CHECKBOX_MASK:
-		ret = sscanf(item->name, "%[^'#']#%d", str, &bit);
-
-		if (ret != 2)
+		if (bit < 0)
 			break;
 
 		gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(widget), !!(val & (1 << bit)));
@@ -889,44 +902,42 @@ static char *set_widget_value(GtkWidget *widget, struct w_info *item, long long
 
 	return NULL;
 }
-static void connect_widget(GtkBuilder *builder, struct w_info *item, long long val)
+static void connect_widget(GtkBuilder *builder, struct w_info *item, int bit,
+                           long long val)
 {
 	char *signal = NULL;
 	GtkWidget *widget;
 	widget = GTK_WIDGET(gtk_builder_get_object(builder, item->name));
-	signal = set_widget_value(widget, item, val);
+	signal = set_widget_value(widget, item, bit, val);
 	g_builder_connect_signal(builder, item->name, signal,
 	                         G_CALLBACK(signal_handler_cb), item);
 }
 
-static void update_widget(GtkBuilder *builder, struct w_info *item, long long val)
+static void update_widget(GtkBuilder *builder, struct w_info *item, int bit,
+                          long long val)
 {
 	GtkWidget *widget;
 
 	widget = GTK_WIDGET(gtk_builder_get_object(builder, item->name));
-	set_widget_value(widget, item, val);
+	set_widget_value(widget, item, bit, val);
 }
 
 static int __connect_widget(struct iio_device *dev, const char *attr,
                             const char *value, size_t len, void *d)
 {
-	unsigned int i, nb_items = ARRAY_SIZE(attrs);
+	const struct iio_attr_map_entry *entries;
 	GtkBuilder *builder = (GtkBuilder *) d;
-	char str[80];
-	int bit, ret;
-
-	for (i = 0; i < nb_items; i++) {
-		ret = sscanf(attrs[i].name, "%[^'#']#%d", str, &bit);
+	unsigned int i, count;
+	long long val;
 
-		if (!strcmp(str, attr)) {
-			connect_widget(builder, &attrs[i], atoll(value));
+	entries = iio_attr_map_lookup(attr_map, attr, &count);
+	if (!count)
+		return 0;
 
-			if (ret == 1 && attrs[i].lut_len == 0) {
-				return 0;
-
-			}
-		}
-	}
+	/* Pending changes win over what the device still holds */
+	val = debug_txn_seed(txn, attr, atoll(value));
+	for (i = 0; i < count; i++)
+		connect_widget(builder, entries[i].data, entries[i].bit, val);
 
 	return 0;
 }
@@ -934,30 +945,34 @@ static int __connect_widget(struct iio_device *dev, const char *attr,
 static int __update_widget(struct iio_device *dev, const char *attr,
                            const char *value, size_t len, void *d)
 {
-	unsigned int i, nb_items = ARRAY_SIZE(attrs);
+	const struct iio_attr_map_entry *entries;
 	GtkBuilder *builder = (GtkBuilder *) d;
-	char str[80];
-	int bit, ret;
-
-	for (i = 0; i < nb_items; i++) {
-
-		ret = sscanf(attrs[i].name, "%[^'#']#%d", str, &bit);
+	unsigned int i, count;
+	long long val;
 
-		if (!strcmp(str, attr)) {
-			update_widget(builder, &attrs[i], atoll(value));
+	entries = iio_attr_map_lookup(attr_map, attr, &count);
+	if (!count)
+		return 0;
 
-			if (ret == 1 && attrs[i].lut_len == 0) {
-				return 0;
-
-			}
-		}
-	}
+	/* Pending changes win over what the device still holds */
+	val = debug_txn_seed(txn, attr, atoll(value));
+	for (i = 0; i < count; i++)
+		update_widget(builder, entries[i].data, entries[i].bit, val);
 
 	return 0;
 }
 
 static int connect_widgets(GtkBuilder *builder)
 {
+	unsigned int i;
+
+	/* Built once, refreshes then cost one lookup per attribute */
+	if (!attr_map) {
+		attr_map = iio_attr_map_new();
+		for (i = 0; i < ARRAY_SIZE(attrs); i++)
+			iio_attr_map_add(attr_map, attrs[i].name, &attrs[i]);
+	}
+
 	return iio_device_debug_attr_read_all(dev, __connect_widget, builder);
 }
 
@@ -1026,6 +1041,9 @@ static void load_profile(const char *ini_fn)
 	                adrv9009_adv_sr_attribs,
 	                ARRAY_SIZE(adrv9009_adv_sr_attribs));
 
+	if (txn)
+		debug_txn_invalidate(txn);
+
 	if (can_update_widgets)
 		update_widgets(builder);
 
@@ -1041,6 +1059,7 @@ static GtkWidget *adrv9009adv_init(GtkWidget *notebook, const char *ini_fn)
 		return NULL;
 
 	dev = iio_context_find_device(ctx, PHY_DEVICE);
+	txn = debug_txn_new(dev);
 
 	if (ini_fn)
 		load_profile(ini_fn);
@@ -1081,7 +1100,13 @@ static void update_active_page(gint active_page, gboolean is_detached)
 
 static void save_profile(const char *ini_fn)
 {
-	FILE *f = fopen(ini_fn, "a");
+	FILE *f;
+
+	/* save_to_ini() reads the device, staged changes must be in there */
+	if (txn)
+		debug_txn_commit(txn);
+
+	f = fopen(ini_fn, "a");
 
 	if (f) {
 		save_to_ini(f, THIS_DRIVER, dev, adrv9009_adv_sr_attribs,
@@ -1092,8 +1117,17 @@ static void save_profile(const char *ini_fn)
 
 static void context_destroy(const char *ini_fn)
 {
+	if (init_source) {
+		g_source_remove(init_source);
+		init_source = 0;
+	}
+
 	save_profile(ini_fn);
 	osc_destroy_context(ctx);
+	iio_attr_map_free(attr_map);
+	attr_map = NULL;
+	debug_txn_free(txn);
+	txn = NULL;
 }
 
 static bool adrv9009adv_identify(void)
@@ -4,12 +4,15 @@
 #include <errno.h>
 #include <math.h>
 #include <ctype.h>
+#include <float.h>
 #include <sys/stat.h>
 #ifdef __linux__
 #include <sys/utsname.h>
 #endif
 #include <matio.h>
 #include <unistd.h>
+#include <complex.h>
+#include <fftw3.h>
 
 #include "dac_data_manager.h"
 #include "../iio_widget.h"
@@ -113,8 +116,28 @@ struct dac_buffer {
 	GtkWidget *tx_channels_view;
 	GtkWidget *scale;
 	GtkTextBuffer *load_status_buf;
+
+	GtkWidget *synth_type;
+	GtkWidget *synth_length;
+	GtkWidget *synth_center;
+	GtkWidget *synth_bandwidth;
+	GtkWidget *synth_tones;
+	GtkWidget *synth_crest;
+};
+
+/* A waveform file converted to the DAC native layout */
+struct waveform {
+	char *key;
+	char *buf;
+	int size;
+	time_t mtime;
+	off_t file_size;
+	guint64 last_use;
 };
 
+/* Upper bound of the memory kept by the waveform library */
+#define WAVEFORMS_MAX_SIZE (256 * 1024 * 1024)
+
 struct dac_data_manager {
 	struct dds_dac dac1;
 	struct dds_dac dac2;
@@ -132,6 +155,16 @@ struct dac_data_manager {
 	struct iio_buffer *dds_buffer;
 	bool is_local;
 
+	/* Converted waveforms, see waveform_get() */
+	GHashTable *waveforms;
+	size_t waveforms_size;
+	guint64 waveforms_tick;
+	struct waveform *active_waveform;
+
+	unsigned switch_count;
+	double switch_total_ms;
+	double switch_max_ms;
+
 	GtkWidget *container;
 };
 
@@ -662,23 +695,38 @@ static void enable_dds(struct dac_data_manager *manager, bool on_off)
 	}
 }
 
-static int process_dac_buffer_file (struct dac_data_manager *manager, const char *file_name, char **stat_msg)
+static void waveform_free(struct waveform *wf)
 {
-	int ret, size = 0, s_size;
-	double scale;
-	/*
-	struct stat st;
-	*/
-	char *buf = NULL, *tmp;
-	/*
-	FILE *infile;
-	*/
-	unsigned int buffer_channels = 0;
+	free(wf->buf);
+	g_free(wf->key);
+	g_free(wf);
+}
 
-	if (manager->dds_buffer) {
-		iio_buffer_destroy(manager->dds_buffer);
-		manager->dds_buffer = NULL;
+static void waveforms_evict(struct dac_data_manager *manager, size_t needed)
+{
+	GHashTableIter iter;
+	struct waveform *wf, *oldest;
+
+	while (manager->waveforms_size + needed > WAVEFORMS_MAX_SIZE) {
+		oldest = NULL;
+		g_hash_table_iter_init(&iter, manager->waveforms);
+		while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &wf)) {
+			if (wf == manager->active_waveform)
+				continue;
+			if (!oldest || wf->last_use < oldest->last_use)
+				oldest = wf;
+		}
+		if (!oldest)
+			break;
+
+		manager->waveforms_size -= oldest->size;
+		g_hash_table_remove(manager->waveforms, oldest->key);
 	}
+}
+
+static unsigned waveform_buffer_channels(struct dac_data_manager *manager)
+{
+	GtkTreeView *tx_view = GTK_TREE_VIEW(manager->dac_buffer_module.tx_channels_view);
 
 	if (manager->is_local) {
 #ifdef __linux__
@@ -689,88 +737,249 @@ static int process_dac_buffer_file (struct dac_data_manager *manager, const char
 		sscanf(uts.release, "%u.%u", &major, &minor);
 		if (major < 2 || (major == 3 && minor < 14)) {
 			if (manager->dacs_count == 2)
-				buffer_channels = 8;
+				return 8;
 			else if (manager->dac1.tx_count == 2)
-				buffer_channels = 4;
+				return 4;
 			else
-				buffer_channels = 2;
-		} else {
-			buffer_channels = tx_enabled_channels_count(GTK_TREE_VIEW(manager->dac_buffer_module.tx_channels_view), NULL);
+				return 2;
 		}
+#else
+		return 0;
 #endif
-	} else {
-		buffer_channels = tx_enabled_channels_count(GTK_TREE_VIEW(manager->dac_buffer_module.tx_channels_view), NULL);
 	}
 
+	return tx_enabled_channels_count(tx_view, NULL);
+}
+
+/* Everything the DAC native layout of a waveform depends on */
+static char * waveform_key(struct dac_data_manager *manager,
+		const char *name, double scale)
+{
+	unsigned mask;
+
+	tx_enabled_channels_count(GTK_TREE_VIEW(manager->dac_buffer_module.tx_channels_view), &mask);
+
+	return g_strdup_printf("%s|%u|%x|%u|%.9f|%.3f", name,
+			waveform_buffer_channels(manager), mask,
+			manager->alignment, scale,
+			dac_offset_get_value(manager->dac1.iio_dac));
+}
+
+static struct waveform * waveform_lookup(struct dac_data_manager *manager,
+		const char *key, time_t mtime, off_t file_size)
+{
+	struct waveform *wf = g_hash_table_lookup(manager->waveforms, key);
+
+	if (!wf || wf->mtime != mtime || wf->file_size != file_size)
+		return NULL;
+
+	wf->last_use = ++manager->waveforms_tick;
+	return wf;
+}
+
+/* Takes ownership of 'key' and 'buf' */
+static struct waveform * waveform_store(struct dac_data_manager *manager,
+		char *key, char *buf, int size, time_t mtime, off_t file_size)
+{
+	struct waveform *wf = g_hash_table_lookup(manager->waveforms, key);
+
+	/* Replaces a conversion of an older version of the file */
+	if (wf) {
+		if (wf == manager->active_waveform)
+			manager->active_waveform = NULL;
+		manager->waveforms_size -= wf->size;
+		g_hash_table_remove(manager->waveforms, wf->key);
+	}
+	waveforms_evict(manager, size);
+
+	wf = g_new0(struct waveform, 1);
+	wf->key = key;
+	wf->buf = buf;
+	wf->size = size;
+	wf->mtime = mtime;
+	wf->file_size = file_size;
+	wf->last_use = ++manager->waveforms_tick;
+	g_hash_table_insert(manager->waveforms, key, wf);
+	manager->waveforms_size += size;
+
+	return wf;
+}
+
+/*
+ * Returns the waveform converted for the current scale, channel selection
+ * and alignment. Conversions are kept in RAM, keyed by all of these, so
+ * switching back to a waveform that was used (or preloaded) before only
+ * costs the buffer swap. Files modified on disk are converted again.
+ */
+static struct waveform * waveform_get(struct dac_data_manager *manager,
+		const char *file_name, char **stat_msg, bool *cached)
+{
+	struct waveform *wf;
+	struct stat st;
+	double scale = 0.0;
+	char *key, *buf = NULL;
+	int ret, size = 0;
+
+	if (stat(file_name, &st) < 0) {
+		ret = -errno;
+		if (stat_msg)
+			*stat_msg = g_strdup_printf("Error while parsing file: %s.", strerror(-ret));
+		return NULL;
+	}
+
+	if (!g_str_has_suffix(file_name, ".bin"))
+		scale = db_full_scale_convert(gtk_spin_button_get_value(GTK_SPIN_BUTTON(manager->dac_buffer_module.scale)), false);
+
+	key = waveform_key(manager, file_name, scale);
+	wf = waveform_lookup(manager, key, st.st_mtime, st.st_size);
+	*cached = !!wf;
+	if (wf) {
+		g_free(key);
+		return wf;
+	}
 
 	if (g_str_has_suffix(file_name, ".bin")) {
 		FILE *infile;
-		struct stat st;
 
 		/* Assume Binary format */
-		stat(file_name, &st);
 		buf = malloc(st.st_size);
 		if (buf == NULL) {
 			if (stat_msg)
 				*stat_msg = g_strdup_printf("Internal memory allocation failed.");
-			return -errno;
+			g_free(key);
+			return NULL;
 		}
 		infile = fopen(file_name, "r");
+		if (!infile) {
+			ret = -errno;
+			if (stat_msg)
+				*stat_msg = g_strdup_printf("Error while opening file: %s.", strerror(-ret));
+			free(buf);
+			g_free(key);
+			return NULL;
+		}
 		size = fread(buf, 1, st.st_size, infile);
 		fclose(infile);
+		if (size != st.st_size) {
+			/* Changed or truncated while it was read */
+			if (stat_msg)
+				*stat_msg = g_strdup_printf("Error while reading file: got %d of %lld bytes.",
+						size, (long long) st.st_size);
+			free(buf);
+			g_free(key);
+			return NULL;
+		}
 	} else {
-
-		scale = db_full_scale_convert(gtk_spin_button_get_value(GTK_SPIN_BUTTON(manager->dac_buffer_module.scale)), false);
-		ret = analyse_wavefile(manager, file_name, &buf, &size, buffer_channels, scale);
+		ret = analyse_wavefile(manager, file_name, &buf, &size,
+				waveform_buffer_channels(manager), scale);
 		if (ret < 0) {
 			if (stat_msg)
 				*stat_msg = g_strdup_printf("Error while parsing file: %s.", strerror(-ret));
-			return ret;
+			g_free(key);
+			return NULL;
 		} else if (ret > 0) {
 			if (stat_msg)
 				*stat_msg = g_strdup_printf("Invalid data format");
-			return -EINVAL;
+			free(buf);
+			g_free(key);
+			return NULL;
 		}
 	}
 
+	return waveform_store(manager, key, buf, size, st.st_mtime, st.st_size);
+}
+
+/* Swaps the cyclic buffer over to 'wf'. Returns the length of the output
+ * gap in ms, or a negative error code. */
+static double waveform_play(struct dac_data_manager *manager,
+		struct waveform *wf, char **stat_msg)
+{
+	struct iio_device *dac = manager->dac_buffer_module.dac_with_scanelems;
+	gint64 start;
+	double elapsed;
+	int s_size;
+
+	/* Only the buffer swap is in the output gap */
+	start = g_get_monotonic_time();
+
+	if (manager->dds_buffer) {
+		iio_buffer_destroy(manager->dds_buffer);
+		manager->dds_buffer = NULL;
+	}
+	manager->active_waveform = NULL;
+
 	usleep(1000); /* FIXME: Temp Workaround needs some investigation */
 
 	enable_dds(manager, false);
 	enable_dds_channels(&manager->dac_buffer_module);
 
-	struct iio_device *dac = manager->dac_buffer_module.dac_with_scanelems;
-
 	s_size = iio_device_get_sample_size(dac);
 	if (!s_size) {
 		fprintf(stderr, "Unable to create buffer due to sample size");
 		if (stat_msg)
 			*stat_msg = g_strdup_printf("Unable to create buffer due to sample size");
-		free(buf);
 		return -EINVAL;
 	}
 
-	if (size % manager->alignment != 0 || size % s_size != 0) {
+	if (wf->size % manager->alignment != 0 || wf->size % s_size != 0) {
 		fprintf(stderr, "Unable to create buffer due to sample size and number of samples");
 		if (stat_msg)
 			*stat_msg = g_strdup_printf("Unable to create buffer due to sample size and number of samples");
-		free(buf);
 		return -EINVAL;
 	}
 
-	manager->dds_buffer = iio_device_create_buffer(dac, size / s_size, true);
+	manager->dds_buffer = iio_device_create_buffer(dac, wf->size / s_size, true);
 	if (!manager->dds_buffer) {
 		fprintf(stderr, "Unable to create buffer: %s\n", strerror(errno));
 		if (stat_msg)
 			*stat_msg = g_strdup_printf("Unable to create iio buffer: %s", strerror(errno));
-		free(buf);
 		return -errno;
 	}
 
-	memcpy(iio_buffer_start(manager->dds_buffer), buf,
+	memcpy(iio_buffer_start(manager->dds_buffer), wf->buf,
 			iio_buffer_end(manager->dds_buffer) - iio_buffer_start(manager->dds_buffer));
 
 	iio_buffer_push(manager->dds_buffer);
-	free(buf);
+	manager->active_waveform = wf;
+
+	elapsed = (g_get_monotonic_time() - start) / 1000.0;
+	manager->switch_count++;
+	manager->switch_total_ms += elapsed;
+	if (elapsed > manager->switch_max_ms)
+		manager->switch_max_ms = elapsed;
+
+	return elapsed;
+}
+
+static char * waveform_switch_summary(struct dac_data_manager *manager,
+		double elapsed)
+{
+	return g_strdup_printf("Switched in %.2f ms (avg %.2f ms, max %.2f ms over %u switches).",
+			elapsed, manager->switch_total_ms / manager->switch_count,
+			manager->switch_max_ms, manager->switch_count);
+}
+
+static int process_dac_buffer_file (struct dac_data_manager *manager, const char *file_name, char **stat_msg)
+{
+	struct waveform *wf;
+	double elapsed;
+	bool cached;
+	char *tmp;
+
+	/* Convert while the previous waveform keeps playing */
+	wf = waveform_get(manager, file_name, stat_msg, &cached);
+	if (!wf)
+		return -EINVAL;
+
+	if (wf == manager->active_waveform && manager->dds_buffer) {
+		if (stat_msg)
+			*stat_msg = g_strdup_printf("Waveform already loaded.");
+		return 0;
+	}
+
+	elapsed = waveform_play(manager, wf, stat_msg);
+	if (elapsed < 0)
+		return (int) elapsed;
 
 	tmp = strdup(file_name);
 
@@ -779,12 +988,473 @@ static int process_dac_buffer_file (struct dac_data_manager *manager, const char
 
 	manager->dac_buffer_module.dac_buf_filename = tmp;
 
-	if (stat_msg)
-		*stat_msg = g_strdup_printf("Waveform loaded successfully.");
+	if (stat_msg) {
+		tmp = waveform_switch_summary(manager, elapsed);
+		*stat_msg = g_strdup_printf("Waveform loaded successfully%s.\n%s",
+				cached ? " from memory" : "", tmp);
+		g_free(tmp);
+	}
+
+	return 0;
+}
+
+/*
+ * Test signal synthesizer. Signals are built for exactly one period of the
+ * cyclic buffer: every frequency is snapped to an FFT bin of the buffer
+ * length, so the output wraps around without a discontinuity. Everything
+ * except the chirp is composed in the frequency domain and brought to the
+ * time domain with a single FFTW transform.
+ */
+enum synth_type {
+	SYNTH_MULTITONE,
+	SYNTH_CHIRP,
+	SYNTH_NOISE,
+	SYNTH_QPSK,
+	SYNTH_QAM16,
+	SYNTH_OFDM,
+};
+
+static const char * const synth_type_names[] = {
+	[SYNTH_MULTITONE] = "Multi-tone",
+	[SYNTH_CHIRP] = "Chirp",
+	[SYNTH_NOISE] = "Noise",
+	[SYNTH_QPSK] = "QPSK",
+	[SYNTH_QAM16] = "16-QAM",
+	[SYNTH_OFDM] = "OFDM",
+};
+
+struct synth_params {
+	enum synth_type type;
+	unsigned length;	/* samples, rounded up to a valid buffer size */
+	double sample_rate;	/* Hz */
+	double center;		/* Hz */
+	double bandwidth;	/* Hz; tone span, sweep span or symbol rate */
+	unsigned tones;
+	double crest_factor;	/* dB, 0 leaves the signal as generated */
+};
+
+#define SYNTH_RRC_ROLLOFF 0.35
+#define SYNTH_CREST_ITERATIONS 8
+
+static unsigned synth_gcd(unsigned a, unsigned b)
+{
+	while (b) {
+		unsigned t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+static long synth_bin(double freq, double sample_rate, unsigned n)
+{
+	long bin = lround(freq * n / sample_rate);
+
+	return ((bin % (long) n) + n) % n;
+}
+
+/* PRBS15, x^15 + x^14 + 1 */
+static unsigned synth_prbs(unsigned *state)
+{
+	unsigned bit = ((*state >> 14) ^ (*state >> 13)) & 1;
+
+	*state = ((*state << 1) | bit) & 0x7fff;
+	return bit;
+}
+
+static double complex synth_symbol(enum synth_type type, unsigned *prbs)
+{
+	static const double qam16_levels[] = { -3.0, -1.0, 3.0, 1.0 };
+	unsigned b0, b1;
+
+	if (type != SYNTH_QAM16) {
+		b0 = synth_prbs(prbs);
+		b1 = synth_prbs(prbs);
+		return ((1.0 - 2.0 * b0) + I * (1.0 - 2.0 * b1)) / sqrt(2.0);
+	}
+
+	b0 = synth_prbs(prbs) << 1;
+	b0 |= synth_prbs(prbs);
+	b1 = synth_prbs(prbs) << 1;
+	b1 |= synth_prbs(prbs);
+	return (qam16_levels[b0] + I * qam16_levels[b1]) / sqrt(10.0);
+}
+
+/* Root raised cosine, 'f' in units of the symbol rate */
+static double synth_rrc(double f)
+{
+	double a = SYNTH_RRC_ROLLOFF;
+
+	f = fabs(f);
+	if (f <= (1.0 - a) / 2)
+		return 1.0;
+	if (f > (1.0 + a) / 2)
+		return 0.0;
+
+	return sqrt(0.5 * (1.0 + cos(M_PI / a * (f - (1.0 - a) / 2))));
+}
+
+static unsigned synth_samples_per_symbol(const struct synth_params *prm)
+{
+	long sps = lround(prm->sample_rate / prm->bandwidth);
+
+	return sps < 2 ? 2 : sps;
+}
+
+/* Smallest length >= the requested one that fills whole buffer words
+ * and, for the modulations, whole symbols */
+static unsigned synth_length(const struct synth_params *prm,
+		unsigned tx_channels, unsigned alignment)
+{
+	unsigned bytes = tx_channels * 2;
+	unsigned step = alignment / synth_gcd(alignment, bytes);
+
+	if (prm->type == SYNTH_QPSK || prm->type == SYNTH_QAM16) {
+		unsigned sps = synth_samples_per_symbol(prm);
+
+		step = step / synth_gcd(step, sps) * sps;
+	}
+
+	return (prm->length + step - 1) / step * step;
+}
+
+/* Iterative clipping and filtering: clip to the target peak, then remove
+ * what the clipping spread outside of the occupied bins */
+static void synth_limit_crest(fftw_complex *x, const bool *band, unsigned n,
+		double crest_db, fftw_plan fwd, fftw_plan inv)
+{
+	unsigned i, iter, clipped;
+	double power, limit, mag;
+
+	for (iter = 0; iter < SYNTH_CREST_ITERATIONS; iter++) {
+		power = 0.0;
+		for (i = 0; i < n; i++)
+			power += creal(x[i]) * creal(x[i]) + cimag(x[i]) * cimag(x[i]);
+		limit = sqrt(power / n) * pow(10.0, crest_db / 20.0);
+
+		clipped = 0;
+		for (i = 0; i < n; i++) {
+			mag = cabs(x[i]);
+			if (mag > limit) {
+				x[i] *= limit / mag;
+				clipped++;
+			}
+		}
+		if (!clipped)
+			break;
+
+		fftw_execute(fwd);
+		for (i = 0; i < n; i++)
+			x[i] = band[i] ? x[i] / n : 0.0;
+		fftw_execute(inv);
+	}
+}
+
+static void synth_chirp(const struct synth_params *prm, fftw_complex *x,
+		bool *band, unsigned n)
+{
+	long span = lround(prm->bandwidth * n / prm->sample_rate / 2) * 2;
+	long first = lround(prm->center * n / prm->sample_rate) - span / 2;
+	unsigned i;
+	double t;
+
+	/* The phase advances by (first + span / 2) whole cycles per buffer */
+	for (i = 0; i < n; i++) {
+		t = (double) i / n;
+		x[i] = cexp(I * 2 * M_PI * (first * t + span * t * t / 2));
+	}
+
+	for (i = 0; i <= (unsigned) span; i++)
+		band[((first + (long) i) % (long) n + n) % n] = true;
+}
+
+/* Fills the spectrum of one buffer period */
+static void synth_spectrum(const struct synth_params *prm, fftw_complex *x,
+		bool *band, unsigned n, fftw_plan fwd)
+{
+	long center = synth_bin(prm->center, prm->sample_rate, n);
+	long half = lround(prm->bandwidth * n / prm->sample_rate / 2);
+	unsigned prbs = 0x7fff, i, k, sps;
+	GRand *rand;
+	long b;
+
+	memset(x, 0, sizeof(*x) * n);
+
+	switch (prm->type) {
+	case SYNTH_MULTITONE:
+		/* Schroeder phases keep the crest factor of the sum low */
+		for (k = 0; k < prm->tones; k++) {
+			double f = prm->center;
+
+			if (prm->tones > 1)
+				f += prm->bandwidth * ((double) k / (prm->tones - 1) - 0.5);
+			b = synth_bin(f, prm->sample_rate, n);
+			x[b] += cexp(-I * M_PI * k * k / prm->tones);
+			band[b] = true;
+		}
+		break;
+	case SYNTH_NOISE:
+		rand = g_rand_new_with_seed(1);
+		for (b = -half; b <= half; b++) {
+			double u1 = g_rand_double_range(rand, DBL_MIN, 1.0);
+			double u2 = g_rand_double(rand);
+			k = ((center + b) % (long) n + n) % n;
+
+			x[k] = sqrt(-2.0 * log(u1)) * cexp(I * 2 * M_PI * u2);
+			band[k] = true;
+		}
+		g_rand_free(rand);
+		break;
+	case SYNTH_OFDM:
+		for (b = -half; b <= half; b++) {
+			if (!b)
+				continue; /* no DC subcarrier */
+			k = ((center + b) % (long) n + n) % n;
+			x[k] = synth_symbol(SYNTH_QPSK, &prbs);
+			band[k] = true;
+		}
+		break;
+	case SYNTH_QPSK:
+	case SYNTH_QAM16:
+		/* Symbol impulses, shaped by an RRC response applied on their
+		 * spectrum, which also makes the filtering circular */
+		sps = synth_samples_per_symbol(prm);
+		for (i = 0; i < n; i += sps)
+			x[i] = synth_symbol(prm->type, &prbs);
+		fftw_execute(fwd);
+
+		for (i = 0; i < n; i++) {
+			double f = (i <= n / 2 ? (double) i : (double) i - n) * sps / n;
+			double h = synth_rrc(f);
+
+			x[i] *= h;
+			band[i] = h > 0.0;
+		}
+
+		/* Move it to the carrier */
+		if (center) {
+			fftw_complex *tmp = fftw_malloc(sizeof(*tmp) * n);
+			bool *btmp = g_new(bool, n);
+
+			for (i = 0; i < n; i++) {
+				tmp[(i + center) % n] = x[i];
+				btmp[(i + center) % n] = band[i];
+			}
+			memcpy(x, tmp, sizeof(*x) * n);
+			memcpy(band, btmp, sizeof(*band) * n);
+			fftw_free(tmp);
+			g_free(btmp);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/* Same layout as analyse_wavefile(): every TX gets the same I/Q stream */
+static char * synth_pack(const fftw_complex *x, unsigned n,
+		unsigned tx_channels, double scale, double offset, int *size)
+{
+	unsigned long long *sample;
+	unsigned int *sample_32;
+	unsigned short *sample_16;
+	unsigned long long word;
+	unsigned i, j;
+	char *buf;
+
+	if (tx_channels != 1 && tx_channels != 2 &&
+			tx_channels != 4 && tx_channels != 8)
+		return NULL;
+
+	*size = n * tx_channels * 2;
+	buf = malloc(*size);
+	if (!buf)
+		return NULL;
+
+	sample = (unsigned long long *) buf;
+	sample_32 = (unsigned int *) buf;
+	sample_16 = (unsigned short *) buf;
+
+	for (i = 0, j = 0; i < n; i++) {
+		float re = creal(x[i]), im = cimag(x[i]);
+
+		switch (tx_channels) {
+		case 1:
+			sample_16[i] = convert(scale, re, offset);
+			break;
+		case 2:
+			sample_32[i] = ((unsigned int) convert(scale, im, offset) << 16) |
+				((unsigned int) convert(scale, re, offset) << 0);
+			break;
+		default:
+			word = (unsigned long long) (((unsigned int) convert(scale, im, offset) << 16) |
+				((unsigned int) convert(scale, re, offset) << 0));
+			sample[j++] = (word << 32) | word;
+			if (tx_channels == 8)
+				sample[j++] = (word << 32) | word;
+			break;
+		}
+	}
+
+	return buf;
+}
+
+static int synth_generate(struct dac_data_manager *manager,
+		struct synth_params *prm, char **stat_msg)
+{
+	unsigned tx_channels = waveform_buffer_channels(manager);
+	fftw_plan fwd, inv;
+	fftw_complex *x;
+	struct waveform *wf;
+	double scale, peak, power, crest = 0.0, generation = 0.0, elapsed;
+	char *name, *key, *buf, *tmp;
+	gint64 start;
+	bool *band, generated = false;
+	unsigned i, n;
+	int size;
+
+	if (prm->sample_rate <= 0.0 || prm->bandwidth <= 0.0) {
+		*stat_msg = g_strdup_printf("Invalid sample rate or bandwidth.");
+		return -EINVAL;
+	}
+	if (!tx_channels) {
+		*stat_msg = g_strdup_printf("Invalid channel selection.");
+		return -EINVAL;
+	}
+
+	n = synth_length(prm, tx_channels, manager->alignment);
+	scale = db_full_scale_convert(gtk_spin_button_get_value(GTK_SPIN_BUTTON(manager->dac_buffer_module.scale)), false);
+
+	name = g_strdup_printf("synth:%s:%u:%.0f:%.0f:%.0f:%u:%.2f",
+			synth_type_names[prm->type], n, prm->sample_rate,
+			prm->center, prm->bandwidth, prm->tones, prm->crest_factor);
+	key = waveform_key(manager, name, scale);
+	g_free(name);
+
+	wf = waveform_lookup(manager, key, 0, 0);
+	if (wf) {
+		g_free(key);
+		if (wf == manager->active_waveform && manager->dds_buffer) {
+			*stat_msg = g_strdup_printf("Waveform already loaded.");
+			return 0;
+		}
+	} else {
+		start = g_get_monotonic_time();
+
+		x = fftw_malloc(sizeof(*x) * n);
+		band = g_new0(bool, n);
+		if (!x || !band) {
+			fftw_free(x);
+			g_free(band);
+			g_free(key);
+			*stat_msg = g_strdup_printf("Internal memory allocation failed.");
+			return -ENOMEM;
+		}
+		fwd = fftw_plan_dft_1d(n, x, x, FFTW_FORWARD, FFTW_ESTIMATE);
+		inv = fftw_plan_dft_1d(n, x, x, FFTW_BACKWARD, FFTW_ESTIMATE);
+
+		if (prm->type == SYNTH_CHIRP) {
+			synth_chirp(prm, x, band, n);
+		} else {
+			synth_spectrum(prm, x, band, n, fwd);
+			fftw_execute(inv);
+		}
+
+		if (prm->crest_factor > 0.0)
+			synth_limit_crest(x, band, n, prm->crest_factor, fwd, inv);
+
+		/* Normalize to full scale */
+		peak = 0.0;
+		power = 0.0;
+		for (i = 0; i < n; i++) {
+			double mag = cabs(x[i]);
+
+			if (mag > peak)
+				peak = mag;
+			power += mag * mag;
+		}
+		crest = peak > 0.0 ? 20 * log10(peak / sqrt(power / n)) : 0.0;
+		for (i = 0; i < n && peak > 0.0; i++)
+			x[i] /= peak;
+
+		buf = synth_pack(x, n, tx_channels, 32767.0 * scale,
+				dac_offset_get_value(manager->dac1.iio_dac), &size);
+
+		fftw_destroy_plan(fwd);
+		fftw_destroy_plan(inv);
+		fftw_free(x);
+		g_free(band);
+
+		if (!buf) {
+			g_free(key);
+			*stat_msg = g_strdup_printf("Unsupported channel selection.");
+			return -EINVAL;
+		}
+
+		wf = waveform_store(manager, key, buf, size, 0, 0);
+		generation = (g_get_monotonic_time() - start) / 1000.0;
+		generated = true;
+	}
+
+	elapsed = waveform_play(manager, wf, stat_msg);
+	if (elapsed < 0)
+		return (int) elapsed;
+
+	tmp = waveform_switch_summary(manager, elapsed);
+	if (generated)
+		*stat_msg = g_strdup_printf("%s generated: %u samples, crest factor %.2f dB, in %.1f ms.\n%s",
+				synth_type_names[prm->type], n, crest,
+				generation, tmp);
+	else
+		*stat_msg = g_strdup_printf("%s loaded from memory.\n%s",
+				synth_type_names[prm->type], tmp);
+	g_free(tmp);
 
 	return 0;
 }
 
+static double dac_sampling_frequency(struct iio_device *dac)
+{
+	unsigned i;
+	double freq;
+
+	for (i = 0; i < iio_device_get_channels_count(dac); i++) {
+		struct iio_channel *ch = iio_device_get_channel(dac, i);
+
+		if (iio_channel_is_output(ch) && iio_channel_is_scan_element(ch) &&
+				!iio_channel_attr_read_double(ch, "sampling_frequency", &freq))
+			return freq;
+	}
+
+	if (!iio_device_attr_read_double(dac, "sampling_frequency", &freq))
+		return freq;
+
+	return 0.0;
+}
+
+static void synth_generate_clicked_cb(GtkButton *btn, struct dac_buffer *dbuf)
+{
+	struct synth_params prm;
+	gchar *status_msg;
+
+	if (!tx_channels_check_valid_setup(dbuf)) {
+		status_msg = g_strdup_printf("Invalid channel selection.");
+	} else {
+		prm.type = gtk_combo_box_get_active(GTK_COMBO_BOX(dbuf->synth_type));
+		prm.length = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(dbuf->synth_length));
+		prm.sample_rate = dac_sampling_frequency(dbuf->dac_with_scanelems);
+		prm.center = gtk_spin_button_get_value(GTK_SPIN_BUTTON(dbuf->synth_center)) * 1e6;
+		prm.bandwidth = gtk_spin_button_get_value(GTK_SPIN_BUTTON(dbuf->synth_bandwidth)) * 1e6;
+		prm.tones = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(dbuf->synth_tones));
+		prm.crest_factor = gtk_spin_button_get_value(GTK_SPIN_BUTTON(dbuf->synth_crest));
+		synth_generate(dbuf->parent, &prm, &status_msg);
+	}
+
+	gtk_text_buffer_set_text(dbuf->load_status_buf, status_msg, -1);
+	g_free(status_msg);
+}
+
 static bool tx_channels_check_valid_setup(struct dac_buffer *dbuf)
 {
 	struct iio_device *dac = dbuf->dac_with_scanelems;
@@ -818,8 +1488,17 @@ static void tx_channel_toggled(GtkCellRendererToggle* renderer, gchar* pathStr,
 
 static void dac_buffer_config_file_set_cb (GtkFileChooser *chooser, struct dac_buffer *dbuf)
 {
+	bool cached;
+
 	dbuf->dac_buf_filename = gtk_file_chooser_get_filename(chooser);
 	gtk_text_buffer_set_text(dbuf->load_status_buf, "", -1);
+
+	/* Preload, so that "Load" only has to swap the buffers */
+	if (dbuf->dac_buf_filename && tx_channels_check_valid_setup(dbuf) &&
+			(g_str_has_suffix(dbuf->dac_buf_filename, ".txt") ||
+			 g_str_has_suffix(dbuf->dac_buf_filename, ".mat") ||
+			 g_str_has_suffix(dbuf->dac_buf_filename, ".bin")))
+		waveform_get(dbuf->parent, dbuf->dac_buf_filename, NULL, &cached);
 }
 
 static void waveform_load_button_clicked_cb (GtkButton *btn, struct dac_buffer *dbuf)
@@ -1106,6 +1785,70 @@ static GtkWidget *gui_dac_channels_tree_create(struct dac_buffer *d_buffer)
 	return scrolled_window;
 }
 
+static GtkWidget *gui_synth_create(struct dac_buffer *d_buffer)
+{
+	static const char * const labels[] = {
+		"Signal:", "Length (samples):", "Center (MHz):",
+		"Bandwidth (MHz):", "Tones:", "Crest factor (dB):",
+	};
+	GtkWidget *synth_frame, *align, *table, *label, *generate_btn;
+	GtkWidget *widgets[G_N_ELEMENTS(labels)];
+	unsigned i;
+
+	synth_frame = frame_with_table_create("<b>Synthesizer</b>",
+			G_N_ELEMENTS(labels) + 1, 2);
+	align = gtk_bin_get_child(GTK_BIN(synth_frame));
+	table = gtk_bin_get_child(GTK_BIN(align));
+	gtk_frame_set_shadow_type(GTK_FRAME(synth_frame), GTK_SHADOW_NONE);
+	gtk_alignment_set_padding(GTK_ALIGNMENT(align), 0, 0, 0, 0);
+
+	d_buffer->synth_type = gtk_combo_box_text_new();
+	for (i = 0; i < G_N_ELEMENTS(synth_type_names); i++)
+		gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(d_buffer->synth_type),
+				synth_type_names[i]);
+	gtk_combo_box_set_active(GTK_COMBO_BOX(d_buffer->synth_type), SYNTH_MULTITONE);
+
+	d_buffer->synth_length = spin_button_create(64, 8 * 1024 * 1024, 1024, 0);
+	gtk_spin_button_set_value(GTK_SPIN_BUTTON(d_buffer->synth_length), 32768);
+	d_buffer->synth_center = spin_button_create(-3000.0, 3000.0, 0.1, 3);
+	gtk_spin_button_set_value(GTK_SPIN_BUTTON(d_buffer->synth_center), 1.0);
+	d_buffer->synth_bandwidth = spin_button_create(0.001, 6000.0, 0.1, 3);
+	gtk_spin_button_set_value(GTK_SPIN_BUTTON(d_buffer->synth_bandwidth), 1.0);
+	d_buffer->synth_tones = spin_button_create(1, 1024, 1, 0);
+	gtk_spin_button_set_value(GTK_SPIN_BUTTON(d_buffer->synth_tones), 1);
+	d_buffer->synth_crest = spin_button_create(0.0, 20.0, 0.5, 1);
+
+	widgets[0] = d_buffer->synth_type;
+	widgets[1] = d_buffer->synth_length;
+	widgets[2] = d_buffer->synth_center;
+	widgets[3] = d_buffer->synth_bandwidth;
+	widgets[4] = d_buffer->synth_tones;
+	widgets[5] = d_buffer->synth_crest;
+
+	for (i = 0; i < G_N_ELEMENTS(labels); i++) {
+		label = gtk_label_new(labels[i]);
+		gtk_misc_set_alignment(GTK_MISC(label), 0.0, 0.5);
+		gtk_table_attach(GTK_TABLE(table), label,
+			0, 1, i, i + 1, GTK_FILL, GTK_FILL, 0, 0);
+		gtk_table_attach(GTK_TABLE(table), widgets[i],
+			1, 2, i, i + 1, GTK_FILL, GTK_FILL, 0, 0);
+	}
+
+	gtk_widget_set_tooltip_text(d_buffer->synth_bandwidth,
+			"Span of the tones or of the sweep, occupied bandwidth of "
+			"noise and OFDM, symbol rate of QPSK and 16-QAM");
+	gtk_widget_set_tooltip_text(d_buffer->synth_crest,
+			"Peak to average power limit, 0 to disable");
+
+	generate_btn = gtk_button_new_with_label("Generate");
+	gtk_table_attach(GTK_TABLE(table), generate_btn,
+		1, 2, i, i + 1, GTK_FILL, GTK_FILL, 0, 0);
+	g_signal_connect(generate_btn, "clicked",
+		G_CALLBACK(synth_generate_clicked_cb), d_buffer);
+
+	return synth_frame;
+}
+
 static GtkWidget *gui_dac_buffer_create(struct dac_buffer *d_buffer)
 {
 	GtkWidget *dacbuf_frame;
@@ -1172,6 +1915,8 @@ static GtkWidget *gui_dac_buffer_create(struct dac_buffer *d_buffer)
 
 	gtk_table_attach(GTK_TABLE(dacbuf_table), fchooser_frame,
 		0, 1, 0, 1, GTK_FILL | GTK_EXPAND, GTK_FILL, 0, 0);
+	gtk_table_attach(GTK_TABLE(dacbuf_table), gui_synth_create(d_buffer),
+		0, 1, 1, 2, GTK_FILL | GTK_EXPAND, GTK_FILL, 0, 0);
 	gtk_table_attach(GTK_TABLE(dacbuf_table), tx_channels_frame,
 		0, 1, 2, 3, GTK_FILL | GTK_EXPAND, GTK_FILL | GTK_EXPAND, 0, 0);
 
@@ -1959,6 +2704,8 @@ static int dac_manager_init(struct dac_data_manager *manager,
 	manager->is_local = strcmp(iio_context_get_name(ctx), "local") ? false : true;
 	manager->ctx = ctx;
 	manager->alignment = 8;
+	manager->waveforms = g_hash_table_new_full(g_str_hash, g_str_equal,
+			NULL, (GDestroyNotify) waveform_free);
 
 	return ret;
 }
@@ -2003,10 +2750,52 @@ void dac_data_manager_free(struct dac_data_manager *manager)
 			manager->dds_buffer = NULL;
 		}
 		g_slist_free(manager->dds_tones);
+		if (manager->waveforms)
+			g_hash_table_destroy(manager->waveforms);
 		free(manager);
 	}
 }
 
+/*
+ * Moves the manager over to 'ctx' after the link to the device was
+ * reopened. The DDS settings are still in the hardware, but the cyclic
+ * buffer went away with the connection: a waveform that was playing is
+ * pushed again from memory.
+ */
+void dac_data_manager_reconnect(struct dac_data_manager *manager,
+		struct iio_context *ctx)
+{
+	struct waveform *wf = manager->dds_buffer ? manager->active_waveform : NULL;
+	struct dac_buffer *dbuf = &manager->dac_buffer_module;
+	GSList *node;
+
+	if (manager->dds_buffer) {
+		iio_buffer_destroy(manager->dds_buffer);
+		manager->dds_buffer = NULL;
+	}
+	manager->active_waveform = NULL;
+
+	manager->ctx = ctx;
+	manager->dac1.iio_dac = osc_device_rebind(ctx, manager->dac1.iio_dac);
+	manager->dac2.iio_dac = osc_device_rebind(ctx, manager->dac2.iio_dac);
+	dbuf->dac_with_scanelems = osc_device_rebind(ctx,
+			dbuf->dac_with_scanelems);
+
+	for (node = manager->dds_tones; node; node = g_slist_next(node)) {
+		struct dds_tone *tone = node->data;
+
+		tone->iio_dac = osc_device_rebind(ctx, tone->iio_dac);
+		tone->iio_ch = osc_channel_rebind(ctx, tone->iio_ch);
+		iio_rebind_widgets(&tone->iio_freq, 1, ctx);
+		iio_rebind_widgets(&tone->iio_scale, 1, ctx);
+		iio_rebind_widgets(&tone->iio_phase, 1, ctx);
+	}
+
+	if (wf && waveform_play(manager, wf, NULL) < 0)
+		fprintf(stderr, "Could not restart the DAC buffer %s\n",
+				dbuf->dac_buf_filename ?: "");
+}
+
 static void freq_spin_range_update(struct dds_tone *tone, double tx_sample_rate)
 {
 	GtkAdjustment *adj;
@@ -48,6 +48,8 @@ struct dac_data_manager;
 struct dac_data_manager *dac_data_manager_new(struct iio_device *dac1,
 		struct iio_device *dac2, struct iio_context *ctx);
 void dac_data_manager_free(struct dac_data_manager *manager);
+void dac_data_manager_reconnect(struct dac_data_manager *manager,
+		struct iio_context *ctx);
 void dac_data_manager_freq_widgets_range_update(struct dac_data_manager *manager,
 		double tx_sample_rate);
 void dac_data_manager_update_iio_widgets(struct dac_data_manager *manager);
@@ -385,6 +385,23 @@ static void context_destroy(const char *ini_fn)
 	osc_destroy_context(ctx);
 }
 
+/* Same hardware behind a new link: swap the handles, keep the panel */
+static void daq2_reconnect(void)
+{
+	struct iio_context *new_ctx = osc_create_context();
+
+	dac = osc_device_rebind(new_ctx, dac);
+	adc = osc_device_rebind(new_ctx, adc);
+
+	iio_rebind_widgets(tx_widgets, num_tx, new_ctx);
+	iio_rebind_widgets(rx_widgets, num_rx, new_ctx);
+	if (dac_tx_manager)
+		dac_data_manager_reconnect(dac_tx_manager, new_ctx);
+
+	osc_destroy_context(ctx);
+	ctx = new_ctx;
+}
+
 static bool daq2_identify(void)
 {
 	/* Use the OSC's IIO context just to detect the devices */
@@ -424,5 +441,6 @@ struct osc_plugin plugin = {
 	.handle_item = daq2_handle,
 	.save_profile = save_profile,
 	.load_profile = load_profile,
+	.reconnect = daq2_reconnect,
 	.destroy = context_destroy,
 };
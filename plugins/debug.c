@@ -84,6 +84,7 @@ static GtkWidget *warning_label;
 static GtkWidget *reg_autoread;
 static GtkWidget *reg_map_type;
 static GtkWidget *toggle_detailed_regmap;
+static GtkWidget *btn_dump_regs;
 
 /* IIO Scan Elements widgets */
 static GtkWidget *scanel_read;
@@ -122,6 +123,9 @@ static int *reg_addr_list;     /* Pointer to the list of addresses of all regist
 static int reg_list_size;      /* Number of register addresses */
 static int reg_bit_width;      /* The size in bits that all registers have in common */
 static reg soft_reg;           /* Holds all information of a register and of the contained bits  */
+static reg *reg_cache;         /* Registers already parsed from the xml file, by list position */
+static bool *reg_cached;       /* Which entries of reg_cache are filled */
+static int *reg_sorted_pos;    /* List positions sorted by register address */
 static gulong reg_map_hid;     /* The handler id of the register map type combobox */
 static gulong reg_addr_hid;    /* The handler id of the register address spin button */
 static gulong reg_val_hid;     /* The handler id of the register value spin button */
@@ -134,7 +138,6 @@ static xmlNodePtr root; /* The reference to the first element in the xml file */
 static xmlXPathObjectPtr register_list; /* List of register references */
 
 static int context_created = 0; /* register data allocation flag */
-static int soft_reg_exists = 0; /* keeps track of alloc-free calls */
 static int xml_file_opened = 0; /* a open file flag */
 
 /* The path of the directory containing the xml files. */
@@ -161,6 +164,7 @@ static void clean_gui_reg_info(void);
 static int get_default_reg_width(void);
 static int * get_reg_addr_list(void);
 static int get_reg_pos(int *regList, int reg_addr);
+static reg * get_cached_register(int reg_index);
 static int update_regmap(int data);
 static void create_device_context(void);
 static void destroy_device_context(void);
@@ -690,9 +694,6 @@ static void fill_soft_register(reg *p_reg, int reg_index)
 	option *p_option;
 	int i, j;
 
-	/* Increment this flag every function call */
-	soft_reg_exists++;
-
 	/* Get the root that points to the list of the registers from the xml file. */
 	nodeset = register_list->nodesetval;
 
@@ -753,12 +754,6 @@ static void free_soft_register(reg *p_reg)
 	bgroup* p_bit;
 	int i, j;
 
-	/* Free memory only when a call of fill_soft_register() already occurred */
-	if (soft_reg_exists == 0)
-		return;
-
-	soft_reg_exists--;
-
 	/* xmlFree() is used to free all strings allocated by read_string_element() function */
 	for (i = 0; i < p_reg->bgroup_cnt; i++){
 		p_bit = &p_reg->bgroup_list[i];
@@ -787,16 +782,14 @@ static void free_soft_register(reg *p_reg)
  */
 static int display_reg_info(int pos_reg_addr)
 {
-	/* Free the previously used register */
-	free_soft_register(&soft_reg);
-
 	/* Display no register information when address is not valid */
 	if (pos_reg_addr < 0){
+		memset(&soft_reg, 0, sizeof(soft_reg));
 		draw_reg_map(0);
 		return 0;
 	}
-	/* Extract data from xml file and fill a "reg" structure with it */
-	fill_soft_register(&soft_reg, pos_reg_addr);
+	/* The cache owns the register data, soft_reg is only a view of it */
+	soft_reg = *get_cached_register(pos_reg_addr);
 
 	/* Display the register map using data from the "reg" structure */
 	draw_reg_map(1);
@@ -993,7 +986,9 @@ static void draw_reg_map(int valid_register)
 	block_bit_option_signals();
 	/* Reset all bits to the "reseverd" status and clear all options */
 	for (i = (reg_bit_width - 1); i >= 0; i--){
-		gtk_widget_reparent(lbl_bits[i], hboxes[i]);
+		/* Only bits that were grouped by the previous register need to move */
+		if (gtk_widget_get_parent(lbl_bits[i]) != hboxes[i])
+			gtk_widget_reparent(lbl_bits[i], hboxes[i]);
 		gtk_label_set_text((GtkLabel *)bit_descrip_list[i], "Reserved");
 		gtk_label_set_width_chars((GtkLabel *)bit_descrip_list[i], 13);
 		gtk_combo_box_text_remove_all(bit_comboboxes[i]);
@@ -1282,21 +1277,163 @@ static int * get_reg_addr_list(void)
 	return list;
 }
 
+static int reg_pos_cmp(const void *a, const void *b)
+{
+	int pos_a = *(const int *)a;
+	int pos_b = *(const int *)b;
+
+	if (reg_addr_list[pos_a] != reg_addr_list[pos_b])
+		return reg_addr_list[pos_a] < reg_addr_list[pos_b] ? -1 : 1;
+
+	return pos_a - pos_b;
+}
+
+/*
+ * Build the address index used by get_reg_pos().
+ */
+static int * get_reg_sorted_pos(void)
+{
+	int *list;
+	int i;
+
+	list = malloc(sizeof(*list) * reg_list_size);
+	if (list == NULL){
+		printf("Memory allocation failed\n");
+		return NULL;
+	}
+
+	for (i = 0; i < reg_list_size; i++)
+		list[i] = i;
+	qsort(list, reg_list_size, sizeof(*list), reg_pos_cmp);
+
+	return list;
+}
+
 /*
  * Find the register position in the given list.
  */
 static int get_reg_pos(int *regList, int reg_addr)
 {
-	int i = 0;
-
-	for (; i < reg_list_size; i++){
-		if (regList[i] == reg_addr)
-			return i;
+	int lo = 0, hi = reg_list_size - 1, mid;
+
+	while (lo <= hi){
+		mid = (lo + hi) / 2;
+		if (regList[reg_sorted_pos[mid]] < reg_addr) {
+			lo = mid + 1;
+		} else if (regList[reg_sorted_pos[mid]] > reg_addr) {
+			hi = mid - 1;
+		} else {
+			/* Same as a linear search: the first register at that address */
+			while (mid > 0 && regList[reg_sorted_pos[mid - 1]] == reg_addr)
+				mid--;
+			return reg_sorted_pos[mid];
+		}
 	}
 
 	return -1;
 }
 
+/*
+ * Return the register found at the given position of the register list. The
+ * xml data of a register is only parsed the first time it is needed.
+ */
+static reg * get_cached_register(int reg_index)
+{
+	if (!reg_cached[reg_index]) {
+		fill_soft_register(&reg_cache[reg_index], reg_index);
+		reg_cached[reg_index] = true;
+	}
+
+	return &reg_cache[reg_index];
+}
+
+/*
+ * Read all registers of the map and save them, together with their default
+ * values, to a CSV file.
+ */
+static void reg_dump_clicked(GtkButton *button, gpointer user_data)
+{
+	GtkWidget *dialog;
+	uint32_t *values;
+	uint32_t address;
+	char *filename;
+	bool axi_core;
+	int *status;
+	int i, diffs = 0;
+	reg *p_reg;
+	FILE *f;
+
+	if (!xml_file_opened || !reg_list_size)
+		return;
+
+	dialog = gtk_file_chooser_dialog_new("Save register dump",
+			GTK_WINDOW(gtk_widget_get_toplevel(GTK_WIDGET(button))),
+			GTK_FILE_CHOOSER_ACTION_SAVE,
+			GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+			GTK_STOCK_SAVE, GTK_RESPONSE_ACCEPT,
+			NULL);
+	gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER(dialog), TRUE);
+	gtk_file_chooser_set_current_name(GTK_FILE_CHOOSER(dialog), "register_dump.csv");
+	if (gtk_dialog_run(GTK_DIALOG(dialog)) != GTK_RESPONSE_ACCEPT) {
+		gtk_widget_destroy(dialog);
+		return;
+	}
+	filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+	gtk_widget_destroy(dialog);
+
+	values = malloc(sizeof(*values) * reg_list_size);
+	status = malloc(sizeof(*status) * reg_list_size);
+	if (!values || !status) {
+		printf("Memory allocation failed\n");
+		goto free_mem;
+	}
+
+	/* Do all the device accesses back to back, before any parsing or I/O */
+	axi_core = gtk_combo_box_get_active(GTK_COMBO_BOX(reg_map_type)) == REG_MAP_AXI_CORE;
+	for (i = 0; i < reg_list_size; i++) {
+		address = reg_addr_list[i];
+		if (axi_core)
+			address |= 0x80000000;
+		status[i] = iio_device_reg_read(dev, address, &values[i]);
+	}
+
+	f = fopen(filename, "w");
+	if (!f) {
+		printf("Cannot open %s: %s\n", filename, strerror(errno));
+		goto free_mem;
+	}
+
+	fprintf(f, "Address,Value,Default,Differs,Name\n");
+	for (i = 0; i < reg_list_size; i++) {
+		p_reg = get_cached_register(i);
+		if (status[i]) {
+			fprintf(f, "0x%X,<error>,0x%X,,%s\n", reg_addr_list[i],
+					p_reg->def_val, p_reg->name);
+			continue;
+		}
+		if (values[i] != (uint32_t)p_reg->def_val)
+			diffs++;
+		fprintf(f, "0x%X,0x%X,0x%X,%s,%s\n", reg_addr_list[i], values[i],
+				p_reg->def_val,
+				values[i] != (uint32_t)p_reg->def_val ? "*" : "",
+				p_reg->name);
+	}
+	fclose(f);
+
+	dialog = gtk_message_dialog_new(
+			GTK_WINDOW(gtk_widget_get_toplevel(GTK_WIDGET(button))),
+			GTK_DIALOG_MODAL, GTK_MESSAGE_INFO, GTK_BUTTONS_CLOSE,
+			"Dumped %d registers, %d differ from their default value.",
+			reg_list_size, diffs);
+	gtk_dialog_run(GTK_DIALOG(dialog));
+	gtk_widget_destroy(dialog);
+
+free_mem:
+	free(values);
+	free(status);
+	g_free(filename);
+}
+
 /*
  * Update bit options using raw data read from the device or provided by user.
  * Check if options exists for the provided data and reconstruct data from only
@@ -1395,6 +1532,7 @@ static int device_xml_file_load(char *filename)
 	if (xml_doc) {
 		xml_file_opened = 1;
 		create_device_context();
+		gtk_widget_set_sensitive(btn_dump_regs, true);
 		g_signal_emit_by_name(spin_btn_reg_addr, "value-changed");
 	} else {
 		printf("Cannot load the file %s\n", temp_path);
@@ -1491,6 +1629,9 @@ static void create_device_context(void)
 		/* Init data */
 		reg_bit_width = get_default_reg_width();
 		if (reg_bit_width) {
+			reg_cache = calloc(reg_list_size, sizeof(*reg_cache));
+			reg_cached = calloc(reg_list_size, sizeof(*reg_cached));
+			reg_sorted_pos = get_reg_sorted_pos();
 			alloc_widget_arrays(reg_bit_width);
 			create_reg_map();
 			context_created = 1;
@@ -1504,14 +1645,23 @@ static void create_device_context(void)
  */
 static void destroy_device_context(void)
 {
+	int i;
+
 /* Free resources */
 	if (context_created == 1) {
+		for (i = 0; i < reg_list_size; i++)
+			if (reg_cached[i])
+				free_soft_register(&reg_cache[i]);
+		free(reg_cache);
+		free(reg_cached);
+		free(reg_sorted_pos);
+		memset(&soft_reg, 0, sizeof(soft_reg));
 		free(reg_addr_list);
 		free_widget_arrays();
-		free_soft_register(&soft_reg);
 		xmlXPathFreeObject(register_list);
 		close_xml_file(xml_doc);
 		xml_file_opened = 0;
+		gtk_widget_set_sensitive(btn_dump_regs, false);
 		reg_bit_width = 0;
 	}
 	context_created = 0;
@@ -1612,6 +1762,7 @@ static GtkWidget * debug_init(GtkWidget *notebook, const char *ini_fn)
 	reg_autoread = GTK_WIDGET(gtk_builder_get_object(builder, "register_autoread"));
 	toggle_detailed_regmap = GTK_WIDGET(gtk_builder_get_object(builder, "toggle_detailed_regmap"));
 	reg_map_type = GTK_WIDGET(gtk_builder_get_object(builder, "cmb_RegisterMapType"));
+	btn_dump_regs = GTK_WIDGET(gtk_builder_get_object(builder, "debug_dump_regs"));
 
 	vbox_scanel =  GTK_WIDGET(gtk_builder_get_object(builder, "scanel_container"));
 	scanel_read = GTK_WIDGET(gtk_builder_get_object(builder, "debug_read_scan"));
@@ -1650,6 +1801,8 @@ static GtkWidget * debug_init(GtkWidget *notebook, const char *ini_fn)
 			G_CALLBACK(reg_read_clicked), NULL);
 	g_signal_connect(G_OBJECT(btn_write_reg), "clicked",
 			G_CALLBACK(reg_write_clicked), NULL);
+	g_signal_connect(G_OBJECT(btn_dump_regs), "clicked",
+			G_CALLBACK(reg_dump_clicked), NULL);
 	reg_addr_hid = g_signal_connect(G_OBJECT(spin_btn_reg_addr),
 		"value-changed", G_CALLBACK(reg_address_value_changed_cb), NULL);
 	reg_val_hid = g_signal_connect(G_OBJECT(spin_btn_reg_value),
@@ -0,0 +1,353 @@
+/**
+ * Copyright (C) 2019 Analog Devices, Inc.
+ *
+ * Licensed under the GPL-2.
+ *
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+
+#include "debug_attr_txn.h"
+
+/* Polling step while waiting for the device to come back */
+#define DEBUG_TXN_POLL_MS	10
+
+struct debug_txn_reg {
+	long long hw;		/* last value known to be in the device */
+	long long staged;
+	bool dirty;
+};
+
+struct debug_txn {
+	struct iio_device *dev;
+	GHashTable *regs;	/* attribute name -> struct debug_txn_reg */
+	unsigned int pending;
+	unsigned int written;
+};
+
+struct debug_txn * debug_txn_new(struct iio_device *dev)
+{
+	struct debug_txn *txn;
+
+	if (!dev)
+		return NULL;
+
+	txn = g_new0(struct debug_txn, 1);
+	txn->dev = dev;
+	txn->regs = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, g_free);
+
+	return txn;
+}
+
+void debug_txn_free(struct debug_txn *txn)
+{
+	if (!txn)
+		return;
+
+	g_hash_table_destroy(txn->regs);
+	g_free(txn);
+}
+
+static struct debug_txn_reg * debug_txn_get(struct debug_txn *txn,
+		const char *attr)
+{
+	struct debug_txn_reg *reg = g_hash_table_lookup(txn->regs, attr);
+	long long val;
+	int ret;
+
+	if (reg)
+		return reg;
+
+	ret = iio_device_debug_attr_read_longlong(txn->dev, attr, &val);
+	if (ret < 0)
+		return NULL;
+
+	reg = g_new0(struct debug_txn_reg, 1);
+	reg->hw = reg->staged = val;
+	g_hash_table_insert(txn->regs, g_strdup(attr), reg);
+
+	return reg;
+}
+
+/* Records a value just read from the device. Returns the value the
+ * widgets should show, which is the staged one if there is any. */
+long long debug_txn_seed(struct debug_txn *txn, const char *attr,
+		long long hw_val)
+{
+	struct debug_txn_reg *reg = g_hash_table_lookup(txn->regs, attr);
+
+	if (!reg) {
+		reg = g_new0(struct debug_txn_reg, 1);
+		reg->staged = hw_val;
+		g_hash_table_insert(txn->regs, g_strdup(attr), reg);
+	}
+
+	reg->hw = hw_val;
+	if (!reg->dirty)
+		reg->staged = hw_val;
+
+	return reg->staged;
+}
+
+/* Forgets the whole image, staged values included. Used when the device
+ * was reinitialized or written behind our back, e.g. by a profile. */
+void debug_txn_invalidate(struct debug_txn *txn)
+{
+	g_hash_table_remove_all(txn->regs);
+	txn->pending = 0;
+}
+
+static void debug_txn_set(struct debug_txn *txn, struct debug_txn_reg *reg,
+		long long val)
+{
+	bool dirty = val != reg->hw;
+
+	if (dirty != reg->dirty) {
+		if (dirty)
+			txn->pending++;
+		else
+			txn->pending--;
+	}
+
+	reg->staged = val;
+	reg->dirty = dirty;
+}
+
+/* Only the bits in 'mask' are changed, the others keep the staged value */
+int debug_txn_stage(struct debug_txn *txn, const char *attr,
+		long long mask, long long val)
+{
+	struct debug_txn_reg *reg = debug_txn_get(txn, attr);
+
+	if (!reg)
+		return -ENOENT;
+
+	debug_txn_set(txn, reg, (reg->staged & ~mask) | (val & mask));
+	return 0;
+}
+
+/* Same as debug_txn_stage(), but the value is written right away */
+int debug_txn_write(struct debug_txn *txn, const char *attr,
+		long long mask, long long val)
+{
+	struct debug_txn_reg *reg = debug_txn_get(txn, attr);
+	int ret;
+
+	if (!reg)
+		return -ENOENT;
+
+	val = (reg->staged & ~mask) | (val & mask);
+	if (val == reg->hw && !reg->dirty)
+		return 0;
+
+	ret = iio_device_debug_attr_write_longlong(txn->dev, attr, val);
+	if (ret < 0)
+		return ret;
+
+	reg->hw = val;
+	debug_txn_set(txn, reg, val);
+	return 0;
+}
+
+unsigned int debug_txn_pending(const struct debug_txn *txn)
+{
+	return txn->pending;
+}
+
+static ssize_t debug_txn_write_cb(struct iio_device *dev,
+		const char *attr, void *buf, size_t len, void *d)
+{
+	struct debug_txn *txn = d;
+	struct debug_txn_reg *reg = g_hash_table_lookup(txn->regs, attr);
+	int ret;
+
+	/* Zero length means the attribute is left alone */
+	if (!reg || !reg->dirty)
+		return 0;
+
+	ret = snprintf(buf, len, "%lld", reg->staged);
+	if (ret < 0 || (size_t) ret >= len)
+		return -ENOMEM;
+
+	txn->written++;
+	return ret;
+}
+
+static void debug_txn_applied(gpointer key, gpointer value, gpointer d)
+{
+	struct debug_txn_reg *reg = value;
+
+	if (reg->dirty) {
+		reg->hw = reg->staged;
+		reg->dirty = false;
+	}
+}
+
+/* Returns the number of attributes written, or a negative error code */
+int debug_txn_commit(struct debug_txn *txn)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	int ret;
+
+	if (!txn->pending)
+		return 0;
+
+	txn->written = 0;
+	ret = iio_device_debug_attr_write_all(txn->dev,
+			debug_txn_write_cb, txn);
+
+	/* Backends without batched writes get one write per value */
+	if (ret == -ENOSYS) {
+		txn->written = 0;
+		g_hash_table_iter_init(&iter, txn->regs);
+		while (g_hash_table_iter_next(&iter, &key, &value)) {
+			struct debug_txn_reg *reg = value;
+
+			if (!reg->dirty)
+				continue;
+
+			ret = iio_device_debug_attr_write_longlong(txn->dev,
+					key, reg->staged);
+			if (ret < 0)
+				break;
+
+			reg->hw = reg->staged;
+			reg->dirty = false;
+			txn->pending--;
+			txn->written++;
+		}
+	}
+
+	if (ret < 0) {
+		fprintf(stderr, "Failed to write debug attributes of %s: %s\n",
+				iio_device_get_name(txn->dev), strerror(-ret));
+		return ret;
+	}
+
+	g_hash_table_foreach(txn->regs, debug_txn_applied, NULL);
+	txn->pending = 0;
+
+	return (int) txn->written;
+}
+
+/* The adi,* values are only applied by "initialize", so they are staged
+ * and sent in one batch right before it. Everything else acts at once. */
+int debug_txn_update(struct debug_txn *txn, const char *attr,
+		long long mask, long long val)
+{
+	int ret;
+
+	if (!strncmp(attr, "adi,", sizeof("adi,") - 1))
+		ret = debug_txn_stage(txn, attr, mask, val);
+	else
+		ret = debug_txn_write(txn, attr, mask, val);
+
+	if (ret < 0)
+		fprintf(stderr, "Failed to set %s: %s\n", attr, strerror(-ret));
+	return ret;
+}
+
+/* Commits the staged values and then triggers 'init_attr' */
+int debug_txn_initialize(struct debug_txn *txn, const char *init_attr)
+{
+	int ret;
+
+	ret = debug_txn_commit(txn);
+	if (ret < 0)
+		return ret;
+
+	ret = iio_device_debug_attr_write_longlong(txn->dev, init_attr, 1);
+
+	/* The driver reloads its defaults, nothing cached is valid anymore */
+	debug_txn_invalidate(txn);
+
+	return ret;
+}
+
+struct debug_txn_wait {
+	struct debug_txn *txn;
+	gchar *init_attr;
+	gchar *state_attr;
+	char state[64];
+	gint64 start;
+	unsigned int timeout_ms;
+	debug_txn_done_cb cb;
+	void *data;
+};
+
+static void debug_txn_wait_free(gpointer ptr)
+{
+	struct debug_txn_wait *wait = ptr;
+
+	g_free(wait->init_attr);
+	g_free(wait->state_attr);
+	g_free(wait);
+}
+
+/* One poll of 'state_attr', from the main loop */
+static gboolean debug_txn_wait_poll(gpointer ptr)
+{
+	struct debug_txn_wait *wait = ptr;
+	int elapsed = (int) ((g_get_monotonic_time() - wait->start) / 1000);
+	char buf[64];
+	int ret;
+
+	if (iio_device_attr_read(wait->txn->dev, wait->state_attr,
+				buf, sizeof(buf)) >= 0 && !strcmp(buf, wait->state)) {
+		ret = elapsed;
+	} else if ((unsigned int) elapsed >= wait->timeout_ms) {
+		fprintf(stderr, "%s didn't go back to %s after %s\n",
+				iio_device_get_name(wait->txn->dev),
+				wait->state, wait->init_attr);
+		ret = -ETIMEDOUT;
+	} else {
+		return TRUE;
+	}
+
+	wait->cb(ret, wait->data);
+	return FALSE;
+}
+
+/*
+ * Like debug_txn_initialize(), then waits until 'state_attr' is back to
+ * the state it was in before, which the driver restores once it is done
+ * bringing the device up. The wait polls from the main loop instead of
+ * blocking it; 'cb' gets how long it took in ms, or a negative error.
+ * Returns the id of the polling source, 0 if 'cb' was already called.
+ */
+guint debug_txn_reinitialize(struct debug_txn *txn, const char *init_attr,
+		const char *state_attr, unsigned int timeout_ms,
+		debug_txn_done_cb cb, void *data)
+{
+	struct debug_txn_wait *wait;
+	char state[64];
+	ssize_t len;
+	int ret;
+
+	len = iio_device_attr_read(txn->dev, state_attr, state, sizeof(state));
+
+	ret = debug_txn_initialize(txn, init_attr);
+	if (ret < 0 || len < 0) {
+		cb(ret, data);
+		return 0;
+	}
+
+	wait = g_new0(struct debug_txn_wait, 1);
+	wait->txn = txn;
+	wait->init_attr = g_strdup(init_attr);
+	wait->state_attr = g_strdup(state_attr);
+	g_strlcpy(wait->state, state, sizeof(wait->state));
+	wait->start = g_get_monotonic_time();
+	wait->timeout_ms = timeout_ms;
+	wait->cb = cb;
+	wait->data = data;
+
+	return g_timeout_add_full(G_PRIORITY_DEFAULT, DEBUG_TXN_POLL_MS,
+			debug_txn_wait_poll, wait, debug_txn_wait_free);
+}
@@ -0,0 +1,51 @@
+/**
+ * Copyright (C) 2019 Analog Devices, Inc.
+ *
+ * Licensed under the GPL-2.
+ *
+ */
+
+#ifndef __DEBUG_ATTR_TXN__
+#define __DEBUG_ATTR_TXN__
+
+#include <glib.h>
+#include <iio.h>
+
+/*
+ * Shadow image of the numeric debug attributes of one device.
+ *
+ * Values read from the device are remembered, so read-modify-write of a
+ * bitfield is merged locally. Staged values are only sent on commit, all
+ * of them in one iio_device_debug_attr_write_all() call, and only those
+ * that differ from what the device already holds.
+ */
+
+#define DEBUG_TXN_ALL_BITS	(~0LL)
+
+struct debug_txn;
+
+struct debug_txn * debug_txn_new(struct iio_device *dev);
+void debug_txn_free(struct debug_txn *txn);
+
+long long debug_txn_seed(struct debug_txn *txn, const char *attr,
+		long long hw_val);
+void debug_txn_invalidate(struct debug_txn *txn);
+
+int debug_txn_stage(struct debug_txn *txn, const char *attr,
+		long long mask, long long val);
+int debug_txn_write(struct debug_txn *txn, const char *attr,
+		long long mask, long long val);
+unsigned int debug_txn_pending(const struct debug_txn *txn);
+int debug_txn_commit(struct debug_txn *txn);
+
+int debug_txn_update(struct debug_txn *txn, const char *attr,
+		long long mask, long long val);
+
+typedef void (*debug_txn_done_cb)(int ret, void *data);
+
+int debug_txn_initialize(struct debug_txn *txn, const char *init_attr);
+guint debug_txn_reinitialize(struct debug_txn *txn, const char *init_attr,
+		const char *state_attr, unsigned int timeout_ms,
+		debug_txn_done_cb cb, void *data);
+
+#endif /* __DEBUG_ATTR_TXN__ */
@@ -28,8 +28,10 @@
 #include "../iio_widget.h"
 #include "../osc_plugin.h"
 #include "../config.h"
+#include "../readout.h"
 
 static GtkWidget *dmm_results;
+static struct text_readout *dmm_readout;
 static GtkWidget *select_all_channels;
 static GtkWidget *dmm_button;
 static GtkWidget *device_list_widget;
@@ -303,14 +305,9 @@ static gboolean dmm_update(void)
 	gboolean loop, enabled;
 	double value;
 
-	GtkTextBuffer *buf;
-	GtkTextIter text_iter;
-
-	/* start at the top every time */
-	buf = gtk_text_buffer_new(NULL);
-	gtk_text_buffer_get_iter_at_offset(buf, &text_iter, 0);
-
 	if (this_page == gtk_notebook_get_current_page(nbook) || plugin_detached) {
+		/* start at the top every time, only changed readings get redrawn */
+		text_readout_begin(dmm_readout);
 		loop = gtk_tree_model_get_iter_first(GTK_TREE_MODEL(channel_list_store), &tree_iter);
 		while (loop) {
 			gtk_tree_model_get(GTK_TREE_MODEL(channel_list_store), &tree_iter,
@@ -344,30 +341,27 @@ static gboolean dmm_update(void)
 							"scale");
 
 				if (!strncmp(channel, "voltage", 7))
-					sprintf(tmp, "%s = %f Volts\n", name, value / 1000);
+					text_readout_add(dmm_readout, "%s = %f Volts", name, value / 1000);
 				else if (!strncmp(channel, "temp", 4))
-					sprintf(tmp, "%s = %3.2f °C\n", name, value / 1000);
+					text_readout_add(dmm_readout, "%s = %3.2f °C", name, value / 1000);
 				else if (!strncmp(channel, "current", 4))
-					sprintf(tmp, "%s = %f Milliampere\n", name, value);
+					text_readout_add(dmm_readout, "%s = %f Milliampere", name, value);
 				else if (!strncmp(channel, "accel", 5))
-					sprintf(tmp, "%s = %f m/s²\n", name, value);
+					text_readout_add(dmm_readout, "%s = %f m/s²", name, value);
 				else if (!strncmp(channel, "anglvel", 7))
-					sprintf(tmp, "%s = %f rad/s\n", name, value);
+					text_readout_add(dmm_readout, "%s = %f rad/s", name, value);
 				else if (!strncmp(channel, "pressure", 8))
-					sprintf(tmp, "%s = %f kPa\n", name, value);
+					text_readout_add(dmm_readout, "%s = %f kPa", name, value);
 				else if (!strncmp(channel, "magn", 4))
-					sprintf(tmp, "%s = %f Gauss\n", name, value);
+					text_readout_add(dmm_readout, "%s = %f Gauss", name, value);
 				else
-					sprintf(tmp, "%s = %f\n", name, value);
-
-				gtk_text_buffer_insert(buf, &text_iter, tmp, -1);
+					text_readout_add(dmm_readout, "%s = %f", name, value);
 			}
 dmm_update_next:
 			loop = gtk_tree_model_iter_next(GTK_TREE_MODEL(channel_list_store), &tree_iter);
 		}
 
-		gtk_text_view_set_buffer(GTK_TEXT_VIEW(dmm_results), buf);
-		g_object_unref(buf);
+		text_readout_end(dmm_readout);
 	}
 
 	return dmm_update_loop_running;
@@ -417,6 +411,7 @@ static GtkWidget * dmm_init(GtkWidget *notebook, const char *ini_fn)
 	channel_list_store = GTK_LIST_STORE(gtk_builder_get_object(builder, "channel_list"));
 
 	dmm_results = GTK_WIDGET(gtk_builder_get_object(builder, "dmm_results"));
+	dmm_readout = text_readout_new(GTK_TEXT_VIEW(dmm_results));
 	select_all_channels = GTK_WIDGET(gtk_builder_get_object(builder, "all_channels"));
 
 	g_builder_connect_signal(builder, "device_toggle", "toggled",
@@ -517,6 +512,7 @@ static void update_active_page(gint active_page, gboolean is_detached)
 static void context_destroy(const char *ini_fn)
 {
 	g_source_remove_by_user_data(ctx);
+	text_readout_free(dmm_readout);
 	osc_destroy_context(ctx);
 }
 
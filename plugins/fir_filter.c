@@ -6,13 +6,183 @@
  **/
 
 #include <errno.h>
+#include <fftw3.h>
 #include <glib.h>
 #include <gtk/gtk.h>
 #include <iio.h>
+#include <math.h>
 #include <string.h>
 
 #include "../config.h"
 #include "../osc.h"
+#include "fir_filter.h"
+
+#define FIR_FILTER_FFT_SIZE	(2 * (FIR_FILTER_RESPONSE_LEN - 1))
+
+/* One plan serves the response of every filter */
+static struct {
+	fftw_plan plan;
+	double *in;
+	fftw_complex *out;
+} fir_fft;
+
+static gchar * fir_filter_path(const char *file_name)
+{
+	gchar *ptr, *path;
+
+	if (!strncmp(file_name, "@FILTERS@/", sizeof("@FILTERS@/") - 1))
+		path = g_build_filename(OSC_FILTER_FILE_PATH,
+				file_name + sizeof("@FILTERS@/") - 1, NULL);
+	else
+		path = g_strdup(file_name);
+	if (!path)
+		return NULL;
+
+	for (ptr = path; *ptr; ptr++)
+		if (*ptr == '/')
+			*ptr = G_DIR_SEPARATOR_S[0];
+
+	return path;
+}
+
+static bool fir_filter_parse_line(struct fir_filter_file *ftr, const char *line)
+{
+	unsigned long *r;
+	unsigned int n;
+	int tx, rx;
+
+	if (line[0] == '#' || line[0] == '\n' || line[0] == '\r' || !line[0])
+		return true;
+
+	if (sscanf(line, "TX %u GAIN %d INT %u",
+				&n, &ftr->tx_gain, &ftr->tx_int) == 3)
+		return true;
+	if (sscanf(line, "RX %u GAIN %d DEC %u",
+				&n, &ftr->rx_gain, &ftr->rx_dec) == 3)
+		return true;
+
+	if (!strncmp(line, "RTX ", 4) || !strncmp(line, "RRX ", 4)) {
+		r = line[1] == 'T' ? ftr->tx_rates : ftr->rx_rates;
+		return sscanf(line + 4, "%lu %lu %lu %lu %lu %lu",
+				&r[0], &r[1], &r[2], &r[3], &r[4], &r[5]) == 6;
+	}
+	if (sscanf(line, "BWTX %lu", &ftr->tx_bw) == 1 ||
+			sscanf(line, "BWRX %lu", &ftr->rx_bw) == 1)
+		return true;
+
+	switch (sscanf(line, "%d,%d", &tx, &rx)) {
+	case 1:
+		rx = tx;
+		/* FALLTHROUGH */
+	case 2:
+		if (ftr->ntaps == FIR_FILTER_MAX_TAPS)
+			return false;
+		ftr->tx_taps[ftr->ntaps] = tx;
+		ftr->rx_taps[ftr->ntaps] = rx;
+		ftr->ntaps++;
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* Parses a .ftr file, "@FILTERS@/" points to the filters shipped with osc */
+struct fir_filter_file * fir_filter_file_load(const char *file_name)
+{
+	struct fir_filter_file *ftr;
+	char line[128];
+	gchar *path;
+	bool ok = true;
+	FILE *f;
+
+	path = fir_filter_path(file_name);
+	if (!path)
+		return NULL;
+
+	f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "Failed to open FIR filter %s: %s\n",
+				path, strerror(errno));
+		g_free(path);
+		return NULL;
+	}
+
+	ftr = g_new0(struct fir_filter_file, 1);
+	ftr->tx_int = 1;
+	ftr->rx_dec = 1;
+
+	while (ok && fgets(line, sizeof(line), f))
+		ok = fir_filter_parse_line(ftr, line);
+	fclose(f);
+
+	if (!ok || !ftr->ntaps || !ftr->tx_int || !ftr->rx_dec) {
+		fprintf(stderr, "Invalid FIR filter file %s\n", path);
+		g_free(ftr);
+		ftr = NULL;
+	}
+
+	g_free(path);
+	return ftr;
+}
+
+void fir_filter_file_free(struct fir_filter_file *ftr)
+{
+	if (!ftr)
+		return;
+
+	g_free(ftr->rx_response);
+	g_free(ftr);
+}
+
+/* Fills 'taps' with the RX coefficients as the hardware applies them: Q15
+ * with the filter gain folded in. Returns the number of taps. */
+unsigned int fir_filter_file_rx_taps(const struct fir_filter_file *ftr,
+		float *taps)
+{
+	float scale = pow(10.0, ftr->rx_gain / 20.0) / 32768.0;
+	unsigned int i;
+
+	for (i = 0; i < ftr->ntaps; i++)
+		taps[i] = ftr->rx_taps[i] * scale;
+
+	return ftr->ntaps;
+}
+
+/* RX magnitude response in dB, FIR_FILTER_RESPONSE_LEN points from DC to
+ * half the filter input rate. Computed on first use and kept with 'ftr'. */
+const float * fir_filter_file_rx_response(struct fir_filter_file *ftr)
+{
+	float taps[FIR_FILTER_MAX_TAPS];
+	float *resp = ftr->rx_response;
+	double mag;
+	unsigned int i, n;
+
+	if (resp)
+		return resp;
+
+	if (!fir_fft.plan) {
+		fir_fft.in = fftw_malloc(sizeof(double) * FIR_FILTER_FFT_SIZE);
+		fir_fft.out = fftw_malloc(sizeof(fftw_complex) *
+				FIR_FILTER_RESPONSE_LEN);
+		fir_fft.plan = fftw_plan_dft_r2c_1d(FIR_FILTER_FFT_SIZE,
+				fir_fft.in, fir_fft.out, FFTW_ESTIMATE);
+	}
+
+	n = fir_filter_file_rx_taps(ftr, taps);
+	for (i = 0; i < FIR_FILTER_FFT_SIZE; i++)
+		fir_fft.in[i] = i < n ? taps[i] : 0.0;
+	fftw_execute(fir_fft.plan);
+
+	resp = g_new(float, FIR_FILTER_RESPONSE_LEN);
+	for (i = 0; i < FIR_FILTER_RESPONSE_LEN; i++) {
+		mag = sqrt(fir_fft.out[i][0] * fir_fft.out[i][0] +
+				fir_fft.out[i][1] * fir_fft.out[i][1]);
+		resp[i] = 20 * log10(mag + 1E-15);
+	}
+
+	ftr->rx_response = resp;
+	return resp;
+}
 
 int load_fir_filter(const char *file_name,
 		struct iio_device *dev1, struct iio_device *dev2,
@@ -23,21 +193,13 @@ int load_fir_filter(const char *file_name,
 {
 	bool rx = false, tx = false;
 	int ret = -ENOMEM;
-	gchar *ptr, *path = NULL;
+	gchar *path;
 	FILE *f;
 
-	if (!strncmp(file_name, "@FILTERS@/", sizeof("@FILTERS@/") - 1))
-		path = g_build_filename(OSC_FILTER_FILE_PATH,
-				file_name + sizeof("@FILTERS@/") - 1, NULL);
-	else
-		path = g_strdup(file_name);
+	path = fir_filter_path(file_name);
 	if (!path)
 		goto err_set_filename;
 
-	for (ptr = path; *ptr; ptr++)
-		if (*ptr == '/')
-			*ptr = G_DIR_SEPARATOR_S[0];
-
 	f = fopen(path, "r");
 	if (f) {
 		char *buf;
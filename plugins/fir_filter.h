@@ -12,6 +12,30 @@
 
 struct iio_device;
 
+/* The AD9361 takes up to 128 taps per filter */
+#define FIR_FILTER_MAX_TAPS	128
+/* Points of the cached magnitude response, from DC to half the input rate */
+#define FIR_FILTER_RESPONSE_LEN	1025
+
+/* Contents of a .ftr file, the TX taps are first on each coefficient line */
+struct fir_filter_file {
+	unsigned int ntaps;
+	short tx_taps[FIR_FILTER_MAX_TAPS];
+	short rx_taps[FIR_FILTER_MAX_TAPS];
+	int tx_gain, rx_gain;			/* dB */
+	unsigned int tx_int, rx_dec;
+	unsigned long tx_rates[6], rx_rates[6];	/* RTX/RRX, 0 if absent */
+	unsigned long tx_bw, rx_bw;		/* BWTX/BWRX, 0 if absent */
+
+	float *rx_response;			/* dB */
+};
+
+struct fir_filter_file * fir_filter_file_load(const char *file_name);
+void fir_filter_file_free(struct fir_filter_file *ftr);
+unsigned int fir_filter_file_rx_taps(const struct fir_filter_file *ftr,
+		float *taps);
+const float * fir_filter_file_rx_response(struct fir_filter_file *ftr);
+
 int load_fir_filter(const char *file_name,
 		struct iio_device *dev1, struct iio_device *dev2,
 		GtkWidget *panel, GtkFileChooser *chooser,
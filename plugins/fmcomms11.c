@@ -380,6 +380,25 @@ static void context_destroy(const char *ini_fn)
 	osc_destroy_context(ctx);
 }
 
+/* Same hardware behind a new link: swap the handles, keep the panel */
+static void fmcomms11_reconnect(void)
+{
+	struct iio_context *new_ctx = osc_create_context();
+
+	dac = osc_device_rebind(new_ctx, dac);
+	adc = osc_device_rebind(new_ctx, adc);
+	vga = osc_device_rebind(new_ctx, vga);
+	attn = osc_device_rebind(new_ctx, attn);
+
+	iio_rebind_widgets(tx_widgets, num_tx, new_ctx);
+	iio_rebind_widgets(rx_widgets, num_rx, new_ctx);
+	if (dac_tx_manager)
+		dac_data_manager_reconnect(dac_tx_manager, new_ctx);
+
+	osc_destroy_context(ctx);
+	ctx = new_ctx;
+}
+
 static bool fmcomms11_identify(void)
 {
 	/* Use the OSC's IIO context just to detect the devices */
@@ -402,5 +421,6 @@ struct osc_plugin plugin = {
 	.handle_item = fmcomms11_handle,
 	.save_profile = save_profile,
 	.load_profile = load_profile,
+	.reconnect = fmcomms11_reconnect,
 	.destroy = context_destroy,
 };
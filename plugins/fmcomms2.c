@@ -413,8 +413,37 @@ static void rssi_update_labels(void)
 	}
 }
 
+/* Captured frames carry the gain of the RX path they came from, the AGC
+ * may change it at any time */
+static void rx_gain_info_update(void)
+{
+	static const char * const cap_channels[][2] = {
+		{ "voltage0", "voltage1" },
+		{ "voltage2", "voltage3" },
+	};
+	struct iio_channel *ch;
+	unsigned int i;
+	double gain;
+
+	if (!cap)
+		return;
+
+	for (i = 0; i < (is_2rx_2tx ? 2 : 1); i++) {
+		ch = iio_device_find_channel(dev, i ? "voltage1" : "voltage0",
+				false);
+		if (!ch || iio_channel_attr_read_double(ch, "hardwaregain",
+					&gain))
+			continue;
+
+		rx_update_channel_gain(CAP_DEVICE, cap_channels[i][0], gain);
+		rx_update_channel_gain(CAP_DEVICE, cap_channels[i][1], gain);
+	}
+}
+
 static gboolean update_display(void)
 {
+	rx_gain_info_update();
+
 	if (this_page == gtk_notebook_get_current_page(nbook) || plugin_detached) {
 		const char *gain_mode;
 
@@ -2108,6 +2137,29 @@ static void context_destroy(const char *ini_fn)
 	osc_destroy_context(ctx);
 }
 
+/* Same hardware behind a new link: swap the handles, keep the panel */
+static void fmcomms2_reconnect(void)
+{
+	struct iio_context *new_ctx = osc_create_context();
+
+	g_source_remove_by_user_data(ctx);
+
+	dev = osc_device_rebind(new_ctx, dev);
+	dds = osc_device_rebind(new_ctx, dds);
+	cap = osc_device_rebind(new_ctx, cap);
+	udc_rx = osc_device_rebind(new_ctx, udc_rx);
+	udc_tx = osc_device_rebind(new_ctx, udc_tx);
+
+	iio_rebind_widgets(widgets, num_glb + num_tx + num_rx + num_fpga, new_ctx);
+	if (dac_tx_manager)
+		dac_data_manager_reconnect(dac_tx_manager, new_ctx);
+
+	osc_destroy_context(ctx);
+	ctx = new_ctx;
+
+	g_timeout_add(1000, (GSourceFunc) update_display, ctx);
+}
+
 struct osc_plugin plugin;
 
 static bool fmcomms2_identify(void)
@@ -2132,5 +2184,6 @@ struct osc_plugin plugin = {
 	.get_preferred_size = fmcomms2_get_preferred_size,
 	.save_profile = save_profile,
 	.load_profile = load_profile,
+	.reconnect = fmcomms2_reconnect,
 	.destroy = context_destroy,
 };
@@ -85,6 +85,8 @@ struct w_info {
 	const char * const name;
 };
 
+static struct iio_attr_map *attr_map;
+
 static struct w_info attrs[] = {
 	{SPINBUTTON, "adi,agc-adc-large-overload-exceed-counter"},
 	{SPINBUTTON, "adi,agc-adc-large-overload-inc-steps"},
@@ -1096,10 +1098,9 @@ static void bist_tone_cb (GtkWidget *widget, gpointer data)
 
 }
 
-static char * set_widget_value(GtkWidget *widget, struct w_info *item, int val)
+static char * set_widget_value(GtkWidget *widget, struct w_info *item, int bit,
+		int val)
 {
-	char str[80];
-	int bit, ret;
 
 	switch (item->type) {
 		case CHECKBOX:
@@ -1117,8 +1118,7 @@ static char * set_widget_value(GtkWidget *widget, struct w_info *item, int val)
 			gtk_combo_box_set_active(GTK_COMBO_BOX(widget), val);
 			return "changed";
 		case CHECKBOX_MASK:
-			ret = sscanf(item->name, "%[^'#']#%d", str, &bit);
-			if (ret != 2)
+			if (bit < 0)
 				break;
 			gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(widget), !!(val & (1 << bit)));
 			return "toggled";
@@ -1127,40 +1127,37 @@ static char * set_widget_value(GtkWidget *widget, struct w_info *item, int val)
 
 	return NULL;
 }
-static void connect_widget(GtkBuilder *builder, struct w_info *item, int val)
+static void connect_widget(GtkBuilder *builder, struct w_info *item, int bit,
+		int val)
 {
 	char *signal = NULL;
 	GtkWidget *widget;
 	widget = GTK_WIDGET(gtk_builder_get_object(builder, item->name));
-	signal = set_widget_value(widget, item, val);
+	signal = set_widget_value(widget, item, bit, val);
 	g_builder_connect_signal(builder, item->name, signal,
 		G_CALLBACK(signal_handler_cb), item);
 }
 
-static void update_widget(GtkBuilder *builder, struct w_info *item, int val)
+static void update_widget(GtkBuilder *builder, struct w_info *item, int bit,
+		int val)
 {
 	GtkWidget *widget;
 
 	widget = GTK_WIDGET(gtk_builder_get_object(builder, item->name));
-	set_widget_value(widget, item, val);
+	set_widget_value(widget, item, bit, val);
 }
 
 static int __connect_widget(struct iio_device *dev, const char *attr,
 		const char *value, size_t len, void *d)
 {
-	unsigned int i, nb_items = ARRAY_SIZE(attrs);
+	const struct iio_attr_map_entry *entries;
 	GtkBuilder *builder = (GtkBuilder *) d;
-	char str[80];
-	int bit, ret;
+	unsigned int i, count;
 
-	for (i = 0; i < nb_items; i++) {
-		ret = sscanf(attrs[i].name, "%[^'#']#%d", str, &bit);
-		if (!strcmp(str, attr)) {
-			connect_widget(builder, &attrs[i], atoi(value));
-			if (ret == 1)
-				return 0;
-		}
-	}
+	entries = iio_attr_map_lookup(attr_map, attr, &count);
+	for (i = 0; i < count; i++)
+		connect_widget(builder, entries[i].data, entries[i].bit,
+				atoi(value));
 
 	return 0;
 }
@@ -1168,26 +1165,29 @@ static int __connect_widget(struct iio_device *dev, const char *attr,
 static int __update_widget(struct iio_device *dev, const char *attr,
 		const char *value, size_t len, void *d)
 {
-	unsigned int i, nb_items = ARRAY_SIZE(attrs);
+	const struct iio_attr_map_entry *entries;
 	GtkBuilder *builder = (GtkBuilder *) d;
-	char str[80];
-	int bit, ret;
+	unsigned int i, count;
 
-	for (i = 0; i < nb_items; i++) {
-
-		ret = sscanf(attrs[i].name, "%[^'#']#%d", str, &bit);
-		if (!strcmp(str, attr)) {
-			update_widget(builder, &attrs[i], atoi(value));
-			if (ret == 1)
-				return 0;
-		}
-	}
+	entries = iio_attr_map_lookup(attr_map, attr, &count);
+	for (i = 0; i < count; i++)
+		update_widget(builder, entries[i].data, entries[i].bit,
+				atoi(value));
 
 	return 0;
 }
 
 static int connect_widgets(GtkBuilder *builder)
 {
+	unsigned int i;
+
+	/* Built once, refreshes then cost one lookup per attribute */
+	if (!attr_map) {
+		attr_map = iio_attr_map_new();
+		for (i = 0; i < ARRAY_SIZE(attrs); i++)
+			iio_attr_map_add(attr_map, attrs[i].name, &attrs[i]);
+	}
+
 	return iio_device_debug_attr_read_all(dev, __connect_widget, builder);
 }
 
@@ -1432,6 +1432,8 @@ static void context_destroy(const char *ini_fn)
 {
 	save_profile(ini_fn);
 	osc_destroy_context(ctx);
+	iio_attr_map_free(attr_map);
+	attr_map = NULL;
 }
 
 static bool fmcomms2adv_identify(void)
@@ -1736,6 +1736,32 @@ static void context_destroy(const char *ini_fn)
 	osc_destroy_context(ctx);
 }
 
+/* Same hardware behind a new link: swap the handles, keep the panel */
+static void fmcomms5_reconnect(void)
+{
+	struct iio_context *new_ctx = osc_create_context();
+
+	g_source_remove_by_user_data(ctx);
+
+	dev1 = osc_device_rebind(new_ctx, dev1);
+	dds1 = osc_device_rebind(new_ctx, dds1);
+	cap1 = osc_device_rebind(new_ctx, cap1);
+	dev2 = osc_device_rebind(new_ctx, dev2);
+	dds2 = osc_device_rebind(new_ctx, dds2);
+	cap2 = osc_device_rebind(new_ctx, cap2);
+
+	iio_rebind_widgets(glb_widgets, num_glb, new_ctx);
+	iio_rebind_widgets(tx_widgets, num_tx, new_ctx);
+	iio_rebind_widgets(rx_widgets, num_rx, new_ctx);
+	if (dac_tx_manager)
+		dac_data_manager_reconnect(dac_tx_manager, new_ctx);
+
+	osc_destroy_context(ctx);
+	ctx = new_ctx;
+
+	g_timeout_add(1000, (GSourceFunc) update_display, ctx);
+}
+
 struct osc_plugin plugin;
 
 static bool fmcomms5_identify(void)
@@ -1767,5 +1793,6 @@ struct osc_plugin plugin = {
 	.get_preferred_size = fmcomms5_get_preferred_size,
 	.save_profile = save_profile,
 	.load_profile = load_profile,
+	.reconnect = fmcomms5_reconnect,
 	.destroy = context_destroy,
 };
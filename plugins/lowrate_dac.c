@@ -0,0 +1,257 @@
+/**
+ * Copyright (C) 2019 Analog Devices, Inc.
+ *
+ * Licensed under the GPL-2.
+ *
+ */
+
+#include <glib.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lowrate_dac.h"
+
+struct lowrate_dac {
+	struct iio_device *dev;
+	size_t block_samples;
+	struct iio_buffer *buffer;
+	enum lowrate_dac_mode mode;
+
+	GThread *thread;
+	volatile bool stop;
+	lowrate_dac_fill_cb fill;
+	void *user_data;
+
+	/* Periodic waveform, when it has to be streamed */
+	uint8_t *period;
+	size_t period_bytes;
+	size_t period_pos;
+
+	/* Block generator of a non-periodic stream */
+	lowrate_dac_gen_cb gen;
+	void *gen_data;
+	unsigned long long gen_pos;
+
+	volatile unsigned long long blocks;
+	volatile uint64_t cpu_ns;
+	uint64_t start_ns;
+};
+
+static uint64_t clock_ns(clockid_t clock)
+{
+	struct timespec ts;
+
+	if (clock_gettime(clock, &ts))
+		return 0;
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t thread_cpu_ns(void)
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+	return clock_ns(CLOCK_THREAD_CPUTIME_ID);
+#else
+	return 0;
+#endif
+}
+
+static gpointer lowrate_dac_thread(struct lowrate_dac *dac)
+{
+	uint64_t cpu_start = thread_cpu_ns();
+	ptrdiff_t step = iio_buffer_step(dac->buffer);
+	size_t samples;
+	ssize_t ret;
+	void *buf;
+
+	while (!dac->stop) {
+		buf = iio_buffer_start(dac->buffer);
+		samples = ((char *) iio_buffer_end(dac->buffer) - (char *) buf) / step;
+
+		if (!dac->fill(buf, samples, step, dac->user_data))
+			break;
+
+		/* Blocks until the device is ready for the next block */
+		ret = iio_buffer_push(dac->buffer);
+		if (ret < 0) {
+			fprintf(stderr, "Error while writing to the DAC buffer: %s\n",
+					strerror(-ret));
+			break;
+		}
+
+		dac->blocks++;
+		dac->cpu_ns = thread_cpu_ns() - cpu_start;
+	}
+
+	return NULL;
+}
+
+/* Copies whole runs of the period instead of going sample by sample */
+static bool lowrate_dac_fill_periodic(void *buf, size_t samples, size_t step,
+		void *user_data)
+{
+	struct lowrate_dac *dac = user_data;
+	size_t left = samples * step, len;
+	uint8_t *out = buf;
+
+	while (left) {
+		len = dac->period_bytes - dac->period_pos;
+		if (len > left)
+			len = left;
+		memcpy(out, dac->period + dac->period_pos, len);
+		out += len;
+		left -= len;
+		dac->period_pos = (dac->period_pos + len) % dac->period_bytes;
+	}
+
+	return true;
+}
+
+/* Hands the generator whole blocks, with their position in the stream */
+static bool lowrate_dac_fill_generated(void *buf, size_t samples, size_t step,
+		void *user_data)
+{
+	struct lowrate_dac *dac = user_data;
+
+	if (!dac->gen(buf, dac->gen_pos, samples, dac->gen_data))
+		return false;
+
+	dac->gen_pos += samples;
+	return true;
+}
+
+static int lowrate_dac_start_thread(struct lowrate_dac *dac,
+		lowrate_dac_fill_cb fill, void *user_data)
+{
+	dac->buffer = iio_device_create_buffer(dac->dev, dac->block_samples, false);
+	if (!dac->buffer)
+		return -errno;
+
+	dac->fill = fill;
+	dac->user_data = user_data;
+	dac->stop = false;
+	dac->blocks = 0;
+	dac->cpu_ns = 0;
+	dac->start_ns = clock_ns(CLOCK_MONOTONIC);
+	dac->mode = LOWRATE_DAC_STREAMING;
+	dac->thread = g_thread_new("lowrate_dac", (GThreadFunc) lowrate_dac_thread, dac);
+
+	return 0;
+}
+
+void lowrate_dac_stop(struct lowrate_dac *dac)
+{
+	if (dac->thread) {
+		dac->stop = true;
+		g_thread_join(dac->thread);
+		dac->thread = NULL;
+	}
+
+	if (dac->buffer) {
+		iio_buffer_destroy(dac->buffer);
+		dac->buffer = NULL;
+	}
+
+	g_free(dac->period);
+	dac->period = NULL;
+	dac->mode = LOWRATE_DAC_STOPPED;
+}
+
+/* 'period' holds 'samples' samples laid out as in the device buffer */
+int lowrate_dac_play_periodic(struct lowrate_dac *dac,
+		const void *period, size_t samples)
+{
+	size_t sample_size = iio_device_get_sample_size(dac->dev);
+	size_t reps, i;
+	uint8_t *buf;
+
+	lowrate_dac_stop(dac);
+
+	if (!samples || !sample_size)
+		return -EINVAL;
+
+	dac->period_bytes = samples * sample_size;
+	dac->period = g_memdup(period, dac->period_bytes);
+	dac->period_pos = 0;
+
+	/* Whole periods only, so the buffer wraps seamlessly */
+	reps = (dac->block_samples + samples - 1) / samples;
+
+	dac->buffer = iio_device_create_buffer(dac->dev, reps * samples, true);
+	if (dac->buffer) {
+		buf = iio_buffer_start(dac->buffer);
+		for (i = 0; i < reps; i++)
+			memcpy(buf + i * dac->period_bytes, dac->period,
+					dac->period_bytes);
+
+		if (iio_buffer_push(dac->buffer) >= 0) {
+			dac->mode = LOWRATE_DAC_CYCLIC;
+			return 0;
+		}
+
+		iio_buffer_destroy(dac->buffer);
+		dac->buffer = NULL;
+	}
+
+	/* No cyclic buffer support, stream it */
+	return lowrate_dac_start_thread(dac, lowrate_dac_fill_periodic, dac);
+}
+
+int lowrate_dac_play_stream(struct lowrate_dac *dac,
+		lowrate_dac_fill_cb fill, void *user_data)
+{
+	lowrate_dac_stop(dac);
+
+	return lowrate_dac_start_thread(dac, fill, user_data);
+}
+
+int lowrate_dac_play_generator(struct lowrate_dac *dac,
+		lowrate_dac_gen_cb gen, void *user_data)
+{
+	lowrate_dac_stop(dac);
+
+	dac->gen = gen;
+	dac->gen_data = user_data;
+	dac->gen_pos = 0;
+
+	return lowrate_dac_start_thread(dac, lowrate_dac_fill_generated, dac);
+}
+
+void lowrate_dac_get_stats(struct lowrate_dac *dac,
+		struct lowrate_dac_stats *stats)
+{
+	uint64_t wall = clock_ns(CLOCK_MONOTONIC) - dac->start_ns;
+
+	stats->mode = dac->mode;
+	stats->blocks = dac->blocks;
+	stats->cpu_load = 0.0;
+	if (dac->mode == LOWRATE_DAC_STREAMING && wall)
+		stats->cpu_load = 100.0 * dac->cpu_ns / wall;
+}
+
+struct lowrate_dac *lowrate_dac_new(struct iio_device *dev,
+		size_t block_samples)
+{
+	struct lowrate_dac *dac;
+
+	if (!dev || !block_samples)
+		return NULL;
+
+	dac = g_new0(struct lowrate_dac, 1);
+	dac->dev = dev;
+	dac->block_samples = block_samples;
+
+	return dac;
+}
+
+void lowrate_dac_free(struct lowrate_dac *dac)
+{
+	if (!dac)
+		return;
+
+	lowrate_dac_stop(dac);
+	g_free(dac);
+}
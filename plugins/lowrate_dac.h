@@ -0,0 +1,65 @@
+/**
+ * Copyright (C) 2019 Analog Devices, Inc.
+ *
+ * Licensed under the GPL-2.
+ *
+ */
+
+#ifndef __LOWRATE_DAC__
+#define __LOWRATE_DAC__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <iio.h>
+
+/*
+ * Output helper for slow, trigger-paced DACs.
+ *
+ * A periodic waveform is pushed once as a cyclic buffer and costs no CPU
+ * afterwards. When the device can't do cyclic buffers, or the signal is not
+ * periodic, a thread has a block generator fill whole blocks and pushes
+ * them; the push blocks until the device drained the previous one, so the
+ * thread only runs once per block. The channels and the trigger must be set up by the caller.
+ */
+
+enum lowrate_dac_mode {
+	LOWRATE_DAC_STOPPED,
+	LOWRATE_DAC_CYCLIC,
+	LOWRATE_DAC_STREAMING,
+};
+
+/* Fills 'samples' samples of 'step' bytes each. Returns false to stop. */
+typedef bool (*lowrate_dac_fill_cb)(void *buf, size_t samples, size_t step,
+		void *user_data);
+
+/*
+ * Generates the block of 'samples' samples starting at sample 'first' of the
+ * stream, laid out as in the device buffer. Returns false to stop.
+ */
+typedef bool (*lowrate_dac_gen_cb)(void *block, unsigned long long first,
+		size_t samples, void *user_data);
+
+struct lowrate_dac_stats {
+	enum lowrate_dac_mode mode;
+	unsigned long long blocks;
+	double cpu_load;	/* of the streaming thread, % of one core */
+};
+
+struct lowrate_dac;
+
+struct lowrate_dac *lowrate_dac_new(struct iio_device *dev,
+		size_t block_samples);
+void lowrate_dac_free(struct lowrate_dac *dac);
+
+int lowrate_dac_play_periodic(struct lowrate_dac *dac,
+		const void *period, size_t samples);
+int lowrate_dac_play_stream(struct lowrate_dac *dac,
+		lowrate_dac_fill_cb fill, void *user_data);
+int lowrate_dac_play_generator(struct lowrate_dac *dac,
+		lowrate_dac_gen_cb gen, void *user_data);
+void lowrate_dac_stop(struct lowrate_dac *dac);
+
+void lowrate_dac_get_stats(struct lowrate_dac *dac,
+		struct lowrate_dac_stats *stats);
+
+#endif /* __LOWRATE_DAC__ */
@@ -86,6 +86,13 @@ struct scpi_instrument {
 	int          ttyfd;
 	int          gpib_addr;
 
+	/* answered in-process by the instrument simulator */
+	bool         simulated;
+	const char   *sim_id;
+
+	/* the transport runs on its own thread, fed by this queue */
+	GThread      *worker;
+	GAsyncQueue  *queue;
 };
 
 struct mag_seek {
@@ -120,6 +127,9 @@ static char *supported_counters[] = {
 
 #define SOCKETS_BUFFER_SIZE  1024
 #define SOCKETS_TIMEOUT      2
+#define SCPI_OPC_TIMEOUT_MS  10000
+#define SCPI_RECONNECT_TRIES 3
+#define SCPI_RECONNECT_DELAY_MS 100
 
 #define DEFAULT_SCPI_IP_ADDR      "192.168.0.1"
 #define DEFAULT_SCPI_IP_PORT      5025
@@ -140,8 +150,10 @@ static char *supported_counters[] = {
  * Network communications functions
  */
 
-/* Wait for data to become available */
-static int network_waitfordata(int MySocket)
+/* Wait up to timeout_ms for data to become available on a descriptor.
+ * Returns 1 when readable, 0 on timeout and a negative errno on error.
+ */
+static int network_waitfordata(int MySocket, int timeout_ms)
 {
 	fd_set MyFDSet;
 	struct timeval tv;
@@ -154,50 +166,77 @@ static int network_waitfordata(int MySocket)
 	FD_SET(MySocket, &MyFDSet);
 
 	/* Set Timeout */
-	tv.tv_sec = SOCKETS_TIMEOUT;
-	tv.tv_usec = 0;
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
 
 	/* Wait for change */
-	retval = select(MySocket+1, &MyFDSet, NULL, NULL, &tv);
+	do {
+		retval = select(MySocket+1, &MyFDSet, NULL, NULL, &tv);
+	} while (retval == -1 && errno == EINTR);
 
 	/* Interpret return value */
 	if(retval == -1) {
-		printf("Error: Problem with select (%i)...\n", errno);
-		perror(__func__);
-		exit(1);
+		retval = -errno;
+		fprintf(stderr, "SCPI: %s: select failed: %s\n",
+				__func__, strerror(errno));
 	}
 
 	/* 0 = timeout, 1 = socket status has changed */
 	return retval;
 }
 
-static int scpi_network_read(struct scpi_instrument *scpi)
+static void network_disconnect(struct scpi_instrument *scpi)
+{
+	if (scpi->control_socket && scpi->control_socket != scpi->main_socket)
+		close(scpi->control_socket);
+	if (scpi->main_socket)
+		close(scpi->main_socket);
+	scpi->control_socket = 0;
+	scpi->main_socket = 0;
+}
+
+/* Read one response, up to its line terminator. Queries are answered in
+ * order, so several commands may be in flight before this is called.
+ */
+static int scpi_network_read_timeout(struct scpi_instrument *scpi, int timeout_ms)
 {
-	int actual;
+	int actual, total = 0, ret;
 
-	/* Wait for data to become available */
-	if (network_waitfordata(scpi->control_socket) == 0) {
-		scpi->response[0] = 0;
-		return 0;
-	}
+	scpi->response[0] = 0;
+	do {
+		/* Wait for data to become available */
+		ret = network_waitfordata(scpi->control_socket, timeout_ms);
+		if (ret <= 0)
+			break;
 
-	/* Read data */
+		/* Read data */
+		actual = recv(scpi->control_socket, scpi->response + total,
+				SOCKETS_BUFFER_SIZE - 1 - total, 0);
+		if (actual <= 0) {
+			ret = actual ? -errno : -ECONNRESET;
+			fprintf(stderr, "SCPI: %s: connection to %s lost: %s\n",
+					__func__, scpi->ip_address, strerror(-ret));
+			network_disconnect(scpi);
+			break;
+		}
+		total += actual;
+		scpi->response[total] = 0;
+	} while (total < SOCKETS_BUFFER_SIZE - 1 &&
+			!memchr(scpi->response, '\n', total));
 
-	actual = recv(scpi->control_socket, scpi->response,
-			SOCKETS_BUFFER_SIZE, 0);
-	if (actual == -1) {
-		printf("Error: Unable to receive data (%i)...\n", errno);
-		perror(__func__);
-		exit(1);
-	} else {
-		scpi->response[actual]=0;
-	}
+	if (ret < 0)
+		return ret;
+
+	return total;
+}
 
-	return actual;
+static int scpi_network_read(struct scpi_instrument *scpi)
+{
+	return scpi_network_read_timeout(scpi, SOCKETS_TIMEOUT * 1000);
 }
 
 /* Turn NOdelay on */
-static void network_setnodelay(int MySocket)
+static int network_setnodelay(int MySocket)
 {
 	int StateNODELAY = 1;
 	int ret;
@@ -206,11 +245,11 @@ static void network_setnodelay(int MySocket)
 			(void *)&StateNODELAY, sizeof StateNODELAY);
 
 	if (ret == -1) {
-		printf("Error: Unable to set NODELAY option (%i)...\n", errno);
-		perror("sockets");
-		exit(1);
+		ret = -errno;
+		fprintf(stderr, "SCPI: Unable to set NODELAY option: %s\n",
+				strerror(errno));
 	}
-	return;
+	return ret;
 }
 
 static int __attribute__ ((warn_unused_result))
@@ -255,18 +294,21 @@ network_connect(struct scpi_instrument *scpi)
 	}
 
 	/* Minimize latency by setting TCP_NODELAY option */
-	network_setnodelay(scpi->main_socket);
+	if (network_setnodelay(scpi->main_socket) < 0)
+		return -1;
 
 	/* Ask for control port */
 	sprintf(buf, "SYST:COMM:TCPIP:CONTROL?\n");
-	status = send(scpi->main_socket, buf, strlen(buf), 0);
+	status = send(scpi->main_socket, buf, strlen(buf), MSG_NOSIGNAL);
 	if (status == -1)
 		return -1;
 
-	if (scpi_network_read((scpi)) == 0) {
-		scpi->control_socket = scpi->main_socket;
-		return 0;
-	}
+	/* Instruments without a control port keep using the main one, but a
+	 * read error already closed it */
+	scpi->control_socket = scpi->main_socket;
+	status = scpi_network_read(scpi);
+	if (status <= 0)
+		return status;
 
 	sscanf(scpi->response, "%" SCNd16, &scpi->control_port);
 
@@ -303,15 +345,6 @@ static int tty_read(struct scpi_instrument *scpi)
 	int n, i, end = 0;
 	int byte_count = 0;
 
-	/* Number of seconds before signaling a tty read timeout. */
-	struct timespec ts_current, ts_end;
-	unsigned long long nsecs;
-	clock_gettime(CLOCK_MONOTONIC, &ts_current);
-	nsecs = ts_current.tv_nsec + (SOCKETS_TIMEOUT * pow(10.0, 9));
-	ts_end.tv_sec = ts_current.tv_sec + (nsecs / pow(10.0, 9));
-	ts_end.tv_nsec = nsecs % (unsigned long long) pow(10.0, 9);
-	ts_end.tv_nsec = ts_current.tv_nsec;
-
 	do {
 		n = read(scpi->ttyfd, (char *)scpi->response + byte_count,
 				SOCKETS_BUFFER_SIZE - byte_count);
@@ -324,19 +357,19 @@ static int tty_read(struct scpi_instrument *scpi)
 					scpi->response[i + 1] = 0;
 				}
 		} else {
-			/* Raw mode does non-blocking I/O by default so try to read data
-			 * until some exists.
+			/* Raw mode does non-blocking I/O by default, so sleep
+			 * until the line has data instead of spinning on read().
 			 */
 			if (errno == EAGAIN) {
-				if (timespeccmp(&ts_current, &ts_end, >) != 0) {
+				if (network_waitfordata(scpi->ttyfd, SOCKETS_TIMEOUT * 1000) <= 0) {
 					fprintf(stderr, "SCPI: reading from TTY timed out\n");
 					return -ETIMEDOUT;
 				}
-				clock_gettime(CLOCK_MONOTONIC, &ts_current);
 				continue;
 			} else {
 				print_output_sys(stderr, "%s: Can't read from TTY device: %s %s (%d)\n",
 					__func__, scpi->tty_path, strerror(errno), errno);
+				return -errno;
 			}
 		}
 	} while (byte_count < SOCKETS_BUFFER_SIZE && (end == 0));
@@ -439,30 +472,152 @@ static int tty_connect(struct scpi_instrument *scpi)
 }
 
 
+/*
+ * Instrument simulator
+ *
+ * Answers the subset of SCPI used by this plugin in-process, so sweeps and
+ * seeks can be exercised without lab equipment. The generator, analyzer and
+ * counter share one state: the analyzer markers see the generator output.
+ */
+
+#define SIM_GENERATOR_ID "Analog Devices,SCPI Simulator Generator,0,1.0"
+#define SIM_ANALYZER_ID "Analog Devices,SCPI Simulator Analyzer,0,1.0"
+
+static struct {
+	double power_dBm;
+	unsigned long long freq;
+	bool output;
+} sim_state = { -20.0, 1000000000ULL, false };
+/* each instrument talks to the simulator from its own thread */
+G_LOCK_DEFINE_STATIC(sim_state);
+
+static void scpi_sim_command(struct scpi_instrument *scpi, char *cmd, GString *reply)
+{
+	double level;
+	char *arg;
+
+	g_strstrip(cmd);
+	if (!cmd[0])
+		return;
+
+	arg = strchr(cmd, ' ');
+	if (arg)
+		*arg++ = 0;
+
+	if (!g_ascii_strcasecmp(cmd, "*IDN?")) {
+		g_string_append_printf(reply, "%s;", scpi->sim_id);
+	} else if (!g_ascii_strcasecmp(cmd, "*OPC?")) {
+		g_string_append(reply, "1;");
+	} else if (!g_ascii_strcasecmp(cmd, ":POW?")) {
+		g_string_append_printf(reply, "%f;", sim_state.power_dBm);
+	} else if (!g_ascii_strcasecmp(cmd, ":POW") && arg) {
+		sim_state.power_dBm = atof(arg);
+	} else if (!g_ascii_strcasecmp(cmd, ":FREQ:CW") && arg) {
+		sim_state.freq = strtoull(arg, NULL, 10);
+	} else if (!g_ascii_strcasecmp(cmd, ":OUTPut") && arg) {
+		sim_state.output = !g_ascii_strncasecmp(arg, "ON", 2);
+	} else if (!g_ascii_strncasecmp(cmd, "CALC:MARK", 9) && g_str_has_suffix(cmd, ":Y?")) {
+		level = sim_state.output ? sim_state.power_dBm : -120.0;
+		g_string_append_printf(reply, "%f;", level);
+	} else if (g_str_has_suffix(cmd, "FREQ?")) {
+		/* markers and counters: an ideal counter reads the requested value */
+		if (arg)
+			g_string_append_printf(reply, "%E;", atof(arg));
+		else
+			g_string_append_printf(reply, "%E;", (double)sim_state.freq);
+	}
+	/* everything else is accepted and ignored */
+}
+
+static ssize_t scpi_sim_write(struct scpi_instrument *scpi, const void *buf, size_t count)
+{
+	GString *reply = g_string_new(NULL);
+	gchar **cmds, *line;
+	unsigned int i;
+
+	line = g_strndup(buf, count);
+	cmds = g_strsplit_set(line, ";\r\n", 0);
+	G_LOCK(sim_state);
+	for (i = 0; cmds[i]; i++)
+		scpi_sim_command(scpi, cmds[i], reply);
+	G_UNLOCK(sim_state);
+
+	if (reply->len) {
+		/* multiple queries on one line are answered ';' separated */
+		reply->str[reply->len - 1] = '\n';
+		snprintf(scpi->response, SOCKETS_BUFFER_SIZE, "%s", reply->str);
+	}
+
+	g_strfreev(cmds);
+	g_free(line);
+	g_string_free(reply, TRUE);
+
+	return count;
+}
+
 /* Main SCPI functions */
 
+/* Re-establish a dropped network connection, backing off between tries */
+static int scpi_network_reconnect(struct scpi_instrument *scpi)
+{
+	unsigned int i, delay = SCPI_RECONNECT_DELAY_MS;
+
+	network_disconnect(scpi);
+	for (i = 0; i < SCPI_RECONNECT_TRIES; i++) {
+		if (network_connect(scpi) == 0)
+			return 0;
+		network_disconnect(scpi);
+		g_usleep(delay * 1000);
+		delay *= 2;
+	}
+
+	fprintf(stderr, "SCPI: giving up on %s after %d attempts\n",
+			scpi->ip_address, SCPI_RECONNECT_TRIES);
+	return -ENOTCONN;
+}
+
 /*
  * writes count bytes from the buffer (buf) to the
- * scpi instrument referred to by the descriptor *scpi.
+ * scpi instrument referred to by the descriptor *scpi,
+ * and reads the answer of a query into scpi->response.
+ * Only called from the instrument's worker thread.
  *
  * On success, the number of bytes written is returned
  * (zero indicates nothing was written).
- * On error, -1 is returned
+ * On error, a negative errno is returned
  */
-static ssize_t scpi_write(struct scpi_instrument *scpi, const void *buf, size_t count)
+static ssize_t scpi_transport_write(struct scpi_instrument *scpi,
+		const void *buf, size_t count)
 {
 	ssize_t retval = -1;
+	int ret;
+
+	if (scpi->simulated)
+		return scpi_sim_write(scpi, buf, count);
 
 	if (!scpi->network && !scpi->serial)
 		return -ENOENT;
 
-	if (scpi->network && !scpi->control_socket)
+	if (scpi->network && !scpi->control_socket && !scpi->model)
 		return -ENXIO;
 	else if (scpi->network) {
-		retval = send(scpi->control_socket, buf, count, 00);
+		/* Reconnect once if the instrument went away since the last command */
+		if (!scpi->control_socket && scpi_network_reconnect(scpi) < 0)
+			return -ENXIO;
+
+		retval = send(scpi->control_socket, buf, count, MSG_NOSIGNAL);
+		if (retval < 0 && (errno == EPIPE || errno == ECONNRESET)) {
+			if (scpi_network_reconnect(scpi) < 0)
+				return -ENXIO;
+			retval = send(scpi->control_socket, buf, count, MSG_NOSIGNAL);
+		}
+		if (retval < 0)
+			return -errno;
+
 		if (retval == (ssize_t)count && memchr(buf, '?', count)) {
-			memset(scpi->response, 0, SOCKETS_BUFFER_SIZE);
-			scpi_network_read(scpi);
+			ret = scpi_network_read(scpi);
+			if (ret < 0)
+				return ret;
 		}
 	}
 
@@ -487,6 +642,216 @@ static ssize_t scpi_write(struct scpi_instrument *scpi, const void *buf, size_t
 
 }
 
+/* Wait until all pending operations of the instrument have completed.
+ * This replaces fixed delays: the instrument answers as soon as it settled.
+ */
+static int scpi_transport_wait_opc(struct scpi_instrument *scpi)
+{
+	int ret;
+
+	if (scpi->simulated)
+		return 0;
+
+	if (scpi->network && scpi->control_socket) {
+		ret = send(scpi->control_socket, "*OPC?\n", 6, MSG_NOSIGNAL);
+		if (ret < 0)
+			return -errno;
+		ret = scpi_network_read_timeout(scpi, SCPI_OPC_TIMEOUT_MS);
+		if (ret == 0) {
+			/* A late answer would be taken as the reply to the
+			 * next query, start over on a fresh connection */
+			fprintf(stderr, "SCPI: %s: *OPC? timed out\n",
+					scpi->ip_address);
+			ret = scpi_network_reconnect(scpi);
+			return ret < 0 ? ret : -ETIMEDOUT;
+		}
+	} else {
+		ret = scpi_transport_write(scpi, "*OPC?\n", 6);
+	}
+	if (ret < 0)
+		return ret;
+
+	return atoi(scpi->response) == 1 ? 0 : -ETIMEDOUT;
+}
+
+static int scpi_transport_open(struct scpi_instrument *scpi)
+{
+	if (scpi->simulated)
+		return 0;
+	else if (scpi->network)
+		return network_connect(scpi);
+	else if (scpi->serial)
+		return tty_connect(scpi);
+
+	return -ENOENT;
+}
+
+/*
+ * Command queue
+ *
+ * Every instrument has a worker thread that owns its transport: connects,
+ * reconnects with their backoff and *OPC? waits of up to
+ * SCPI_OPC_TIMEOUT_MS all happen there. Settings are only queued, so the
+ * caller goes on while they reach the instrument back to back; queries,
+ * *OPC? and connects are waited for. Commands are run in the order they
+ * were queued, so an answer always belongs to the last query.
+ */
+
+enum scpi_op {
+	SCPI_OP_OPEN,
+	SCPI_OP_WRITE,
+	SCPI_OP_WAIT_OPC,
+	SCPI_OP_QUIT,
+};
+
+struct scpi_cmd {
+	enum scpi_op op;
+	gchar *buf;
+	size_t count;
+	bool wait;
+	bool done;
+	ssize_t ret;
+};
+
+static GMutex scpi_cmd_lock;
+static GCond scpi_cmd_cond;
+
+static gpointer scpi_worker(gpointer data)
+{
+	struct scpi_instrument *scpi = data;
+	struct scpi_cmd *cmd;
+	bool quit = false;
+
+	while (!quit) {
+		cmd = g_async_queue_pop(scpi->queue);
+
+		switch (cmd->op) {
+		case SCPI_OP_OPEN:
+			cmd->ret = scpi_transport_open(scpi);
+			break;
+		case SCPI_OP_WRITE:
+			cmd->ret = scpi_transport_write(scpi, cmd->buf, cmd->count);
+			break;
+		case SCPI_OP_WAIT_OPC:
+			cmd->ret = scpi_transport_wait_opc(scpi);
+			break;
+		case SCPI_OP_QUIT:
+			quit = true;
+			break;
+		}
+
+		if (!cmd->wait) {
+			/* Nobody is left to tell */
+			if (cmd->ret < 0)
+				fprintf(stderr, "SCPI: '%s' failed: %s\n",
+						g_strchomp(cmd->buf),
+						strerror(-cmd->ret));
+			g_free(cmd->buf);
+			g_free(cmd);
+			continue;
+		}
+
+		g_mutex_lock(&scpi_cmd_lock);
+		cmd->done = true;
+		g_cond_broadcast(&scpi_cmd_cond);
+		g_mutex_unlock(&scpi_cmd_lock);
+
+		/* A waiter on the GUI thread sits in the main loop */
+		g_main_context_wakeup(NULL);
+	}
+
+	return NULL;
+}
+
+static bool scpi_cmd_done(struct scpi_cmd *cmd)
+{
+	bool done;
+
+	g_mutex_lock(&scpi_cmd_lock);
+	done = cmd->done;
+	g_mutex_unlock(&scpi_cmd_lock);
+	return done;
+}
+
+static ssize_t scpi_submit(struct scpi_instrument *scpi, enum scpi_op op,
+		const void *buf, size_t count)
+{
+	struct scpi_cmd *cmd = g_new0(struct scpi_cmd, 1);
+	ssize_t ret;
+
+	if (!scpi->worker) {
+		scpi->queue = g_async_queue_new();
+		scpi->worker = g_thread_new("scpi", scpi_worker, scpi);
+	}
+
+	cmd->op = op;
+	if (buf) {
+		cmd->buf = g_strndup(buf, count);
+		cmd->count = count;
+	}
+	cmd->wait = op != SCPI_OP_WRITE || memchr(buf, '?', count);
+
+	/* Once queued, a setting belongs to the worker */
+	if (!cmd->wait) {
+		g_async_queue_push(scpi->queue, cmd);
+		return count;
+	}
+
+	g_async_queue_push(scpi->queue, cmd);
+
+	if (g_main_context_is_owner(g_main_context_default())) {
+		/* Keep the GUI alive while the instrument answers */
+		while (!scpi_cmd_done(cmd))
+			gtk_main_iteration();
+	} else {
+		g_mutex_lock(&scpi_cmd_lock);
+		while (!cmd->done)
+			g_cond_wait(&scpi_cmd_cond, &scpi_cmd_lock);
+		g_mutex_unlock(&scpi_cmd_lock);
+	}
+
+	ret = cmd->ret;
+	g_free(cmd->buf);
+	g_free(cmd);
+	return ret;
+}
+
+/* Lets the queued commands go out, then stops the worker */
+static void scpi_worker_stop(struct scpi_instrument *scpi)
+{
+	struct scpi_cmd *cmd;
+
+	if (!scpi->worker)
+		return;
+
+	cmd = g_new0(struct scpi_cmd, 1);
+	cmd->op = SCPI_OP_QUIT;
+	g_async_queue_push(scpi->queue, cmd);
+	g_thread_join(scpi->worker);
+	g_async_queue_unref(scpi->queue);
+	scpi->worker = NULL;
+	scpi->queue = NULL;
+}
+
+static ssize_t scpi_write(struct scpi_instrument *scpi, const void *buf, size_t count)
+{
+	if (!scpi->simulated && !scpi->network && !scpi->serial)
+		return -ENOENT;
+
+	return scpi_submit(scpi, SCPI_OP_WRITE, buf, count);
+}
+
+/* Wait until all pending operations of the instrument have completed */
+static int scpi_wait_opc(struct scpi_instrument *scpi)
+{
+	return scpi_submit(scpi, SCPI_OP_WAIT_OPC, NULL, 0);
+}
+
+static int scpi_open(struct scpi_instrument *scpi)
+{
+	return scpi_submit(scpi, SCPI_OP_OPEN, NULL, 0);
+}
+
 #define MAX_STR_SIZE 256
 
 static ssize_t scpi_fprintf(struct scpi_instrument *scpi, const char *str, ...)
@@ -528,8 +893,10 @@ static int scpi_connect(struct scpi_instrument *scpi)
 {
 	int ret;
 
-	if(scpi->network) {
-		ret = network_connect(scpi);
+	if (scpi->simulated) {
+		/* nothing to open */
+	} else if(scpi->network) {
+		ret = scpi_open(scpi);
 		if (ret != 0)
 			return ret;
 		if (scpi->control_socket != scpi->main_socket) {
@@ -540,15 +907,17 @@ static int scpi_connect(struct scpi_instrument *scpi)
 			}
 		}
 	} else if (scpi->serial) {
-		tty_connect(scpi);
+		scpi_open(scpi);
 	} else {
 		printf("misconfigured SCPI data structure\n");
 		return -1;
 	}
 
-	ret = scpi_fprintf(current_instrument, "*CLS;*RST;*IDN?\r\n");
+	ret = scpi_fprintf(scpi, "*CLS;*RST;*IDN?\r\n");
+	if (scpi->model)
+		free(scpi->model);
 	scpi->model = strdup(scpi->response);
-	if (!strstr(scpi->model, scpi->id_regex)) {
+	if (!scpi->simulated && !strstr(scpi->model, scpi->id_regex)) {
 		printf("instrument doesn't match regex\n");
 		printf("\twanted   : '%s'\n", scpi->id_regex);
 		printf("\treceived : '%s'\n", scpi->response);
@@ -564,7 +933,8 @@ static int scpi_connect(struct scpi_instrument *scpi)
 
 bool scpi_rx_connected(void)
 {
-	return (spectrum_analyzer.ttyfd != 0 || spectrum_analyzer.control_port != 0);
+	return (spectrum_analyzer.ttyfd != 0 || spectrum_analyzer.control_port != 0 ||
+			spectrum_analyzer.simulated);
 }
 
 void scpi_rx_trigger_sweep(void)
@@ -718,24 +1088,48 @@ static int scpi_query_errors(struct scpi_instrument *scpi)
 #endif
 
 /* Retrieve the plot markers related to a certain device. */
-static int get_markers(const char *device_ref, struct marker_type *markers)
+static int get_markers(const char *device_ref, struct marker_type **markers)
 {
 	OscPlot *fft_plot = plugin_find_plot_with_domain(FFT_PLOT);
 	int ret = 0;
 
 	do {
-		ret = plugin_data_capture_of_plot(fft_plot, device_ref, NULL, &markers);
+		ret = plugin_data_capture_of_plot(fft_plot, device_ref, NULL, markers);
 	} while (ret == -EBUSY);
 	return ret;
 }
 
+/* The level the seek closes its loop on: marker 1 of the AD9625 FFT plot.
+ * With the generator and the analyzer simulated, the simulated analyzer
+ * marker stands in for it, so the loop runs without the hardware. */
+static int mag_seek_measure(struct mag_seek *mag_seek, const char *device_ref,
+		struct marker_type **markers, double *lvl)
+{
+	int ret;
+
+	if (mag_seek->scpi->simulated && spectrum_analyzer.simulated)
+		return scpi_rx_get_marker_level(1, true, lvl) ? -EIO : 0;
+
+	if (!device_ref)
+		return -ENODEV;
+
+	/* The frame in flight may predate the new level, use the next one */
+	get_markers(device_ref, markers);
+	ret = get_markers(device_ref, markers);
+	if (ret < 0 || !*markers)
+		return ret < 0 ? ret : -ENODATA;
+
+	*lvl = (*markers)[0].y;
+	return 0;
+}
+
 /* Perform a binary search for a given magnitude in dBm when driving an input
  * signal into the AD9625.
  */
 static int tx_mag_seek_dBm(struct mag_seek *mag_seek)
 {
 	int ret = 0;
-	double dBm = 0;
+	double dBm = 0, lvl;
 	double difference = 1;
 	struct marker_type *markers = NULL;
 	const char *device_ref = NULL;
@@ -746,13 +1140,26 @@ static int tx_mag_seek_dBm(struct mag_seek *mag_seek)
 	while ((fabs(difference) > 0.01) && (dBm <= mag_seek->max_lvl)) {
 		tx_mag_set_dBm(mag_seek->scpi, dBm);
 		/* ret = scpi_query_errors(mag_seek->scpi); */
-		sleep(1);
-		get_markers(device_ref, markers);
-		difference = mag_seek->target_lvl - markers[0].y;
+		ret = scpi_wait_opc(mag_seek->scpi);
+		if (ret < 0) {
+			fprintf(stderr, "SCPI: %s: instrument not ready: %s\n",
+					__func__, strerror(-ret));
+			break;
+		}
+		ret = mag_seek_measure(mag_seek, device_ref, &markers, &lvl);
+		if (ret < 0) {
+			fprintf(stderr, "SCPI: %s: no measurement: %s\n",
+					__func__, strerror(-ret));
+			break;
+		}
+		difference = mag_seek->target_lvl - lvl;
 		dBm += difference / 2;
 	}
 
-	if ((dBm < mag_seek->min_lvl) || (dBm > mag_seek->max_lvl))
+	if (ret < 0)
+		/* anything but 0 lets mag_input_seek() go on */
+		dBm = NAN;
+	else if ((dBm < mag_seek->min_lvl) || (dBm > mag_seek->max_lvl))
 		ret = 1;
 
 	g_free(markers);
@@ -796,6 +1203,9 @@ int scpi_connect_counter(void)
 	current_instrument->id_regex = "";
 	current_instrument->response[0] = 0;
 
+	if (current_instrument->simulated)
+		return scpi_connect(current_instrument);
+
 	/* Iterate over tty dev nodes, trying to connect to a supported device. */
 	for (tty_node = 0; tty_node <= 9; tty_node++) {
 		current_instrument->tty_path[strlen(current_instrument->tty_path)-1] = (char)(tty_node + '0');
@@ -807,10 +1217,10 @@ int scpi_connect_counter(void)
 				do {
 					if (hameg_inputs[i] == NULL)
 						break;
+					/* commands run in order, the answer to
+					 * XMT? is for the new input */
 					scpi_fprintf(current_instrument, "%s\r\n", hameg_inputs[i++]);
-					sleep(1);
 					scpi_fprintf(current_instrument, "XMT?\r\n");
-					sleep(1);
 				} while (strstr(current_instrument->response, "Not Available"));
 			} else if (strstr(current_instrument->model, AGILENT_53131A)) {
 				/* reset the counter */
@@ -952,6 +1362,8 @@ static int scpi_handle(int line, const char *attrib, const char *value)
 		current_instrument->tty_path = strdup(value);
 	} else if (MATCH_ATTRIB("gpib_addr")) {
 		current_instrument->gpib_addr = atoi(value);
+	} else if (MATCH_ATTRIB("simulator")) {
+		current_instrument->simulated = !!atoi(value);
 	} else if (MATCH_ATTRIB("connect")) {
 		if (atoi(value) == 1)
 			return scpi_connect(current_instrument);
@@ -1180,9 +1592,11 @@ static void scpi_text_entry_cb (GtkEntry *box, int data)
 	}
 }
 
-static void init_scpi_device(struct scpi_instrument *device)
+static void init_scpi_device(struct scpi_instrument *device, const char *sim_id)
 {
 	memset(device, 0, sizeof(struct scpi_instrument));
+	device->sim_id = sim_id;
+	device->simulated = !!getenv("OSC_SCPI_SIMULATOR");
 	device->ip_address = strdup(DEFAULT_SCPI_IP_ADDR);
 	device->main_port = DEFAULT_SCPI_IP_PORT;
 	device->tty_path = strdup(DEFAULT_SCPI_TTY);
@@ -1197,36 +1611,45 @@ static void init_scpi_device(struct scpi_instrument *device)
 
 static void connect_clicked_cb(void)
 {
+	/* The GUI runs while connecting, current_instrument may change */
+	struct scpi_instrument *scpi = current_instrument;
+	static bool connecting;
 	int i, ret = -1;
 
-	if(current_instrument->network && current_instrument->ip_address) {
-		if (!current_instrument->main_port)
-			current_instrument->main_port = DEFAULT_SCPI_IP_PORT;
+	if (connecting)
+		return;
+	connecting = true;
 
-		ret = network_connect(current_instrument);
+	if (scpi->simulated) {
+		ret = 0;
+	} else if(scpi->network && scpi->ip_address) {
+		if (!scpi->main_port)
+			scpi->main_port = DEFAULT_SCPI_IP_PORT;
 
-	}
+		ret = scpi_open(scpi);
 
-	if(current_instrument->serial && current_instrument->tty_path) {
-		ret = tty_connect(current_instrument);
+	} else if(scpi->serial && scpi->tty_path) {
+		ret = scpi_open(scpi);
 	}
 
 	if (ret == 0) {
-		scpi_fprintf(current_instrument, "*CLS;*RST;*IDN?\r\n");
-		if (strlen(current_instrument->response)) {
-			current_instrument->model = current_instrument->response;
-			gtk_label_set_text(GTK_LABEL(scpi_id), current_instrument->response);
+		scpi_fprintf(scpi, "*CLS;*RST;*IDN?\r\n");
+		if (strlen(scpi->response)) {
+			if (scpi->model)
+				free(scpi->model);
+			scpi->model = strdup(scpi->response);
+			gtk_label_set_text(GTK_LABEL(scpi_id), scpi->response);
 			for (i = 0; supported_spectrum_analyzers[i] != NULL; i++) {
 				if (supported_spectrum_analyzers[i] &&
-							!strcmp(supported_spectrum_analyzers[i], current_instrument->response)) {
-					gtk_label_set_text(GTK_LABEL(scpi_regex), current_instrument->response);
+							!strcmp(supported_spectrum_analyzers[i], scpi->response)) {
+					gtk_label_set_text(GTK_LABEL(scpi_regex), scpi->response);
 					break;
 				}
 			}
 		}
 
-		if (current_instrument->id_regex)
-			gtk_entry_set_text(GTK_ENTRY(scpi_regex), current_instrument->id_regex);
+		if (scpi->id_regex)
+			gtk_entry_set_text(GTK_ENTRY(scpi_regex), scpi->id_regex);
 		else
 			gtk_entry_set_text(GTK_ENTRY(scpi_regex), "");
 		g_signal_emit_by_name(scpi_regex, "changed");
@@ -1234,6 +1657,7 @@ static void connect_clicked_cb(void)
 		gtk_widget_show(scpi_output);
 	}
 
+	connecting = false;
 }
 
 static void scpi_radio_cb (GtkRadioButton *button, int data)
@@ -1297,9 +1721,10 @@ static GtkWidget * scpi_init(GtkWidget *notebook, const char *ini_fn)
 	GtkWidget *scpi_play;
 	GtkWidget *tty_conf, *network_conf;
 
-	init_scpi_device(&signal_generator);
-	init_scpi_device(&spectrum_analyzer);
-	init_scpi_device(&prog_counter);
+	init_scpi_device(&signal_generator, SIM_GENERATOR_ID);
+	init_scpi_device(&spectrum_analyzer, SIM_ANALYZER_ID);
+	/* the counter code paths key off the model, so impersonate a real one */
+	init_scpi_device(&prog_counter, AGILENT_53131A);
 
 	builder = gtk_builder_new();
 	if (!gtk_builder_add_from_file(builder, "scpi.glade", NULL))
@@ -1387,24 +1812,28 @@ static void scpi_save_profile(const char *ini_fn)
 			"tx.ip_addr = %s\n"
 			"tx.tty_path = %s\n"
 			"tx.gpib_addr = %i\n"
+			"tx.simulator = %i\n"
 			"rx.serial = %i\n"
 			"rx.network = %i\n"
 			"rx.id_regex = %s\n"
 			"rx.ip_addr = %s\n"
 			"rx.tty_path = %s\n"
-			"rx.gpib_addr = %i\n",
+			"rx.gpib_addr = %i\n"
+			"rx.simulator = %i\n",
 			signal_generator.serial,
 			signal_generator.network,
 			signal_generator.id_regex,
 			signal_generator.ip_address,
 			signal_generator.tty_path,
 			signal_generator.gpib_addr,
+			signal_generator.simulated,
 			spectrum_analyzer.serial,
 			spectrum_analyzer.network,
 			spectrum_analyzer.id_regex,
 			spectrum_analyzer.ip_address,
 			spectrum_analyzer.tty_path,
-			spectrum_analyzer.gpib_addr);
+			spectrum_analyzer.gpib_addr,
+			spectrum_analyzer.simulated);
 	fwrite(buf, 1, strlen(buf), f);
 	fclose(f);
 }
@@ -1414,6 +1843,10 @@ static void scpi_destroy(const char *ini_fn)
 	if (ini_fn)
 		scpi_save_profile(ini_fn);
 
+	scpi_worker_stop(&signal_generator);
+	scpi_worker_stop(&spectrum_analyzer);
+	scpi_worker_stop(&prog_counter);
+
 	if (current_instrument) {
 		if (current_instrument->model)
 			free(current_instrument->model);
@@ -5,6 +5,7 @@
  *
  **/
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <gtk/gtk.h>
 #include <gtkdatabox.h>
@@ -64,6 +65,7 @@ typedef struct _fastlock_profile {
 	unsigned index;
 	long long frequency;
 	char data[66];
+	bool verified;
 } fastlock_profile;
 
 /* Plugin Global Variables */
@@ -80,6 +82,18 @@ static char *rx_fastlock_save_name;
 static GtkWidget *spectrum_window;
 static plugin_setup psetup;
 
+/* Fastlock profiles persisted across sessions, keyed by LO frequency. A
+ * recalled profile must bring the LO this close to where it was taken. */
+#define FASTLOCK_FREQ_TOLERANCE 1000 /* Hz */
+static GHashTable *fastlock_cache;
+static char *fastlock_cache_file;
+static bool fastlock_cache_dirty;
+
+/* Hop-to-settled statistics: from fastlock_recall until the next capture */
+static gint64 hop_start;
+static gint64 hop_sum_us, hop_max_us;
+static unsigned long long hop_count;
+
 /* Plugin Threads */
 static GThread *freq_sweep_thread;
 static GThread *capture_thread;
@@ -289,6 +303,161 @@ static bool plugin_gather_user_setup(plugin_setup *setup)
 	return data_is_new;
 }
 
+/* Serial number of the board if the context has one, its URI otherwise */
+static gchar * fastlock_board_id(void)
+{
+	const char *id;
+
+	id = iio_context_get_attr_value(ctx, "hw_serial");
+	if (!id)
+		id = usb_get_serialnumber(ctx);
+	if (!id)
+		id = iio_context_get_attr_value(ctx, "uri");
+	if (!id)
+		id = iio_context_get_name(ctx);
+
+	return g_strcanon(g_strdup(id), G_CSET_A_2_Z G_CSET_a_2_z
+			G_CSET_DIGITS "-_.", '_');
+}
+
+/* The profiles depend on the board (its VCO calibration), its reference
+ * clock and the LO frequency, so the cache file is named after the first
+ * two. */
+static void fastlock_cache_init(void)
+{
+	long long ref_clk = 0;
+	gchar *name, *dir, *board;
+
+	iio_device_attr_read_longlong(dev, "xo_correction", &ref_clk);
+
+	dir = g_build_filename(g_get_user_cache_dir(), "osc", NULL);
+	g_mkdir_with_parents(dir, 0755);
+	board = fastlock_board_id();
+	name = g_strdup_printf("fastlock-%s-%s-%s-%lld.txt", PHY_DEVICE,
+			board, rx_fastlock_save_name, ref_clk);
+	g_free(board);
+	fastlock_cache_file = g_build_filename(dir, name, NULL);
+	g_free(name);
+	g_free(dir);
+
+	fastlock_cache = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+			g_free, g_free);
+	fastlock_cache_dirty = false;
+}
+
+static void fastlock_cache_load(void)
+{
+	char line[128], data[66];
+	long long freq;
+	gint64 *key;
+	FILE *fp;
+
+	fp = fopen(fastlock_cache_file, "r");
+	if (!fp)
+		return;
+
+	/* "<freq> <slot> <values>", the profile itself contains a space.
+	 * Entries without any value are left from a broken save: skip them. */
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "%lld %65[^\n]", &freq, data) != 2 ||
+				!strchr(data, ','))
+			continue;
+		key = g_new(gint64, 1);
+		*key = freq;
+		g_hash_table_replace(fastlock_cache, key, g_strdup(data));
+	}
+
+	fclose(fp);
+}
+
+static void fastlock_cache_save(void)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	FILE *fp;
+
+	if (!fastlock_cache_dirty)
+		return;
+
+	fp = fopen(fastlock_cache_file, "w");
+	if (!fp) {
+		fprintf(stderr, "Could not write fastlock cache %s: %s\n",
+				fastlock_cache_file, strerror(errno));
+		return;
+	}
+
+	g_hash_table_iter_init(&iter, fastlock_cache);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+		fprintf(fp, "%lld %s\n", (long long)*(gint64 *)key,
+				(char *)value);
+
+	fclose(fp);
+	fastlock_cache_dirty = false;
+}
+
+static void fastlock_cache_destroy(void)
+{
+	if (!fastlock_cache)
+		return;
+
+	fastlock_cache_save();
+	g_hash_table_destroy(fastlock_cache);
+	fastlock_cache = NULL;
+	g_free(fastlock_cache_file);
+	fastlock_cache_file = NULL;
+}
+
+/* Tune the LO once and read back the profile, unless it is cached.
+ * Returns true for a cached profile, which still has to be verified. */
+static bool fastlock_profile_get(long long freq, char *data, size_t len)
+{
+	const char *cached;
+	gint64 *key;
+
+	cached = g_hash_table_lookup(fastlock_cache, &freq);
+	if (cached) {
+		snprintf(data, len, "%s", cached);
+		return true;
+	}
+
+	iio_channel_attr_write_longlong(alt_ch0, "frequency", freq);
+	iio_channel_attr_write_longlong(alt_ch0, rx_fastlock_store_name, 0);
+	if (iio_channel_attr_read(alt_ch0, rx_fastlock_save_name,
+				data, len) <= 0) {
+		data[0] = '\0';
+		return false;
+	}
+	g_strchomp(data);
+
+	key = g_new(gint64, 1);
+	*key = freq;
+	g_hash_table_replace(fastlock_cache, key, g_strdup(data));
+	fastlock_cache_dirty = true;
+	return false;
+}
+
+/* Called right after the profile was recalled. One that doesn't bring the
+ * LO where it was taken is stale (other board, driver or calibration):
+ * it is dropped from the cache, so the next sweep asks the device again.
+ * The sweep threads are the only users of the cache while they run. */
+static void fastlock_profile_verify(fastlock_profile *profile)
+{
+	gint64 key = profile->frequency;
+	long long freq;
+
+	profile->verified = true;
+	if (iio_channel_attr_read_longlong(alt_ch0, "frequency", &freq) < 0)
+		return;
+	if (llabs(freq - profile->frequency) <= FASTLOCK_FREQ_TOLERANCE)
+		return;
+
+	fprintf(stderr, "Spectrum Analyzer: cached fastlock profile for "
+			"%lld Hz tunes to %lld Hz, dropping it\n",
+			profile->frequency, freq);
+	g_hash_table_remove(fastlock_cache, &key);
+	fastlock_cache_dirty = true;
+}
+
 static void build_profiles_for_entire_sweep(plugin_setup *setup)
 {
 	double start, stop, step, f;
@@ -296,10 +465,13 @@ static void build_profiles_for_entire_sweep(plugin_setup *setup)
 	static unsigned char prev_alc = 0;
 	unsigned char alc;
 	char *last_byte;
-	unsigned int i = 0;
+	unsigned int i = 0, cached;
+	gint64 t_start = g_get_monotonic_time();
 
 	g_return_if_fail(setup);
 
+	cached = g_hash_table_size(fastlock_cache);
+
 	/* Clear any previous profiles */
 	g_slist_free_full(setup->rx_profiles, (GDestroyNotify)free);
 	setup->rx_profiles = NULL;
@@ -309,23 +481,22 @@ static void build_profiles_for_entire_sweep(plugin_setup *setup)
 	step = sweep_freq_step;
 
 	for (f = start; (f - sweep_freq_step / 2) < stop; f += step) {
-		iio_channel_attr_write_longlong(alt_ch0, "frequency",
-				(long long)MHZ_TO_HZ(f));
-		iio_channel_attr_write_longlong(alt_ch0,
-					rx_fastlock_store_name, 0);
 		profile = malloc(sizeof(fastlock_profile));
 		if (!profile)
 			return;
-		iio_channel_attr_read(alt_ch0, rx_fastlock_save_name,
-					profile->data, sizeof(profile->data));
 		profile->frequency = (long long)MHZ_TO_HZ(f);
+		profile->verified = !fastlock_profile_get(profile->frequency,
+				profile->data, sizeof(profile->data));
 		profile->index = i++;
 		setup->rx_profiles = g_slist_prepend(setup->rx_profiles, profile);
 
 		/* Make sure two consecutive profiles do not have the same ALC.
 		 * Disregard the LBS of the ALC when comparing.
 		   More on: https://ez.analog.com/message/151702#151702 */
-		last_byte = g_strrstr(profile->data, ",") + 1;
+		last_byte = g_strrstr(profile->data, ",");
+		if (!last_byte)
+			continue;
+		last_byte++;
 		alc = atoi(last_byte);
 		if (abs(alc - prev_alc) < 2)
 			alc += 2;
@@ -335,6 +506,12 @@ static void build_profiles_for_entire_sweep(plugin_setup *setup)
 	}
 	setup->rx_profiles = g_slist_reverse(setup->rx_profiles);
 	setup->profile_count = g_slist_length(setup->rx_profiles);
+
+	cached = g_hash_table_size(fastlock_cache) - cached;
+	printf("Spectrum Analyzer: %u fastlock profiles (%u new) in %.1f ms\n",
+			setup->profile_count, cached,
+			(g_get_monotonic_time() - t_start) / 1000.0);
+	fastlock_cache_save();
 	#if DEBUG
 	log_before_sweep_starts(setup);
 	#endif
@@ -519,7 +696,17 @@ static gpointer profile_load_thread_func(plugin_setup *setup)
 		if (kill_sweep_thread)
 			break;
 
+		if (hop_start) {
+			gint64 hop = g_get_monotonic_time() - hop_start;
+
+			hop_sum_us += hop;
+			if (hop > hop_max_us)
+				hop_max_us = hop;
+			hop_count++;
+		}
+
 		/* Recall profile at slot 0 or 1 (alternative) */
+		hop_start = g_get_monotonic_time();
 		ret = iio_channel_attr_write_longlong(alt_ch0,
 			"fastlock_recall", setup->profile_slot);
 		setup->profile_slot = (setup->profile_slot + 1) % 2;
@@ -528,6 +715,8 @@ static gpointer profile_load_thread_func(plugin_setup *setup)
 		if (ret < 0)
 		fprintf(stderr, "Could not write to fastlock_recall"
 			"attribute in %s\n", __func__);
+		else if (!((fastlock_profile *)node->data)->verified)
+			fastlock_profile_verify(node->data);
 
 		/* Signal the "Data Capture" thread that a new profile has been applied */
 		g_mutex_lock(&profile_applied_mutex);
@@ -663,11 +852,19 @@ static bool setup_before_sweep_start(plugin_setup *setup)
 			"attribute in %s. %s\n", __func__, strerror(ret));
 		goto fail;
 	}
+	profile = setup->rx_profiles ? setup->rx_profiles->data : NULL;
+	if (profile && !profile->verified)
+		fastlock_profile_verify(profile);
 
 	kill_capture_thread = false;
 	kill_sweep_thread = false;
 	kill_fft_thread = false;
 
+	hop_start = 0;
+	hop_sum_us = 0;
+	hop_max_us = 0;
+	hop_count = 0;
+
 	capture_done = false;
 	profile_applied = false;
 	demux_done = false;
@@ -739,6 +936,11 @@ static void stop_sweep_clicked(GtkButton *btn, gpointer data)
 		capture_buffer = NULL;
 	}
 
+	if (hop_count)
+		printf("Spectrum Analyzer: %llu hops, hop-to-settled "
+			"average %.1f us, max %lld us\n", hop_count,
+			(double)hop_sum_us / hop_count, (long long)hop_max_us);
+
 	gtk_widget_set_sensitive(GTK_WIDGET(start_button), true);
 #if DEBUG
 fprintf(stderr, "Average Sweep Duration: %f\n", loop_durations_sum / loop_count);
@@ -812,6 +1014,9 @@ static GtkWidget * analyzer_init(GtkWidget *notebook, const char *ini_fn)
 	else
 		rx_fastlock_save_name = "RX_LO_fastlock_save";
 
+	fastlock_cache_init();
+	fastlock_cache_load();
+
 	builder = gtk_builder_new();
 	nbook = GTK_NOTEBOOK(notebook);
 
@@ -884,6 +1089,7 @@ static void context_destroy(const char *ini_fn)
 		capture_buffer = NULL;
 	}
 	g_source_remove_by_user_data(ctx);
+	fastlock_cache_destroy();
 
 	osc_destroy_context(ctx);
 }
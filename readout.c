@@ -0,0 +1,124 @@
+/**
+ * Copyright (C) 2019 Analog Devices, Inc.
+ *
+ * Licensed under the GPL-2.
+ *
+ **/
+#include <glib.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "readout.h"
+
+struct text_readout {
+	GtkTextBuffer *buf;
+	GPtrArray *lines;	/* text of each line */
+	GArray *dirty;		/* lines changed since the last flush */
+	unsigned int nb_lines;	/* lines written in the current frame */
+	unsigned int buf_lines;	/* lines in the text buffer */
+};
+
+struct text_readout * text_readout_new(GtkTextView *view)
+{
+	struct text_readout *r = g_new0(struct text_readout, 1);
+
+	r->buf = g_object_ref(gtk_text_view_get_buffer(view));
+	gtk_text_buffer_set_text(r->buf, "", -1);
+	r->lines = g_ptr_array_new_with_free_func(g_free);
+	r->dirty = g_array_new(FALSE, TRUE, sizeof(gboolean));
+
+	return r;
+}
+
+void text_readout_free(struct text_readout *r)
+{
+	if (!r)
+		return;
+
+	g_ptr_array_free(r->lines, TRUE);
+	g_array_free(r->dirty, TRUE);
+	g_object_unref(r->buf);
+	g_free(r);
+}
+
+void text_readout_begin(struct text_readout *r)
+{
+	r->nb_lines = 0;
+}
+
+/* Lines can't hold a '\n', a frame that needs more lines adds more of them */
+void text_readout_add(struct text_readout *r, const char *fmt, ...)
+{
+	unsigned int i = r->nb_lines++;
+	char text[256];
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(text, sizeof(text), fmt, ap);
+	va_end(ap);
+
+	if (i < r->lines->len) {
+		if (!strcmp(g_ptr_array_index(r->lines, i), text))
+			return;
+		g_free(g_ptr_array_index(r->lines, i));
+		g_ptr_array_index(r->lines, i) = g_strdup(text);
+	} else {
+		g_ptr_array_add(r->lines, g_strdup(text));
+		g_array_set_size(r->dirty, r->lines->len);
+	}
+
+	g_array_index(r->dirty, gboolean, i) = TRUE;
+}
+
+void text_readout_end(struct text_readout *r)
+{
+	GtkTextIter start, end;
+	unsigned int i;
+
+	for (i = 0; i < r->nb_lines; i++) {
+		if (!g_array_index(r->dirty, gboolean, i))
+			continue;
+		g_array_index(r->dirty, gboolean, i) = FALSE;
+
+		if (i < r->buf_lines) {
+			gtk_text_buffer_get_iter_at_line(r->buf, &start, i);
+			end = start;
+			if (!gtk_text_iter_ends_line(&end))
+				gtk_text_iter_forward_to_line_end(&end);
+			gtk_text_buffer_delete(r->buf, &start, &end);
+		} else {
+			/* New lines come in order, this one goes last */
+			gtk_text_buffer_get_end_iter(r->buf, &start);
+			if (i)
+				gtk_text_buffer_insert(r->buf, &start, "\n", 1);
+			r->buf_lines++;
+		}
+		gtk_text_buffer_insert(r->buf, &start,
+				g_ptr_array_index(r->lines, i), -1);
+	}
+
+	if (r->nb_lines < r->buf_lines) {
+		if (r->nb_lines) {
+			gtk_text_buffer_get_iter_at_line(r->buf, &start,
+					r->nb_lines - 1);
+			if (!gtk_text_iter_ends_line(&start))
+				gtk_text_iter_forward_to_line_end(&start);
+		} else {
+			gtk_text_buffer_get_start_iter(r->buf, &start);
+		}
+		gtk_text_buffer_get_end_iter(r->buf, &end);
+		gtk_text_buffer_delete(r->buf, &start, &end);
+
+		r->buf_lines = r->nb_lines;
+		g_ptr_array_set_size(r->lines, r->nb_lines);
+		g_array_set_size(r->dirty, r->nb_lines);
+	}
+}
+
+void text_readout_set_text(struct text_readout *r, const char *text)
+{
+	text_readout_begin(r);
+	text_readout_add(r, "%s", text);
+	text_readout_end(r);
+}
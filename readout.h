@@ -0,0 +1,37 @@
+/**
+ * Copyright (C) 2019 Analog Devices, Inc.
+ *
+ * Licensed under the GPL-2.
+ *
+ **/
+
+#ifndef __READOUT_H__
+#define __READOUT_H__
+
+#include <gtk/gtk.h>
+
+/*
+ * Line based text readout for values refreshed at the plot rate (marker
+ * values, DMM readings).
+ *
+ * A frame is written between text_readout_begin() and text_readout_end(),
+ * one line per text_readout_add(). Lines are kept as last formatted, so
+ * the text view is only touched for lines whose text changed, that is
+ * values that moved by at least their display precision, and all of a
+ * frame's edits are applied at once when it ends. Lines that stay the same
+ * keep their layout in the text view.
+ */
+
+struct text_readout;
+
+struct text_readout * text_readout_new(GtkTextView *view);
+void text_readout_free(struct text_readout *r);
+
+void text_readout_begin(struct text_readout *r);
+void text_readout_add(struct text_readout *r, const char *fmt, ...)
+	G_GNUC_PRINTF(2, 3);
+void text_readout_end(struct text_readout *r);
+
+void text_readout_set_text(struct text_readout *r, const char *text);
+
+#endif /* __READOUT_H__ */